@@ -0,0 +1,389 @@
+/* Gamma-corrected LED dimming effects on LEDC
+ *
+ * An effect is a list of keyframes (target level, share of the period).
+ * Moving between keyframes walks the gamma table one level at a time and
+ * each step is a single linear LEDC hardware fade, so the CPU only runs
+ * when a fade ends: the fade-end ISR queues the LED and the service task
+ * starts the next segment. Holds at a constant level use a one-shot
+ * esp_timer instead of a fade.
+ */
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "driver/ledc.h"
+#include "driver/gptimer.h"
+#include "esp_timer.h"
+#include "esp_cpu.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "soc/soc.h"
+#include "soc/gpio_reg.h"
+#include "led_breathe.h"
+
+static const char *TAG = "LED_BREATHE";
+
+#define LEDC_DUTY_RES       LEDC_TIMER_13_BIT
+#define SERVICE_TASK_PRIO   5
+#define SERVICE_QUEUE_LEN   (LED_BREATHE_MAX_LEDS * 2)
+
+// Gamma 2.8 correction, perceptual level -> 13-bit duty
+static const uint16_t gamma_duty[LED_BREATHE_LEVELS + 1] = {
+    0, 3, 24, 75, 169, 315, 526, 809, 1176,
+    1636, 2197, 2869, 3660, 4580, 5636, 6837, 8191
+};
+
+// Gamma 2.8 correction, perceptual level -> 8-bit software PWM duty.
+// Read by the software PWM ISR, so it lives in DRAM, not flash rodata.
+static const DRAM_ATTR uint8_t gamma_duty8[LED_BREATHE_LEVELS + 1] = {
+    0, 0, 1, 2, 5, 10, 16, 25, 37,
+    51, 68, 89, 114, 143, 175, 213, 255
+};
+
+// Keyframe: reach level within permille of the effect period
+typedef struct {
+    uint8_t level;
+    uint16_t permille;
+} keyframe_t;
+
+static const keyframe_t breathe_frames[] = {
+    { LED_BREATHE_LEVELS, 500 },
+    { 0, 500 }
+};
+
+static const keyframe_t heartbeat_frames[] = {
+    { LED_BREATHE_LEVELS, 80 },
+    { 6, 100 },
+    { LED_BREATHE_LEVELS, 80 },
+    { 0, 240 },
+    { 0, 500 }      // Rest
+};
+
+// Per-LED effect state
+typedef struct {
+    ledc_mode_t mode;
+    ledc_channel_t channel;
+    const keyframe_t *frames;
+    uint8_t num_frames;
+    uint8_t frame;          // Active keyframe
+    uint8_t level;          // Level reached by the running segment
+    uint32_t period_ms;
+    uint32_t seg_ms;        // Fade time of each segment of the active ramp
+    esp_timer_handle_t hold_timer;
+} breathe_led_t;
+
+static breathe_led_t leds[LED_BREATHE_MAX_LEDS];
+static int num_leds = 0;
+static QueueHandle_t service_queue = NULL;
+static led_breathe_stats_t stats;
+static portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static IRAM_ATTR void add_cycles(uint32_t cycles, uint32_t segments)
+{
+    portENTER_CRITICAL_SAFE(&stats_lock);
+    stats.total_cycles += cycles;
+    stats.segments += segments;
+    portEXIT_CRITICAL_SAFE(&stats_lock);
+}
+
+static IRAM_ATTR bool fade_end_cb(const ledc_cb_param_t *param, void *user_arg)
+{
+    uint32_t start = esp_cpu_get_cycle_count();
+    BaseType_t woken = pdFALSE;
+    uint8_t id = (uint8_t)(uintptr_t)user_arg;
+
+    if (param->event == LEDC_FADE_END_EVT) {
+        xQueueSendFromISR(service_queue, &id, &woken);
+    }
+    add_cycles(esp_cpu_get_cycle_count() - start, 0);
+    return woken == pdTRUE;
+}
+
+static void hold_end_cb(void *arg)
+{
+    uint8_t id = (uint8_t)(uintptr_t)arg;
+    xQueueSend(service_queue, &id, 0);
+}
+
+// Segment time for a ramp from the current level to kf: the keyframe's
+// share of the period split evenly over its steps, fixed when the ramp
+// begins so every segment of it is the same length
+static uint32_t ramp_seg_ms(const breathe_led_t *led, const keyframe_t *kf)
+{
+    uint32_t frame_ms = led->period_ms * kf->permille / 1000;
+    int steps = (kf->level > led->level) ? kf->level - led->level : led->level - kf->level;
+    uint32_t seg_ms = (steps > 0) ? frame_ms / steps : frame_ms;
+    return (seg_ms < 1) ? 1 : seg_ms;
+}
+
+static void start_segment(breathe_led_t *led)
+{
+    // Advance to the next keyframe once the current target is reached
+    const keyframe_t *kf = &led->frames[led->frame];
+    if (led->level == kf->level) {
+        led->frame = (led->frame + 1) % led->num_frames;
+        kf = &led->frames[led->frame];
+        led->seg_ms = ramp_seg_ms(led, kf);
+    }
+
+    if (led->level == kf->level) {
+        // Constant level: hold without touching the LEDC
+        uint32_t frame_ms = led->period_ms * kf->permille / 1000;
+        esp_timer_start_once(led->hold_timer, (uint64_t)frame_ms * 1000);
+        return;
+    }
+
+    led->level += (kf->level > led->level) ? 1 : -1;
+
+    ledc_set_fade_with_time(led->mode, led->channel, gamma_duty[led->level], led->seg_ms);
+    ledc_fade_start(led->mode, led->channel, LEDC_FADE_NO_WAIT);
+}
+
+static void service_task(void *arg)
+{
+    uint8_t id;
+    while (1) {
+        if (xQueueReceive(service_queue, &id, portMAX_DELAY) == pdTRUE) {
+            uint32_t start = esp_cpu_get_cycle_count();
+            start_segment(&leds[id]);
+            add_cycles(esp_cpu_get_cycle_count() - start, 1);
+        }
+    }
+}
+
+esp_err_t led_breathe_init(void)
+{
+    // One timer per speed mode shared by all channels of that mode
+    ledc_timer_config_t ledc_timer = {
+        .speed_mode       = LEDC_LOW_SPEED_MODE,
+        .timer_num        = LEDC_TIMER_0,
+        .duty_resolution  = LEDC_DUTY_RES,
+        .freq_hz          = LED_BREATHE_PWM_FREQ,
+        .clk_cfg          = LEDC_AUTO_CLK
+    };
+    ESP_ERROR_CHECK(ledc_timer_config(&ledc_timer));
+#if SOC_LEDC_SUPPORT_HS_MODE
+    ledc_timer.speed_mode = LEDC_HIGH_SPEED_MODE;
+    ESP_ERROR_CHECK(ledc_timer_config(&ledc_timer));
+#endif
+    ESP_ERROR_CHECK(ledc_fade_func_install(0));
+
+    service_queue = xQueueCreate(SERVICE_QUEUE_LEN, sizeof(uint8_t));
+    if (service_queue == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    if (xTaskCreate(service_task, "led_breathe", 3072, NULL, SERVICE_TASK_PRIO, NULL) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(TAG, "Initialized: %d channels, %d gamma levels", LED_BREATHE_MAX_LEDS, LED_BREATHE_LEVELS);
+    return ESP_OK;
+}
+
+esp_err_t led_breathe_add(gpio_num_t pin, led_effect_t effect, uint32_t period_ms)
+{
+    if (num_leds >= LED_BREATHE_MAX_LEDS) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    int id = num_leds;
+    breathe_led_t *led = &leds[id];
+    memset(led, 0, sizeof(*led));
+    led->mode = (id < SOC_LEDC_CHANNEL_NUM) ? LEDC_LOW_SPEED_MODE : LEDC_HIGH_SPEED_MODE;
+    led->channel = (ledc_channel_t)(id % SOC_LEDC_CHANNEL_NUM);
+    led->period_ms = period_ms;
+    if (effect == LED_EFFECT_HEARTBEAT) {
+        led->frames = heartbeat_frames;
+        led->num_frames = sizeof(heartbeat_frames) / sizeof(heartbeat_frames[0]);
+    } else {
+        led->frames = breathe_frames;
+        led->num_frames = sizeof(breathe_frames) / sizeof(breathe_frames[0]);
+    }
+    led->seg_ms = ramp_seg_ms(led, &led->frames[0]);
+
+    ledc_channel_config_t ledc_channel = {
+        .speed_mode     = led->mode,
+        .channel        = led->channel,
+        .timer_sel      = LEDC_TIMER_0,
+        .intr_type      = LEDC_INTR_DISABLE,
+        .gpio_num       = pin,
+        .duty           = 0,
+        .hpoint         = 0
+    };
+    esp_err_t ret = ledc_channel_config(&ledc_channel);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to configure LEDC channel: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    ledc_cbs_t callbacks = {
+        .fade_cb = fade_end_cb
+    };
+    ESP_ERROR_CHECK(ledc_cb_register(led->mode, led->channel, &callbacks, (void *)(uintptr_t)id));
+
+    esp_timer_create_args_t hold_args = {
+        .callback = hold_end_cb,
+        .arg = (void *)(uintptr_t)id,
+        .name = "led_hold"
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&hold_args, &led->hold_timer));
+
+    num_leds++;
+    // Kick off the first segment from the service task
+    uint8_t qid = id;
+    xQueueSend(service_queue, &qid, portMAX_DELAY);
+
+    ESP_LOGI(TAG, "LED %d on GPIO%d: %s, period %lu ms", id, pin,
+             effect == LED_EFFECT_HEARTBEAT ? "heartbeat" : "breathe", (unsigned long)period_ms);
+    return ESP_OK;
+}
+
+void led_breathe_get_stats(led_breathe_stats_t *out)
+{
+    portENTER_CRITICAL(&stats_lock);
+    *out = stats;
+    portEXIT_CRITICAL(&stats_lock);
+}
+
+void led_breathe_reset_stats(void)
+{
+    portENTER_CRITICAL(&stats_lock);
+    memset(&stats, 0, sizeof(stats));
+    portEXIT_CRITICAL(&stats_lock);
+}
+
+/* Software PWM reference
+ * A 20 kHz GPTimer ISR runs an 8-bit PWM counter (78 Hz frame) for every
+ * LED and recomputes the breathing duty at the start of each frame.
+ */
+#define SOFT_TICK_US        50
+#define SOFT_FRAME_TICKS    256
+
+typedef struct {
+    uint32_t mask_lo;
+    uint32_t mask_hi;
+    uint8_t duty;
+} soft_led_t;
+
+static soft_led_t soft_leds[LED_BREATHE_MAX_LEDS];
+static int soft_count = 0;
+static uint32_t soft_frames_per_period = 1;
+static uint32_t soft_frame = 0;
+static uint32_t soft_tick = 0;
+static gptimer_handle_t soft_timer = NULL;
+static led_breathe_stats_t soft_stats;
+
+static IRAM_ATTR uint8_t soft_breathe_duty(uint32_t frame, int id)
+{
+    // Triangle in perceptual space, stagger LEDs so they don't move in lockstep
+    uint32_t span = LED_BREATHE_LEVELS * 256;
+    uint32_t pos = ((frame + id * soft_frames_per_period / LED_BREATHE_MAX_LEDS) % soft_frames_per_period)
+                   * 2 * span / soft_frames_per_period;
+    if (pos > span) {
+        pos = 2 * span - pos;
+    }
+    uint32_t level = pos >> 8;
+    uint32_t frac = pos & 0xFF;
+    if (level >= LED_BREATHE_LEVELS) {
+        return gamma_duty8[LED_BREATHE_LEVELS];
+    }
+    return gamma_duty8[level] + (((gamma_duty8[level + 1] - gamma_duty8[level]) * frac) >> 8);
+}
+
+static IRAM_ATTR bool soft_pwm_isr(gptimer_handle_t timer, const gptimer_alarm_event_data_t *edata, void *user_ctx)
+{
+    uint32_t start = esp_cpu_get_cycle_count();
+    uint32_t phase = soft_tick++ % SOFT_FRAME_TICKS;
+    uint32_t set_lo = 0, set_hi = 0, clr_lo = 0, clr_hi = 0;
+
+    if (phase == 0) {
+        // New frame: update duties and switch on every non-dark LED
+        for (int i = 0; i < soft_count; i++) {
+            soft_leds[i].duty = soft_breathe_duty(soft_frame, i);
+            if (soft_leds[i].duty) {
+                set_lo |= soft_leds[i].mask_lo;
+                set_hi |= soft_leds[i].mask_hi;
+            }
+        }
+        soft_frame++;
+    } else {
+        for (int i = 0; i < soft_count; i++) {
+            if (soft_leds[i].duty == phase) {
+                clr_lo |= soft_leds[i].mask_lo;
+                clr_hi |= soft_leds[i].mask_hi;
+            }
+        }
+    }
+    REG_WRITE(GPIO_OUT_W1TS_REG, set_lo);
+    REG_WRITE(GPIO_OUT1_W1TS_REG, set_hi);
+    REG_WRITE(GPIO_OUT_W1TC_REG, clr_lo);
+    REG_WRITE(GPIO_OUT1_W1TC_REG, clr_hi);
+
+    soft_stats.segments++;
+    soft_stats.total_cycles += esp_cpu_get_cycle_count() - start;
+    return false;
+}
+
+esp_err_t led_breathe_soft_start(const gpio_num_t *pins, int count, uint32_t period_ms)
+{
+    if (count > LED_BREATHE_MAX_LEDS || soft_timer != NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    for (int i = 0; i < count; i++) {
+        gpio_reset_pin(pins[i]);
+        gpio_set_direction(pins[i], GPIO_MODE_OUTPUT);
+        soft_leds[i].mask_lo = (pins[i] < 32) ? (1u << pins[i]) : 0;
+        soft_leds[i].mask_hi = (pins[i] >= 32) ? (1u << (pins[i] - 32)) : 0;
+        soft_leds[i].duty = 0;
+    }
+    soft_count = count;
+    soft_frames_per_period = period_ms * 1000 / (SOFT_TICK_US * SOFT_FRAME_TICKS);
+    if (soft_frames_per_period == 0) {
+        soft_frames_per_period = 1;
+    }
+    soft_frame = 0;
+    soft_tick = 0;
+    memset(&soft_stats, 0, sizeof(soft_stats));
+
+    gptimer_config_t timer_config = {
+        .clk_src = GPTIMER_CLK_SRC_DEFAULT,
+        .direction = GPTIMER_COUNT_UP,
+        .resolution_hz = 1000000
+    };
+    ESP_ERROR_CHECK(gptimer_new_timer(&timer_config, &soft_timer));
+    gptimer_event_callbacks_t callbacks = {
+        .on_alarm = soft_pwm_isr
+    };
+    ESP_ERROR_CHECK(gptimer_register_event_callbacks(soft_timer, &callbacks, NULL));
+    gptimer_alarm_config_t alarm = {
+        .alarm_count = SOFT_TICK_US,
+        .reload_count = 0,
+        .flags.auto_reload_on_alarm = true
+    };
+    ESP_ERROR_CHECK(gptimer_set_alarm_action(soft_timer, &alarm));
+    ESP_ERROR_CHECK(gptimer_enable(soft_timer));
+    return gptimer_start(soft_timer);
+}
+
+esp_err_t led_breathe_soft_stop(void)
+{
+    if (soft_timer == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    gptimer_stop(soft_timer);
+    gptimer_disable(soft_timer);
+    gptimer_del_timer(soft_timer);
+    soft_timer = NULL;
+
+    for (int i = 0; i < soft_count; i++) {
+        REG_WRITE(GPIO_OUT_W1TC_REG, soft_leds[i].mask_lo);
+        REG_WRITE(GPIO_OUT1_W1TC_REG, soft_leds[i].mask_hi);
+    }
+    return ESP_OK;
+}
+
+void led_breathe_soft_get_stats(led_breathe_stats_t *out)
+{
+    *out = soft_stats;
+}
@@ -0,0 +1,41 @@
+/* Gamma-corrected LED dimming effects on LEDC
+ * Brightness curves are played as chains of LEDC hardware fades between
+ * points of a gamma-correction table, one LEDC channel per LED.
+ */
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "driver/gpio.h"
+#include "soc/soc_caps.h"
+
+// One LED per LEDC channel, high-speed channels included where available
+#if SOC_LEDC_SUPPORT_HS_MODE
+#define LED_BREATHE_MAX_LEDS    (SOC_LEDC_CHANNEL_NUM * 2)
+#else
+#define LED_BREATHE_MAX_LEDS    SOC_LEDC_CHANNEL_NUM
+#endif
+
+#define LED_BREATHE_PWM_FREQ    5000    // LEDC PWM frequency (Hz)
+#define LED_BREATHE_LEVELS      16      // Perceptual brightness steps (table has LEVELS + 1 points)
+
+typedef enum {
+    LED_EFFECT_BREATHE,     // Smooth fade in and out
+    LED_EFFECT_HEARTBEAT    // Double pulse followed by a pause
+} led_effect_t;
+
+// CPU cycles spent servicing effects (fade-end ISR + service task)
+typedef struct {
+    uint32_t segments;      // Hardware fades started
+    uint64_t total_cycles;  // Cycles spent in effect code
+} led_breathe_stats_t;
+
+esp_err_t led_breathe_init(void);
+esp_err_t led_breathe_add(gpio_num_t pin, led_effect_t effect, uint32_t period_ms);
+void led_breathe_get_stats(led_breathe_stats_t *stats);
+void led_breathe_reset_stats(void);
+
+// Software PWM reference: same curves generated by a timer ISR toggling GPIOs
+esp_err_t led_breathe_soft_start(const gpio_num_t *pins, int count, uint32_t period_ms);
+esp_err_t led_breathe_soft_stop(void);
+void led_breathe_soft_get_stats(led_breathe_stats_t *stats);
@@ -0,0 +1,331 @@
+/* Multi-LED status pattern engine - hashed timer wheel implementation
+ *
+ * The wheel has LED_PATTERN_WHEEL_SLOTS buckets of LED_PATTERN_TICK_MS each.
+ * An LED is only queued for the tick on which its level next changes, so a
+ * tick touches nothing but the LEDs that actually toggle. All edges due on
+ * the same tick are merged into one set mask and one clear mask and written
+ * to the GPIO W1TS/W1TC registers together.
+ *
+ * The tick runs from the esp_timer ISR where ISR dispatch is enabled, with
+ * everything it touches in IRAM/DRAM, so blink codes keep their timing
+ * while flash is written. Otherwise it runs in the esp_timer task.
+ */
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_timer.h"
+#include "esp_cpu.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "soc/soc.h"
+#include "soc/gpio_reg.h"
+#include "led_pattern.h"
+
+static const char *TAG = "LED_PATTERN";
+
+#define WHEEL_MASK  (LED_PATTERN_WHEEL_SLOTS - 1)
+#define LED_NONE    (-1)
+
+// Predefined blink codes (LSB plays first)
+const led_pattern_t LED_PATTERN_STEADY_ON    = { .bits = 0x1,    .length = 1,  .step_ms = 1000 };
+const led_pattern_t LED_PATTERN_BLINK_1HZ    = { .bits = 0x1,    .length = 2,  .step_ms = 500 };
+const led_pattern_t LED_PATTERN_HEARTBEAT    = { .bits = 0x5,    .length = 10, .step_ms = 100 };
+const led_pattern_t LED_PATTERN_DOUBLE_BLINK = { .bits = 0x5,    .length = 8,  .step_ms = 150 };
+const led_pattern_t LED_PATTERN_ERROR_3      = { .bits = 0x15,   .length = 12, .step_ms = 200 };
+
+// Per-LED engine state
+typedef struct {
+    uint32_t bits;          // Pattern bits
+    uint8_t length;         // Pattern length in steps
+    uint8_t step;           // Current step index
+    uint8_t level;          // Current output level
+    uint16_t rounds;        // Wheel revolutions to skip before the LED is due
+    uint16_t step_ticks;    // Wheel ticks per pattern step
+    int16_t slot;           // Wheel slot holding this LED (LED_NONE = idle)
+    int8_t next;            // Next LED in the same wheel slot
+    uint32_t mask_lo;       // Bit in GPIO_OUT_REG  (GPIO0-31)
+    uint32_t mask_hi;       // Bit in GPIO_OUT1_REG (GPIO32-39)
+} led_state_t;
+
+static led_state_t leds[LED_PATTERN_MAX_LEDS];
+static int num_leds = 0;
+static int8_t wheel[LED_PATTERN_WHEEL_SLOTS] = { [0 ... WHEEL_MASK] = LED_NONE };
+static uint32_t current_tick = 0;
+static led_pattern_stats_t stats;
+static uint32_t tick_start_cycles = 0;      // 0 = no tick since reset
+static esp_timer_handle_t wheel_timer = NULL;
+static portMUX_TYPE engine_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static IRAM_ATTR uint32_t pattern_window(const led_state_t *led)
+{
+    // Rotate the pattern so the current step sits at bit 0
+    uint32_t valid = (led->length == 32) ? 0xFFFFFFFFu : ((1u << led->length) - 1);
+    uint32_t bits = led->bits & valid;
+    if (led->step == 0) {
+        return bits;
+    }
+    return ((bits >> led->step) | (bits << (led->length - led->step))) & valid;
+}
+
+static IRAM_ATTR int run_length(const led_state_t *led)
+{
+    // Steps until the level changes, 0 if the pattern is constant
+    uint32_t valid = (led->length == 32) ? 0xFFFFFFFFu : ((1u << led->length) - 1);
+    uint32_t window = pattern_window(led);
+    uint32_t changes = (led->level ? ~window : window) & valid;
+    if (changes == 0) {
+        return 0;
+    }
+    return __builtin_ctz(changes);
+}
+
+static IRAM_ATTR void wheel_insert(int id, uint32_t slot)
+{
+    leds[id].slot = slot;
+    leds[id].next = wheel[slot];
+    wheel[slot] = id;
+}
+
+static void wheel_unlink(int id)
+{
+    int16_t slot = leds[id].slot;
+    if (slot == LED_NONE) {
+        return;
+    }
+    int8_t *link = &wheel[slot];
+    while (*link != LED_NONE && *link != id) {
+        link = &leds[*link].next;
+    }
+    if (*link == id) {
+        *link = leds[id].next;
+    }
+    leds[id].slot = LED_NONE;
+}
+
+static IRAM_ATTR void wheel_schedule(int id)
+{
+    // Queue the LED for the tick of its next edge
+    led_state_t *led = &leds[id];
+    int run = run_length(led);
+    if (run == 0) {
+        led->slot = LED_NONE;   // Constant pattern, never due again
+        return;
+    }
+    uint32_t delay = (uint32_t)run * led->step_ticks;
+    led->step = (led->step + run) % led->length;
+    led->rounds = (delay - 1) / LED_PATTERN_WHEEL_SLOTS;
+    wheel_insert(id, (current_tick + delay) & WHEEL_MASK);
+}
+
+static IRAM_ATTR int write_outputs(uint32_t set_lo, uint32_t clr_lo, uint32_t set_hi, uint32_t clr_hi)
+{
+    // Returns the number of register writes issued
+    int writes = 0;
+    if (set_lo) {
+        REG_WRITE(GPIO_OUT_W1TS_REG, set_lo);
+        writes++;
+    }
+    if (clr_lo) {
+        REG_WRITE(GPIO_OUT_W1TC_REG, clr_lo);
+        writes++;
+    }
+    if (set_hi) {
+        REG_WRITE(GPIO_OUT1_W1TS_REG, set_hi);
+        writes++;
+    }
+    if (clr_hi) {
+        REG_WRITE(GPIO_OUT1_W1TC_REG, clr_hi);
+        writes++;
+    }
+    return writes;
+}
+
+static IRAM_ATTR void wheel_tick(void *arg)
+{
+    uint32_t start = esp_cpu_get_cycle_count();
+    uint32_t set_lo = 0, clr_lo = 0, set_hi = 0, clr_hi = 0;
+    uint32_t updates = 0;
+
+    portENTER_CRITICAL_SAFE(&engine_lock);
+    current_tick++;
+    uint32_t slot = current_tick & WHEEL_MASK;
+
+    // Detach the bucket so LEDs re-queued into it are not seen twice
+    int id = wheel[slot];
+    wheel[slot] = LED_NONE;
+
+    while (id != LED_NONE) {
+        led_state_t *led = &leds[id];
+        int next = led->next;
+
+        if (led->rounds > 0) {
+            // Due on a later revolution of the wheel
+            led->rounds--;
+            wheel_insert(id, slot);
+        } else {
+            // Edge due now: the step index already points at the new level
+            led->level = !led->level;
+            if (led->level) {
+                set_lo |= led->mask_lo;
+                set_hi |= led->mask_hi;
+            } else {
+                clr_lo |= led->mask_lo;
+                clr_hi |= led->mask_hi;
+            }
+            updates++;
+            wheel_schedule(id);
+        }
+        id = next;
+    }
+    portEXIT_CRITICAL_SAFE(&engine_lock);
+
+    // One register write per direction and bank for every edge due now
+    int writes = write_outputs(set_lo, clr_lo, set_hi, clr_hi);
+    uint32_t cycles = esp_cpu_get_cycle_count() - start;
+
+    portENTER_CRITICAL_SAFE(&engine_lock);
+    stats.ticks++;
+    stats.led_updates += updates;
+    stats.gpio_writes += writes;
+    stats.total_cycles += cycles;
+    if (cycles > stats.max_cycles) {
+        stats.max_cycles = cycles;
+    }
+    if (tick_start_cycles) {
+        uint32_t period = start - tick_start_cycles;
+        if (stats.min_period_cycles == 0 || period < stats.min_period_cycles) {
+            stats.min_period_cycles = period;
+        }
+        if (period > stats.max_period_cycles) {
+            stats.max_period_cycles = period;
+        }
+    }
+    tick_start_cycles = start;
+    portEXIT_CRITICAL_SAFE(&engine_lock);
+}
+
+static void load_pattern(int id, const led_pattern_t *pattern)
+{
+    // Apply step 0 immediately and queue the first edge (engine lock held)
+    led_state_t *led = &leds[id];
+    wheel_unlink(id);
+    led->bits = pattern->bits;
+    led->length = pattern->length;
+    led->step = 0;
+    led->level = pattern->bits & 1;
+    led->step_ticks = pattern->step_ms / LED_PATTERN_TICK_MS;
+    if (led->step_ticks == 0) {
+        led->step_ticks = 1;
+    }
+    wheel_schedule(id);
+}
+
+esp_err_t led_pattern_engine_start(void)
+{
+    if (wheel_timer == NULL) {
+        esp_timer_create_args_t timer_args = {
+            .callback = wheel_tick,
+#if CONFIG_ESP_TIMER_SUPPORTS_ISR_DISPATCH_METHOD
+            .dispatch_method = ESP_TIMER_ISR,
+#endif
+            .name = "led_wheel"
+        };
+        esp_err_t ret = esp_timer_create(&timer_args, &wheel_timer);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to create wheel timer: %s", esp_err_to_name(ret));
+            return ret;
+        }
+    }
+    ESP_LOGI(TAG, "Timer wheel started (%d slots x %d ms)",
+             LED_PATTERN_WHEEL_SLOTS, LED_PATTERN_TICK_MS);
+    return esp_timer_start_periodic(wheel_timer, LED_PATTERN_TICK_MS * 1000);
+}
+
+esp_err_t led_pattern_engine_stop(void)
+{
+    if (wheel_timer == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    return esp_timer_stop(wheel_timer);
+}
+
+esp_err_t led_pattern_add(gpio_num_t pin, const led_pattern_t *pattern, int *led_id)
+{
+    if (pattern == NULL || pattern->length == 0 || pattern->length > 32) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (num_leds >= LED_PATTERN_MAX_LEDS) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    // GPIO_NUM_NC adds a virtual LED that runs the pattern without an output
+    if (pin != GPIO_NUM_NC) {
+        gpio_reset_pin(pin);
+        gpio_set_direction(pin, GPIO_MODE_OUTPUT);
+        gpio_set_level(pin, pattern->bits & 1);
+    }
+
+    portENTER_CRITICAL(&engine_lock);
+    int id = num_leds++;
+    led_state_t *led = &leds[id];
+    led->slot = LED_NONE;
+    led->mask_lo = (pin >= 0 && pin < 32) ? (1u << pin) : 0;
+    led->mask_hi = (pin >= 32) ? (1u << (pin - 32)) : 0;
+    load_pattern(id, pattern);
+    portEXIT_CRITICAL(&engine_lock);
+
+    if (led_id) {
+        *led_id = id;
+    }
+    return ESP_OK;
+}
+
+esp_err_t led_pattern_set(int led_id, const led_pattern_t *pattern)
+{
+    if (led_id < 0 || led_id >= num_leds || pattern == NULL ||
+        pattern->length == 0 || pattern->length > 32) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    portENTER_CRITICAL(&engine_lock);
+    led_state_t *led = &leds[led_id];
+    load_pattern(led_id, pattern);
+    uint32_t set_lo = led->level ? led->mask_lo : 0;
+    uint32_t set_hi = led->level ? led->mask_hi : 0;
+    uint32_t clr_lo = led->level ? 0 : led->mask_lo;
+    uint32_t clr_hi = led->level ? 0 : led->mask_hi;
+    portEXIT_CRITICAL(&engine_lock);
+
+    write_outputs(set_lo, clr_lo, set_hi, clr_hi);
+    return ESP_OK;
+}
+
+void led_pattern_remove_all(void)
+{
+    uint32_t clr_lo = 0, clr_hi = 0;
+
+    portENTER_CRITICAL(&engine_lock);
+    for (int i = 0; i < num_leds; i++) {
+        clr_lo |= leds[i].mask_lo;
+        clr_hi |= leds[i].mask_hi;
+    }
+    num_leds = 0;
+    memset(wheel, LED_NONE, sizeof(wheel));
+    portEXIT_CRITICAL(&engine_lock);
+
+    write_outputs(0, clr_lo, 0, clr_hi);
+}
+
+void led_pattern_get_stats(led_pattern_stats_t *out)
+{
+    portENTER_CRITICAL(&engine_lock);
+    *out = stats;
+    portEXIT_CRITICAL(&engine_lock);
+}
+
+void led_pattern_reset_stats(void)
+{
+    portENTER_CRITICAL(&engine_lock);
+    memset(&stats, 0, sizeof(stats));
+    tick_start_cycles = 0;
+    portEXIT_CRITICAL(&engine_lock);
+}
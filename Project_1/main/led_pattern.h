@@ -0,0 +1,47 @@
+/* Multi-LED status pattern engine
+ * Every LED plays a short bit pattern (1 = ON) at its own step period.
+ * All LEDs are serviced by one esp_timer driving a hashed timer wheel.
+ */
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "driver/gpio.h"
+
+// Engine configuration
+#define LED_PATTERN_MAX_LEDS    32      // Maximum number of status LEDs
+#define LED_PATTERN_TICK_MS     10      // Timer wheel resolution
+#define LED_PATTERN_WHEEL_SLOTS 256     // Must be a power of two
+
+// Blink code: bit i (LSB first) is the LED level during step i
+typedef struct {
+    uint32_t bits;      // Pattern bits, 1 = LED ON
+    uint8_t length;     // Number of valid bits (1..32)
+    uint16_t step_ms;   // Duration of one step, multiple of LED_PATTERN_TICK_MS
+} led_pattern_t;
+
+// Engine timing statistics (CPU cycles spent in the wheel callback)
+typedef struct {
+    uint32_t ticks;         // Wheel ticks serviced
+    uint32_t led_updates;   // LED steps processed
+    uint32_t gpio_writes;   // Coalesced register writes issued
+    uint64_t total_cycles;  // Cycles spent in all ticks
+    uint32_t max_cycles;    // Worst-case cycles for a single tick
+    uint32_t min_period_cycles; // Shortest tick start to tick start
+    uint32_t max_period_cycles; // Longest tick start to tick start
+} led_pattern_stats_t;
+
+// Predefined blink codes
+extern const led_pattern_t LED_PATTERN_STEADY_ON;
+extern const led_pattern_t LED_PATTERN_BLINK_1HZ;
+extern const led_pattern_t LED_PATTERN_HEARTBEAT;
+extern const led_pattern_t LED_PATTERN_DOUBLE_BLINK;
+extern const led_pattern_t LED_PATTERN_ERROR_3;
+
+esp_err_t led_pattern_engine_start(void);
+esp_err_t led_pattern_engine_stop(void);
+esp_err_t led_pattern_add(gpio_num_t pin, const led_pattern_t *pattern, int *led_id);
+esp_err_t led_pattern_set(int led_id, const led_pattern_t *pattern);
+void led_pattern_remove_all(void);
+void led_pattern_get_stats(led_pattern_stats_t *stats);
+void led_pattern_reset_stats(void);
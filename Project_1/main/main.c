@@ -2,12 +2,74 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "esp_log.h"
+#include "esp_cpu.h"
+#include "esp_timer.h"
 #include "driver/gpio.h"
+#include "led_pattern.h"
+#include "led_breathe.h"
+#include "soft_pwm.h"
+#include "flash_stress.h"
 
 // MACROS
 #define TAG "MAIN"
 #define led_pin GPIO_NUM_2
-void app_main(void)
+
+// Application modes
+#define APP_MODE_BLINK          0   // Single LED blink at 1 Hz
+#define APP_MODE_STATUS_LEDS    1   // Status LEDs with independent blink codes
+#define APP_MODE_PATTERN_BENCH  2   // Pattern engine CPU cost vs LED count
+#define APP_MODE_BREATHE        3   // Gamma-corrected breathing on every LEDC channel
+#define APP_MODE_BREATHE_BENCH  4   // CPU load: LEDC hardware fades vs software PWM
+#define APP_MODE_SOFT_PWM       5   // BAM software PWM wave across many LEDs
+#define APP_MODE_SOFT_PWM_BENCH 6   // BAM ISR cost vs LED count and resolution
+#define APP_MODE                APP_MODE_BLINK
+
+// Status LED pins for APP_MODE_STATUS_LEDS
+#define STATUS_LED_COUNT 4
+static const gpio_num_t status_led_pins[STATUS_LED_COUNT] = {
+    led_pin,        // Heartbeat
+    GPIO_NUM_4,     // Double blink
+    GPIO_NUM_18,    // Error code 3
+    GPIO_NUM_19     // 1 Hz blink
+};
+
+// Dimmable LED pins for the breathing modes (one per LEDC channel)
+#define BREATHE_LED_COUNT   LED_BREATHE_MAX_LEDS
+#define BREATHE_PERIOD_MS   3000
+static const gpio_num_t breathe_led_pins[] = {
+    led_pin, GPIO_NUM_4, GPIO_NUM_5, GPIO_NUM_13,
+    GPIO_NUM_14, GPIO_NUM_15, GPIO_NUM_16, GPIO_NUM_17,
+    GPIO_NUM_18, GPIO_NUM_19, GPIO_NUM_21, GPIO_NUM_22,
+    GPIO_NUM_23, GPIO_NUM_25, GPIO_NUM_26, GPIO_NUM_27
+};
+
+// Software PWM: every free output pin, the rest are virtual channels
+#define SOFT_PWM_LED_COUNT  24
+#define SOFT_PWM_BITS       8
+#define SOFT_PWM_FRAME_HZ   200
+static const gpio_num_t soft_pwm_pins[] = {
+    led_pin, GPIO_NUM_4, GPIO_NUM_5, GPIO_NUM_13,
+    GPIO_NUM_14, GPIO_NUM_15, GPIO_NUM_16, GPIO_NUM_17,
+    GPIO_NUM_18, GPIO_NUM_19, GPIO_NUM_21, GPIO_NUM_22,
+    GPIO_NUM_23, GPIO_NUM_25, GPIO_NUM_26, GPIO_NUM_27,
+    GPIO_NUM_32, GPIO_NUM_33
+};
+#define SOFT_PWM_PIN_COUNT  (sizeof(soft_pwm_pins) / sizeof(soft_pwm_pins[0]))
+
+// Benchmark configuration
+#define BENCH_WINDOW_MS 2000
+
+// Erase/write the NVS partition nonstop; the status LED and soft PWM modes
+// then log their timer period min/max every BENCH_WINDOW_MS
+#define FLASH_STRESS        0
+
+static float cpu_load_percent(uint64_t cycles, uint32_t window_ms)
+{
+    // Cycles used / cycles available in the measurement window
+    return (float)cycles * 100.0f / ((float)CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ * 1000.0f * window_ms);
+}
+
+static void run_blink(void)
 {
     // Initialize the LED pin
     ESP_LOGI(TAG,"Starting LED blink example");
@@ -24,4 +86,235 @@ void app_main(void)
         ESP_LOGI(TAG,"LED OFF");
         vTaskDelay(1000 / portTICK_PERIOD_MS);
     }
-}
\ No newline at end of file
+}
+
+static void run_status_leds(void)
+{
+    const led_pattern_t *codes[STATUS_LED_COUNT] = {
+        &LED_PATTERN_HEARTBEAT,
+        &LED_PATTERN_DOUBLE_BLINK,
+        &LED_PATTERN_ERROR_3,
+        &LED_PATTERN_BLINK_1HZ
+    };
+
+    ESP_LOGI(TAG,"Starting status LED patterns on %d LEDs", STATUS_LED_COUNT);
+    for (int i = 0; i < STATUS_LED_COUNT; i++) {
+        ESP_ERROR_CHECK(led_pattern_add(status_led_pins[i], codes[i], NULL));
+    }
+    ESP_ERROR_CHECK(led_pattern_engine_start());
+
+#if FLASH_STRESS
+    // Wheel tick period: 10 ms unless the tick is held off during a flash write
+    ESP_ERROR_CHECK(flash_stress_start());
+    while (1) {
+        led_pattern_reset_stats();
+        vTaskDelay(pdMS_TO_TICKS(BENCH_WINDOW_MS));
+        led_pattern_stats_t stats;
+        led_pattern_get_stats(&stats);
+        ESP_LOGI(TAG,"Wheel ticks=%lu period %lu-%lu us",
+                 (unsigned long)stats.ticks,
+                 (unsigned long)(stats.min_period_cycles / CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ),
+                 (unsigned long)(stats.max_period_cycles / CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ));
+        flash_stress_log();
+    }
+#else
+    // Patterns run from the timer wheel, nothing left to do here
+    while (1) {
+        vTaskDelay(pdMS_TO_TICKS(10000));
+    }
+#endif
+}
+
+static void run_pattern_bench(void)
+{
+    // Mix of blink codes so edges land on shared and distinct ticks
+    const led_pattern_t *codes[] = {
+        &LED_PATTERN_HEARTBEAT,
+        &LED_PATTERN_DOUBLE_BLINK,
+        &LED_PATTERN_ERROR_3,
+        &LED_PATTERN_BLINK_1HZ
+    };
+    const int num_codes = sizeof(codes) / sizeof(codes[0]);
+
+    ESP_LOGI(TAG,"Pattern engine benchmark (%d ms per run)", BENCH_WINDOW_MS);
+    ESP_ERROR_CHECK(led_pattern_engine_start());
+
+    for (int count = 1; count <= LED_PATTERN_MAX_LEDS; count *= 2) {
+        led_pattern_remove_all();
+        // First LED is real so the output can be checked on a scope
+        for (int i = 0; i < count; i++) {
+            gpio_num_t pin = (i == 0) ? led_pin : GPIO_NUM_NC;
+            ESP_ERROR_CHECK(led_pattern_add(pin, codes[i % num_codes], NULL));
+        }
+        led_pattern_reset_stats();
+        vTaskDelay(pdMS_TO_TICKS(BENCH_WINDOW_MS));
+
+        led_pattern_stats_t stats;
+        led_pattern_get_stats(&stats);
+        uint32_t avg_cycles = stats.ticks ? (uint32_t)(stats.total_cycles / stats.ticks) : 0;
+        float cpu_load = cpu_load_percent(stats.total_cycles, BENCH_WINDOW_MS);
+        ESP_LOGI(TAG,"LEDs=%2d ticks=%lu edges=%lu writes=%lu avg=%lu cyc max=%lu cyc load=%.4f%%",
+                 count, (unsigned long)stats.ticks, (unsigned long)stats.led_updates,
+                 (unsigned long)stats.gpio_writes, (unsigned long)avg_cycles,
+                 (unsigned long)stats.max_cycles, cpu_load);
+    }
+
+    led_pattern_engine_stop();
+    led_pattern_remove_all();
+    ESP_LOGI(TAG,"Benchmark complete");
+}
+
+static void start_breathing_leds(int count)
+{
+    ESP_ERROR_CHECK(led_breathe_init());
+    for (int i = 0; i < count; i++) {
+        // Every fourth LED shows a heartbeat, the rest breathe
+        led_effect_t effect = (i % 4 == 3) ? LED_EFFECT_HEARTBEAT : LED_EFFECT_BREATHE;
+        ESP_ERROR_CHECK(led_breathe_add(breathe_led_pins[i], effect, BREATHE_PERIOD_MS));
+    }
+}
+
+static void run_breathe(void)
+{
+    ESP_LOGI(TAG,"Starting gamma-corrected breathing on %d LEDs", BREATHE_LED_COUNT);
+    start_breathing_leds(BREATHE_LED_COUNT);
+
+    // Effects run on LEDC hardware fades, nothing left to do here
+    while (1) {
+        vTaskDelay(pdMS_TO_TICKS(10000));
+    }
+}
+
+static void run_breathe_bench(void)
+{
+    led_breathe_stats_t stats;
+
+    // Baseline: software PWM generating the same curves from a timer ISR
+    ESP_LOGI(TAG,"Software PWM baseline on %d LEDs", BREATHE_LED_COUNT);
+    ESP_ERROR_CHECK(led_breathe_soft_start(breathe_led_pins, BREATHE_LED_COUNT, BREATHE_PERIOD_MS));
+    vTaskDelay(pdMS_TO_TICKS(BENCH_WINDOW_MS));
+    ESP_ERROR_CHECK(led_breathe_soft_stop());
+    led_breathe_soft_get_stats(&stats);
+    ESP_LOGI(TAG,"Software PWM: ISR runs=%lu cycles=%llu load=%.3f%%",
+             (unsigned long)stats.segments, (unsigned long long)stats.total_cycles,
+             cpu_load_percent(stats.total_cycles, BENCH_WINDOW_MS));
+
+    // LEDC hardware fades: CPU only runs at segment boundaries
+    ESP_LOGI(TAG,"LEDC hardware fades on %d LEDs", BREATHE_LED_COUNT);
+    start_breathing_leds(BREATHE_LED_COUNT);
+    while (1) {
+        led_breathe_reset_stats();
+        vTaskDelay(pdMS_TO_TICKS(BENCH_WINDOW_MS));
+        led_breathe_get_stats(&stats);
+        ESP_LOGI(TAG,"LEDC fades: segments=%lu cycles=%llu load=%.4f%%",
+                 (unsigned long)stats.segments, (unsigned long long)stats.total_cycles,
+                 cpu_load_percent(stats.total_cycles, BENCH_WINDOW_MS));
+    }
+}
+
+static void add_soft_pwm_channels(int count)
+{
+    for (int i = 0; i < count; i++) {
+        gpio_num_t pin = (i < SOFT_PWM_PIN_COUNT) ? soft_pwm_pins[i] : GPIO_NUM_NC;
+        ESP_ERROR_CHECK(soft_pwm_add(pin, NULL));
+    }
+}
+
+static void run_soft_pwm(void)
+{
+    const uint32_t max_duty = (1u << SOFT_PWM_BITS) - 1;
+    uint32_t phase = 0;
+
+    ESP_LOGI(TAG,"Starting BAM software PWM on %d LEDs", SOFT_PWM_LED_COUNT);
+    ESP_ERROR_CHECK(soft_pwm_init(SOFT_PWM_BITS, SOFT_PWM_FRAME_HZ));
+    add_soft_pwm_channels(SOFT_PWM_LED_COUNT);
+#if FLASH_STRESS
+    ESP_ERROR_CHECK(flash_stress_start());
+    int updates = 0;
+#endif
+
+    // Brightness wave travelling along the bar
+    while (1) {
+        for (int i = 0; i < SOFT_PWM_LED_COUNT; i++) {
+            uint32_t pos = (phase + i * 16) % (2 * max_duty);
+            uint32_t level = (pos > max_duty) ? 2 * max_duty - pos : pos;
+            // Square the ramp as a cheap perceptual correction
+            soft_pwm_set_duty(i, level * level / max_duty);
+        }
+        ESP_ERROR_CHECK(soft_pwm_commit());
+        phase += 4;
+        vTaskDelay(pdMS_TO_TICKS(20));
+#if FLASH_STRESS
+        // Frame period stays at 1 / SOFT_PWM_FRAME_HZ unless a slot ISR is held off
+        if (++updates == BENCH_WINDOW_MS / 20) {
+            soft_pwm_stats_t stats;
+            soft_pwm_get_stats(&stats);
+            ESP_LOGI(TAG,"BAM frames=%lu period %lu-%lu us, max ISR %lu cyc",
+                     (unsigned long)stats.frames,
+                     (unsigned long)(stats.min_frame_cycles / CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ),
+                     (unsigned long)(stats.max_frame_cycles / CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ),
+                     (unsigned long)stats.max_cycles);
+            flash_stress_log();
+            soft_pwm_reset_stats();
+            updates = 0;
+        }
+#endif
+    }
+}
+
+static void run_soft_pwm_bench(void)
+{
+    const uint8_t bit_options[] = { 6, 8, 10 };
+    const int led_options[] = { 8, 16, 24, 32 };
+
+    ESP_LOGI(TAG,"BAM software PWM benchmark (%d Hz frame, %d ms per run)",
+             SOFT_PWM_FRAME_HZ, BENCH_WINDOW_MS);
+    for (int b = 0; b < sizeof(bit_options) / sizeof(bit_options[0]); b++) {
+        for (int n = 0; n < sizeof(led_options) / sizeof(led_options[0]); n++) {
+            ESP_ERROR_CHECK(soft_pwm_init(bit_options[b], SOFT_PWM_FRAME_HZ));
+            add_soft_pwm_channels(led_options[n]);
+            for (int i = 0; i < led_options[n]; i++) {
+                soft_pwm_set_duty(i, (i * 37) & ((1u << bit_options[b]) - 1));
+            }
+
+            // Frame table rebuild cost (done in task context)
+            uint32_t start = esp_cpu_get_cycle_count();
+            ESP_ERROR_CHECK(soft_pwm_commit());
+            uint32_t commit_cycles = esp_cpu_get_cycle_count() - start;
+
+            soft_pwm_reset_stats();
+            vTaskDelay(pdMS_TO_TICKS(BENCH_WINDOW_MS));
+            soft_pwm_stats_t stats;
+            soft_pwm_get_stats(&stats);
+            ESP_ERROR_CHECK(soft_pwm_deinit());
+
+            uint32_t avg_cycles = stats.isr_count ? (uint32_t)(stats.total_cycles / stats.isr_count) : 0;
+            ESP_LOGI(TAG,"bits=%2d LEDs=%2d isr/s=%lu avg=%lu cyc max=%lu cyc load=%.3f%% commit=%lu cyc",
+                     bit_options[b], led_options[n],
+                     (unsigned long)(stats.isr_count * 1000 / BENCH_WINDOW_MS),
+                     (unsigned long)avg_cycles, (unsigned long)stats.max_cycles,
+                     cpu_load_percent(stats.total_cycles, BENCH_WINDOW_MS),
+                     (unsigned long)commit_cycles);
+        }
+    }
+    ESP_LOGI(TAG,"Benchmark complete");
+}
+
+void app_main(void)
+{
+#if APP_MODE == APP_MODE_STATUS_LEDS
+    run_status_leds();
+#elif APP_MODE == APP_MODE_PATTERN_BENCH
+    run_pattern_bench();
+#elif APP_MODE == APP_MODE_BREATHE
+    run_breathe();
+#elif APP_MODE == APP_MODE_BREATHE_BENCH
+    run_breathe_bench();
+#elif APP_MODE == APP_MODE_SOFT_PWM
+    run_soft_pwm();
+#elif APP_MODE == APP_MODE_SOFT_PWM_BENCH
+    run_soft_pwm_bench();
+#else
+    run_blink();
+#endif
+}
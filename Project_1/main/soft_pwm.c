@@ -0,0 +1,241 @@
+/* Software PWM engine using bit-angle modulation (BAM)
+ *
+ * Duties are staged with soft_pwm_set_duty() and turned into a frame table
+ * of per-slot ON masks by soft_pwm_commit(). Two frame tables are kept:
+ * the ISR reads the active one while the next is built, and the swap
+ * happens on a frame boundary so a frame never mixes old and new duties.
+ *
+ * The original ESP32 has no dedicated-GPIO bundles, so each slot costs
+ * one W1TS and one W1TC write per GPIO bank in use, independent of the
+ * number of LEDs.
+ */
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "driver/gptimer.h"
+#include "esp_cpu.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "soc/soc.h"
+#include "soc/gpio_reg.h"
+#include "soft_pwm.h"
+
+static const char *TAG = "SOFT_PWM";
+
+// Precomputed output for one PWM frame
+typedef struct {
+    uint32_t on_lo[SOFT_PWM_MAX_BITS];  // GPIO0-31 ON mask per slot
+    uint32_t on_hi[SOFT_PWM_MAX_BITS];  // GPIO32-39 ON mask per slot
+    uint32_t all_lo;                    // Every engine pin in GPIO0-31
+    uint32_t all_hi;                    // Every engine pin in GPIO32-39
+} bam_frame_t;
+
+static DRAM_ATTR bam_frame_t frames[2];
+static DRAM_ATTR gptimer_alarm_config_t slot_alarms[SOFT_PWM_MAX_BITS];
+static volatile int active_frame = 0;
+static volatile bool swap_pending = false;
+static uint8_t num_bits = 0;
+static uint8_t slot = 0;
+
+static uint32_t chan_mask_lo[SOFT_PWM_MAX_LEDS];
+static uint32_t chan_mask_hi[SOFT_PWM_MAX_LEDS];
+static uint16_t chan_duty[SOFT_PWM_MAX_LEDS];
+static int num_channels = 0;
+
+static gptimer_handle_t pwm_timer = NULL;
+static soft_pwm_stats_t stats;
+static uint32_t frame_start_cycles = 0;     // 0 = no frame started since reset
+
+static IRAM_ATTR bool bam_slot_isr(gptimer_handle_t timer, const gptimer_alarm_event_data_t *edata, void *user_ctx)
+{
+    uint32_t start = esp_cpu_get_cycle_count();
+    const bam_frame_t *frame = &frames[active_frame];
+    uint8_t k = slot;
+
+    if (k == 0) {
+        // Frame period: a late slot ISR (e.g. held off by a flash write) shows up here
+        if (frame_start_cycles) {
+            uint32_t period = start - frame_start_cycles;
+            if (stats.min_frame_cycles == 0 || period < stats.min_frame_cycles) {
+                stats.min_frame_cycles = period;
+            }
+            if (period > stats.max_frame_cycles) {
+                stats.max_frame_cycles = period;
+            }
+        }
+        frame_start_cycles = start;
+    }
+
+    // Output slot k: LEDs with duty bit k set are ON for 2^k base ticks
+    REG_WRITE(GPIO_OUT_W1TS_REG, frame->on_lo[k]);
+    REG_WRITE(GPIO_OUT_W1TC_REG, frame->all_lo & ~frame->on_lo[k]);
+    if (frame->all_hi) {
+        REG_WRITE(GPIO_OUT1_W1TS_REG, frame->on_hi[k]);
+        REG_WRITE(GPIO_OUT1_W1TC_REG, frame->all_hi & ~frame->on_hi[k]);
+    }
+    gptimer_set_alarm_action(timer, &slot_alarms[k]);
+
+    if (++slot == num_bits) {
+        slot = 0;
+        stats.frames++;
+        if (swap_pending) {
+            active_frame ^= 1;
+            swap_pending = false;
+        }
+    }
+
+    uint32_t cycles = esp_cpu_get_cycle_count() - start;
+    stats.isr_count++;
+    stats.total_cycles += cycles;
+    if (cycles > stats.max_cycles) {
+        stats.max_cycles = cycles;
+    }
+    return false;
+}
+
+esp_err_t soft_pwm_init(uint8_t bits, uint32_t frame_hz)
+{
+    if (pwm_timer != NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (bits < SOFT_PWM_MIN_BITS || bits > SOFT_PWM_MAX_BITS || frame_hz == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // A frame is (2^bits - 1) base ticks long
+    uint32_t base_ticks = SOFT_PWM_TIMER_HZ / (frame_hz * ((1u << bits) - 1));
+    if (base_ticks == 0) {
+        ESP_LOGE(TAG, "%lu Hz frame rate too high for %d bits", (unsigned long)frame_hz, bits);
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (int k = 0; k < bits; k++) {
+        slot_alarms[k].alarm_count = (uint64_t)base_ticks << k;
+        slot_alarms[k].reload_count = 0;
+        slot_alarms[k].flags.auto_reload_on_alarm = true;
+    }
+
+    memset(frames, 0, sizeof(frames));
+    memset(&stats, 0, sizeof(stats));
+    frame_start_cycles = 0;
+    active_frame = 0;
+    swap_pending = false;
+    num_bits = bits;
+    slot = 0;
+    num_channels = 0;
+
+    gptimer_config_t timer_config = {
+        .clk_src = GPTIMER_CLK_SRC_DEFAULT,
+        .direction = GPTIMER_COUNT_UP,
+        .resolution_hz = SOFT_PWM_TIMER_HZ,
+        .intr_priority = 3      // Highest level available to C handlers
+    };
+    ESP_ERROR_CHECK(gptimer_new_timer(&timer_config, &pwm_timer));
+    gptimer_event_callbacks_t callbacks = {
+        .on_alarm = bam_slot_isr
+    };
+    ESP_ERROR_CHECK(gptimer_register_event_callbacks(pwm_timer, &callbacks, NULL));
+    ESP_ERROR_CHECK(gptimer_set_alarm_action(pwm_timer, &slot_alarms[0]));
+    ESP_ERROR_CHECK(gptimer_enable(pwm_timer));
+    ESP_ERROR_CHECK(gptimer_start(pwm_timer));
+
+    ESP_LOGI(TAG, "BAM engine: %d bits, %lu Hz frame, LSB slot %lu ns",
+             bits, (unsigned long)frame_hz, (unsigned long)(base_ticks * (1000000000UL / SOFT_PWM_TIMER_HZ)));
+    return ESP_OK;
+}
+
+esp_err_t soft_pwm_deinit(void)
+{
+    if (pwm_timer == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    gptimer_stop(pwm_timer);
+    gptimer_disable(pwm_timer);
+    gptimer_del_timer(pwm_timer);
+    pwm_timer = NULL;
+
+    // Leave every engine pin OFF
+    const bam_frame_t *frame = &frames[active_frame];
+    REG_WRITE(GPIO_OUT_W1TC_REG, frame->all_lo);
+    REG_WRITE(GPIO_OUT1_W1TC_REG, frame->all_hi);
+    return ESP_OK;
+}
+
+esp_err_t soft_pwm_add(gpio_num_t pin, int *channel)
+{
+    if (pwm_timer == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (num_channels >= SOFT_PWM_MAX_LEDS) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    // GPIO_NUM_NC adds a virtual channel (no output) for benchmarking
+    int id = num_channels++;
+    chan_mask_lo[id] = 0;
+    chan_mask_hi[id] = 0;
+    chan_duty[id] = 0;
+    if (pin != GPIO_NUM_NC) {
+        gpio_reset_pin(pin);
+        gpio_set_direction(pin, GPIO_MODE_OUTPUT);
+        gpio_set_level(pin, 0);
+        if (pin < 32) {
+            chan_mask_lo[id] = 1u << pin;
+        } else {
+            chan_mask_hi[id] = 1u << (pin - 32);
+        }
+    }
+
+    if (channel) {
+        *channel = id;
+    }
+    return ESP_OK;
+}
+
+esp_err_t soft_pwm_set_duty(int channel, uint32_t duty)
+{
+    if (channel < 0 || channel >= num_channels) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    uint32_t max_duty = (1u << num_bits) - 1;
+    chan_duty[channel] = (duty > max_duty) ? max_duty : duty;
+    return ESP_OK;
+}
+
+esp_err_t soft_pwm_commit(void)
+{
+    if (pwm_timer == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // The spare table may still be waiting for its frame boundary
+    while (swap_pending) {
+        vTaskDelay(1);
+    }
+
+    bam_frame_t *next = &frames[active_frame ^ 1];
+    memset(next, 0, sizeof(*next));
+    for (int i = 0; i < num_channels; i++) {
+        next->all_lo |= chan_mask_lo[i];
+        next->all_hi |= chan_mask_hi[i];
+        uint32_t duty = chan_duty[i];
+        while (duty) {
+            int k = __builtin_ctz(duty);
+            next->on_lo[k] |= chan_mask_lo[i];
+            next->on_hi[k] |= chan_mask_hi[i];
+            duty &= duty - 1;
+        }
+    }
+    swap_pending = true;
+    return ESP_OK;
+}
+
+void soft_pwm_get_stats(soft_pwm_stats_t *out)
+{
+    *out = stats;
+}
+
+void soft_pwm_reset_stats(void)
+{
+    memset(&stats, 0, sizeof(stats));
+    frame_start_cycles = 0;
+}
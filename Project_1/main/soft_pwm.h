@@ -0,0 +1,33 @@
+/* Software PWM engine using bit-angle modulation (BAM)
+ * Dims more LEDs than there are LEDC channels. Each PWM frame is split into
+ * one time slot per duty bit (slot k lasts 2^k base ticks); a GPTimer ISR
+ * writes a precomputed GPIO mask at the start of every slot.
+ */
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "driver/gpio.h"
+
+#define SOFT_PWM_MAX_LEDS   32      // Channels per engine
+#define SOFT_PWM_MIN_BITS   4       // Lowest supported duty resolution
+#define SOFT_PWM_MAX_BITS   10      // Highest supported duty resolution
+#define SOFT_PWM_TIMER_HZ   10000000    // GPTimer resolution (100 ns ticks)
+
+// ISR timing statistics
+typedef struct {
+    uint32_t isr_count;     // Slot interrupts serviced
+    uint64_t total_cycles;  // Cycles spent in the ISR
+    uint32_t max_cycles;    // Worst-case cycles for a single ISR
+    uint32_t frames;        // Complete PWM frames output
+    uint32_t min_frame_cycles;  // Shortest frame start to frame start
+    uint32_t max_frame_cycles;  // Longest frame start to frame start
+} soft_pwm_stats_t;
+
+esp_err_t soft_pwm_init(uint8_t bits, uint32_t frame_hz);
+esp_err_t soft_pwm_deinit(void);
+esp_err_t soft_pwm_add(gpio_num_t pin, int *channel);
+esp_err_t soft_pwm_set_duty(int channel, uint32_t duty);
+esp_err_t soft_pwm_commit(void);
+void soft_pwm_get_stats(soft_pwm_stats_t *stats);
+void soft_pwm_reset_stats(void);
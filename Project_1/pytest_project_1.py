@@ -0,0 +1,16 @@
+"""Project 1 under QEMU: the default 1 Hz blink (APP_MODE_BLINK)"""
+import pytest
+
+BLINK_HALF_PERIOD_MS = 1000     # run_blink: vTaskDelay between ON and OFF
+EDGES = 10
+
+
+@pytest.mark.esp32
+@pytest.mark.qemu
+def test_blink(log):
+    log.check_boot()
+    log.expect('MAIN', 'Starting LED blink example')
+    edges = log.expect_all('MAIN', 'LED (ON|OFF)', EDGES)
+    levels = [m.group(2) for _, m in edges]
+    assert levels == [b'ON', b'OFF'] * (EDGES // 2)
+    log.check_period([ms for ms, _ in edges], BLINK_HALF_PERIOD_MS)
@@ -0,0 +1,153 @@
+/* Light bar render/encode timing on the host
+ *
+ * Renders every pattern with the firmware's lightbar_fx.c for 8..300
+ * pixel strips and expands each frame into WS2812 RMT symbols the way the
+ * firmware's bytes + latch encoder does. Reports the time per frame for
+ * both next to the strip's wire time and the frame rate the firmware
+ * runs that strip at, and checks the frames:
+ *   - the generator writes exactly num_pixels * 3 bytes
+ *   - the symbol stream is 8 symbols per byte plus the latch, and each
+ *     symbol lasts one bit time
+ *   - the frame period is never shorter than the wire time, and is the
+ *     full LIGHTBAR_FPS rate wherever the wire time allows it
+ *
+ * Host times are for comparing strip lengths and patterns; the on-device
+ * cycle counts come from LIGHTBAR_BENCH in main.c.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include "lightbar_fx.h"
+
+#define LIGHTBAR_FPS        120         // Same as lightbar.h
+#define MAX_PIXELS          300
+#define FRAMES              2000        // Timed frames per pattern and length
+#define RES_HZ              10000000    // RMT resolution, lightbar.h
+#define CANARY              0xA5
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do { \
+    if (!(cond)) { \
+        printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+        printf(__VA_ARGS__); \
+        printf("\n"); \
+        failures++; \
+    } \
+} while (0)
+
+// RMT symbol word: level/duration pairs as in rmt_symbol_word_t
+typedef struct {
+    uint16_t duration0 : 15;
+    uint16_t level0 : 1;
+    uint16_t duration1 : 15;
+    uint16_t level1 : 1;
+} symbol_t;
+
+static const symbol_t bit_symbols[2] = {
+    { .level0 = 1, .duration0 = 3, .level1 = 0, .duration1 = 9 },   // 0: 0.3 us high, 0.9 us low
+    { .level0 = 1, .duration0 = 9, .level1 = 0, .duration1 = 3 }    // 1: 0.9 us high, 0.3 us low
+};
+
+// Bytes MSB first, then the latch as one symbol, as ws2812_encode() does
+static size_t encode_frame(const uint8_t *bytes, size_t len, symbol_t *out)
+{
+    size_t n = 0;
+    for (size_t i = 0; i < len; i++) {
+        for (int bit = 7; bit >= 0; bit--) {
+            out[n++] = bit_symbols[(bytes[i] >> bit) & 1];
+        }
+    }
+    uint16_t latch_ticks = (RES_HZ / 1000000) * LIGHTBAR_LATCH_US / 2;
+    out[n++] = (symbol_t) { .level0 = 0, .duration0 = latch_ticks, .level1 = 0, .duration1 = latch_ticks };
+    return n;
+}
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static uint8_t pixels[MAX_PIXELS * LIGHTBAR_BYTES_PER_PIXEL + 16];
+static symbol_t symbols[MAX_PIXELS * LIGHTBAR_BYTES_PER_PIXEL * 8 + 1];
+
+static void check_frame(int num_pixels, lightbar_pattern_t pattern, const lightbar_sync_t *sync)
+{
+    size_t len = (size_t)num_pixels * LIGHTBAR_BYTES_PER_PIXEL;
+    memset(pixels, CANARY, sizeof(pixels));
+    lightbar_render(pixels, num_pixels, pattern, sync);
+    for (size_t i = len; i < sizeof(pixels); i++) {
+        CHECK(pixels[i] == CANARY, "pattern %d, %d pixels: byte %zu written past the frame",
+              pattern, num_pixels, i);
+    }
+
+    size_t n = encode_frame(pixels, len, symbols);
+    CHECK(n == len * 8 + 1, "%d pixels: %zu symbols", num_pixels, n);
+    uint64_t ticks = 0;
+    for (size_t i = 0; i + 1 < n; i++) {
+        CHECK(symbols[i].duration0 + symbols[i].duration1 == LIGHTBAR_BIT_NS * (RES_HZ / 1000000) / 1000,
+              "symbol %zu is not one bit time", i);
+        ticks += symbols[i].duration0 + symbols[i].duration1;
+    }
+    ticks += symbols[n - 1].duration0 + symbols[n - 1].duration1;
+    uint32_t wire_us = lightbar_wire_us(num_pixels);
+    uint64_t encoded_us = (ticks + RES_HZ / 1000000 - 1) / (RES_HZ / 1000000);
+    CHECK(encoded_us == wire_us, "%d pixels: encoded %llu us, wire time %lu us",
+          num_pixels, (unsigned long long)encoded_us, (unsigned long)wire_us);
+}
+
+int main(void)
+{
+    const int lengths[] = { 8, 30, 60, 150, 300 };
+    const lightbar_pattern_t patterns[] = { LIGHTBAR_WIGWAG, LIGHTBAR_QUAD_FLASH, LIGHTBAR_SWEEP };
+    const char *names[] = { "wigwag", "quad", "sweep" };
+
+    printf("pattern  pixels  render_ns  encode_ns  wire_us  period_us  fps\n");
+    for (size_t p = 0; p < sizeof(patterns) / sizeof(patterns[0]); p++) {
+        for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++) {
+            int num_pixels = lengths[l];
+            size_t len = (size_t)num_pixels * LIGHTBAR_BYTES_PER_PIXEL;
+            lightbar_sync_t sync = { .side_period_ms = 200 };
+
+            uint64_t render_ns = 0, encode_ns = 0;
+            for (int f = 0; f < FRAMES; f++) {
+                // Walk the sync inputs like a running siren
+                sync.side_ms = (f * 8) % sync.side_period_ms;
+                sync.red_side = ((f * 8) / sync.side_period_ms) % 2;
+                sync.sweep_pos = (uint16_t)(f * 331);
+                sync.sweep_up = (f / 100) % 2;
+
+                uint64_t t0 = now_ns();
+                lightbar_render(pixels, num_pixels, patterns[p], &sync);
+                uint64_t t1 = now_ns();
+                encode_frame(pixels, len, symbols);
+                uint64_t t2 = now_ns();
+                render_ns += t1 - t0;
+                encode_ns += t2 - t1;
+                if (f % 500 == 0) {
+                    check_frame(num_pixels, patterns[p], &sync);
+                }
+            }
+
+            uint32_t wire_us = lightbar_wire_us(num_pixels);
+            uint32_t period_us = lightbar_frame_us(num_pixels, LIGHTBAR_FPS);
+            CHECK(period_us >= wire_us, "%d pixels: period %lu us under wire time %lu us",
+                  num_pixels, (unsigned long)period_us, (unsigned long)wire_us);
+            CHECK(wire_us > 1000000 / LIGHTBAR_FPS || period_us == 1000000 / LIGHTBAR_FPS,
+                  "%d pixels: %lu us period, full rate fits", num_pixels, (unsigned long)period_us);
+            printf("%-7s  %6d  %9llu  %9llu  %7lu  %9lu  %3lu\n", names[p], num_pixels,
+                   (unsigned long long)(render_ns / FRAMES), (unsigned long long)(encode_ns / FRAMES),
+                   (unsigned long)wire_us, (unsigned long)period_us, (unsigned long)(1000000 / period_us));
+        }
+    }
+
+    if (failures) {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("All light bar checks passed\n");
+    return 0;
+}
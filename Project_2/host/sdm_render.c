@@ -0,0 +1,118 @@
+/* Sigma-delta voice renderer
+ *
+ * Renders one note of the buzzer's SDM voice with the firmware's
+ * sdm_voice.c and reports what the samples show, so a waveform, pitch or
+ * envelope setting can be checked (and listened to) before flashing.
+ *
+ *     sdm_render [options]
+ *       -w WAVE     sine, triangle, square or saw (default sine)
+ *       -f HZ       pitch (default 600, the siren's low tone)
+ *       -v VOL      volume 1-255 (default 200)
+ *       -r HZ       SDM update rate (default 16000)
+ *       -a MS       attack (default 5)
+ *       -d MS       release (default 20)
+ *       -l MS       note length, note-on to note-off (default 500)
+ *       -s MIN:MAX:MS  follow a siren sweep instead of a fixed pitch
+ *       -o FILE     write the samples as 8-bit WAV
+ *
+ * The report gives the attack and release in samples and ms, the peak
+ * density and the pitch measured from zero crossings while the note is
+ * held (the sweep's average pitch with -s).
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "voice_render.h"
+
+static const char *const wave_names[] = { "sine", "triangle", "square", "saw" };
+
+static bool parse_wave(const char *name, sdm_wave_t *wave)
+{
+    for (size_t i = 0; i < sizeof(wave_names) / sizeof(wave_names[0]); i++) {
+        if (strcmp(name, wave_names[i]) == 0) {
+            *wave = (sdm_wave_t)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr, "usage: %s [-w wave] [-f hz] [-v volume] [-r update_hz] [-a attack_ms]\n"
+                    "       [-d release_ms] [-l length_ms] [-s min:max:period_ms] [-o out.wav]\n", argv0);
+}
+
+int main(int argc, char **argv)
+{
+    voice_render_config_t config = {
+        .sample_rate = 16000,
+        .wave = SDM_WAVE_SINE,
+        .freq_q4 = 600 * 16,
+        .volume = 200,
+        .attack_ms = 5,
+        .release_ms = 20,
+        .hold_ms = 500
+    };
+    const char *wav_path = NULL;
+    int volume = config.volume;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "w:f:v:r:a:d:l:s:o:")) != -1) {
+        switch (opt) {
+            case 'w':
+                if (!parse_wave(optarg, &config.wave)) {
+                    usage(argv[0]);
+                    return 2;
+                }
+                break;
+            case 'f': config.freq_q4 = (uint32_t)(atof(optarg) * 16); break;
+            case 'v': volume = atoi(optarg); break;
+            case 'r': config.sample_rate = (uint32_t)atoi(optarg); break;
+            case 'a': config.attack_ms = (uint32_t)atoi(optarg); break;
+            case 'd': config.release_ms = (uint32_t)atoi(optarg); break;
+            case 'l': config.hold_ms = (uint32_t)atoi(optarg); break;
+            case 's':
+                if (sscanf(optarg, "%u:%u:%u", &config.sweep_min_hz, &config.sweep_max_hz,
+                           &config.sweep_period_ms) != 3) {
+                    usage(argv[0]);
+                    return 2;
+                }
+                break;
+            case 'o': wav_path = optarg; break;
+            default: usage(argv[0]); return 2;
+        }
+    }
+    if (optind != argc || volume < 1 || volume > 255 || config.sample_rate < 1000 ||
+        config.freq_q4 / 16 >= config.sample_rate / 2) {
+        usage(argv[0]);
+        return 2;
+    }
+    config.volume = (uint8_t)volume;
+
+    voice_buffer_t buf = { 0 };
+    if (!voice_render(&config, &buf)) {
+        fprintf(stderr, "render failed (bad sweep or out of memory)\n");
+        voice_buffer_free(&buf);
+        return 1;
+    }
+    voice_analysis_t analysis;
+    voice_analyse(&buf, &analysis);
+
+    double ms_per_sample = 1000.0 / config.sample_rate;
+    printf("wave %s, %u Hz update, volume %u\n", wave_names[config.wave],
+           (unsigned)config.sample_rate, (unsigned)config.volume);
+    printf("attack   %6zu samples  %7.2f ms\n", buf.attack_samples, buf.attack_samples * ms_per_sample);
+    printf("release  %6zu samples  %7.2f ms\n", buf.release_samples, buf.release_samples * ms_per_sample);
+    printf("peak     %6d (of %d)\n", analysis.peak, config.wave == SDM_WAVE_SAW ? 128 : 127);
+    printf("pitch    %9.2f Hz\n", analysis.pitch_hz);
+
+    int ret = 0;
+    if (wav_path && voice_write_wav(wav_path, &buf) != 0) {
+        perror(wav_path);
+        ret = 1;
+    }
+    voice_buffer_free(&buf);
+    return ret;
+}
@@ -0,0 +1,250 @@
+/* Host test for the SDM voice's rendered output
+ *
+ * Renders notes with the firmware's sdm_voice.c through voice_render.c and
+ * checks the samples, for every waveform at the lowest, default and
+ * highest update rates:
+ *   - peak density is the waveform's full scale times volume / 255
+ *   - pitch measured from zero crossings is within 1% of the note
+ *   - attack and release last ms * volume / 255 (the envelope sweeps the
+ *     full range in the set time), within 1% and a sample
+ *   - the output is silent once the release has finished
+ * plus a note that follows a siren sweep through freq_src, and the WAV
+ * file layout. A first-order model of the SDM turns each note into the
+ * pin's pulse stream; low-pass filtered, it must track the exact densities
+ * through the same filter within MAX_ERROR, with the tone's level
+ * following the envelope and its pitch within 1%.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "voice_render.h"
+
+#define SDM_MOD_HZ          1000000     // BUZZER_SDM_MOD_HZ, buzzer_sdm.h
+#define LISTEN_HZ           4000        // Two-pole listening filter on the bitstream
+// Density units (full scale 128) between the filtered bitstream and the
+// same filter on the exact densities
+#define MAX_ERROR           2.0
+#define MAX_RMS_ERROR       0.25
+#define MAX_ENVELOPE_ERROR  1.0         // Tone RMS over one period
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do { \
+    if (!(cond)) { \
+        printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+        printf(__VA_ARGS__); \
+        printf("\n"); \
+        failures++; \
+    } \
+} while (0)
+
+static const char *const wave_names[] = { "sine", "triangle", "square", "saw" };
+
+static bool near_samples(size_t got, double expected)
+{
+    return fabs((double)got - expected) <= expected * 0.01 + 1.0;
+}
+
+static void test_note(sdm_wave_t wave, uint32_t rate, uint8_t volume, uint32_t freq_hz)
+{
+    voice_render_config_t config = {
+        .sample_rate = rate,
+        .wave = wave,
+        .freq_q4 = freq_hz * 16,
+        .volume = volume,
+        .attack_ms = 5,
+        .release_ms = 20,
+        .hold_ms = 300
+    };
+    voice_buffer_t buf = { 0 };
+    bool ok = voice_render(&config, &buf);
+    CHECK(ok, "%s %u Hz: render failed", wave_names[wave], (unsigned)rate);
+    if (!ok) {
+        voice_buffer_free(&buf);
+        return;
+    }
+    voice_analysis_t a;
+    voice_analyse(&buf, &a);
+
+    int full_scale = (wave == SDM_WAVE_SAW) ? 128 : 127;
+    int expected_peak = full_scale * volume / 255;
+    CHECK(a.peak <= expected_peak && a.peak >= expected_peak - 1,
+          "%s %u Hz vol %u: peak %d, expected %d", wave_names[wave], (unsigned)rate, volume,
+          a.peak, expected_peak);
+    CHECK(fabs(a.pitch_hz - freq_hz) <= freq_hz * 0.01,
+          "%s %u Hz: pitch %.2f Hz, expected %u", wave_names[wave], (unsigned)rate, a.pitch_hz,
+          (unsigned)freq_hz);
+
+    double attack = config.attack_ms * (rate / 1000.0) * volume / 255.0;
+    double release = config.release_ms * (rate / 1000.0) * volume / 255.0;
+    CHECK(near_samples(buf.attack_samples, attack), "%s %u Hz vol %u: attack %zu samples, expected %.1f",
+          wave_names[wave], (unsigned)rate, volume, buf.attack_samples, attack);
+    CHECK(near_samples(buf.release_samples, release), "%s %u Hz vol %u: release %zu samples, expected %.1f",
+          wave_names[wave], (unsigned)rate, volume, buf.release_samples, release);
+    CHECK(a.tail_nonzero == 0, "%s %u Hz: %zu samples after the release",
+          wave_names[wave], (unsigned)rate, a.tail_nonzero);
+    voice_buffer_free(&buf);
+}
+
+static void test_hard_keying(void)
+{
+    // 0 ms envelope: full level on the first sample, silent on the next
+    voice_render_config_t config = {
+        .sample_rate = 16000, .wave = SDM_WAVE_SQUARE, .freq_q4 = 1000 * 16,
+        .volume = 255, .hold_ms = 10
+    };
+    voice_buffer_t buf = { 0 };
+    CHECK(voice_render(&config, &buf), "hard keying: render failed");
+    CHECK(buf.attack_samples == 1, "hard keying: attack %zu samples", buf.attack_samples);
+    CHECK(buf.release_samples == 1, "hard keying: release %zu samples", buf.release_samples);
+    voice_buffer_free(&buf);
+}
+
+static void test_sweep(void)
+{
+    // freq_src overrides the note's own pitch; whole sweeps average to the midpoint
+    voice_render_config_t config = {
+        .sample_rate = 16000, .wave = SDM_WAVE_SINE, .freq_q4 = 3000 * 16,
+        .volume = 200, .attack_ms = 1, .release_ms = 1, .hold_ms = 1200,
+        .sweep_min_hz = 600, .sweep_max_hz = 1200, .sweep_period_ms = 400
+    };
+    voice_buffer_t buf = { 0 };
+    CHECK(voice_render(&config, &buf), "sweep: render failed");
+    voice_analysis_t a;
+    voice_analyse(&buf, &a);
+    CHECK(fabs(a.pitch_hz - 900) <= 9, "sweep: average pitch %.2f Hz, expected 900", a.pitch_hz);
+    voice_buffer_free(&buf);
+}
+
+// RMS over one tone period, centred on n
+static double window_rms(const float *x, size_t n, size_t period, size_t count)
+{
+    size_t from = n >= period / 2 ? n - period / 2 : 0;
+    size_t to = from + period < count ? from + period : count;
+    double sum = 0;
+    for (size_t i = from; i < to; i++) {
+        sum += (double)x[i] * x[i];
+    }
+    return sqrt(sum / (to - from));
+}
+
+static void test_bitstream(sdm_wave_t wave, uint32_t rate)
+{
+    voice_render_config_t config = {
+        .sample_rate = rate, .wave = wave, .freq_q4 = 600 * 16,
+        .volume = 200, .attack_ms = 20, .release_ms = 40, .hold_ms = 200
+    };
+    voice_buffer_t buf = { 0 };
+    bool ok = voice_render(&config, &buf);
+    float *recovered = malloc(buf.num_samples * sizeof(float));
+    float *ideal = malloc(buf.num_samples * sizeof(float));
+    CHECK(ok && recovered && ideal, "bitstream %s %u Hz: render failed", wave_names[wave], (unsigned)rate);
+    if (!ok || !recovered || !ideal) {
+        free(recovered);
+        free(ideal);
+        voice_buffer_free(&buf);
+        return;
+    }
+    voice_sdm_recover(&buf, SDM_MOD_HZ, LISTEN_HZ, recovered, ideal);
+
+    // Sample by sample: the modulator's error left after the listening filter
+    double worst = 0, sum_sq = 0;
+    for (size_t n = 0; n < buf.num_samples; n++) {
+        double e = fabs((double)recovered[n] - ideal[n]);
+        worst = e > worst ? e : worst;
+        sum_sq += e * e;
+    }
+    double rms = sqrt(sum_sq / buf.num_samples);
+    CHECK(worst <= MAX_ERROR && rms <= MAX_RMS_ERROR,
+          "bitstream %s %u Hz: error %.2f peak %.2f rms, limits %.1f and %.1f",
+          wave_names[wave], (unsigned)rate, worst, rms, MAX_ERROR, MAX_RMS_ERROR);
+
+    // Envelope: tone amplitude through attack, hold and release
+    size_t period = rate / 600;
+    for (size_t n = 0; n < buf.num_samples; n += period) {
+        double got = window_rms(recovered, n, period, buf.num_samples);
+        double want = window_rms(ideal, n, period, buf.num_samples);
+        if (fabs(got - want) > MAX_ENVELOPE_ERROR) {
+            CHECK(0, "bitstream %s %u Hz: level %.2f at %.1f ms, expected %.2f", wave_names[wave],
+                  (unsigned)rate, got, n * 1000.0 / rate, want);
+            break;
+        }
+    }
+
+    // Tone: pitch from rising zero crossings of the recovered wave while held
+    size_t first = 0, last = 0, crossings = 0;
+    for (size_t n = buf.attack_samples + 1; n < buf.note_off; n++) {
+        if (recovered[n - 1] < 0 && recovered[n] >= 0) {
+            first = crossings++ ? first : n;
+            last = n;
+        }
+    }
+    double pitch = crossings > 1 ? (double)(crossings - 1) * rate / (double)(last - first) : 0;
+    CHECK(fabs(pitch - 600) <= 6, "bitstream %s %u Hz: recovered pitch %.2f Hz, expected 600",
+          wave_names[wave], (unsigned)rate, pitch);
+
+    free(recovered);
+    free(ideal);
+    voice_buffer_free(&buf);
+}
+
+static void test_wav(void)
+{
+    voice_render_config_t config = {
+        .sample_rate = 8000, .wave = SDM_WAVE_SAW, .freq_q4 = 440 * 16,
+        .volume = 255, .attack_ms = 2, .release_ms = 2, .hold_ms = 20
+    };
+    voice_buffer_t buf = { 0 };
+    CHECK(voice_render(&config, &buf), "wav: render failed");
+    char path[] = "/tmp/test_sdm_voice_XXXXXX";
+    int fd = mkstemp(path);
+    CHECK(fd >= 0, "wav: no temp file");
+    if (fd < 0) {
+        voice_buffer_free(&buf);
+        return;
+    }
+    CHECK(voice_write_wav(path, &buf) == 0, "wav: write failed");
+    FILE *f = fopen(path, "rb");
+    unsigned char data[64 * 1024];
+    size_t size = f ? fread(data, 1, sizeof(data), f) : 0;
+    if (f) {
+        fclose(f);
+    }
+    remove(path);
+    CHECK(size == 44 + buf.num_samples, "wav: %zu bytes for %zu samples", size, buf.num_samples);
+    CHECK(size > 44 && data[34] == 8 && data[24] == (8000 & 0xFF) && data[25] == (8000 >> 8),
+          "wav: header is not 8-bit at 8000 Hz");
+    for (size_t i = 0; i + 44 < size; i++) {
+        if (data[44 + i] != (unsigned char)(buf.samples[i] + 128)) {
+            CHECK(0, "wav: sample %zu is %u, expected %d", i, data[44 + i], buf.samples[i] + 128);
+            break;
+        }
+    }
+    voice_buffer_free(&buf);
+}
+
+int main(void)
+{
+    const uint32_t rates[] = { 8000, 16000, 48000 };
+    const uint8_t volumes[] = { 255, 200, 64 };
+    for (int w = SDM_WAVE_SINE; w <= SDM_WAVE_SAW; w++) {
+        for (size_t r = 0; r < sizeof(rates) / sizeof(rates[0]); r++) {
+            for (size_t v = 0; v < sizeof(volumes) / sizeof(volumes[0]); v++) {
+                test_note((sdm_wave_t)w, rates[r], volumes[v], 600);
+            }
+        }
+        test_note((sdm_wave_t)w, 16000, 200, 1200);
+        test_bitstream((sdm_wave_t)w, 8000);
+        test_bitstream((sdm_wave_t)w, 16000);
+    }
+    test_hard_keying();
+    test_sweep();
+    test_wav();
+
+    if (failures) {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("All SDM voice checks passed\n");
+    return 0;
+}
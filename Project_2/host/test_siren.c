@@ -0,0 +1,174 @@
+/* Host test for concurrent siren instances
+ *
+ * Steps the firmware's siren_sweep.c the way the scheduler ISR does: every
+ * instance on the list advances once per update, its divider goes to its
+ * own LEDC timer and the LED masks of all instances are merged into one
+ * set and one clear write of GPIO_OUT. Two instances with different pins,
+ * timers, sweep periods and LED periods run together for several sweeps,
+ * and each one's freq_q4, divider and LED levels are checked update by
+ * update against the same instance run on its own, plus:
+ *   - freq_q4 stays within the instance's limits and reaches both ends
+ *   - the divider is divider_k / freq_q4
+ *   - red and blue are never on together, one is lit from the first
+ *     switch on, and they switch every led_period_ms
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "siren_sweep.h"
+
+#define SIREN_UPDATE_HZ     2000        // Same as siren.h
+#define DIVIDER_K           ((80000000ULL << 12) >> 10)     // 80 MHz APB, 10-bit duty
+#define UPDATES             (SIREN_UPDATE_HZ * 5)
+#define NUM_TIMERS          4
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do { \
+    if (!(cond)) { \
+        printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+        printf(__VA_ARGS__); \
+        printf("\n"); \
+        failures++; \
+    } \
+} while (0)
+
+typedef struct {
+    const char *name;
+    int red_pin;
+    int blue_pin;
+    int timer;
+    siren_sweep_config_t config;
+} instance_t;
+
+// What one instance showed on one update
+typedef struct {
+    uint32_t freq_q4;
+    uint32_t divider;
+    bool red;
+    bool blue;
+} sample_t;
+
+static sample_t trace[2][UPDATES];
+
+// Runs the listed instances together; trace[i] gets what instance i showed
+static void run(const instance_t *const *list, size_t count, sample_t out[][UPDATES])
+{
+    siren_sweep_t sweeps[2];
+    for (size_t i = 0; i < count; i++) {
+        siren_sweep_config_t config = list[i]->config;
+        config.update_hz = SIREN_UPDATE_HZ;
+        config.divider_k = (uint32_t)DIVIDER_K;
+        config.red_mask = 1u << list[i]->red_pin;
+        config.blue_mask = 1u << list[i]->blue_pin;
+        siren_sweep_init(&sweeps[i], &config);
+    }
+
+    uint32_t gpio_out = 0;
+    uint32_t dividers[NUM_TIMERS] = { 0 };
+    for (uint32_t n = 0; n < UPDATES; n++) {
+        uint32_t set_mask = 0, clr_mask = 0;
+        for (size_t i = 0; i < count; i++) {
+            dividers[list[i]->timer] = siren_sweep_step(&sweeps[i], &set_mask, &clr_mask);
+        }
+        gpio_out |= set_mask;
+        gpio_out &= ~clr_mask;
+        for (size_t i = 0; i < count; i++) {
+            out[i][n].freq_q4 = sweeps[i].freq_q4;
+            out[i][n].divider = dividers[list[i]->timer];
+            out[i][n].red = (gpio_out >> list[i]->red_pin) & 1;
+            out[i][n].blue = (gpio_out >> list[i]->blue_pin) & 1;
+        }
+    }
+}
+
+static void check_alone(const instance_t *inst, const sample_t *got)
+{
+    const siren_sweep_config_t *c = &inst->config;
+    uint32_t min_q4 = c->freq_min * 16, max_q4 = c->freq_max * 16;
+    uint32_t lowest = UINT32_MAX, highest = 0;
+    uint32_t led_period = c->led_period_ms * SIREN_UPDATE_HZ / 1000;
+    uint32_t switches = 0, last_switch = 0;
+    bool red = false;
+
+    for (uint32_t n = 0; n < UPDATES; n++) {
+        const sample_t *s = &got[n];
+        if (s->freq_q4 < lowest) {
+            lowest = s->freq_q4;
+        }
+        if (s->freq_q4 > highest) {
+            highest = s->freq_q4;
+        }
+        if (s->divider != (uint32_t)(DIVIDER_K / s->freq_q4)) {
+            CHECK(0, "%s: update %u divider %u for %u/16 Hz", inst->name, (unsigned)n,
+                  (unsigned)s->divider, (unsigned)s->freq_q4);
+            break;
+        }
+        // Both dark until the first switch, one of them lit from then on
+        if (n + 1 >= led_period ? s->red == s->blue : s->red || s->blue) {
+            CHECK(0, "%s: update %u red %d blue %d", inst->name, (unsigned)n, s->red, s->blue);
+            break;
+        }
+        if (s->red != red) {
+            red = s->red;
+            if (n + 1 - last_switch != led_period) {
+                CHECK(0, "%s: switch at update %u, %u after the last, expected %u", inst->name,
+                      (unsigned)n, (unsigned)(n + 1 - last_switch), (unsigned)led_period);
+                break;
+            }
+            last_switch = n + 1;
+            switches++;
+        }
+    }
+    CHECK(lowest >= min_q4 && highest <= max_q4, "%s: freq_q4 %u..%u outside %u..%u", inst->name,
+          (unsigned)lowest, (unsigned)highest, (unsigned)min_q4, (unsigned)max_q4);
+    CHECK(lowest <= min_q4 + 16 && highest >= max_q4 - 16, "%s: sweep only reached %u..%u of %u..%u",
+          inst->name, (unsigned)lowest, (unsigned)highest, (unsigned)min_q4, (unsigned)max_q4);
+    CHECK(switches == UPDATES / led_period, "%s: %u LED switches, expected %u", inst->name,
+          (unsigned)switches, (unsigned)(UPDATES / led_period));
+}
+
+static void check_same(const instance_t *inst, const sample_t *alone, const sample_t *together)
+{
+    for (uint32_t n = 0; n < UPDATES; n++) {
+        const sample_t *a = &alone[n], *t = &together[n];
+        if (a->freq_q4 != t->freq_q4 || a->divider != t->divider || a->red != t->red ||
+            a->blue != t->blue) {
+            CHECK(0, "%s: update %u differs with two instances: freq %u/%u divider %u/%u red %d/%d blue %d/%d",
+                  inst->name, (unsigned)n, (unsigned)a->freq_q4, (unsigned)t->freq_q4,
+                  (unsigned)a->divider, (unsigned)t->divider, a->red, t->red, a->blue, t->blue);
+            return;
+        }
+    }
+}
+
+int main(void)
+{
+    // No two settings shared, so any cross-talk between instances shows
+    const instance_t front = {
+        .name = "front", .red_pin = 4, .blue_pin = 5, .timer = 0,
+        .config = { .freq_min = 600, .freq_max = 1200, .sweep_period_ms = 400, .led_period_ms = 150 }
+    };
+    const instance_t rear = {
+        .name = "rear", .red_pin = 18, .blue_pin = 19, .timer = 1,
+        .config = { .freq_min = 800, .freq_max = 1500, .sweep_period_ms = 1000, .led_period_ms = 250 }
+    };
+    const instance_t *const both[] = { &front, &rear };
+    static sample_t alone[2][UPDATES];
+
+    for (size_t i = 0; i < 2; i++) {
+        run(&both[i], 1, &alone[i]);
+        check_alone(both[i], alone[i]);
+    }
+    run(both, 2, trace);
+    for (size_t i = 0; i < 2; i++) {
+        check_same(both[i], alone[i], trace[i]);
+    }
+
+    if (failures) {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("All siren instance checks passed\n");
+    return 0;
+}
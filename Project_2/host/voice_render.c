@@ -0,0 +1,201 @@
+/* Offline sigma-delta voice renderer
+ *
+ * The envelope lengths come from the voice state while rendering; pitch
+ * and amplitude are measured afterwards from the samples, so a change to
+ * the waveform tables or the phase step shows up in the analysis. The SDM
+ * model turns the samples into the pin's pulse stream and filters it the
+ * way the buzzer hears it.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "voice_render.h"
+
+#define SIREN_UPDATE_HZ     2000        // Same as siren.h
+#define TAIL_MS             10          // Rendered after the release ends
+
+static bool reserve(voice_buffer_t *buf, size_t count)
+{
+    if (count <= buf->capacity) {
+        return true;
+    }
+    int8_t *samples = realloc(buf->samples, count);
+    if (samples == NULL) {
+        return false;
+    }
+    buf->samples = samples;
+    buf->capacity = count;
+    return true;
+}
+
+// Triangle sweep between the limits, one point per siren update
+static uint32_t sweep_freq_q4(const voice_render_config_t *config, uint64_t update)
+{
+    uint64_t period_updates = (uint64_t)config->sweep_period_ms * SIREN_UPDATE_HZ / 1000;
+    uint64_t pos = update % period_updates;
+    uint64_t half = period_updates / 2;
+    uint64_t tri = (pos < half) ? pos : period_updates - pos;
+    uint32_t span_q4 = (config->sweep_max_hz - config->sweep_min_hz) * 16;
+    return config->sweep_min_hz * 16 + (uint32_t)(span_q4 * tri / (half ? half : 1));
+}
+
+bool voice_render(const voice_render_config_t *config, voice_buffer_t *buf)
+{
+    if (config->sample_rate == 0 || config->volume == 0 ||
+        (config->sweep_period_ms && config->sweep_max_hz <= config->sweep_min_hz)) {
+        return false;
+    }
+    sdm_voice_t voice;
+    sdm_voice_init(&voice, config->sample_rate);
+    voice.wave = config->wave;
+    sdm_voice_set_envelope(&voice, config->attack_ms, config->release_ms);
+
+    volatile uint32_t siren_freq_q4 = config->freq_q4;
+    if (config->sweep_period_ms) {
+        siren_freq_q4 = sweep_freq_q4(config, 0);
+        voice.freq_src = &siren_freq_q4;
+    }
+
+    // The release can't outlast a full-range sweep at the release step
+    size_t rate_ms = config->sample_rate / 1000;
+    size_t hold = (size_t)config->hold_ms * rate_ms;
+    size_t max_release = (size_t)(255u << 8) / (voice.release_step ? voice.release_step : 1) + 1;
+    size_t tail = (size_t)TAIL_MS * rate_ms;
+    if (!reserve(buf, hold + max_release + tail)) {
+        return false;
+    }
+
+    buf->num_samples = 0;
+    buf->sample_rate = config->sample_rate;
+    buf->attack_samples = 0;
+    buf->release_samples = 0;
+    uint32_t per_update = config->sample_rate / SIREN_UPDATE_HZ;
+    uint64_t update = 0;
+    bool attacked = false, released = false;
+    size_t tail_left = tail;
+
+    sdm_voice_note_on(&voice, config->freq_q4, config->volume);
+    for (size_t n = 0; n < buf->capacity; n++) {
+        if (n == hold) {
+            sdm_voice_note_off(&voice);
+            buf->note_off = n;
+        }
+        if (config->sweep_period_ms && per_update && n % per_update == 0) {
+            siren_freq_q4 = sweep_freq_q4(config, update++);
+        }
+        buf->samples[n] = sdm_voice_next(&voice);
+        buf->num_samples = n + 1;
+
+        if (!attacked && voice.level == (uint32_t)config->volume << 8) {
+            attacked = true;
+            buf->attack_samples = n + 1;
+        }
+        if (n >= hold && !released && voice.level == 0) {
+            released = true;
+            buf->release_samples = n + 1 - hold;
+        }
+        if (released && tail_left-- == 0) {
+            break;
+        }
+    }
+    return attacked && released;
+}
+
+void voice_analyse(const voice_buffer_t *buf, voice_analysis_t *out)
+{
+    memset(out, 0, sizeof(*out));
+    size_t from = buf->attack_samples;
+    size_t to = buf->note_off;
+
+    // Rising zero crossings: last sample below zero, this one at or above
+    size_t first = 0, last = 0, crossings = 0;
+    for (size_t i = from; i < to; i++) {
+        int s = buf->samples[i];
+        int a = s < 0 ? -s : s;
+        if (a > out->peak) {
+            out->peak = a;
+        }
+        if (i > from && buf->samples[i - 1] < 0 && s >= 0) {
+            if (crossings == 0) {
+                first = i;
+            }
+            last = i;
+            crossings++;
+        }
+    }
+    if (crossings > 1) {
+        out->pitch_hz = (double)(crossings - 1) * buf->sample_rate / (double)(last - first);
+    }
+
+    for (size_t i = buf->note_off + buf->release_samples; i < buf->num_samples; i++) {
+        out->tail_nonzero += buf->samples[i] != 0;
+    }
+}
+
+void voice_sdm_recover(const voice_buffer_t *buf, uint32_t mod_hz, uint32_t cutoff_hz,
+                       float *recovered, float *ideal)
+{
+    uint32_t clocks = mod_hz / buf->sample_rate;
+    double alpha = 1.0 - exp(-2.0 * M_PI * cutoff_hz / mod_hz);
+    uint32_t acc = 0;
+    double r1 = 0.5, r2 = 0.5, i1 = 0.5, i2 = 0.5;  // Duty, starting from silence
+
+    for (size_t n = 0; n < buf->num_samples; n++) {
+        uint32_t step = (uint32_t)(buf->samples[n] + 128);
+        double duty = step / 256.0;
+        for (uint32_t c = 0; c < clocks; c++) {
+            acc += step;
+            double bit = (acc >> 8) & 1;
+            acc &= 0xFF;
+            r1 += alpha * (bit - r1);
+            r2 += alpha * (r1 - r2);
+            i1 += alpha * (duty - i1);
+            i2 += alpha * (i1 - i2);
+        }
+        recovered[n] = (float)(r2 * 256.0 - 128.0);
+        ideal[n] = (float)(i2 * 256.0 - 128.0);
+    }
+}
+
+void voice_buffer_free(voice_buffer_t *buf)
+{
+    free(buf->samples);
+    memset(buf, 0, sizeof(*buf));
+}
+
+static void put_le(uint8_t *p, uint32_t value, int bytes)
+{
+    for (int i = 0; i < bytes; i++) {
+        p[i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+int voice_write_wav(const char *path, const voice_buffer_t *buf)
+{
+    FILE *f = fopen(path, "wb");
+    if (f == NULL) {
+        return -1;
+    }
+    // 8-bit mono PCM is unsigned, centred on 128
+    uint32_t data_bytes = (uint32_t)buf->num_samples;
+    uint8_t header[44];
+    memcpy(header, "RIFF", 4);
+    put_le(header + 4, 36 + data_bytes, 4);
+    memcpy(header + 8, "WAVEfmt ", 8);
+    put_le(header + 16, 16, 4);
+    put_le(header + 20, 1, 2);
+    put_le(header + 22, 1, 2);
+    put_le(header + 24, buf->sample_rate, 4);
+    put_le(header + 28, buf->sample_rate, 4);
+    put_le(header + 32, 1, 2);
+    put_le(header + 34, 8, 2);
+    memcpy(header + 36, "data", 4);
+    put_le(header + 40, data_bytes, 4);
+
+    int ok = fwrite(header, sizeof(header), 1, f) == 1;
+    for (size_t i = 0; ok && i < buf->num_samples; i++) {
+        ok = fputc(buf->samples[i] + 128, f) != EOF;
+    }
+    return (fclose(f) == 0 && ok) ? 0 : -1;
+}
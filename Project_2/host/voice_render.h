@@ -0,0 +1,63 @@
+/* Offline sigma-delta voice renderer
+ * Runs the firmware voice (sdm_voice.c) one sample per SDM update, exactly
+ * as the buzzer ISR does: note-on, hold, note-off, then on until the
+ * release reaches silence. The pitch is fixed or follows a siren sweep
+ * stepped at SIREN_UPDATE_HZ like the siren scheduler. The samples are the
+ * signed 8-bit pulse densities the SDM would be given.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "sdm_voice.h"
+
+typedef struct {
+    uint32_t sample_rate;       // SDM update rate (8000..48000 on the device)
+    sdm_wave_t wave;
+    uint32_t freq_q4;           // Pitch in 1/16 Hz
+    uint8_t volume;
+    uint32_t attack_ms;
+    uint32_t release_ms;
+    uint32_t hold_ms;           // Note-on to note-off
+    // Optional siren sweep the pitch follows; sweep_period_ms 0 = fixed pitch
+    uint32_t sweep_min_hz;
+    uint32_t sweep_max_hz;
+    uint32_t sweep_period_ms;
+} voice_render_config_t;
+
+typedef struct {
+    int8_t *samples;
+    size_t num_samples;
+    size_t capacity;
+    uint32_t sample_rate;
+    size_t attack_samples;      // Note-on until the envelope reached the volume
+    size_t note_off;            // Sample index of the note-off
+    size_t release_samples;     // Note-off until the envelope reached 0
+} voice_buffer_t;
+
+// What the rendered samples show, measured from the samples alone
+typedef struct {
+    int peak;                   // Largest |density| while held at full level
+    double pitch_hz;            // From rising zero crossings while held
+    size_t tail_nonzero;        // Non-zero samples after the release ended
+} voice_analysis_t;
+
+// Returns false on a bad configuration or out of memory
+bool voice_render(const voice_render_config_t *config, voice_buffer_t *buf);
+void voice_analyse(const voice_buffer_t *buf, voice_analysis_t *out);
+void voice_buffer_free(voice_buffer_t *buf);
+
+// First-order sigma-delta model of the SDM peripheral. Each density d is
+// held for mod_hz / sample_rate modulator clocks; every clock adds d + 128
+// to an 8-bit accumulator and the carry out is the pin level, so the pulse
+// density is (d + 128) / 256 as the driver documents. The bitstream goes
+// through a two-pole RC low-pass at cutoff_hz (the listening filter) and
+// is read at the end of each sample, back in density units. ideal gets
+// the same filter applied to the exact densities, so recovered - ideal is
+// the modulator's error alone. Both arrays hold buf->num_samples values.
+void voice_sdm_recover(const voice_buffer_t *buf, uint32_t mod_hz, uint32_t cutoff_hz,
+                       float *recovered, float *ideal);
+
+// 8-bit unsigned mono PCM, density + 128
+int voice_write_wav(const char *path, const voice_buffer_t *buf);
@@ -0,0 +1,147 @@
+/* Sigma-delta buzzer output
+ *
+ * The SDM peripheral turns a signed 8-bit density into a pulse stream at
+ * BUZZER_SDM_MOD_HZ; the buzzer (or an RC filter in front of it) averages
+ * that stream into the waveform. The update ISR only has to produce the
+ * next sample, so its cost is a phase add, one table lookup and one
+ * multiply regardless of waveform.
+ */
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "driver/gptimer.h"
+#include "driver/sdm.h"
+#include "esp_cpu.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "buzzer_sdm.h"
+
+static const char *TAG = "BUZZER_SDM";
+
+static sdm_channel_handle_t sdm_channel = NULL;
+static gptimer_handle_t update_timer = NULL;
+static sdm_voice_t voice;
+static buzzer_sdm_stats_t stats;
+static portMUX_TYPE voice_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static IRAM_ATTR bool buzzer_sdm_update_isr(gptimer_handle_t timer, const gptimer_alarm_event_data_t *edata, void *user_ctx)
+{
+    uint32_t start = esp_cpu_get_cycle_count();
+
+    portENTER_CRITICAL_ISR(&voice_lock);
+    int8_t density = sdm_voice_next(&voice);
+    portEXIT_CRITICAL_ISR(&voice_lock);
+    sdm_channel_set_pulse_density(sdm_channel, density);
+
+    uint32_t cycles = esp_cpu_get_cycle_count() - start;
+    stats.updates++;
+    stats.total_cycles += cycles;
+    if (cycles > stats.max_cycles) {
+        stats.max_cycles = cycles;
+    }
+    return false;
+}
+
+esp_err_t buzzer_sdm_init(const buzzer_sdm_config_t *config)
+{
+    if (config == NULL || config->update_hz < 8000 || config->update_hz > 48000) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (sdm_channel != NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    sdm_voice_init(&voice, config->update_hz);
+    voice.wave = config->wave;
+    sdm_voice_set_envelope(&voice, config->attack_ms, config->release_ms);
+    memset(&stats, 0, sizeof(stats));
+
+    // Claims the pin through the GPIO matrix, replacing any LEDC routing
+    sdm_config_t sdm_cfg = {
+        .gpio_num = config->pin,
+        .clk_src = SDM_CLK_SRC_DEFAULT,
+        .sample_rate_hz = BUZZER_SDM_MOD_HZ
+    };
+    ESP_ERROR_CHECK(sdm_new_channel(&sdm_cfg, &sdm_channel));
+    ESP_ERROR_CHECK(sdm_channel_enable(sdm_channel));
+    ESP_ERROR_CHECK(sdm_channel_set_pulse_density(sdm_channel, 0));
+
+    gptimer_config_t timer_config = {
+        .clk_src = GPTIMER_CLK_SRC_DEFAULT,
+        .direction = GPTIMER_COUNT_UP,
+        .resolution_hz = BUZZER_SDM_TIMER_HZ
+    };
+    ESP_ERROR_CHECK(gptimer_new_timer(&timer_config, &update_timer));
+    gptimer_event_callbacks_t callbacks = {
+        .on_alarm = buzzer_sdm_update_isr
+    };
+    ESP_ERROR_CHECK(gptimer_register_event_callbacks(update_timer, &callbacks, NULL));
+    gptimer_alarm_config_t alarm = {
+        .alarm_count = BUZZER_SDM_TIMER_HZ / config->update_hz,
+        .reload_count = 0,
+        .flags.auto_reload_on_alarm = true
+    };
+    ESP_ERROR_CHECK(gptimer_set_alarm_action(update_timer, &alarm));
+    ESP_ERROR_CHECK(gptimer_enable(update_timer));
+
+    ESP_LOGI(TAG, "SDM buzzer on GPIO%d: %lu Hz updates, %d Hz modulator, wave %d",
+             config->pin, (unsigned long)config->update_hz, BUZZER_SDM_MOD_HZ, config->wave);
+    return gptimer_start(update_timer);
+}
+
+esp_err_t buzzer_sdm_deinit(void)
+{
+    if (sdm_channel == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    ESP_ERROR_CHECK(gptimer_stop(update_timer));
+    ESP_ERROR_CHECK(gptimer_disable(update_timer));
+    ESP_ERROR_CHECK(gptimer_del_timer(update_timer));
+    update_timer = NULL;
+    ESP_ERROR_CHECK(sdm_channel_set_pulse_density(sdm_channel, 0));
+    ESP_ERROR_CHECK(sdm_channel_disable(sdm_channel));
+    ESP_ERROR_CHECK(sdm_del_channel(sdm_channel));
+    sdm_channel = NULL;
+    return ESP_OK;
+}
+
+void buzzer_sdm_set_wave(sdm_wave_t wave)
+{
+    portENTER_CRITICAL(&voice_lock);
+    voice.wave = wave;
+    portEXIT_CRITICAL(&voice_lock);
+}
+
+void buzzer_sdm_note_on(uint32_t freq_q4, uint8_t volume)
+{
+    portENTER_CRITICAL(&voice_lock);
+    sdm_voice_note_on(&voice, freq_q4, volume);
+    portEXIT_CRITICAL(&voice_lock);
+}
+
+void buzzer_sdm_note_off(void)
+{
+    portENTER_CRITICAL(&voice_lock);
+    sdm_voice_note_off(&voice);
+    portEXIT_CRITICAL(&voice_lock);
+}
+
+void buzzer_sdm_follow(const volatile uint32_t *freq_q4)
+{
+    portENTER_CRITICAL(&voice_lock);
+    voice.freq_src = freq_q4;
+    portEXIT_CRITICAL(&voice_lock);
+}
+
+void buzzer_sdm_get_stats(buzzer_sdm_stats_t *out)
+{
+    portENTER_CRITICAL(&voice_lock);
+    *out = stats;
+    portEXIT_CRITICAL(&voice_lock);
+}
+
+void buzzer_sdm_reset_stats(void)
+{
+    portENTER_CRITICAL(&voice_lock);
+    memset(&stats, 0, sizeof(stats));
+    portEXIT_CRITICAL(&voice_lock);
+}
@@ -0,0 +1,42 @@
+/* Sigma-delta buzzer output
+ * Drives the buzzer pin from the SDM peripheral instead of a fixed-duty
+ * LEDC square wave. A GPTimer ISR renders one sdm_voice sample per update
+ * and writes it as the pulse density, giving volume and timbre control
+ * on a plain GPIO. Needs CONFIG_SDM_CTRL_FUNC_IN_IRAM so the density
+ * update stays callable while the flash cache is disabled.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "driver/gpio.h"
+#include "sdm_voice.h"
+
+#define BUZZER_SDM_MOD_HZ       1000000     // Modulator clock (pulse rate on the pin)
+#define BUZZER_SDM_TIMER_HZ     8000000     // GPTimer resolution for the update alarm
+
+typedef struct {
+    gpio_num_t pin;
+    uint32_t update_hz;         // Samples per second (8000..48000)
+    sdm_wave_t wave;
+    uint32_t attack_ms;
+    uint32_t release_ms;
+} buzzer_sdm_config_t;
+
+// ISR timing statistics
+typedef struct {
+    uint32_t updates;           // Samples written
+    uint64_t total_cycles;      // Cycles spent in the ISR
+    uint32_t max_cycles;        // Worst-case cycles for a single ISR
+} buzzer_sdm_stats_t;
+
+esp_err_t buzzer_sdm_init(const buzzer_sdm_config_t *config);
+esp_err_t buzzer_sdm_deinit(void);
+void buzzer_sdm_set_wave(sdm_wave_t wave);
+void buzzer_sdm_note_on(uint32_t freq_q4, uint8_t volume);
+void buzzer_sdm_note_off(void);
+// Take pitch from a live Q4 source (e.g. a siren's freq_q4), NULL to stop following
+void buzzer_sdm_follow(const volatile uint32_t *freq_q4);
+void buzzer_sdm_get_stats(buzzer_sdm_stats_t *stats);
+void buzzer_sdm_reset_stats(void);
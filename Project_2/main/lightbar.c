@@ -0,0 +1,316 @@
+/* RMT-driven WS2812 light bar
+ *
+ * A periodic esp_timer wakes the render task once per frame. The task
+ * renders into whichever of the two frame buffers is free and queues it
+ * on the RMT channel; the RMT encoder converts bytes to WS2812 symbols
+ * while the strip is being clocked, and the TX-done callback hands the
+ * buffer back. The original ESP32 RMT has no DMA, so the channel uses
+ * ping-pong refills of its symbol memory instead.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "driver/rmt_tx.h"
+#include "esp_timer.h"
+#include "esp_cpu.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "lightbar.h"
+
+static const char *TAG = "LIGHTBAR";
+
+#define RENDER_TASK_PRIO    6
+#define RMT_MEM_SYMBOLS     128     // Two RMT memory blocks for ping-pong refill
+#define NUM_FRAME_BUFFERS   2
+
+// WS2812 encoder: pixel bytes followed by the latch (reset) low time
+typedef struct {
+    rmt_encoder_t base;
+    rmt_encoder_t *bytes_encoder;
+    rmt_encoder_t *copy_encoder;
+    int state;
+    rmt_symbol_word_t reset_code;
+} ws2812_encoder_t;
+
+static uint8_t frame_buffers[NUM_FRAME_BUFFERS][LIGHTBAR_MAX_PIXELS * LIGHTBAR_BYTES_PER_PIXEL];
+static int next_buffer = 0;                     // Buffer the next frame renders into
+static int tx_head = 0;                         // Buffer the next TX-done belongs to
+static int64_t submit_time[NUM_FRAME_BUFFERS];
+
+static rmt_channel_handle_t led_chan = NULL;
+static rmt_encoder_t *led_encoder = NULL;
+static SemaphoreHandle_t free_buffers = NULL;
+static TaskHandle_t render_task_handle = NULL;
+static esp_timer_handle_t frame_timer = NULL;
+static uint32_t frame_period_us = 0;
+
+static volatile int strip_pixels = 0;
+static volatile lightbar_pattern_t active_pattern = LIGHTBAR_WIGWAG;
+static lightbar_sync_t sync_state = { .side_period_ms = 200 };
+static int64_t side_start_us = 0;
+static lightbar_stats_t stats;
+static portMUX_TYPE sync_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static IRAM_ATTR size_t ws2812_encode(rmt_encoder_t *encoder, rmt_channel_handle_t channel,
+                                      const void *primary_data, size_t data_size,
+                                      rmt_encode_state_t *ret_state)
+{
+    uint32_t start = esp_cpu_get_cycle_count();
+    ws2812_encoder_t *ws = __containerof(encoder, ws2812_encoder_t, base);
+    rmt_encode_state_t session_state = RMT_ENCODING_RESET;
+    rmt_encode_state_t state = RMT_ENCODING_RESET;
+    size_t encoded_symbols = 0;
+
+    switch (ws->state) {
+        case 0:
+            // Pixel data
+            encoded_symbols += ws->bytes_encoder->encode(ws->bytes_encoder, channel,
+                                                         primary_data, data_size, &session_state);
+            if (session_state & RMT_ENCODING_COMPLETE) {
+                ws->state = 1;
+            }
+            if (session_state & RMT_ENCODING_MEM_FULL) {
+                state |= RMT_ENCODING_MEM_FULL;
+                break;
+            }
+            // fall through
+        case 1:
+            // Latch
+            encoded_symbols += ws->copy_encoder->encode(ws->copy_encoder, channel, &ws->reset_code,
+                                                        sizeof(ws->reset_code), &session_state);
+            if (session_state & RMT_ENCODING_COMPLETE) {
+                ws->state = RMT_ENCODING_RESET;
+                state |= RMT_ENCODING_COMPLETE;
+            }
+            if (session_state & RMT_ENCODING_MEM_FULL) {
+                state |= RMT_ENCODING_MEM_FULL;
+            }
+            break;
+    }
+
+    *ret_state = state;
+    stats.encode_cycles += esp_cpu_get_cycle_count() - start;
+    return encoded_symbols;
+}
+
+static esp_err_t ws2812_reset(rmt_encoder_t *encoder)
+{
+    ws2812_encoder_t *ws = __containerof(encoder, ws2812_encoder_t, base);
+    rmt_encoder_reset(ws->bytes_encoder);
+    rmt_encoder_reset(ws->copy_encoder);
+    ws->state = RMT_ENCODING_RESET;
+    return ESP_OK;
+}
+
+static esp_err_t ws2812_del(rmt_encoder_t *encoder)
+{
+    ws2812_encoder_t *ws = __containerof(encoder, ws2812_encoder_t, base);
+    rmt_del_encoder(ws->bytes_encoder);
+    rmt_del_encoder(ws->copy_encoder);
+    free(ws);
+    return ESP_OK;
+}
+
+static esp_err_t ws2812_new_encoder(rmt_encoder_t **ret_encoder)
+{
+    ws2812_encoder_t *ws = calloc(1, sizeof(ws2812_encoder_t));
+    if (ws == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    ws->base.encode = ws2812_encode;
+    ws->base.reset = ws2812_reset;
+    ws->base.del = ws2812_del;
+
+    // WS2812 bit timing: T0H 0.3 us / T0L 0.9 us, T1H 0.9 us / T1L 0.3 us
+    const uint32_t ticks_per_us = LIGHTBAR_RMT_RES_HZ / 1000000;
+    rmt_bytes_encoder_config_t bytes_config = {
+        .bit0 = {
+            .level0 = 1, .duration0 = 3 * ticks_per_us / 10,
+            .level1 = 0, .duration1 = 9 * ticks_per_us / 10,
+        },
+        .bit1 = {
+            .level0 = 1, .duration0 = 9 * ticks_per_us / 10,
+            .level1 = 0, .duration1 = 3 * ticks_per_us / 10,
+        },
+        .flags.msb_first = 1
+    };
+    esp_err_t ret = rmt_new_bytes_encoder(&bytes_config, &ws->bytes_encoder);
+    if (ret == ESP_OK) {
+        rmt_copy_encoder_config_t copy_config = {};
+        ret = rmt_new_copy_encoder(&copy_config, &ws->copy_encoder);
+    }
+    if (ret != ESP_OK) {
+        if (ws->bytes_encoder) {
+            rmt_del_encoder(ws->bytes_encoder);
+        }
+        free(ws);
+        return ret;
+    }
+
+    uint32_t reset_ticks = ticks_per_us * LIGHTBAR_LATCH_US / 2;
+    ws->reset_code = (rmt_symbol_word_t) {
+        .level0 = 0, .duration0 = reset_ticks,
+        .level1 = 0, .duration1 = reset_ticks,
+    };
+    *ret_encoder = &ws->base;
+    return ESP_OK;
+}
+
+static IRAM_ATTR bool tx_done_cb(rmt_channel_handle_t channel, const rmt_tx_done_event_data_t *edata, void *user_ctx)
+{
+    BaseType_t woken = pdFALSE;
+    stats.tx_us += esp_timer_get_time() - submit_time[tx_head];
+    stats.tx_done++;
+    tx_head = (tx_head + 1) % NUM_FRAME_BUFFERS;
+    xSemaphoreGiveFromISR(free_buffers, &woken);
+    return woken == pdTRUE;
+}
+
+static void frame_tick(void *arg)
+{
+    xTaskNotifyGive(render_task_handle);
+}
+
+static void render_task(void *arg)
+{
+    rmt_transmit_config_t tx_config = {
+        .loop_count = 0
+    };
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        // Both buffers still on the wire: skip this frame tick
+        if (xSemaphoreTake(free_buffers, 0) != pdTRUE) {
+            stats.dropped++;
+            continue;
+        }
+
+        lightbar_sync_t sync;
+        portENTER_CRITICAL(&sync_lock);
+        sync = sync_state;
+        sync.side_ms = (uint32_t)((esp_timer_get_time() - side_start_us) / 1000);
+        portEXIT_CRITICAL(&sync_lock);
+
+        // Buffers are queued and completed in strict rotation
+        int buf = next_buffer;
+        next_buffer = (next_buffer + 1) % NUM_FRAME_BUFFERS;
+        int num_pixels = strip_pixels;
+        uint8_t *pixels = frame_buffers[buf];
+
+        uint32_t start = esp_cpu_get_cycle_count();
+        lightbar_render(pixels, num_pixels, active_pattern, &sync);
+        uint32_t cycles = esp_cpu_get_cycle_count() - start;
+        stats.render_cycles += cycles;
+        if (cycles > stats.max_render_cycles) {
+            stats.max_render_cycles = cycles;
+        }
+
+        submit_time[buf] = esp_timer_get_time();
+        stats.frames++;
+        ESP_ERROR_CHECK(rmt_transmit(led_chan, led_encoder, pixels,
+                                     num_pixels * LIGHTBAR_BYTES_PER_PIXEL, &tx_config));
+    }
+}
+
+esp_err_t lightbar_init(gpio_num_t pin, int num_pixels, lightbar_pattern_t pattern)
+{
+    if (num_pixels <= 0 || num_pixels > LIGHTBAR_MAX_PIXELS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    strip_pixels = num_pixels;
+    active_pattern = pattern;
+    side_start_us = esp_timer_get_time();
+
+    rmt_tx_channel_config_t chan_config = {
+        .gpio_num = pin,
+        .clk_src = RMT_CLK_SRC_DEFAULT,
+        .resolution_hz = LIGHTBAR_RMT_RES_HZ,
+        .mem_block_symbols = RMT_MEM_SYMBOLS,
+        .trans_queue_depth = NUM_FRAME_BUFFERS
+    };
+    ESP_ERROR_CHECK(rmt_new_tx_channel(&chan_config, &led_chan));
+    ESP_ERROR_CHECK(ws2812_new_encoder(&led_encoder));
+
+    rmt_tx_event_callbacks_t callbacks = {
+        .on_trans_done = tx_done_cb
+    };
+    ESP_ERROR_CHECK(rmt_tx_register_event_callbacks(led_chan, &callbacks, NULL));
+    ESP_ERROR_CHECK(rmt_enable(led_chan));
+
+    free_buffers = xSemaphoreCreateCounting(NUM_FRAME_BUFFERS, NUM_FRAME_BUFFERS);
+    if (free_buffers == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    if (xTaskCreate(render_task, "lightbar", 3072, NULL, RENDER_TASK_PRIO, &render_task_handle) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    esp_timer_create_args_t timer_args = {
+        .callback = frame_tick,
+        .name = "lightbar_frame"
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &frame_timer));
+    frame_period_us = lightbar_frame_us(num_pixels, LIGHTBAR_FPS);
+    ESP_ERROR_CHECK(esp_timer_start_periodic(frame_timer, frame_period_us));
+
+    ESP_LOGI(TAG, "Light bar on GPIO%d: %d pixels at %lu FPS", pin, num_pixels,
+             (unsigned long)(1000000 / frame_period_us));
+    return ESP_OK;
+}
+
+esp_err_t lightbar_set_length(int num_pixels)
+{
+    if (num_pixels <= 0 || num_pixels > LIGHTBAR_MAX_PIXELS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    strip_pixels = num_pixels;
+
+    // The frame period follows the strip's wire time
+    uint32_t period_us = lightbar_frame_us(num_pixels, LIGHTBAR_FPS);
+    if (frame_timer != NULL && period_us != frame_period_us) {
+        frame_period_us = period_us;
+        esp_timer_stop(frame_timer);
+        ESP_ERROR_CHECK(esp_timer_start_periodic(frame_timer, period_us));
+    }
+    return ESP_OK;
+}
+
+void lightbar_set_pattern(lightbar_pattern_t pattern)
+{
+    active_pattern = pattern;
+}
+
+void lightbar_sync_side(bool red_side, uint32_t side_period_ms)
+{
+    portENTER_CRITICAL(&sync_lock);
+    sync_state.red_side = red_side;
+    sync_state.side_period_ms = side_period_ms;
+    side_start_us = esp_timer_get_time();
+    portEXIT_CRITICAL(&sync_lock);
+}
+
+void lightbar_sync_sweep(int freq, int freq_min, int freq_max, bool rising)
+{
+    uint32_t span = (freq_max > freq_min) ? (uint32_t)(freq_max - freq_min) : 1;
+    uint32_t pos = (freq <= freq_min) ? 0 : (uint32_t)(freq - freq_min);
+    if (pos > span) {
+        pos = span;
+    }
+    portENTER_CRITICAL(&sync_lock);
+    sync_state.sweep_pos = (uint16_t)((pos * 65535u) / span);
+    sync_state.sweep_up = rising;
+    portEXIT_CRITICAL(&sync_lock);
+}
+
+void lightbar_get_stats(lightbar_stats_t *out)
+{
+    *out = stats;
+}
+
+void lightbar_reset_stats(void)
+{
+    memset(&stats, 0, sizeof(stats));
+}
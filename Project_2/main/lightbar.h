@@ -0,0 +1,36 @@
+/* RMT-driven WS2812 light bar
+ * Renders lightbar_fx patterns at a fixed frame rate and streams them to
+ * the strip through an RMT TX channel with two frame buffers in flight.
+ * The rate is LIGHTBAR_FPS, or what the strip's wire time allows if that
+ * is lower (lightbar_frame_us()).
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "driver/gpio.h"
+#include "lightbar_fx.h"
+
+#define LIGHTBAR_MAX_PIXELS     300
+#define LIGHTBAR_FPS            120         // Strips over 287 pixels run slower
+#define LIGHTBAR_RMT_RES_HZ     10000000    // 0.1 us per RMT tick
+
+// Per-frame timing statistics
+typedef struct {
+    uint32_t frames;            // Frames rendered and queued
+    uint32_t dropped;           // Frame ticks skipped (both buffers busy)
+    uint64_t render_cycles;     // Cycles spent in the frame generator
+    uint32_t max_render_cycles;
+    uint64_t encode_cycles;     // Cycles spent in the RMT encoder
+    uint64_t tx_us;             // Submit-to-done time of completed frames
+    uint32_t tx_done;           // Completed transmissions
+} lightbar_stats_t;
+
+esp_err_t lightbar_init(gpio_num_t pin, int num_pixels, lightbar_pattern_t pattern);
+esp_err_t lightbar_set_length(int num_pixels);
+void lightbar_set_pattern(lightbar_pattern_t pattern);
+void lightbar_sync_side(bool red_side, uint32_t side_period_ms);
+void lightbar_sync_sweep(int freq, int freq_min, int freq_max, bool rising);
+void lightbar_get_stats(lightbar_stats_t *stats);
+void lightbar_reset_stats(void);
@@ -0,0 +1,86 @@
+/* Light bar frame generator
+ * Every pattern is a single O(pixels) pass with integer math only.
+ */
+#include <string.h>
+#include "lightbar_fx.h"
+
+#define LEVEL_FULL      255
+#define LEVEL_DIM       12      // Background glow of the inactive half
+#define FLASHES_PER_SIDE 4
+
+static inline void set_pixel(uint8_t *pixels, int i, uint8_t r, uint8_t g, uint8_t b)
+{
+    uint8_t *p = &pixels[i * LIGHTBAR_BYTES_PER_PIXEL];
+    p[0] = g;
+    p[1] = r;
+    p[2] = b;
+}
+
+static void render_halves(uint8_t *pixels, int num_pixels, bool red_side, uint8_t active, uint8_t inactive)
+{
+    // Left half red, right half blue; the side named by red_side is active
+    int half = num_pixels / 2;
+    uint8_t red_level = red_side ? active : inactive;
+    uint8_t blue_level = red_side ? inactive : active;
+    for (int i = 0; i < half; i++) {
+        set_pixel(pixels, i, red_level, 0, 0);
+    }
+    for (int i = half; i < num_pixels; i++) {
+        set_pixel(pixels, i, 0, 0, blue_level);
+    }
+}
+
+static void render_sweep(uint8_t *pixels, int num_pixels, const lightbar_sync_t *sync)
+{
+    // Beam with a linear falloff centred on the pitch position
+    int width = num_pixels / 8 + 1;
+    int centre = (int)(((uint32_t)sync->sweep_pos * (num_pixels - 1)) >> 16);
+    for (int i = 0; i < num_pixels; i++) {
+        int dist = (i > centre) ? i - centre : centre - i;
+        uint8_t level = (dist < width) ? LEVEL_FULL - (dist * (LEVEL_FULL - LEVEL_DIM)) / width : LEVEL_DIM;
+        if (sync->sweep_up) {
+            set_pixel(pixels, i, level, 0, 0);
+        } else {
+            set_pixel(pixels, i, 0, 0, level);
+        }
+    }
+}
+
+uint32_t lightbar_wire_us(int num_pixels)
+{
+    uint32_t bits = (uint32_t)num_pixels * LIGHTBAR_BYTES_PER_PIXEL * 8;
+    return (bits * LIGHTBAR_BIT_NS + 999) / 1000 + LIGHTBAR_LATCH_US;
+}
+
+uint32_t lightbar_frame_us(int num_pixels, uint32_t max_fps)
+{
+    uint32_t period_us = 1000000 / max_fps;
+    uint32_t wire_us = lightbar_wire_us(num_pixels);
+    return (wire_us > period_us) ? wire_us : period_us;
+}
+
+void lightbar_render(uint8_t *pixels, int num_pixels, lightbar_pattern_t pattern,
+                     const lightbar_sync_t *sync)
+{
+    switch (pattern) {
+        case LIGHTBAR_WIGWAG:
+            render_halves(pixels, num_pixels, sync->red_side, LEVEL_FULL, LEVEL_DIM);
+            break;
+
+        case LIGHTBAR_QUAD_FLASH: {
+            // Four equal on/off flashes inside each side period
+            uint32_t slot_ms = sync->side_period_ms / (FLASHES_PER_SIDE * 2);
+            bool flash_on = slot_ms == 0 || ((sync->side_ms / slot_ms) % 2) == 0;
+            render_halves(pixels, num_pixels, sync->red_side, flash_on ? LEVEL_FULL : 0, 0);
+            break;
+        }
+
+        case LIGHTBAR_SWEEP:
+            render_sweep(pixels, num_pixels, sync);
+            break;
+
+        default:
+            memset(pixels, 0, num_pixels * LIGHTBAR_BYTES_PER_PIXEL);
+            break;
+    }
+}
@@ -0,0 +1,36 @@
+/* Light bar frame generator
+ * Renders siren light patterns into a GRB pixel buffer. Pure C with no
+ * ESP-IDF dependencies so frames can also be rendered on a host.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define LIGHTBAR_BYTES_PER_PIXEL 3     // WS2812 wire order: G, R, B
+#define LIGHTBAR_BIT_NS         1200    // One bit on the wire: T0H+T0L = T1H+T1L
+#define LIGHTBAR_LATCH_US       50      // Low time that latches a frame
+
+typedef enum {
+    LIGHTBAR_WIGWAG,        // Halves alternate red/blue with the siren LEDs
+    LIGHTBAR_QUAD_FLASH,    // Active half flashes four times per side
+    LIGHTBAR_SWEEP          // Beam position follows the siren pitch
+} lightbar_pattern_t;
+
+// Siren state the frame is synchronised to
+typedef struct {
+    bool red_side;          // Same value as the RED/BLUE discrete LEDs
+    uint32_t side_ms;       // Time since the last side switch
+    uint32_t side_period_ms;// Time between side switches
+    uint16_t sweep_pos;     // Siren pitch, 0 = FREQ_MIN .. 65535 = FREQ_MAX
+    bool sweep_up;          // Pitch currently rising
+} lightbar_sync_t;
+
+void lightbar_render(uint8_t *pixels, int num_pixels, lightbar_pattern_t pattern,
+                     const lightbar_sync_t *sync);
+// Time the strip takes to clock in one frame, latch included
+uint32_t lightbar_wire_us(int num_pixels);
+// Frame period at up to max_fps. A frame can't go out faster than the
+// strip clocks it in, so long strips run slower: 300 pixels take 8.7 ms
+// on the wire, about 115 FPS
+uint32_t lightbar_frame_us(int num_pixels, uint32_t max_fps);
@@ -6,125 +6,314 @@
 #include "driver/ledc.h"
 #include "esp_timer.h"
 #include "esp_log.h"
+#include "lightbar.h"
+#include "siren.h"
+#include "buzzer_sdm.h"
+#include "flash_stress.h"
 
 /* TAG for logging */
 static const char *TAG = "POLICE_SIREN";
 
+/* Set by idf.py -DQEMU_TEST=1 for the QEMU tests: QEMU has no RMT for the light bar */
+#ifndef QEMU_TEST
+#define QEMU_TEST   0
+#endif
+
 /* GPIO pins */
 #define RED_LED     18
 #define BLUE_LED    19
 #define BUZZER      21
 
+/* Second (rear) siren, 0 to run the front unit only */
+#define REAR_SIREN_ENABLE   0
+#define REAR_RED_LED        25
+#define REAR_BLUE_LED       26
+#define REAR_BUZZER         27
+
+/* WS2812 light bar */
+#define LIGHTBAR_ENABLE     (!QEMU_TEST)
+#define LIGHTBAR_BENCH      0       /* Cycle strip lengths and log frame timing */
+#define LIGHTBAR_PIN        23
+#define LIGHTBAR_PIXELS     16
+#define LIGHTBAR_PATTERN    LIGHTBAR_SWEEP
+#define BENCH_WINDOW_MS     2000
+
+/* Siren scheduler benchmark: cost per instance as instances are added */
+#define SIREN_BENCH         0
+#define SIREN_BENCH_MAX     8
+
+/* Buzzer through the sigma-delta modulator: volume and waveform control.
+ * The siren keeps sweeping the pitch; the SDM voice follows it. */
+#define BUZZER_OUTPUT_SDM   0
+#define SDM_BENCH           0       /* Log ISR load at several update rates */
+#define SDM_UPDATE_HZ       16000
+#define SDM_WAVE            SDM_WAVE_SINE
+#define SDM_VOLUME          200     /* 0-255 */
+
+/* Flash stress: erase/write the NVS partition (unused here) without a break
+ * while the siren runs. Every operation turns the flash cache off; the
+ * scheduler's ISR period in the stats shows whether the outputs stalled. */
+#define FLASH_STRESS        0
+
 /* Timing */
 #define LED_TIME_MS     200
 #define BUZZER_TIME_MS   5
+#define STATS_TIME_MS 5000
 
 /* Buzzer frequency */
 #define FREQ_MIN   600
 #define FREQ_MAX  1200
 #define FREQ_STEP    5
+#define BUZZER_DUTY 950
 
-bool led_on = false;
-bool freq_up = true;
+/* One sweep cycle takes as long as the original FREQ_STEP stepping did */
+#define SWEEP_PERIOD_MS (2 * (FREQ_MAX - FREQ_MIN) / FREQ_STEP * BUZZER_TIME_MS)
 
-int buzzer_freq = FREQ_MIN;
+static siren_t front_siren;
+#if REAR_SIREN_ENABLE
+static siren_t rear_siren;
+#endif
 
-uint64_t last_led_time = 0;
-uint64_t last_buzzer_time = 0;
+static void log_scheduler_stats(void)
+{
+    siren_stats_t stats;
+    siren_get_stats(&stats);
+    siren_reset_stats();
+    uint32_t updates = stats.updates ? stats.updates : 1;
+    uint32_t steps = stats.instance_updates ? stats.instance_updates : 1;
+    ESP_LOGI(TAG, "Scheduler: %lu updates, avg %lu cycles (%lu per instance), max %lu cycles",
+             (unsigned long)stats.updates,
+             (unsigned long)(stats.total_cycles / updates),
+             (unsigned long)(stats.total_cycles / steps),
+             (unsigned long)stats.max_cycles);
+    ESP_LOGI(TAG, "Scheduler: ISR period %lu-%lu us",
+             (unsigned long)(stats.min_period_cycles / CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ),
+             (unsigned long)(stats.max_period_cycles / CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ));
+}
 
-/* Buzzer setup */
-void buzzer_start(void)
+#if SIREN_BENCH
+/* Bench instances sweep on their own LEDC timers and run the LED logic,
+ * but drive no pins (GPIO_NUM_NC), so they never fight over the siren's
+ * outputs */
+static void siren_bench(void)
 {
-    ESP_LOGI(TAG, "Initializing buzzer PWM");
+    static siren_t bench_sirens[SIREN_BENCH_MAX];
 
-    ledc_timer_config_t timer = {
-        .speed_mode = LEDC_LOW_SPEED_MODE,
-        .timer_num = LEDC_TIMER_0,
-        .duty_resolution = LEDC_TIMER_10_BIT,
-        .freq_hz = buzzer_freq,
-        .clk_cfg = LEDC_AUTO_CLK
-    };
-    ledc_timer_config(&timer);
+    for (int n = 0; n < SIREN_BENCH_MAX; n++) {
+        siren_config_t cfg = {
+            .red_led = GPIO_NUM_NC,
+            .blue_led = GPIO_NUM_NC,
+            .buzzer = GPIO_NUM_NC,
+            .speed_mode = (n < 4) ? LEDC_LOW_SPEED_MODE : LEDC_HIGH_SPEED_MODE,
+            .timer_num = (ledc_timer_t)(n % 4),
+            .channel = (ledc_channel_t)(n % 4),
+            .duty = 0,
+            .freq_min = FREQ_MIN + n * 10,
+            .freq_max = FREQ_MAX + n * 10,
+            .sweep_period_ms = SWEEP_PERIOD_MS,
+            .led_period_ms = LED_TIME_MS
+        };
+        ESP_ERROR_CHECK(siren_init(&bench_sirens[n], &cfg));
+        ESP_ERROR_CHECK(siren_start(&bench_sirens[n]));
+        siren_reset_stats();
+        vTaskDelay(pdMS_TO_TICKS(BENCH_WINDOW_MS));
+        ESP_LOGI(TAG, "%d instance(s):", n + 1);
+        log_scheduler_stats();
+    }
+    for (int n = 0; n < SIREN_BENCH_MAX; n++) {
+        siren_stop(&bench_sirens[n]);
+    }
+    ESP_LOGI(TAG, "Siren benchmark complete");
+}
+#endif
 
-    ledc_channel_config_t channel = {
-        .gpio_num = BUZZER,
-        .speed_mode = LEDC_LOW_SPEED_MODE,
-        .channel = LEDC_CHANNEL_0,
-        .timer_sel = LEDC_TIMER_0,
-        .duty = 950,
-        .hpoint = 0
-    };
-    ledc_channel_config(&channel);
+#if BUZZER_OUTPUT_SDM
+static void log_sdm_stats(uint32_t window_ms)
+{
+    buzzer_sdm_stats_t stats;
+    buzzer_sdm_get_stats(&stats);
+    buzzer_sdm_reset_stats();
+    uint32_t updates = stats.updates ? stats.updates : 1;
+    uint32_t load_x10 = (uint32_t)(stats.total_cycles * 10 /
+                                   ((uint64_t)window_ms * CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ * 1000));
+    ESP_LOGI(TAG, "SDM: %lu updates, avg %lu cycles, max %lu cycles, load %lu.%lu%%",
+             (unsigned long)stats.updates,
+             (unsigned long)(stats.total_cycles / updates),
+             (unsigned long)stats.max_cycles,
+             (unsigned long)(load_x10 / 10), (unsigned long)(load_x10 % 10));
+}
+#endif
 
-    ledc_set_duty(LEDC_LOW_SPEED_MODE, LEDC_CHANNEL_0, 950);
-    ledc_update_duty(LEDC_LOW_SPEED_MODE, LEDC_CHANNEL_0);
+#if BUZZER_OUTPUT_SDM && SDM_BENCH
+/* SDM update ISR cost per update rate and waveform */
+static void sdm_bench(void)
+{
+    const uint32_t rates[] = { 8000, 16000, 32000, 48000 };
+    const sdm_wave_t waves[] = { SDM_WAVE_SINE, SDM_WAVE_TRIANGLE, SDM_WAVE_SQUARE, SDM_WAVE_SAW };
 
-    ESP_LOGI(TAG, "Buzzer started at %d Hz", buzzer_freq);
+    for (int r = 0; r < sizeof(rates) / sizeof(rates[0]); r++) {
+        buzzer_sdm_config_t cfg = {
+            .pin = BUZZER,
+            .update_hz = rates[r],
+            .wave = SDM_WAVE_SINE,
+            .attack_ms = 5,
+            .release_ms = 20
+        };
+        ESP_ERROR_CHECK(buzzer_sdm_init(&cfg));
+        buzzer_sdm_note_on(FREQ_MIN * 16, SDM_VOLUME);
+        for (int w = 0; w < sizeof(waves) / sizeof(waves[0]); w++) {
+            buzzer_sdm_set_wave(waves[w]);
+            buzzer_sdm_reset_stats();
+            vTaskDelay(pdMS_TO_TICKS(BENCH_WINDOW_MS));
+            ESP_LOGI(TAG, "%lu Hz, wave %d:", (unsigned long)rates[r], waves[w]);
+            log_sdm_stats(BENCH_WINDOW_MS);
+        }
+        ESP_ERROR_CHECK(buzzer_sdm_deinit());
+    }
+    ESP_LOGI(TAG, "SDM benchmark complete");
+}
+#endif
+
+#if LIGHTBAR_ENABLE && LIGHTBAR_BENCH
+/* Light bar frame timing vs strip length */
+static void lightbar_bench_task(void *arg)
+{
+    const int lengths[] = { 8, 30, 60, 150, 300 };
+    const lightbar_pattern_t patterns[] = { LIGHTBAR_WIGWAG, LIGHTBAR_QUAD_FLASH, LIGHTBAR_SWEEP };
+
+    for (int p = 0; p < sizeof(patterns) / sizeof(patterns[0]); p++) {
+        lightbar_set_pattern(patterns[p]);
+        for (int i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+            lightbar_set_length(lengths[i]);
+            vTaskDelay(pdMS_TO_TICKS(100));
+            lightbar_reset_stats();
+            vTaskDelay(pdMS_TO_TICKS(BENCH_WINDOW_MS));
+
+            lightbar_stats_t stats;
+            lightbar_get_stats(&stats);
+            uint32_t frames = stats.frames ? stats.frames : 1;
+            uint32_t done = stats.tx_done ? stats.tx_done : 1;
+            ESP_LOGI(TAG, "pattern=%d pixels=%3d fps=%lu/%lu dropped=%lu render=%lu cyc (max %lu) encode=%lu cyc tx=%lu us",
+                     patterns[p], lengths[i],
+                     (unsigned long)(stats.frames * 1000 / BENCH_WINDOW_MS),
+                     (unsigned long)(1000000 / lightbar_frame_us(lengths[i], LIGHTBAR_FPS)),
+                     (unsigned long)stats.dropped,
+                     (unsigned long)(stats.render_cycles / frames),
+                     (unsigned long)stats.max_render_cycles,
+                     (unsigned long)(stats.encode_cycles / frames),
+                     (unsigned long)(stats.tx_us / done));
+        }
+    }
+    lightbar_set_length(LIGHTBAR_PIXELS);
+    lightbar_set_pattern(LIGHTBAR_PATTERN);
+    ESP_LOGI(TAG, "Light bar benchmark complete");
+    vTaskDelete(NULL);
 }
+#endif
 
 void app_main(void)
 {
     ESP_LOGI(TAG, "Police Siren Project Started");
 
-    /* LED pins setup */
-    gpio_config_t led_cfg = {
-        .pin_bit_mask = (1ULL << RED_LED) | (1ULL << BLUE_LED),
-        .mode = GPIO_MODE_OUTPUT
+#if SIREN_BENCH
+    siren_bench();
+#endif
+
+    siren_config_t front_cfg = {
+        .red_led = RED_LED,
+        .blue_led = BLUE_LED,
+        .buzzer = BUZZER,
+        .speed_mode = LEDC_LOW_SPEED_MODE,
+        .timer_num = LEDC_TIMER_0,
+        .channel = LEDC_CHANNEL_0,
+        .duty = BUZZER_DUTY,
+        .freq_min = FREQ_MIN,
+        .freq_max = FREQ_MAX,
+        .sweep_period_ms = SWEEP_PERIOD_MS,
+        .led_period_ms = LED_TIME_MS
+    };
+#if BUZZER_OUTPUT_SDM
+    /* LEDC still runs the sweep with no pin attached; the SDM drives the buzzer */
+    front_cfg.buzzer = GPIO_NUM_NC;
+#endif
+    ESP_ERROR_CHECK(siren_init(&front_siren, &front_cfg));
+    ESP_ERROR_CHECK(siren_start(&front_siren));
+
+#if BUZZER_OUTPUT_SDM
+#if SDM_BENCH
+    sdm_bench();
+#endif
+    buzzer_sdm_config_t sdm_cfg = {
+        .pin = BUZZER,
+        .update_hz = SDM_UPDATE_HZ,
+        .wave = SDM_WAVE,
+        .attack_ms = 5,
+        .release_ms = 20
     };
-    gpio_config(&led_cfg);
+    ESP_ERROR_CHECK(buzzer_sdm_init(&sdm_cfg));
+    buzzer_sdm_follow(siren_freq_q4_ptr(&front_siren));
+    buzzer_sdm_note_on(FREQ_MIN * 16, SDM_VOLUME);
+#endif
 
-    ESP_LOGI(TAG, "LED GPIO configured");
+#if REAR_SIREN_ENABLE
+    /* Rear unit: own pins and LEDC resources, offset pitch range */
+    siren_config_t rear_cfg = front_cfg;
+    rear_cfg.red_led = REAR_RED_LED;
+    rear_cfg.blue_led = REAR_BLUE_LED;
+    rear_cfg.buzzer = REAR_BUZZER;
+    rear_cfg.timer_num = LEDC_TIMER_1;
+    rear_cfg.channel = LEDC_CHANNEL_1;
+    rear_cfg.freq_min = FREQ_MIN - 100;
+    rear_cfg.freq_max = FREQ_MAX - 100;
+    ESP_ERROR_CHECK(siren_init(&rear_siren, &rear_cfg));
+    ESP_ERROR_CHECK(siren_start(&rear_siren));
+#endif
 
-    buzzer_start();
+#if LIGHTBAR_ENABLE
+    ESP_ERROR_CHECK(lightbar_init(LIGHTBAR_PIN, LIGHTBAR_PIXELS, LIGHTBAR_PATTERN));
+#if LIGHTBAR_BENCH
+    xTaskCreate(lightbar_bench_task, "lightbar_bench", 3072, NULL, 2, NULL);
+#endif
+#endif
 
+#if FLASH_STRESS
+    ESP_ERROR_CHECK(flash_stress_start());
+#endif
+
+    /* Sirens run from the scheduler ISR; this loop only follows the front unit */
+    bool red_on = siren_red_on(&front_siren);
+    uint64_t last_stats_time = 0;
     while (1)
     {
         uint64_t now = esp_timer_get_time() / 1000;
 
-        /* LED blinking */
-        if (now - last_led_time >= LED_TIME_MS)
+        if (siren_red_on(&front_siren) != red_on)
         {
-            led_on = !led_on;
-            gpio_set_level(RED_LED, led_on);
-            gpio_set_level(BLUE_LED, !led_on);
-
-            ESP_LOGI(TAG, "LED switched: RED=%d BLUE=%d",
-                     led_on, !led_on);
-
-            last_led_time = now;
+            red_on = !red_on;
+            ESP_LOGI(TAG, "LED switched: RED=%d BLUE=%d", red_on, !red_on);
+#if LIGHTBAR_ENABLE
+            lightbar_sync_side(red_on, LED_TIME_MS);
+#endif
         }
 
-        /* Buzzer smooth siren */
-        if (now - last_buzzer_time >= BUZZER_TIME_MS)
+#if LIGHTBAR_ENABLE
+        lightbar_sync_sweep(siren_get_freq_q4(&front_siren) / 16, FREQ_MIN, FREQ_MAX,
+                            siren_is_rising(&front_siren));
+#endif
+
+        if (now - last_stats_time >= STATS_TIME_MS)
         {
-            if (freq_up)
-            {
-                buzzer_freq += FREQ_STEP;
-                if (buzzer_freq >= FREQ_MAX)
-                {
-                    freq_up = false;
-                    ESP_LOGI(TAG, "Reached MAX frequency");
-                }
-            }
-            else
-            {
-                buzzer_freq -= FREQ_STEP;
-                if (buzzer_freq <= FREQ_MIN)
-                {
-                    freq_up = true;
-                    ESP_LOGI(TAG, "Reached MIN frequency");
-                }
-            }
-            ledc_timer_config_t timer = {
-                .speed_mode = LEDC_LOW_SPEED_MODE,
-                .timer_num = LEDC_TIMER_0,
-                .duty_resolution = LEDC_TIMER_10_BIT,
-                .freq_hz = buzzer_freq,
-                .clk_cfg = LEDC_AUTO_CLK
-            };
-            ledc_timer_config(&timer);
-            ESP_LOGI(TAG, "Buzzer frequency: %d Hz", buzzer_freq);
-            last_buzzer_time = now;
+            uint32_t freq_q4 = siren_get_freq_q4(&front_siren);
+            ESP_LOGI(TAG, "Buzzer frequency: %lu.%02lu Hz",
+                     (unsigned long)(freq_q4 / 16), (unsigned long)(freq_q4 % 16 * 100 / 16));
+            log_scheduler_stats();
+#if FLASH_STRESS
+            flash_stress_log();
+#endif
+#if BUZZER_OUTPUT_SDM
+            log_sdm_stats(now - last_stats_time);
+#endif
+            last_stats_time = now;
         }
         vTaskDelay(1);
     }
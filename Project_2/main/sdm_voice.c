@@ -0,0 +1,105 @@
+/* Tone voice for the sigma-delta buzzer output
+ * One call to sdm_voice_next() produces one sample: advance the phase,
+ * look up the waveform, scale by the envelope.
+ */
+#include <string.h>
+#include "sdm_voice.h"
+
+#define ENVELOPE_MAX_Q8 (255u << 8)
+
+static const int8_t sine_table[256] = {
+       0,    3,    6,    9,   12,   16,   19,   22,   25,   28,   31,   34,   37,   40,   43,   46,
+      49,   51,   54,   57,   60,   63,   65,   68,   71,   73,   76,   78,   81,   83,   85,   88,
+      90,   92,   94,   96,   98,  100,  102,  104,  106,  107,  109,  111,  112,  113,  115,  116,
+     117,  118,  120,  121,  122,  122,  123,  124,  125,  125,  126,  126,  126,  127,  127,  127,
+     127,  127,  127,  127,  126,  126,  126,  125,  125,  124,  123,  122,  122,  121,  120,  118,
+     117,  116,  115,  113,  112,  111,  109,  107,  106,  104,  102,  100,   98,   96,   94,   92,
+      90,   88,   85,   83,   81,   78,   76,   73,   71,   68,   65,   63,   60,   57,   54,   51,
+      49,   46,   43,   40,   37,   34,   31,   28,   25,   22,   19,   16,   12,    9,    6,    3,
+       0,   -3,   -6,   -9,  -12,  -16,  -19,  -22,  -25,  -28,  -31,  -34,  -37,  -40,  -43,  -46,
+     -49,  -51,  -54,  -57,  -60,  -63,  -65,  -68,  -71,  -73,  -76,  -78,  -81,  -83,  -85,  -88,
+     -90,  -92,  -94,  -96,  -98, -100, -102, -104, -106, -107, -109, -111, -112, -113, -115, -116,
+    -117, -118, -120, -121, -122, -122, -123, -124, -125, -125, -126, -126, -126, -127, -127, -127,
+    -127, -127, -127, -127, -126, -126, -126, -125, -125, -124, -123, -122, -122, -121, -120, -118,
+    -117, -116, -115, -113, -112, -111, -109, -107, -106, -104, -102, -100,  -98,  -96,  -94,  -92,
+     -90,  -88,  -85,  -83,  -81,  -78,  -76,  -73,  -71,  -68,  -65,  -63,  -60,  -57,  -54,  -51,
+     -49,  -46,  -43,  -40,  -37,  -34,  -31,  -28,  -25,  -22,  -19,  -16,  -12,   -9,   -6,   -3,
+};
+
+static inline int32_t wave_sample(sdm_wave_t wave, uint32_t phase)
+{
+    uint8_t index = phase >> 24;
+    switch (wave) {
+        case SDM_WAVE_TRIANGLE: {
+            // 0 -> 127 -> -127 -> 0 over one period
+            int32_t t = phase >> 23;
+            int32_t v = (t < 128) ? t : (t < 384) ? 256 - t : t - 512;
+            return (v * 127) >> 7;
+        }
+        case SDM_WAVE_SQUARE:
+            return (index < 128) ? 127 : -127;
+        case SDM_WAVE_SAW:
+            return (int32_t)index - 128;
+        case SDM_WAVE_SINE:
+        default:
+            return sine_table[index];
+    }
+}
+
+static uint16_t envelope_step(uint32_t sample_rate_hz, uint32_t time_ms)
+{
+    // Q8 level change per sample to sweep the full range in time_ms
+    uint32_t samples = sample_rate_hz / 1000 * time_ms;
+    if (samples == 0) {
+        return ENVELOPE_MAX_Q8 > 0xFFFF ? 0xFFFF : ENVELOPE_MAX_Q8;
+    }
+    uint32_t step = ENVELOPE_MAX_Q8 / samples;
+    return step ? step : 1;
+}
+
+void sdm_voice_init(sdm_voice_t *voice, uint32_t sample_rate_hz)
+{
+    memset(voice, 0, sizeof(*voice));
+    voice->sample_rate_hz = sample_rate_hz;
+    voice->phase_per_q4 = (uint32_t)((1ULL << 28) / sample_rate_hz);
+    voice->wave = SDM_WAVE_SINE;
+    sdm_voice_set_envelope(voice, 5, 20);
+}
+
+void sdm_voice_set_envelope(sdm_voice_t *voice, uint32_t attack_ms, uint32_t release_ms)
+{
+    voice->attack_step = envelope_step(voice->sample_rate_hz, attack_ms);
+    voice->release_step = envelope_step(voice->sample_rate_hz, release_ms);
+}
+
+void sdm_voice_note_on(sdm_voice_t *voice, uint32_t freq_q4, uint8_t volume)
+{
+    voice->freq_q4 = freq_q4;
+    voice->volume = volume;
+    voice->gate = true;
+}
+
+void sdm_voice_note_off(sdm_voice_t *voice)
+{
+    voice->gate = false;
+}
+
+int8_t sdm_voice_next(sdm_voice_t *voice)
+{
+    // Envelope: ramp towards volume while held, towards 0 after release
+    uint32_t target = voice->gate ? (uint32_t)voice->volume << 8 : 0;
+    if (voice->level < target) {
+        uint32_t next = voice->level + voice->attack_step;
+        voice->level = (next > target) ? target : next;
+    } else if (voice->level > target) {
+        voice->level = (voice->level > target + voice->release_step) ?
+                       (uint32_t)(voice->level - voice->release_step) : target;
+    }
+    if (voice->level == 0) {
+        return 0;
+    }
+
+    uint32_t freq_q4 = voice->freq_src ? *voice->freq_src : voice->freq_q4;
+    voice->phase += freq_q4 * voice->phase_per_q4;
+    return (int8_t)((wave_sample(voice->wave, voice->phase) * (voice->level >> 8)) / 255);
+}
@@ -0,0 +1,36 @@
+/* Tone voice for the sigma-delta buzzer output
+ * Phase-accumulator oscillator with selectable waveform and a linear
+ * attack/release envelope. Produces signed 8-bit pulse-density samples.
+ * Pure C with no ESP-IDF dependencies so output can be rendered offline.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef enum {
+    SDM_WAVE_SINE,
+    SDM_WAVE_TRIANGLE,
+    SDM_WAVE_SQUARE,
+    SDM_WAVE_SAW
+} sdm_wave_t;
+
+typedef struct {
+    uint32_t sample_rate_hz;
+    uint32_t phase;                 // Oscillator phase accumulator
+    uint32_t phase_per_q4;          // Phase step per 1/16 Hz: 2^28 / sample_rate
+    uint32_t freq_q4;               // Pitch in 1/16 Hz
+    const volatile uint32_t *freq_src;  // Optional live pitch source (Q4), overrides freq_q4
+    sdm_wave_t wave;
+    uint8_t volume;                 // Envelope target while the note is held
+    uint16_t level;                 // Current envelope level, Q8 (0..volume << 8)
+    uint16_t attack_step;           // Level increase per sample, Q8
+    uint16_t release_step;          // Level decrease per sample, Q8
+    bool gate;                      // Note held
+} sdm_voice_t;
+
+void sdm_voice_init(sdm_voice_t *voice, uint32_t sample_rate_hz);
+void sdm_voice_set_envelope(sdm_voice_t *voice, uint32_t attack_ms, uint32_t release_ms);
+void sdm_voice_note_on(sdm_voice_t *voice, uint32_t freq_q4, uint8_t volume);
+void sdm_voice_note_off(sdm_voice_t *voice);
+int8_t sdm_voice_next(sdm_voice_t *voice);
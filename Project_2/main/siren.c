@@ -0,0 +1,263 @@
+/* Police siren instances
+ *
+ * The per-instance sweep and LED logic is in siren_sweep.c. The ESP32
+ * LEDC timer divider has 8 fractional bits, so the scheduler writes the
+ * Q8 divider it returns straight into the instance's timer through the
+ * LEDC LL layer. LED switches of all instances due on the same update are
+ * merged into one W1TS and one W1TC write.
+ */
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "driver/gptimer.h"
+#include "hal/ledc_ll.h"
+#include "esp_cpu.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "soc/soc.h"
+#include "soc/gpio_reg.h"
+#include "siren.h"
+
+static const char *TAG = "SIREN";
+
+#define GPTIMER_RES_HZ  1000000
+
+static siren_t *siren_list = NULL;
+static gptimer_handle_t scheduler_timer = NULL;
+static siren_stats_t stats = { .min_period_cycles = UINT32_MAX };
+static uint32_t last_start;
+static portMUX_TYPE siren_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static IRAM_ATTR void siren_step(siren_t *siren, ledc_dev_t *hw, uint32_t *set_mask, uint32_t *clr_mask)
+{
+    uint32_t divider = siren_sweep_step(&siren->sweep, set_mask, clr_mask);
+    ledc_ll_set_clock_divider(hw, siren->config.speed_mode, siren->config.timer_num, divider);
+    ledc_ll_ls_timer_update(hw, siren->config.speed_mode, siren->config.timer_num);
+}
+
+static IRAM_ATTR bool siren_scheduler_isr(gptimer_handle_t timer, const gptimer_alarm_event_data_t *edata, void *user_ctx)
+{
+    uint32_t start = esp_cpu_get_cycle_count();
+    ledc_dev_t *hw = LEDC_LL_GET_HW();
+    uint32_t set_mask = 0, clr_mask = 0;
+    uint32_t instances = 0;
+
+    portENTER_CRITICAL_ISR(&siren_lock);
+    for (siren_t *siren = siren_list; siren != NULL; siren = siren->next) {
+        siren_step(siren, hw, &set_mask, &clr_mask);
+        instances++;
+    }
+    portEXIT_CRITICAL_ISR(&siren_lock);
+
+    if (set_mask) {
+        REG_WRITE(GPIO_OUT_W1TS_REG, set_mask);
+    }
+    if (clr_mask) {
+        REG_WRITE(GPIO_OUT_W1TC_REG, clr_mask);
+    }
+
+    if (stats.updates > 0) {
+        uint32_t period = start - last_start;
+        if (period < stats.min_period_cycles) {
+            stats.min_period_cycles = period;
+        }
+        if (period > stats.max_period_cycles) {
+            stats.max_period_cycles = period;
+        }
+    }
+    last_start = start;
+    uint32_t cycles = esp_cpu_get_cycle_count() - start;
+    stats.updates++;
+    stats.instance_updates += instances;
+    stats.total_cycles += cycles;
+    if (cycles > stats.max_cycles) {
+        stats.max_cycles = cycles;
+    }
+    return false;
+}
+
+static esp_err_t scheduler_start(void)
+{
+    gptimer_config_t timer_config = {
+        .clk_src = GPTIMER_CLK_SRC_DEFAULT,
+        .direction = GPTIMER_COUNT_UP,
+        .resolution_hz = GPTIMER_RES_HZ
+    };
+    ESP_ERROR_CHECK(gptimer_new_timer(&timer_config, &scheduler_timer));
+    gptimer_event_callbacks_t callbacks = {
+        .on_alarm = siren_scheduler_isr
+    };
+    ESP_ERROR_CHECK(gptimer_register_event_callbacks(scheduler_timer, &callbacks, NULL));
+    gptimer_alarm_config_t alarm = {
+        .alarm_count = GPTIMER_RES_HZ / SIREN_UPDATE_HZ,
+        .reload_count = 0,
+        .flags.auto_reload_on_alarm = true
+    };
+    ESP_ERROR_CHECK(gptimer_set_alarm_action(scheduler_timer, &alarm));
+    ESP_ERROR_CHECK(gptimer_enable(scheduler_timer));
+    ESP_LOGI(TAG, "Scheduler running at %d Hz", SIREN_UPDATE_HZ);
+    return gptimer_start(scheduler_timer);
+}
+
+static float divider_step_hz(const siren_t *siren, uint32_t freq)
+{
+    // Pitch change caused by one LSB (1/256) of the divider at freq
+    uint32_t div_q8 = siren->sweep.divider_k / (freq * 16);
+    float f_times_div = (float)siren->sweep.divider_k / 16.0f;
+    return f_times_div / div_q8 - f_times_div / (div_q8 + 1);
+}
+
+esp_err_t siren_init(siren_t *siren, const siren_config_t *config)
+{
+    if (siren == NULL || config == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (config->freq_min == 0 || config->freq_max <= config->freq_min ||
+        config->sweep_period_ms == 0 || config->led_period_ms == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    // LEDs are switched through GPIO_OUT_REG
+    if (config->red_led >= 32 || config->blue_led >= 32) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    uint64_t k = ((uint64_t)SIREN_LEDC_CLK_HZ << 12) >> SIREN_DUTY_RESOLUTION;
+    if (k > UINT32_MAX || k / (config->freq_min * 16) >= (1u << 18)) {
+        ESP_LOGE(TAG, "Divider out of range for %lu Hz", (unsigned long)config->freq_min);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memset(siren, 0, sizeof(*siren));
+    siren->config = *config;
+    siren_sweep_config_t sweep = {
+        .freq_min = config->freq_min,
+        .freq_max = config->freq_max,
+        .sweep_period_ms = config->sweep_period_ms,
+        .led_period_ms = config->led_period_ms,
+        .update_hz = SIREN_UPDATE_HZ,
+        .divider_k = (uint32_t)k,
+        .red_mask = (config->red_led == GPIO_NUM_NC) ? 0 : 1u << config->red_led,
+        .blue_mask = (config->blue_led == GPIO_NUM_NC) ? 0 : 1u << config->blue_led
+    };
+    siren_sweep_init(&siren->sweep, &sweep);
+
+    if (sweep.red_mask | sweep.blue_mask) {
+        gpio_config_t led_cfg = {
+            .pin_bit_mask = sweep.red_mask | sweep.blue_mask,
+            .mode = GPIO_MODE_OUTPUT
+        };
+        ESP_ERROR_CHECK(gpio_config(&led_cfg));
+    }
+
+    ledc_timer_config_t timer = {
+        .speed_mode = config->speed_mode,
+        .timer_num = config->timer_num,
+        .duty_resolution = SIREN_DUTY_RESOLUTION,
+        .freq_hz = config->freq_min,
+        .clk_cfg = LEDC_USE_APB_CLK
+    };
+    ESP_ERROR_CHECK(ledc_timer_config(&timer));
+
+    // Without a buzzer pin the sweep still runs on the timer, silently
+    if (config->buzzer != GPIO_NUM_NC) {
+        ledc_channel_config_t channel = {
+            .gpio_num = config->buzzer,
+            .speed_mode = config->speed_mode,
+            .channel = config->channel,
+            .timer_sel = config->timer_num,
+            .duty = 0,
+            .hpoint = 0
+        };
+        ESP_ERROR_CHECK(ledc_channel_config(&channel));
+    }
+
+    ESP_LOGI(TAG, "Siren: LEDs %d/%d, buzzer GPIO%d (timer %d, channel %d), %lu-%lu Hz",
+             config->red_led, config->blue_led, config->buzzer, config->timer_num, config->channel,
+             (unsigned long)config->freq_min, (unsigned long)config->freq_max);
+    ESP_LOGI(TAG, "Divider resolution: %.4f Hz at %lu Hz, %.4f Hz at %lu Hz",
+             divider_step_hz(siren, config->freq_min), (unsigned long)config->freq_min,
+             divider_step_hz(siren, config->freq_max), (unsigned long)config->freq_max);
+    return ESP_OK;
+}
+
+esp_err_t siren_start(siren_t *siren)
+{
+    if (siren->running) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (siren->config.buzzer != GPIO_NUM_NC) {
+        ESP_ERROR_CHECK(ledc_set_duty(siren->config.speed_mode, siren->config.channel, siren->config.duty));
+        ESP_ERROR_CHECK(ledc_update_duty(siren->config.speed_mode, siren->config.channel));
+    }
+
+    portENTER_CRITICAL(&siren_lock);
+    siren->running = true;
+    siren->next = siren_list;
+    siren_list = siren;
+    portEXIT_CRITICAL(&siren_lock);
+
+    if (scheduler_timer == NULL) {
+        return scheduler_start();
+    }
+    return ESP_OK;
+}
+
+esp_err_t siren_stop(siren_t *siren)
+{
+    if (!siren->running) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    portENTER_CRITICAL(&siren_lock);
+    siren_t **link = &siren_list;
+    while (*link != NULL && *link != siren) {
+        link = &(*link)->next;
+    }
+    if (*link == siren) {
+        *link = siren->next;
+    }
+    siren->running = false;
+    siren->next = NULL;
+    portEXIT_CRITICAL(&siren_lock);
+
+    // Silence and darken this instance only
+    REG_WRITE(GPIO_OUT_W1TC_REG, siren->sweep.red_mask | siren->sweep.blue_mask);
+    if (siren->config.buzzer == GPIO_NUM_NC) {
+        return ESP_OK;
+    }
+    ESP_ERROR_CHECK(ledc_set_duty(siren->config.speed_mode, siren->config.channel, 0));
+    return ledc_update_duty(siren->config.speed_mode, siren->config.channel);
+}
+
+uint32_t siren_get_freq_q4(const siren_t *siren)
+{
+    return siren->sweep.freq_q4;
+}
+
+const volatile uint32_t *siren_freq_q4_ptr(const siren_t *siren)
+{
+    return &siren->sweep.freq_q4;
+}
+
+bool siren_is_rising(const siren_t *siren)
+{
+    return siren->sweep.rising;
+}
+
+bool siren_red_on(const siren_t *siren)
+{
+    return siren->sweep.red_on;
+}
+
+void siren_get_stats(siren_stats_t *out)
+{
+    portENTER_CRITICAL(&siren_lock);
+    *out = stats;
+    portEXIT_CRITICAL(&siren_lock);
+}
+
+void siren_reset_stats(void)
+{
+    portENTER_CRITICAL(&siren_lock);
+    memset(&stats, 0, sizeof(stats));
+    stats.min_period_cycles = UINT32_MAX;
+    portEXIT_CRITICAL(&siren_lock);
+}
@@ -0,0 +1,64 @@
+/* Police siren instances
+ * Each siren_t owns its LED pins, buzzer pin and LEDC timer/channel and
+ * keeps all of its sweep and blink state. One shared GPTimer scheduler
+ * advances every running instance, so any number of sirens (front/rear,
+ * several vehicles) can run side by side without global state.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "driver/gpio.h"
+#include "driver/ledc.h"
+#include "siren_sweep.h"
+
+#define SIREN_UPDATE_HZ         2000        // Scheduler rate (pitch and LED updates)
+#define SIREN_LEDC_CLK_HZ       80000000    // LEDC timer source (APB)
+#define SIREN_DUTY_RESOLUTION   LEDC_TIMER_10_BIT
+
+// Any pin may be GPIO_NUM_NC: the instance runs as usual without that output
+typedef struct {
+    gpio_num_t red_led;
+    gpio_num_t blue_led;
+    gpio_num_t buzzer;
+    ledc_mode_t speed_mode;
+    ledc_timer_t timer_num;     // Not shared with other sirens
+    ledc_channel_t channel;
+    uint32_t duty;              // Buzzer duty at SIREN_DUTY_RESOLUTION
+    uint32_t freq_min;          // Sweep bottom (Hz)
+    uint32_t freq_max;          // Sweep top (Hz)
+    uint32_t sweep_period_ms;   // Full up + down cycle
+    uint32_t led_period_ms;     // Time between red/blue switches
+} siren_config_t;
+
+// Instance state, owned by the caller (static or heap)
+typedef struct siren_t {
+    siren_config_t config;
+    siren_sweep_t sweep;        // Pitch and red/blue state (siren_sweep.c)
+    // Scheduler list
+    bool running;
+    struct siren_t *next;
+} siren_t;
+
+// Scheduler timing statistics
+typedef struct {
+    uint32_t updates;           // Scheduler ISR runs
+    uint32_t instance_updates;  // Instance steps across all runs
+    uint64_t total_cycles;      // Cycles spent in the ISR
+    uint32_t max_cycles;        // Worst-case cycles for a single ISR
+    uint32_t min_period_cycles; // Between consecutive ISR entries: a stall
+    uint32_t max_period_cycles; // (e.g. a flash write) shows up here
+} siren_stats_t;
+
+esp_err_t siren_init(siren_t *siren, const siren_config_t *config);
+esp_err_t siren_start(siren_t *siren);
+esp_err_t siren_stop(siren_t *siren);
+uint32_t siren_get_freq_q4(const siren_t *siren);
+// Live pitch for a reader that follows the sweep (e.g. buzzer_sdm_follow)
+const volatile uint32_t *siren_freq_q4_ptr(const siren_t *siren);
+bool siren_is_rising(const siren_t *siren);
+bool siren_red_on(const siren_t *siren);
+
+void siren_get_stats(siren_stats_t *stats);
+void siren_reset_stats(void);
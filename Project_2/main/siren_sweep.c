@@ -0,0 +1,48 @@
+/* Siren sweep and red/blue alternation for one instance
+ *
+ * A 32-bit phase accumulator wraps once per sweep period and its top bits
+ * fold into a 16-bit triangle. Pitch is kept in 1/16 Hz (Q4) and turned
+ * into the LEDC divider with one 32-bit division:
+ *
+ *     divider_q8 = (clk << 12 >> duty_bits) / freq_q4
+ *
+ * Runs in the scheduler ISR; linker.lf keeps it out of flash.
+ */
+#include <string.h>
+#include "siren_sweep.h"
+
+void siren_sweep_init(siren_sweep_t *sweep, const siren_sweep_config_t *config)
+{
+    memset(sweep, 0, sizeof(*sweep));
+    sweep->divider_k = config->divider_k;
+    sweep->freq_min_q4 = config->freq_min * 16;
+    sweep->span_q4 = (config->freq_max - config->freq_min) * 16;
+    sweep->freq_q4 = sweep->freq_min_q4;
+    sweep->rising = true;
+    // Phase wraps once per sweep period
+    sweep->phase_inc = (uint32_t)((1ULL << 32) * 1000 /
+                                  ((uint64_t)config->sweep_period_ms * config->update_hz));
+    sweep->led_period = config->led_period_ms * config->update_hz / 1000;
+    sweep->red_mask = config->red_mask;
+    sweep->blue_mask = config->blue_mask;
+}
+
+uint32_t siren_sweep_step(siren_sweep_t *sweep, uint32_t *set_mask, uint32_t *clr_mask)
+{
+    // Pitch
+    sweep->phase += sweep->phase_inc;
+    bool rising = (sweep->phase & 0x80000000u) == 0;
+    uint32_t tri = ((rising ? sweep->phase : ~sweep->phase) >> 15) & 0xFFFF;
+    uint32_t freq_q4 = sweep->freq_min_q4 + ((sweep->span_q4 * tri) >> 16);
+    sweep->freq_q4 = freq_q4;
+    sweep->rising = rising;
+
+    // Red/blue alternation
+    if (++sweep->led_count >= sweep->led_period) {
+        sweep->led_count = 0;
+        sweep->red_on = !sweep->red_on;
+        *set_mask |= sweep->red_on ? sweep->red_mask : sweep->blue_mask;
+        *clr_mask |= sweep->red_on ? sweep->blue_mask : sweep->red_mask;
+    }
+    return sweep->divider_k / freq_q4;
+}
@@ -0,0 +1,43 @@
+/* Siren sweep and red/blue alternation for one instance
+ * Everything a siren does per scheduler update: advance the pitch phase,
+ * fold it into the triangle, turn the pitch into an LEDC divider and count
+ * towards the next LED switch. Pure C with no ESP-IDF dependencies so the
+ * same code runs in the scheduler ISR and in the host tests.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct {
+    uint32_t freq_min;          // Sweep bottom (Hz)
+    uint32_t freq_max;          // Sweep top (Hz)
+    uint32_t sweep_period_ms;   // Full up + down cycle
+    uint32_t led_period_ms;     // Time between red/blue switches
+    uint32_t update_hz;         // Step rate
+    uint32_t divider_k;         // (clk << 12) >> duty_bits, see siren.c
+    uint32_t red_mask;          // GPIO_OUT bit of the red LED, 0 = none
+    uint32_t blue_mask;         // GPIO_OUT bit of the blue LED, 0 = none
+} siren_sweep_config_t;
+
+typedef struct {
+    // Pitch sweep (DDS)
+    uint32_t divider_k;
+    uint32_t freq_min_q4;       // Pitch in 1/16 Hz
+    uint32_t span_q4;
+    uint32_t phase;             // Sweep phase accumulator
+    uint32_t phase_inc;
+    volatile uint32_t freq_q4;
+    volatile bool rising;
+    // Red/blue LEDs
+    volatile bool red_on;
+    uint32_t led_count;         // Updates since the last switch
+    uint32_t led_period;        // Updates between switches
+    uint32_t red_mask;
+    uint32_t blue_mask;
+} siren_sweep_t;
+
+void siren_sweep_init(siren_sweep_t *sweep, const siren_sweep_config_t *config);
+// One update: returns the Q8 LEDC divider for the new pitch and adds any
+// LED switch to the set/clear masks (merged across instances by the caller)
+uint32_t siren_sweep_step(siren_sweep_t *sweep, uint32_t *set_mask, uint32_t *clr_mask);
@@ -0,0 +1,49 @@
+"""Project 2 under QEMU: siren scheduler, LED alternation and pitch sweep
+
+Built with -DQEMU_TEST=1, which leaves out the RMT light bar.
+"""
+import pytest
+
+from conftest import TICK_MS
+
+TAG = 'POLICE_SIREN'
+LED_TIME_MS = 200               # main.c
+FREQ_MIN, FREQ_MAX = 600, 1200  # main.c
+SIREN_UPDATE_HZ = 2000          # siren.h: one scheduler step every 500 us
+STATS_WINDOWS = 3
+SCHED_MAX_CYCLES = 4000         # Regression budget for the scheduler ISR
+
+
+@pytest.mark.esp32
+@pytest.mark.qemu
+def test_led_alternation(log):
+    log.check_boot()
+    switches = log.expect_all(TAG, r'LED switched: RED=(\d) BLUE=(\d)', 20)
+    reds = [int(m.group(2)) for _, m in switches]
+    assert all(a != b for a, b in zip(reds, reds[1:])), 'RED and BLUE must alternate'
+    # The loop polls the ISR's LED state once a tick
+    log.check_period([ms for ms, _ in switches], LED_TIME_MS)
+
+
+@pytest.mark.esp32
+@pytest.mark.qemu
+def test_siren_step_period(log):
+    log.check_boot()
+    # The first window starts at siren_start(), not at a stats line
+    last_ms, _ = log.expect(TAG, r'Buzzer frequency', timeout=15)
+    log.expect(TAG, r'Scheduler:')
+    for _ in range(STATS_WINDOWS):
+        ms, freq = log.expect(TAG, r'Buzzer frequency: (\d+)\.(\d+) Hz', timeout=15)
+        _, sched = log.expect(TAG, r'Scheduler: (\d+) updates, avg (\d+) cycles '
+                                   r'\((\d+) per instance\), max (\d+) cycles')
+        assert FREQ_MIN <= int(freq.group(2)) <= FREQ_MAX
+
+        # Step period: updates per window against the scheduler rate
+        window_ms = ms - last_ms
+        expected = window_ms * SIREN_UPDATE_HZ // 1000
+        slop = log.budget(2 * TICK_MS * SIREN_UPDATE_HZ // 1000)
+        updates = int(sched.group(2))
+        assert abs(updates - expected) <= slop, \
+            f'{updates} scheduler steps in {window_ms} ms, expected {expected}'
+        assert int(sched.group(5)) <= log.budget(SCHED_MAX_CYCLES)
+        last_ms = ms
@@ -0,0 +1,145 @@
+/* Light-show analysis timing on the host
+ *
+ * Builds the light show with the firmware's lightshow.c for the playlist
+ * songs tiled to 1000..16000 notes, reports the time per song and per
+ * note, and checks every rendered stream, including the 16000-note tiles
+ * that run past the ~71 min a 32-bit at_us could hold:
+ *   - beat period in 250..1000 ms and a 2, 3 or 4 beat bar
+ *   - every sounding note counted as an onset
+ *   - no more events than lightshow_max_events(), strictly increasing
+ *     times, and nothing after the end of the song
+ *
+ * Host times are for comparing song lengths; the on-device cycle counts
+ * come from LIGHTSHOW_BENCH in main.c.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include "lightshow.h"
+#include "songs.h"
+
+#define TEMPO           100         // Playlist tempo of the library songs
+#define MAX_NOTES       16000
+#define RUNS            20          // Timed builds per length
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do { \
+    if (!(cond)) { \
+        printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+        printf(__VA_ARGS__); \
+        printf("\n"); \
+        failures++; \
+    } \
+} while (0)
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// {frequency, divider} to durations, as playlist.c decodes a track
+static void tile_song(const int (*raw)[2], size_t raw_length, melody_note_t *notes, size_t num_notes)
+{
+    uint32_t whole_note = 60000 * 4 / TEMPO;
+    for (size_t i = 0; i < num_notes; i++) {
+        int divider = raw[i % raw_length][1];
+        notes[i].frequency = (uint16_t)raw[i % raw_length][0];
+        notes[i].duration = (divider > 0) ? whole_note / divider : whole_note * 3 / (-divider * 2);
+    }
+}
+
+static uint64_t song_length_us(const melody_note_t *notes, size_t num_notes)
+{
+    uint64_t song_us = 0;
+    for (size_t i = 0; i < num_notes; i++) {
+        song_us += notes[i].duration * 1000ULL;
+    }
+    return song_us;
+}
+
+static void check_show(const char *name, const melody_note_t *notes, size_t num_notes,
+                       const melody_event_t *events, const lightshow_info_t *info)
+{
+    uint64_t song_us = song_length_us(notes, num_notes);
+    uint32_t onsets = 0;
+    for (size_t i = 0; i < num_notes; i++) {
+        onsets += notes[i].frequency != 0;
+    }
+
+    CHECK(info->beat_ms >= 250 && info->beat_ms <= 1000, "%s: beat %lu ms", name,
+          (unsigned long)info->beat_ms);
+    CHECK(info->meter >= 2 && info->meter <= 4, "%s: %u beats per bar", name, info->meter);
+    CHECK(info->onsets == onsets, "%s: %lu onsets, song has %lu", name,
+          (unsigned long)info->onsets, (unsigned long)onsets);
+    CHECK(info->num_events > 0 && info->num_events <= lightshow_max_events(num_notes),
+          "%s: %lu events for %zu notes", name, (unsigned long)info->num_events, num_notes);
+    for (size_t i = 1; i < info->num_events; i++) {
+        if (events[i].at_us <= events[i - 1].at_us) {
+            CHECK(0, "%s: event %zu at %llu us after %llu us", name, i,
+                  (unsigned long long)events[i].at_us, (unsigned long long)events[i - 1].at_us);
+            break;
+        }
+    }
+    CHECK(events[info->num_events - 1].at_us <= song_us, "%s: last event at %llu us, song ends at %llu us",
+          name, (unsigned long long)events[info->num_events - 1].at_us, (unsigned long long)song_us);
+}
+
+int main(void)
+{
+    const struct {
+        const char *name;
+        const int (*raw)[2];
+        size_t length;
+    } songs[] = {
+        { "ode", ode_to_joy, ode_to_joy_length },
+        { "twinkle", twinkle_twinkle, twinkle_twinkle_length }
+    };
+    const size_t lengths[] = { 1000, 2000, 4000, 16000 };
+    melody_note_t *notes = malloc(MAX_NOTES * sizeof(melody_note_t));
+    if (notes == NULL) {
+        printf("out of memory\n");
+        return 1;
+    }
+
+    printf("song     notes   build_us  ns/note  beat_ms  meter  events  length_min\n");
+    for (size_t s = 0; s < sizeof(songs) / sizeof(songs[0]); s++) {
+        for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++) {
+            size_t num_notes = lengths[l];
+            tile_song(songs[s].raw, songs[s].length, notes, num_notes);
+            uint64_t song_us = song_length_us(notes, num_notes);
+
+            lightshow_info_t info;
+            uint64_t total_ns = 0;
+            for (int r = 0; r < RUNS; r++) {
+                uint64_t t0 = now_ns();
+                melody_event_t *events = lightshow_build(notes, num_notes, &info);
+                total_ns += now_ns() - t0;
+                CHECK(events != NULL, "%s %zu notes: out of memory", songs[s].name, num_notes);
+                if (events == NULL) {
+                    break;
+                }
+                if (r == 0) {
+                    check_show(songs[s].name, notes, num_notes, events, &info);
+                }
+                free(events);
+            }
+            printf("%-7s  %5zu  %9.1f  %7.1f  %7lu  %5u  %6lu  %10.1f\n", songs[s].name, num_notes,
+                   total_ns / RUNS / 1000.0, (double)total_ns / RUNS / num_notes,
+                   (unsigned long)info.beat_ms, info.meter, (unsigned long)info.num_events,
+                   song_us / 60e6);
+        }
+    }
+    free(notes);
+
+    if (failures) {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("All light show checks passed\n");
+    return 0;
+}
@@ -0,0 +1,257 @@
+/* Light-show track for the melody player
+ *
+ * Analysis passes over the note list:
+ *   1. Beat: each distinct note duration, folded into 250-1000 ms, is a
+ *      candidate period. A candidate scores by the share of onsets that
+ *      land on its grid, weighted towards ~120 BPM.
+ *   2. Accents: a note is accented when it is longer than the note before
+ *      it, leaps by a fourth or more, starts after a rest, or falls on a
+ *      downbeat. Two or more of these make an accent.
+ *   3. Meter: 2, 3 or 4 beats per bar, whichever puts the most accent
+ *      weight on bar starts.
+ *   4. Phrases end on notes of two beats or more and before rests of half
+ *      a beat or more.
+ *
+ * Rendering: the note's band LED lights for its sounding part. An accent
+ * opens with a short all-LED flash. A phrase end sweeps low -> mid -> high
+ * through the gap before the next note.
+ */
+#include <stdlib.h>
+#include <stdbool.h>
+#include "lightshow.h"
+
+#define BEAT_MIN_MS         250
+#define BEAT_MAX_MS         1000
+#define BEAT_PRIOR_MS       500
+#define MAX_CANDIDATES      16
+#define ACCENT_FLASH_MS     60
+#define CHASE_STEP_MS       80
+#define CHASE_MIN_STEP_MS   10
+#define EVENTS_PER_NOTE     7           // Flash, band, off, 4 chase steps
+
+static uint8_t band_leds(uint16_t frequency)
+{
+    // Same bands as update_leds()
+    if (frequency < 400) {
+        return LIGHTSHOW_LED_LOW;
+    } else if (frequency < 650) {
+        return LIGHTSHOW_LED_MID;
+    }
+    return LIGHTSHOW_LED_HIGH;
+}
+
+static uint32_t fold_period(uint32_t ms)
+{
+    while (ms < BEAT_MIN_MS) {
+        ms *= 2;
+    }
+    while (ms > BEAT_MAX_MS) {
+        ms /= 2;
+    }
+    return ms;
+}
+
+static uint32_t detect_beat(const melody_note_t *notes, size_t num_notes)
+{
+    uint32_t candidates[MAX_CANDIDATES];
+    int num_candidates = 0;
+
+    for (size_t i = 0; i < num_notes && num_candidates < MAX_CANDIDATES; i++) {
+        if (notes[i].duration == 0) {
+            continue;
+        }
+        uint32_t period = fold_period(notes[i].duration);
+        int j = 0;
+        while (j < num_candidates && candidates[j] != period) {
+            j++;
+        }
+        if (j == num_candidates) {
+            candidates[num_candidates++] = period;
+        }
+    }
+    if (num_candidates == 0) {
+        return BEAT_PRIOR_MS;
+    }
+
+    uint32_t best = candidates[0];
+    float best_score = -1.0f;
+    for (int c = 0; c < num_candidates; c++) {
+        uint32_t period = candidates[c];
+        uint32_t tolerance = period / 16;
+        uint32_t now = 0, onsets = 0, on_grid = 0;
+        for (size_t i = 0; i < num_notes; i++) {
+            if (notes[i].frequency) {
+                uint32_t phase = now % period;
+                onsets++;
+                if (phase <= tolerance || period - phase <= tolerance) {
+                    on_grid++;
+                }
+            }
+            now += notes[i].duration;
+        }
+        // Fraction on the grid, discounted by distance from the prior in octaves
+        float octaves = (period > BEAT_PRIOR_MS) ? (float)period / BEAT_PRIOR_MS
+                                                 : (float)BEAT_PRIOR_MS / period;
+        float score = (onsets ? (float)on_grid / onsets : 0.0f) / octaves;
+        if (score > best_score) {
+            best_score = score;
+            best = period;
+        }
+    }
+    return best;
+}
+
+static uint8_t accent_base(const melody_note_t *notes, size_t i, const melody_note_t *prev)
+{
+    uint8_t strength = 0;
+    if (prev == NULL || (i > 0 && notes[i - 1].frequency == 0)) {
+        strength++;             // First note or after a rest
+    }
+    if (prev != NULL) {
+        if (notes[i].duration * 2 >= prev->duration * 3) {
+            strength++;         // Agogic: at least 1.5x the previous note
+        }
+        // Leap of a fourth or more (frequency ratio 4/3)
+        uint32_t hi = notes[i].frequency > prev->frequency ? notes[i].frequency : prev->frequency;
+        uint32_t lo = notes[i].frequency > prev->frequency ? prev->frequency : notes[i].frequency;
+        if (hi * 3 >= lo * 4) {
+            strength++;
+        }
+    }
+    return strength;
+}
+
+static uint8_t detect_meter(const melody_note_t *notes, size_t num_notes, uint32_t beat_ms)
+{
+    static const uint8_t meters[] = { 4, 3, 2 };
+    uint32_t tolerance = beat_ms / 16;
+    uint8_t best = 4;
+    uint32_t best_score = 0;
+
+    for (size_t m = 0; m < sizeof(meters); m++) {
+        uint32_t bar_ms = beat_ms * meters[m];
+        uint32_t now = 0, score = 0;
+        const melody_note_t *prev = NULL;
+        for (size_t i = 0; i < num_notes; i++) {
+            if (notes[i].frequency) {
+                uint32_t phase = now % bar_ms;
+                if (phase <= tolerance || bar_ms - phase <= tolerance) {
+                    score += accent_base(notes, i, prev);
+                }
+                prev = &notes[i];
+            }
+            now += notes[i].duration;
+        }
+        // Per-bar weight; shorter bars need clearly more to win (x5/4)
+        score = score * meters[m] * 4 / (m == 0 ? 4 : 5);
+        if (score > best_score) {
+            best_score = score;
+            best = meters[m];
+        }
+    }
+    return best;
+}
+
+static void emit(melody_event_t *events, size_t *count, uint32_t at_ms, uint16_t frequency, uint8_t leds)
+{
+    // Same-time events: the later one wins
+    uint64_t at_us = (uint64_t)at_ms * 1000;
+    if (*count > 0 && events[*count - 1].at_us == at_us) {
+        (*count)--;
+    }
+    events[*count] = (melody_event_t) {
+        .at_us = at_us,
+        .frequency = frequency,
+        .leds = leds
+    };
+    (*count)++;
+}
+
+size_t lightshow_max_events(size_t num_notes)
+{
+    return num_notes * EVENTS_PER_NOTE;
+}
+
+size_t lightshow_render(const melody_note_t *notes, size_t num_notes,
+                        melody_event_t *events, lightshow_info_t *info)
+{
+    lightshow_info_t result = { 0 };
+    result.beat_ms = detect_beat(notes, num_notes);
+    result.meter = detect_meter(notes, num_notes, result.beat_ms);
+
+    uint32_t bar_ms = result.beat_ms * result.meter;
+    uint32_t tolerance = result.beat_ms / 16;
+    const melody_note_t *prev = NULL;
+    size_t count = 0;
+    uint32_t now = 0;
+
+    for (size_t i = 0; i < num_notes; i++) {
+        const melody_note_t *note = &notes[i];
+        uint32_t start = now;
+        now += note->duration;
+        if (note->frequency == 0) {
+            continue;
+        }
+        result.onsets++;
+
+        // Accent
+        uint8_t strength = accent_base(notes, i, prev);
+        uint32_t phase = start % bar_ms;
+        if (phase <= tolerance || bar_ms - phase <= tolerance) {
+            strength++;         // Downbeat
+        }
+        prev = note;
+
+        uint8_t band = band_leds(note->frequency);
+        uint32_t tone_ms = note->duration * MELODY_TONE_PERCENT / 100;
+        if (strength >= 2) {
+            result.accents++;
+            uint32_t flash = tone_ms / 2 < ACCENT_FLASH_MS ? tone_ms / 2 : ACCENT_FLASH_MS;
+            emit(events, &count, start, note->frequency, LIGHTSHOW_LED_ALL);
+            emit(events, &count, start + flash, note->frequency, band);
+        } else {
+            emit(events, &count, start, note->frequency, band);
+        }
+        emit(events, &count, start + tone_ms, 0, 0);
+
+        // Phrase end: long note, rest of half a beat or more, or the last note
+        uint32_t next_onset = now;
+        size_t j = i + 1;
+        while (j < num_notes && notes[j].frequency == 0) {
+            next_onset += notes[j].duration;
+            j++;
+        }
+        bool long_note = note->duration >= 2 * result.beat_ms;
+        bool long_rest = next_onset - now >= result.beat_ms / 2;
+        if (long_note || long_rest || j >= num_notes) {
+            result.phrases++;
+            // Sweep through the gap before the next note, compressed if short
+            uint32_t gap = next_onset - (start + tone_ms);
+            uint32_t step = gap / 4 < CHASE_STEP_MS ? gap / 4 : CHASE_STEP_MS;
+            if (step >= CHASE_MIN_STEP_MS) {
+                uint32_t at = start + tone_ms;
+                emit(events, &count, at, 0, LIGHTSHOW_LED_LOW);
+                emit(events, &count, at + step, 0, LIGHTSHOW_LED_MID);
+                emit(events, &count, at + 2 * step, 0, LIGHTSHOW_LED_HIGH);
+                emit(events, &count, at + 3 * step, 0, 0);
+            }
+        }
+    }
+
+    result.num_events = count;
+    if (info) {
+        *info = result;
+    }
+    return count;
+}
+
+melody_event_t *lightshow_build(const melody_note_t *notes, size_t num_notes, lightshow_info_t *info)
+{
+    melody_event_t *events = malloc(lightshow_max_events(num_notes) * sizeof(melody_event_t));
+    if (events == NULL) {
+        return NULL;
+    }
+    size_t count = lightshow_render(notes, num_notes, events, info);
+    melody_event_t *fitted = realloc(events, (count ? count : 1) * sizeof(melody_event_t));
+    return fitted ? fitted : events;
+}
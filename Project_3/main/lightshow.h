@@ -0,0 +1,33 @@
+/* Light-show track for the melody player
+ * Analyses a song once when it is loaded: beat period from note onsets,
+ * bar length, accented notes and phrase ends. The result is pre-rendered
+ * into a timestamped LED-mask event stream that plays in lockstep with the
+ * audio, so playback does no per-note analysis.
+ * Plain C, no ESP-IDF dependencies.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "melody_note.h"
+
+#define LIGHTSHOW_LED_LOW       0x01
+#define LIGHTSHOW_LED_MID       0x02
+#define LIGHTSHOW_LED_HIGH      0x04
+#define LIGHTSHOW_LED_ALL       0x07
+
+typedef struct {
+    uint32_t beat_ms;           // Detected beat period
+    uint8_t meter;              // Beats per bar (2, 3 or 4)
+    uint32_t onsets;            // Sounding notes
+    uint32_t accents;
+    uint32_t phrases;
+    uint32_t num_events;        // Events in the rendered stream
+} lightshow_info_t;
+
+// Upper bound of events lightshow_render() writes for num_notes notes
+size_t lightshow_max_events(size_t num_notes);
+size_t lightshow_render(const melody_note_t *notes, size_t num_notes,
+                        melody_event_t *events, lightshow_info_t *info);
+// Render into a right-sized heap array; NULL on allocation failure
+melody_event_t *lightshow_build(const melody_note_t *notes, size_t num_notes, lightshow_info_t *info);
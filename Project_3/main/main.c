@@ -2,52 +2,70 @@
  * ESP32 ESP-IDF Implementation
  */
 #include <stdio.h>
+#include <stdlib.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "driver/ledc.h"
 #include "driver/gpio.h"
 #include "esp_err.h"
+#include "esp_cpu.h"
+#include "esp_timer.h"
+#include "esp_attr.h"
+#include "sdkconfig.h"
+#include "soc/soc.h"
+#include "soc/gpio_reg.h"
+#include "melody_rmt.h"
+#include "note_table.h"
+#include "songs.h"
+#include "playlist.h"
+#include "lightshow.h"
+// Set by idf.py -DQEMU_TEST=1 for the QEMU tests: QEMU has no RMT, so the
+// song plays on the LEDC backend
+#ifndef QEMU_TEST
+#define QEMU_TEST       0
+#endif
 // Pin definitions
 #define BUZZER_PIN      GPIO_NUM_5
 #define LED1_PIN        GPIO_NUM_2   // Low notes
 #define LED2_PIN        GPIO_NUM_4   // Mid notes
 #define LED3_PIN        GPIO_NUM_15  // High notes
+#define LED_PIN_MASK    ((1UL << LED1_PIN) | (1UL << LED2_PIN) | (1UL << LED3_PIN))
 // LEDC configuration
 #define LEDC_TIMER              LEDC_TIMER_0
 #define LEDC_MODE               LEDC_LOW_SPEED_MODE
 #define LEDC_BUZZER_CHANNEL     LEDC_CHANNEL_0
 #define LEDC_DUTY_RES           LEDC_TIMER_13_BIT
 #define LEDC_DUTY               (4096) // 50% duty cycle
+// Playback backend: 0 = LEDC + vTaskDelay per note, 1 = whole song queued on RMT
+#define USE_RMT_BACKEND         (!QEMU_TEST)
+// Play the song on both backends in turn and log CPU time per song.
+// The RMT copy goes to BENCH_RMT_PIN so both backends keep their pin.
+#define MELODY_BENCH            0
+#define BENCH_RMT_PIN           GPIO_NUM_18
+// Note-on through the precomputed 88-key divider table instead of ledc_set_freq
+#define USE_NOTE_TABLE          1
+#define TUNING_A4_CENTIHZ       44000   // A4 reference in 1/100 Hz
+#define TRANSPOSE_SEMITONES     0
+// Log note-on latency of ledc_set_freq vs the table at startup
+#define NOTE_ON_BENCH           0
+// Playlist of all songs on the RMT backend, next track prepared while one plays
+#define PLAYLIST_ENABLE         (!QEMU_TEST)
+#define PLAYLIST_ORDER          PLAYLIST_ORDERED
+#define PLAYLIST_REPEAT         PLAYLIST_REPEAT_ALL
+#define PLAYLIST_PREFETCH       1       // 0 = prepare after each track ends (baseline)
+#define PLAYLIST_STATS_MS       10000
+// LEDs from a light show rendered at song load (beats, accents, phrases)
+#define LIGHTSHOW_ENABLE        1
+// Time the one-off light-show analysis on long synthetic songs at startup
+#define LIGHTSHOW_BENCH         0
+#if PLAYLIST_ENABLE && (!USE_RMT_BACKEND || MELODY_BENCH)
+#error "PLAYLIST_ENABLE needs USE_RMT_BACKEND and no MELODY_BENCH"
+#endif
 // Musical note structure
 typedef struct {
     int frequency;      // Note frequency in Hz (0 = rest)
     int duration;       // Duration in milliseconds
 } Note;
-// Note frequency definitions (in Hz) [web:31][page:3]
-#define NOTE_B3  247
-#define NOTE_C4  262
-#define NOTE_CS4 277
-#define NOTE_D4  294
-#define NOTE_DS4 311
-#define NOTE_E4  330
-#define NOTE_F4  349
-#define NOTE_FS4 370
-#define NOTE_G4  392
-#define NOTE_GS4 415
-#define NOTE_A4  440
-#define NOTE_AS4 466
-#define NOTE_B4  494
-#define NOTE_C5  523
-#define NOTE_CS5 554
-#define NOTE_D5  587
-#define NOTE_DS5 622
-#define NOTE_E5  659
-#define NOTE_F5  698
-#define NOTE_FS5 740
-#define NOTE_G5  784
-#define NOTE_GS5 831
-#define NOTE_A5  880
-#define REST     0
 // Tempo setting (120 BPM) [page:3]
 #define TEMPO 120
 #define WHOLE_NOTE ((60000 * 4) / TEMPO)
@@ -63,7 +81,7 @@ int calc_duration(int divider) {
 // Imperial March melody - complete version [web:31][page:3]
 // Format: {frequency, duration_divider}
 // Negative durations represent dotted notes
-int imperial_march_raw[][2] = {
+const int imperial_march_raw[][2] = {
     // Main theme
     {NOTE_A4, -4}, {NOTE_A4, -4}, {NOTE_A4, 16}, {NOTE_A4, 16}, 
     {NOTE_A4, 16}, {NOTE_A4, 16}, {NOTE_F4, 8}, {REST, 8},
@@ -93,13 +111,37 @@ int imperial_march_raw[][2] = {
     {NOTE_A4, 4}, {NOTE_F4, -8}, {NOTE_C5, 16}, {NOTE_A4, 2},
 };
 #define MELODY_LENGTH (sizeof(imperial_march_raw) / sizeof(imperial_march_raw[0]))
+// Score length of the melody, the sum of its note durations
+static uint32_t melody_length_ms(void)
+{
+    uint32_t total = 0;
+    for (int i = 0; i < MELODY_LENGTH; i++) {
+        total += calc_duration(imperial_march_raw[i][1]);
+    }
+    return total;
+}
 // Function prototypes
 void init_buzzer(void);
 void init_leds(void);
-void play_note(int frequency, int duration);
+void play_note(int frequency, int key, int duration);
 void play_melody(void);
 void update_leds(int frequency);
 void leds_off(void);
+void compile_song(void);
+void play_melody_rmt(void);
+void rmt_note_event(const melody_event_t *event);
+void set_led_mask(uint8_t leds);
+void lightshow_bench(void);
+void log_song_cpu(void);
+void init_note_keys(void);
+void note_on_bench(void);
+void run_playlist(void);
+uint16_t tuned_frequency(int frequency);
+
+static melody_song_t compiled_song;
+static uint32_t compile_cycles = 0;
+static uint64_t ledc_song_cycles = 0;   // CPU cycles in LEDC/GPIO calls for one song
+static int melody_keys[MELODY_LENGTH];  // Piano key of each note, NOTE_KEY_REST for rests
 
 void app_main(void)
 {
@@ -108,14 +150,53 @@ void app_main(void)
     init_leds();
     
     printf("Digital Jukebox - Star Wars Imperial March\n");
-    printf("Melody Length: %d notes\n", MELODY_LENGTH);
-    
+    printf("Melody Length: %d notes, %lu ms\n", MELODY_LENGTH, (unsigned long)melody_length_ms());
+
+#if USE_NOTE_TABLE || NOTE_ON_BENCH
+    ESP_ERROR_CHECK(note_table_init(LEDC_MODE, LEDC_TIMER, LEDC_DUTY_RES));
+    ESP_ERROR_CHECK(note_table_set_tuning(TUNING_A4_CENTIHZ, TRANSPOSE_SEMITONES));
+    init_note_keys();
+#endif
+#if NOTE_ON_BENCH
+    note_on_bench();
+#endif
+#if LIGHTSHOW_BENCH
+    lightshow_bench();
+#endif
+
+#if USE_RMT_BACKEND || MELODY_BENCH
+#if !PLAYLIST_ENABLE
+    compile_song();
+#endif
+#if MELODY_BENCH
+    ESP_ERROR_CHECK(melody_rmt_init(BENCH_RMT_PIN, rmt_note_event));
+#else
+    ESP_ERROR_CHECK(melody_rmt_init(BUZZER_PIN, rmt_note_event));
+#endif
+#endif
+
+#if PLAYLIST_ENABLE
+    run_playlist();
+#else
     while(1) {
         printf("Playing: Star Wars Imperial March\n");
+        int64_t song_start = esp_timer_get_time();
+#if MELODY_BENCH
+        ledc_song_cycles = 0;
+        play_melody();
+        melody_rmt_reset_stats();
+        play_melody_rmt();
+        log_song_cpu();
+#elif USE_RMT_BACKEND
+        play_melody_rmt();
+#else
         play_melody();
-        printf("Melody complete. Restarting in 5 seconds...\n");
+#endif
+        printf("Melody complete in %lu ms. Restarting in 5 seconds...\n",
+               (unsigned long)((esp_timer_get_time() - song_start) / 1000));
         vTaskDelay(pdMS_TO_TICKS(5000));
     }
+#endif
 }
 
 void init_buzzer(void)
@@ -126,7 +207,7 @@ void init_buzzer(void)
         .timer_num        = LEDC_TIMER,
         .duty_resolution  = LEDC_DUTY_RES,
         .freq_hz          = 1000,
-        .clk_cfg          = LEDC_AUTO_CLK
+        .clk_cfg          = LEDC_USE_APB_CLK    // Note table dividers assume APB
     };
     ESP_ERROR_CHECK(ledc_timer_config(&ledc_timer));
     
@@ -157,8 +238,9 @@ void init_leds(void)
     leds_off();
 }
 
-void play_note(int frequency, int duration)
+void play_note(int frequency, int key, int duration)
 {
+    uint32_t start = esp_cpu_get_cycle_count();
     if (frequency == 0) {
         // Rest - silence [page:3]
         ESP_ERROR_CHECK(ledc_set_duty(LEDC_MODE, LEDC_BUZZER_CHANNEL, 0));
@@ -166,21 +248,31 @@ void play_note(int frequency, int duration)
         leds_off();
     } else {
         // Play note with specified frequency [web:18]
+#if USE_NOTE_TABLE
+        // Pitches off the 88-key table (NOTE_KEY_REST) fall back to the driver
+        if (note_table_note_on(key) != ESP_OK) {
+            ESP_ERROR_CHECK(ledc_set_freq(LEDC_MODE, LEDC_TIMER, frequency));
+        }
+#else
         ESP_ERROR_CHECK(ledc_set_freq(LEDC_MODE, LEDC_TIMER, frequency));
+#endif
         ESP_ERROR_CHECK(ledc_set_duty(LEDC_MODE, LEDC_BUZZER_CHANNEL, LEDC_DUTY));
         ESP_ERROR_CHECK(ledc_update_duty(LEDC_MODE, LEDC_BUZZER_CHANNEL));
         
         // Update LED pattern based on frequency [web:37]
         update_leds(frequency);
     }
+    ledc_song_cycles += esp_cpu_get_cycle_count() - start;
     
     // Play for 90% of duration (10% pause between notes) [page:3]
     vTaskDelay(pdMS_TO_TICKS(duration * 0.9));
     
     // Brief silence between notes
+    start = esp_cpu_get_cycle_count();
     ESP_ERROR_CHECK(ledc_set_duty(LEDC_MODE, LEDC_BUZZER_CHANNEL, 0));
     ESP_ERROR_CHECK(ledc_update_duty(LEDC_MODE, LEDC_BUZZER_CHANNEL));
     leds_off();
+    ledc_song_cycles += esp_cpu_get_cycle_count() - start;
     vTaskDelay(pdMS_TO_TICKS(duration * 0.1));
 }
 
@@ -192,30 +284,215 @@ void play_melody(void)
         int divider = imperial_march_raw[i][1];
         int duration = calc_duration(divider);
         
-        play_note(frequency, duration);
+        play_note(frequency, melody_keys[i], duration);
     }
 }
 
-void update_leds(int frequency)
+void compile_song(void)
 {
-    // Turn on different LEDs based on note frequency range [web:37]
+    // Same note table as the LEDC path, flattened to frequency + duration
+    static melody_note_t notes[MELODY_LENGTH];
+    uint32_t start = esp_cpu_get_cycle_count();
+    for (int i = 0; i < MELODY_LENGTH; i++) {
+#if USE_NOTE_TABLE
+        notes[i].frequency = note_table_freq_centihz(melody_keys[i]) / 100;
+#else
+        notes[i].frequency = imperial_march_raw[i][0];
+#endif
+        notes[i].duration = calc_duration(imperial_march_raw[i][1]);
+    }
+    ESP_ERROR_CHECK(melody_rmt_compile(notes, MELODY_LENGTH, &compiled_song));
+#if LIGHTSHOW_ENABLE
+    lightshow_info_t info;
+    melody_event_t *events = lightshow_build(notes, MELODY_LENGTH, &info);
+    if (events != NULL) {
+        melody_rmt_set_events(&compiled_song, events, info.num_events);
+        printf("Light show: beat %lu ms, %d/4, %lu accents, %lu phrases, %lu events\n",
+               (unsigned long)info.beat_ms, info.meter, (unsigned long)info.accents,
+               (unsigned long)info.phrases, (unsigned long)info.num_events);
+    }
+#endif
+    compile_cycles = esp_cpu_get_cycle_count() - start;
+    printf("RMT song: %d runs, %lu symbols, %lu ms\n", (int)compiled_song.num_runs,
+           (unsigned long)compiled_song.num_symbols, (unsigned long)(compiled_song.duration_us / 1000));
+}
+
+void play_melody_rmt(void)
+{
+    // Whole song is queued to the RMT; this task sleeps until it finishes
+    ESP_ERROR_CHECK(melody_rmt_play(&compiled_song));
+    ESP_ERROR_CHECK(melody_rmt_wait(compiled_song.duration_us / 1000 + 1000));
     leds_off();
-    
+}
+
+// Called from the esp_timer ISR (melody_rmt.h), so the LED path is in IRAM
+IRAM_ATTR void rmt_note_event(const melody_event_t *event)
+{
+    if (event->leds != MELODY_LEDS_BY_NOTE) {
+        set_led_mask(event->leds);
+    } else if (event->frequency) {
+        update_leds(event->frequency);
+    } else {
+        leds_off();
+    }
+}
+
+IRAM_ATTR void set_led_mask(uint8_t leds)
+{
+    // All three LEDs in one W1TS and one W1TC write
+    uint32_t on = ((leds & LIGHTSHOW_LED_LOW) ? 1UL << LED1_PIN : 0) |
+                  ((leds & LIGHTSHOW_LED_MID) ? 1UL << LED2_PIN : 0) |
+                  ((leds & LIGHTSHOW_LED_HIGH) ? 1UL << LED3_PIN : 0);
+    REG_WRITE(GPIO_OUT_W1TS_REG, on);
+    REG_WRITE(GPIO_OUT_W1TC_REG, LED_PIN_MASK & ~on);
+}
+
+void lightshow_bench(void)
+{
+    // Imperial March tiled to long song lengths
+    const size_t lengths[] = { MELODY_LENGTH, 500, 1000, 2000 };
+    melody_note_t *notes = malloc(2000 * sizeof(melody_note_t));
+    if (notes == NULL) {
+        printf("Light-show bench: out of memory\n");
+        return;
+    }
+    for (size_t i = 0; i < 2000; i++) {
+        notes[i].frequency = imperial_march_raw[i % MELODY_LENGTH][0];
+        notes[i].duration = calc_duration(imperial_march_raw[i % MELODY_LENGTH][1]);
+    }
+    for (int l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++) {
+        lightshow_info_t info;
+        uint32_t start = esp_cpu_get_cycle_count();
+        melody_event_t *events = lightshow_build(notes, lengths[l], &info);
+        uint32_t cycles = esp_cpu_get_cycle_count() - start;
+        if (events == NULL) {
+            printf("Light show %5u notes: out of memory\n", (unsigned)lengths[l]);
+            break;
+        }
+        free(events);
+        printf("Light show %5u notes: %lu us (%lu ns/note), %lu events\n", (unsigned)lengths[l],
+               (unsigned long)(cycles / CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ),
+               (unsigned long)(cycles * 1000ULL / CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ / lengths[l]),
+               (unsigned long)info.num_events);
+    }
+    free(notes);
+}
+
+void log_song_cpu(void)
+{
+    melody_rmt_stats_t stats;
+    melody_rmt_get_stats(&stats);
+    uint64_t rmt_cycles = stats.encode_cycles + stats.event_cycles;
+    printf("LEDC/vTaskDelay: %llu cycles (%llu us) per song\n",
+           (unsigned long long)ledc_song_cycles,
+           (unsigned long long)(ledc_song_cycles / CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ));
+    printf("RMT: %llu cycles (%llu us) per song: encoder %llu in %lu refills (max %lu), LED events %llu, compile once %lu\n",
+           (unsigned long long)rmt_cycles,
+           (unsigned long long)(rmt_cycles / CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ),
+           (unsigned long long)stats.encode_cycles, (unsigned long)stats.encode_calls,
+           (unsigned long)stats.max_encode_cycles, (unsigned long long)stats.event_cycles,
+           (unsigned long)compile_cycles);
+}
+
+void init_note_keys(void)
+{
+    // Map the NOTE_* frequencies onto piano keys once; playback only looks up keys
+    for (int i = 0; i < MELODY_LENGTH; i++) {
+        melody_keys[i] = note_table_key_from_hz(imperial_march_raw[i][0]);
+    }
+}
+
+void note_on_bench(void)
+{
+    const int rounds = 10;
+    uint64_t freq_total = 0, table_total = 0;
+    uint32_t freq_max = 0, table_max = 0;
+
+    for (int r = 0; r < rounds; r++) {
+        for (int key = 0; key < NOTE_TABLE_KEYS; key++) {
+            int frequency = note_table_freq_centihz(key) / 100;
+
+            uint32_t start = esp_cpu_get_cycle_count();
+            ledc_set_freq(LEDC_MODE, LEDC_TIMER, frequency);
+            uint32_t cycles = esp_cpu_get_cycle_count() - start;
+            freq_total += cycles;
+            freq_max = cycles > freq_max ? cycles : freq_max;
+
+            start = esp_cpu_get_cycle_count();
+            ESP_ERROR_CHECK(note_table_note_on(key));
+            cycles = esp_cpu_get_cycle_count() - start;
+            table_total += cycles;
+            table_max = cycles > table_max ? cycles : table_max;
+        }
+    }
+    int count = rounds * NOTE_TABLE_KEYS;
+    printf("Note-on ledc_set_freq: avg %lu cycles (%lu ns), max %lu cycles\n",
+           (unsigned long)(freq_total / count),
+           (unsigned long)(freq_total * 1000 / count / CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ),
+           (unsigned long)freq_max);
+    printf("Note-on table lookup: avg %lu cycles (%lu ns), max %lu cycles\n",
+           (unsigned long)(table_total / count),
+           (unsigned long)(table_total * 1000 / count / CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ),
+           (unsigned long)table_max);
+}
+
+uint16_t tuned_frequency(int frequency)
+{
+#if USE_NOTE_TABLE
+    return note_table_freq_centihz(note_table_key_from_hz(frequency)) / 100;
+#else
+    return frequency;
+#endif
+}
+
+void run_playlist(void)
+{
+    // Stays in scope for as long as the playlist runs
+    const playlist_track_t tracks[] = {
+        { "Star Wars Imperial March", imperial_march_raw, MELODY_LENGTH, TEMPO },
+        { "Ode to Joy", ode_to_joy, ode_to_joy_length, 100 },
+        { "Twinkle Twinkle Little Star", twinkle_twinkle, twinkle_twinkle_length, 100 },
+    };
+
+    playlist_config_t config = {
+        .tracks = tracks,
+        .num_tracks = sizeof(tracks) / sizeof(tracks[0]),
+        .order = PLAYLIST_ORDER,
+        .repeat = PLAYLIST_REPEAT,
+        .prefetch = PLAYLIST_PREFETCH,
+        .light_show = LIGHTSHOW_ENABLE,
+        .map_frequency = tuned_frequency
+    };
+    ESP_ERROR_CHECK(playlist_start(&config));
+
+    while (playlist_is_running()) {
+        vTaskDelay(pdMS_TO_TICKS(PLAYLIST_STATS_MS));
+        playlist_stats_t stats;
+        playlist_get_stats(&stats);
+        printf("Playlist: %lu tracks, switch %lu us (max %lu), prepare %lu us (max %lu), buffers %u bytes (peak %u)\n",
+               (unsigned long)stats.tracks_started,
+               (unsigned long)stats.last_switch_us, (unsigned long)stats.max_switch_us,
+               (unsigned long)stats.last_prepare_us, (unsigned long)stats.max_prepare_us,
+               (unsigned)stats.buffer_bytes, (unsigned)stats.peak_buffer_bytes);
+    }
+}
+
+IRAM_ATTR void update_leds(int frequency)
+{
+    // Turn on different LEDs based on note frequency range [web:37]
     if (frequency < 400) {
         // Low notes (A4 and below) - LED1
-        gpio_set_level(LED1_PIN, 1);
+        set_led_mask(LIGHTSHOW_LED_LOW);
     } else if (frequency < 650) {
         // Mid notes (A4-E5) - LED2
-        gpio_set_level(LED2_PIN, 1);
+        set_led_mask(LIGHTSHOW_LED_MID);
     } else {
         // High notes (E5 and above) - LED3
-        gpio_set_level(LED3_PIN, 1);
+        set_led_mask(LIGHTSHOW_LED_HIGH);
     }
 }
 
-void leds_off(void)
+IRAM_ATTR void leds_off(void)
 {
-    gpio_set_level(LED1_PIN, 0);
-    gpio_set_level(LED2_PIN, 0);
-    gpio_set_level(LED3_PIN, 0);
+    set_led_mask(0);
 }
@@ -0,0 +1,21 @@
+/* Note and LED event types shared by the melody backends
+ * Plain C, no ESP-IDF dependencies.
+ */
+#pragma once
+
+#include <stdint.h>
+
+#define MELODY_TONE_PERCENT     90          // Sounding part of each note, rest is gap
+#define MELODY_LEDS_BY_NOTE     0xFF        // Event LEDs follow the note's band
+
+typedef struct {
+    uint16_t frequency;         // Hz, 0 = rest
+    uint16_t duration;          // ms
+} melody_note_t;
+
+// Timestamped LED update played alongside the audio
+typedef struct {
+    uint64_t at_us;             // Offset from song start
+    uint16_t frequency;         // Note sounding at this point, 0 = none
+    uint8_t leds;               // LED mask, or MELODY_LEDS_BY_NOTE
+} melody_event_t;
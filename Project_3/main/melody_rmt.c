@@ -0,0 +1,468 @@
+/* RMT melody backend
+ *
+ * The ESP32 RMT carrier is configured per channel and cannot change inside
+ * a transaction, so pitch is carried by the symbol durations instead: a
+ * note of frequency f is `cycles` copies of one {high, low} symbol whose
+ * two halves add up to the period in RMT ticks. Rests and gaps are low
+ * symbols of up to 2 x 32767 ticks. Each note's tone plus gap is padded to
+ * exactly its duration, so the song never drifts.
+ *
+ * The encoder copies runs into RMT memory in chunks of identical symbols;
+ * it runs from the RMT interrupt each time half of the memory drains.
+ * LEDs follow the song from an esp_timer chain fired at note boundaries;
+ * with esp_timer ISR dispatch it runs from the timer ISR, in IRAM, so the
+ * lights stay on the beat while flash is written.
+ * Queued songs are separate RMT transactions; the driver starts the next
+ * one from the TX-done interrupt, so consecutive songs play without a gap
+ * as long as the next one is queued before the current one ends.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+#include "esp_cpu.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "melody_rmt.h"
+
+static const char *TAG = "MELODY_RMT";
+
+#define RMT_MEM_SYMBOLS     128     // Two RMT memory blocks for ping-pong refill
+#define RUN_CHUNK           32      // Identical symbols copied per encoder step
+#define MAX_HALF_TICKS      32767   // 15-bit symbol duration
+#define TX_QUEUE_DEPTH      2
+#define SONG_SLOTS          (TX_QUEUE_DEPTH + 1)   // Pending songs plus the one playing
+
+typedef struct {
+    rmt_encoder_t base;
+    rmt_encoder_t *copy_encoder;
+    size_t run;                     // Current run
+    uint32_t done;                  // Symbols of the current run already written
+    uint32_t chunk;                 // Symbols in the chunk being copied
+    rmt_symbol_word_t buffer[RUN_CHUNK];
+} melody_encoder_t;
+
+static rmt_channel_handle_t tone_chan = NULL;
+static rmt_encoder_t *tone_encoder = NULL;
+static esp_timer_handle_t event_timer = NULL;
+static melody_event_cb_t event_callback = NULL;
+
+// Songs whose LED events are still to be dispatched, oldest first
+typedef struct {
+    const melody_song_t *song;
+    int64_t start_us;           // Expected start on the esp_timer clock
+} queued_song_t;
+
+static queued_song_t song_queue[SONG_SLOTS];
+static size_t queue_head = 0;
+static size_t queue_count = 0;
+static size_t next_event = 0;
+static int64_t queue_end_us = 0;                // Expected end of the last queued song
+static portMUX_TYPE queue_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static SemaphoreHandle_t song_done = NULL;
+static volatile int64_t last_done_us = 0;
+static volatile bool switch_pending = false;    // Next transaction follows a finished one
+static melody_rmt_stats_t stats;
+static portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static IRAM_ATTR size_t melody_encode(rmt_encoder_t *encoder, rmt_channel_handle_t channel,
+                                      const void *primary_data, size_t data_size,
+                                      rmt_encode_state_t *ret_state)
+{
+    uint32_t start = esp_cpu_get_cycle_count();
+    melody_encoder_t *m = __containerof(encoder, melody_encoder_t, base);
+    const melody_run_t *runs = primary_data;
+    size_t num_runs = data_size / sizeof(melody_run_t);
+    rmt_encode_state_t state = RMT_ENCODING_RESET;
+    size_t encoded_symbols = 0;
+
+    // First call of a transaction queued behind a finished one
+    if (m->run == 0 && m->done == 0 && m->chunk == 0 && switch_pending) {
+        uint32_t gap_us = (uint32_t)(esp_timer_get_time() - last_done_us);
+        switch_pending = false;
+        portENTER_CRITICAL_SAFE(&stats_lock);
+        stats.switches++;
+        stats.last_switch_us = gap_us;
+        if (gap_us > stats.max_switch_us) {
+            stats.max_switch_us = gap_us;
+        }
+        portEXIT_CRITICAL_SAFE(&stats_lock);
+    }
+
+    while (m->run < num_runs) {
+        const melody_run_t *run = &runs[m->run];
+        // New chunk: fill the buffer once, the copy encoder may need several calls
+        if (m->chunk == 0) {
+            uint32_t left = run->repeat - m->done;
+            m->chunk = left < RUN_CHUNK ? left : RUN_CHUNK;
+            if (m->done == 0) {
+                for (uint32_t i = 0; i < m->chunk; i++) {
+                    m->buffer[i] = run->symbol;
+                }
+            }
+        }
+
+        rmt_encode_state_t session_state = RMT_ENCODING_RESET;
+        encoded_symbols += m->copy_encoder->encode(m->copy_encoder, channel, m->buffer,
+                                                   m->chunk * sizeof(rmt_symbol_word_t),
+                                                   &session_state);
+        if (session_state & RMT_ENCODING_COMPLETE) {
+            m->done += m->chunk;
+            m->chunk = 0;
+            if (m->done >= run->repeat) {
+                m->done = 0;
+                m->run++;
+            }
+        }
+        if (session_state & RMT_ENCODING_MEM_FULL) {
+            state |= RMT_ENCODING_MEM_FULL;
+            goto out;
+        }
+    }
+    m->run = 0;
+    state |= RMT_ENCODING_COMPLETE;
+
+out:
+    *ret_state = state;
+    uint32_t cycles = esp_cpu_get_cycle_count() - start;
+    portENTER_CRITICAL_SAFE(&stats_lock);
+    stats.encode_calls++;
+    stats.symbols += encoded_symbols;
+    stats.encode_cycles += cycles;
+    if (cycles > stats.max_encode_cycles) {
+        stats.max_encode_cycles = cycles;
+    }
+    portEXIT_CRITICAL_SAFE(&stats_lock);
+    return encoded_symbols;
+}
+
+static esp_err_t melody_encoder_reset(rmt_encoder_t *encoder)
+{
+    melody_encoder_t *m = __containerof(encoder, melody_encoder_t, base);
+    rmt_encoder_reset(m->copy_encoder);
+    m->run = 0;
+    m->done = 0;
+    m->chunk = 0;
+    return ESP_OK;
+}
+
+static esp_err_t melody_encoder_del(rmt_encoder_t *encoder)
+{
+    melody_encoder_t *m = __containerof(encoder, melody_encoder_t, base);
+    rmt_del_encoder(m->copy_encoder);
+    free(m);
+    return ESP_OK;
+}
+
+static esp_err_t melody_new_encoder(rmt_encoder_t **ret_encoder)
+{
+    melody_encoder_t *m = calloc(1, sizeof(melody_encoder_t));
+    if (m == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    m->base.encode = melody_encode;
+    m->base.reset = melody_encoder_reset;
+    m->base.del = melody_encoder_del;
+
+    rmt_copy_encoder_config_t copy_config = {};
+    esp_err_t ret = rmt_new_copy_encoder(&copy_config, &m->copy_encoder);
+    if (ret != ESP_OK) {
+        free(m);
+        return ret;
+    }
+    *ret_encoder = &m->base;
+    return ESP_OK;
+}
+
+static IRAM_ATTR bool tx_done_cb(rmt_channel_handle_t channel, const rmt_tx_done_event_data_t *edata, void *user_ctx)
+{
+    BaseType_t woken = pdFALSE;
+    last_done_us = esp_timer_get_time();
+    switch_pending = true;
+    xSemaphoreGiveFromISR(song_done, &woken);
+    return woken == pdTRUE;
+}
+
+static IRAM_ATTR void event_timer_cb(void *arg)
+{
+    uint32_t start = esp_cpu_get_cycle_count();
+    uint32_t dispatched = 0;
+
+    while (1) {
+        portENTER_CRITICAL_SAFE(&queue_lock);
+        if (queue_count == 0) {
+            portEXIT_CRITICAL_SAFE(&queue_lock);
+            break;
+        }
+        queued_song_t current = song_queue[queue_head];
+        portEXIT_CRITICAL_SAFE(&queue_lock);
+
+        // Dispatch everything that is due, then arm for the next boundary
+        const melody_song_t *song = current.song;
+        int64_t elapsed = esp_timer_get_time() - current.start_us;
+        while (next_event < song->num_events && (int64_t)song->events[next_event].at_us <= elapsed) {
+            if (event_callback) {
+                event_callback(&song->events[next_event]);
+            }
+            next_event++;
+            dispatched++;
+        }
+        if (next_event < song->num_events) {
+            esp_timer_start_once(event_timer, song->events[next_event].at_us - elapsed);
+            break;
+        }
+
+        // All events of this song sent: continue with the one queued behind it
+        portENTER_CRITICAL_SAFE(&queue_lock);
+        queue_head = (queue_head + 1) % SONG_SLOTS;
+        queue_count--;
+        portEXIT_CRITICAL_SAFE(&queue_lock);
+        next_event = 0;
+    }
+
+    uint32_t cycles = esp_cpu_get_cycle_count() - start;
+    portENTER_CRITICAL_SAFE(&stats_lock);
+    stats.events += dispatched;
+    stats.event_cycles += cycles;
+    portEXIT_CRITICAL_SAFE(&stats_lock);
+}
+
+static bool song_in_queue(const melody_song_t *song)
+{
+    bool found = false;
+    portENTER_CRITICAL(&queue_lock);
+    for (size_t i = 0; i < queue_count; i++) {
+        if (song_queue[(queue_head + i) % SONG_SLOTS].song == song) {
+            found = true;
+        }
+    }
+    portEXIT_CRITICAL(&queue_lock);
+    return found;
+}
+
+static void add_run(melody_song_t *song, uint32_t high, uint32_t low, int level, uint32_t repeat)
+{
+    melody_run_t *run = &song->runs[song->num_runs++];
+    run->symbol = (rmt_symbol_word_t) {
+        .level0 = level, .duration0 = high,
+        .level1 = 0, .duration1 = low,
+    };
+    run->repeat = repeat;
+    song->num_symbols += repeat;
+}
+
+static void add_silence(melody_song_t *song, uint32_t ticks)
+{
+    uint32_t full = ticks / (2 * MAX_HALF_TICKS);
+    uint32_t rest = ticks % (2 * MAX_HALF_TICKS);
+    if (full) {
+        add_run(song, MAX_HALF_TICKS, MAX_HALF_TICKS, 0, full);
+    }
+    // Sub-tick-pair remainder below 2 us is dropped
+    if (rest >= 2) {
+        add_run(song, rest / 2, rest - rest / 2, 0, 1);
+    }
+}
+
+static void add_event(melody_song_t *song, uint32_t at_us, uint16_t frequency)
+{
+    melody_event_t *event = &song->events[song->num_events++];
+    event->at_us = at_us;
+    event->frequency = frequency;
+    event->leds = MELODY_LEDS_BY_NOTE;
+}
+
+esp_err_t melody_rmt_compile(const melody_note_t *notes, size_t count, melody_song_t *song)
+{
+    const uint32_t ticks_per_us = MELODY_RMT_RES_HZ / 1000000;
+
+    memset(song, 0, sizeof(*song));
+    // Worst case per note: one tone run and two silence runs
+    song->runs = calloc(count * 3, sizeof(melody_run_t));
+    song->events = calloc(count * 2, sizeof(melody_event_t));
+    if (song->runs == NULL || song->events == NULL) {
+        melody_rmt_free_song(song);
+        return ESP_ERR_NO_MEM;
+    }
+
+    uint32_t now_us = 0;
+    for (size_t i = 0; i < count; i++) {
+        uint32_t note_ticks = notes[i].duration * 1000 * ticks_per_us;
+        uint32_t tone_ticks = 0;
+
+        if (notes[i].frequency != 0) {
+            uint32_t period = (MELODY_RMT_RES_HZ + notes[i].frequency / 2) / notes[i].frequency;
+            if (period < 2 || period > 2 * MAX_HALF_TICKS) {
+                ESP_LOGE(TAG, "Note %u Hz out of range", notes[i].frequency);
+                melody_rmt_free_song(song);
+                return ESP_ERR_INVALID_ARG;
+            }
+            // Whole periods only, so the tone ends on a low edge
+            uint32_t cycles = note_ticks * MELODY_TONE_PERCENT / 100 / period;
+            if (cycles) {
+                add_run(song, period / 2, period - period / 2, 1, cycles);
+                tone_ticks = cycles * period;
+                add_event(song, now_us, notes[i].frequency);
+                add_event(song, now_us + tone_ticks / ticks_per_us, 0);
+            }
+        }
+        add_silence(song, note_ticks - tone_ticks);
+        now_us += notes[i].duration * 1000;
+    }
+    song->duration_us = now_us;
+
+    // Give back the worst-case reservation
+    melody_run_t *runs = realloc(song->runs, song->num_runs * sizeof(melody_run_t));
+    if (runs != NULL) {
+        song->runs = runs;
+    }
+    if (song->num_events) {
+        melody_event_t *events = realloc(song->events, song->num_events * sizeof(melody_event_t));
+        if (events != NULL) {
+            song->events = events;
+        }
+    }
+    song->bytes = song->num_runs * sizeof(melody_run_t) + song->num_events * sizeof(melody_event_t);
+    return ESP_OK;
+}
+
+void melody_rmt_free_song(melody_song_t *song)
+{
+    free(song->runs);
+    free(song->events);
+    memset(song, 0, sizeof(*song));
+}
+
+void melody_rmt_set_events(melody_song_t *song, melody_event_t *events, size_t num_events)
+{
+    song->bytes -= song->num_events * sizeof(melody_event_t);
+    free(song->events);
+    song->events = events;
+    song->num_events = num_events;
+    song->bytes += num_events * sizeof(melody_event_t);
+}
+
+esp_err_t melody_rmt_init(gpio_num_t pin, melody_event_cb_t event_cb)
+{
+    if (tone_chan != NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    rmt_tx_channel_config_t chan_config = {
+        .gpio_num = pin,
+        .clk_src = RMT_CLK_SRC_DEFAULT,
+        .resolution_hz = MELODY_RMT_RES_HZ,
+        .mem_block_symbols = RMT_MEM_SYMBOLS,
+        .trans_queue_depth = TX_QUEUE_DEPTH
+    };
+    ESP_ERROR_CHECK(rmt_new_tx_channel(&chan_config, &tone_chan));
+    ESP_ERROR_CHECK(melody_new_encoder(&tone_encoder));
+
+    song_done = xSemaphoreCreateCounting(SONG_SLOTS, 0);
+    if (song_done == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    rmt_tx_event_callbacks_t callbacks = {
+        .on_trans_done = tx_done_cb
+    };
+    ESP_ERROR_CHECK(rmt_tx_register_event_callbacks(tone_chan, &callbacks, NULL));
+    ESP_ERROR_CHECK(rmt_enable(tone_chan));
+
+    event_callback = event_cb;
+    esp_timer_create_args_t timer_args = {
+        .callback = event_timer_cb,
+#if CONFIG_ESP_TIMER_SUPPORTS_ISR_DISPATCH_METHOD
+        .dispatch_method = ESP_TIMER_ISR,
+#endif
+        .name = "melody_events"
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &event_timer));
+
+    ESP_LOGI(TAG, "RMT melody output on GPIO%d, %d Hz tick", pin, MELODY_RMT_RES_HZ);
+    return ESP_OK;
+}
+
+esp_err_t melody_rmt_play(const melody_song_t *song)
+{
+    // Fresh start: drop leftover LED events and don't count this as a switch
+    esp_timer_stop(event_timer);
+    portENTER_CRITICAL(&queue_lock);
+    queue_count = 0;
+    queue_end_us = 0;
+    portEXIT_CRITICAL(&queue_lock);
+    next_event = 0;
+    switch_pending = false;
+    return melody_rmt_queue(song);
+}
+
+esp_err_t melody_rmt_queue(const melody_song_t *song)
+{
+    if (song == NULL || song->num_runs == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    rmt_transmit_config_t tx_config = {
+        .loop_count = 0,
+        .flags.eot_level = 0
+    };
+
+    int64_t now = esp_timer_get_time();
+    bool was_empty;
+    portENTER_CRITICAL(&queue_lock);
+    if (queue_count == SONG_SLOTS) {
+        portEXIT_CRITICAL(&queue_lock);
+        return ESP_ERR_INVALID_STATE;
+    }
+    int64_t start_us = (queue_end_us > now) ? queue_end_us : now;
+    queue_end_us = start_us + song->duration_us;
+    song_queue[(queue_head + queue_count) % SONG_SLOTS] = (queued_song_t) {
+        .song = song,
+        .start_us = start_us
+    };
+    was_empty = (queue_count++ == 0);
+    portEXIT_CRITICAL(&queue_lock);
+
+    ESP_ERROR_CHECK(rmt_transmit(tone_chan, tone_encoder, song->runs,
+                                 song->num_runs * sizeof(melody_run_t), &tx_config));
+    // Otherwise the running event chain reaches this song by itself
+    if (was_empty) {
+        esp_timer_stop(event_timer);
+        esp_timer_start_once(event_timer, 0);
+    }
+    return ESP_OK;
+}
+
+esp_err_t melody_rmt_wait(int timeout_ms)
+{
+    esp_err_t ret = rmt_tx_wait_all_done(tone_chan, timeout_ms);
+    while (xSemaphoreTake(song_done, 0) == pdTRUE) {
+    }
+    return ret;
+}
+
+esp_err_t melody_rmt_wait_song(const melody_song_t *song, int timeout_ms)
+{
+    if (xSemaphoreTake(song_done, pdMS_TO_TICKS(timeout_ms)) != pdTRUE) {
+        return ESP_ERR_TIMEOUT;
+    }
+    // The event chain may trail the RMT by a tick
+    while (song_in_queue(song)) {
+        vTaskDelay(1);
+    }
+    return ESP_OK;
+}
+
+void melody_rmt_get_stats(melody_rmt_stats_t *out)
+{
+    portENTER_CRITICAL(&stats_lock);
+    *out = stats;
+    portEXIT_CRITICAL(&stats_lock);
+}
+
+void melody_rmt_reset_stats(void)
+{
+    portENTER_CRITICAL(&stats_lock);
+    memset(&stats, 0, sizeof(stats));
+    portEXIT_CRITICAL(&stats_lock);
+}
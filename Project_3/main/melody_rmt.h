@@ -0,0 +1,63 @@
+/* RMT melody backend
+ * Compiles a note list into RMT symbol runs (one square-wave run per note
+ * plus silence) and queues the whole song as a single RMT transaction.
+ * Pitch and note timing come from the RMT tick clock, so playback is
+ * tick-exact and the CPU only refills RMT memory from the encoder.
+ * Songs can be queued back to back for gapless playback.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "driver/gpio.h"
+#include "driver/rmt_tx.h"
+#include "melody_note.h"
+
+#define MELODY_RMT_RES_HZ       1000000     // 1 us per RMT tick
+
+// Repeated RMT symbol: one tone period or one slice of silence
+typedef struct {
+    rmt_symbol_word_t symbol;
+    uint32_t repeat;
+} melody_run_t;
+
+typedef struct {
+    melody_run_t *runs;
+    size_t num_runs;
+    melody_event_t *events;
+    size_t num_events;
+    uint32_t duration_us;
+    uint32_t num_symbols;       // Symbols the encoder will emit
+    size_t bytes;               // Heap used by runs and events
+} melody_song_t;
+
+// Runs from the esp_timer ISR when ISR dispatch is enabled: keep it short and IRAM_ATTR
+typedef void (*melody_event_cb_t)(const melody_event_t *event);
+
+// CPU cost of playback
+typedef struct {
+    uint32_t encode_calls;      // Encoder invocations (RMT memory refills)
+    uint32_t symbols;           // Symbols written to RMT memory
+    uint64_t encode_cycles;
+    uint32_t max_encode_cycles;
+    uint32_t events;            // LED events dispatched
+    uint64_t event_cycles;
+    uint32_t switches;          // Back-to-back song transitions
+    uint32_t last_switch_us;    // Previous song done -> next song's first symbols
+    uint32_t max_switch_us;
+} melody_rmt_stats_t;
+
+esp_err_t melody_rmt_init(gpio_num_t pin, melody_event_cb_t event_cb);
+esp_err_t melody_rmt_compile(const melody_note_t *notes, size_t count, melody_song_t *song);
+void melody_rmt_free_song(melody_song_t *song);
+// Replace the song's note events (e.g. with a light show); takes ownership of a heap array
+void melody_rmt_set_events(melody_song_t *song, melody_event_t *events, size_t num_events);
+esp_err_t melody_rmt_play(const melody_song_t *song);
+// Queue behind the songs already playing; starts as soon as the previous one ends
+esp_err_t melody_rmt_queue(const melody_song_t *song);
+esp_err_t melody_rmt_wait(int timeout_ms);
+// Wait for the oldest queued song to finish; its buffers may then be freed
+esp_err_t melody_rmt_wait_song(const melody_song_t *song, int timeout_ms);
+void melody_rmt_get_stats(melody_rmt_stats_t *stats);
+void melody_rmt_reset_stats(void);
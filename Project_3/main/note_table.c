@@ -0,0 +1,104 @@
+/* 88-key equal-temperament divider table
+ *
+ * key k sounds at  a4 * 2^((k - 48 + transpose) / 12)  and needs
+ *
+ *     divider_q8 = (clk << 8) / (freq << duty_bits)
+ *
+ * Tables are double-buffered: a retune fills the idle copy and then swaps
+ * the active pointer, so note-on never sees a half-written table.
+ */
+#include <math.h>
+#include "hal/ledc_ll.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "note_table.h"
+
+static const char *TAG = "NOTE_TABLE";
+
+#define DIVIDER_MIN_Q8  (1u << 8)       // Divider must be >= 1.0
+#define DIVIDER_MAX_Q8  ((1u << 18) - 1)
+
+typedef struct {
+    uint32_t divider_q8[NOTE_TABLE_KEYS];
+    uint32_t freq_centihz[NOTE_TABLE_KEYS];
+} note_table_t;
+
+static note_table_t tables[2];
+static note_table_t *volatile active = &tables[0];
+static ledc_mode_t table_mode;
+static ledc_timer_t table_timer;
+static ledc_timer_bit_t table_duty_res;
+
+esp_err_t note_table_init(ledc_mode_t speed_mode, ledc_timer_t timer_num, ledc_timer_bit_t duty_resolution)
+{
+    table_mode = speed_mode;
+    table_timer = timer_num;
+    table_duty_res = duty_resolution;
+    return note_table_set_tuning(44000, 0);
+}
+
+esp_err_t note_table_set_tuning(uint32_t a4_centihz, int transpose)
+{
+    if (a4_centihz == 0 || transpose < -24 || transpose > 24) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    note_table_t *next = (active == &tables[0]) ? &tables[1] : &tables[0];
+    double a4 = a4_centihz / 100.0;
+    int clamped = 0;
+
+    for (int key = 0; key < NOTE_TABLE_KEYS; key++) {
+        double freq = a4 * pow(2.0, (key - NOTE_TABLE_A4_KEY + transpose) / 12.0);
+        double divider = (double)NOTE_TABLE_CLK_HZ * 256.0 / (freq * (1u << table_duty_res));
+        uint32_t div_q8 = (uint32_t)(divider + 0.5);
+        if (div_q8 < DIVIDER_MIN_Q8 || div_q8 > DIVIDER_MAX_Q8) {
+            div_q8 = (div_q8 < DIVIDER_MIN_Q8) ? DIVIDER_MIN_Q8 : DIVIDER_MAX_Q8;
+            clamped++;
+        }
+        next->divider_q8[key] = div_q8;
+        // Pitch the divider actually produces, not the ideal one
+        next->freq_centihz[key] = (uint32_t)((double)NOTE_TABLE_CLK_HZ * 25600.0 /
+                                             ((double)div_q8 * (1u << table_duty_res)) + 0.5);
+    }
+    active = next;
+
+    if (clamped) {
+        ESP_LOGW(TAG, "%d keys outside the divider range at %d-bit duty", clamped, table_duty_res);
+    }
+    ESP_LOGI(TAG, "Tuning A4=%lu.%02lu Hz, transpose %+d", (unsigned long)(a4_centihz / 100),
+             (unsigned long)(a4_centihz % 100), transpose);
+    return ESP_OK;
+}
+
+int note_table_key_from_hz(int frequency)
+{
+    // Nearest key at the nominal A4 = 440 Hz the NOTE_* macros are written for
+    if (frequency <= 0) {
+        return NOTE_KEY_REST;
+    }
+    int key = (int)lround(12.0 * log2(frequency / 440.0)) + NOTE_TABLE_A4_KEY;
+    if (key < 0 || key >= NOTE_TABLE_KEYS) {
+        return NOTE_KEY_REST;
+    }
+    return key;
+}
+
+uint32_t note_table_freq_centihz(int key)
+{
+    return (key >= 0 && key < NOTE_TABLE_KEYS) ? active->freq_centihz[key] : 0;
+}
+
+uint32_t note_table_divider(int key)
+{
+    return (key >= 0 && key < NOTE_TABLE_KEYS) ? active->divider_q8[key] : 0;
+}
+
+IRAM_ATTR esp_err_t note_table_note_on(int key)
+{
+    if (key < 0 || key >= NOTE_TABLE_KEYS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    ledc_dev_t *hw = LEDC_LL_GET_HW();
+    ledc_ll_set_clock_divider(hw, table_mode, table_timer, active->divider_q8[key]);
+    ledc_ll_ls_timer_update(hw, table_mode, table_timer);
+    return ESP_OK;
+}
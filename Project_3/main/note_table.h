@@ -0,0 +1,23 @@
+/* 88-key equal-temperament divider table
+ * Holds the LEDC timer divider (Q10.8, as written to the timer register)
+ * for every piano key A0..C8 at the current tuning. The table is rebuilt
+ * only when the A4 reference or the transposition changes; note-on is a
+ * table lookup and one divider register write.
+ */
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "driver/ledc.h"
+
+#define NOTE_TABLE_KEYS     88
+#define NOTE_TABLE_A4_KEY   48          // A0 = 0, C8 = 87
+#define NOTE_TABLE_CLK_HZ   80000000    // LEDC timer source (APB)
+#define NOTE_KEY_REST       (-1)
+
+esp_err_t note_table_init(ledc_mode_t speed_mode, ledc_timer_t timer_num, ledc_timer_bit_t duty_resolution);
+esp_err_t note_table_set_tuning(uint32_t a4_centihz, int transpose);
+int note_table_key_from_hz(int frequency);
+uint32_t note_table_freq_centihz(int key);
+uint32_t note_table_divider(int key);
+esp_err_t note_table_note_on(int key);  // ESP_ERR_INVALID_ARG outside 0..87 (incl. NOTE_KEY_REST)
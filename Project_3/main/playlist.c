@@ -0,0 +1,225 @@
+/* Jukebox playlist
+ *
+ * Two song slots: the one playing and the one being prepared. With
+ * prefetch the next track is decoded right after the current one is
+ * queued, so the RMT driver starts it from the TX-done interrupt of the
+ * current track. Without prefetch the next track is prepared only once
+ * the current one has finished, which is the baseline for the switch
+ * latency metric.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include "esp_random.h"
+#include "esp_log.h"
+#include "melody_rmt.h"
+#include "lightshow.h"
+#include "playlist.h"
+
+static const char *TAG = "PLAYLIST";
+
+#define PLAYER_STACK_SIZE   4096
+#define PLAYER_PRIORITY     5
+
+static playlist_config_t config;
+static size_t *order = NULL;        // Track indices for the current pass
+static size_t position = 0;         // Index into order of the current track
+static bool started = false;
+static volatile bool running = false;
+static playlist_stats_t stats;
+static portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static void buffer_change(long bytes)
+{
+    portENTER_CRITICAL(&stats_lock);
+    stats.buffer_bytes += bytes;
+    if (stats.buffer_bytes > stats.peak_buffer_bytes) {
+        stats.peak_buffer_bytes = stats.buffer_bytes;
+    }
+    portEXIT_CRITICAL(&stats_lock);
+}
+
+static void shuffle_order(size_t last_played)
+{
+    for (size_t i = config.num_tracks - 1; i > 0; i--) {
+        size_t j = esp_random() % (i + 1);
+        size_t tmp = order[i];
+        order[i] = order[j];
+        order[j] = tmp;
+    }
+    // Don't start a pass with the track that ended the previous one
+    if (config.num_tracks > 1 && order[0] == last_played) {
+        order[0] = order[config.num_tracks - 1];
+        order[config.num_tracks - 1] = last_played;
+    }
+}
+
+// Track after the current one, -1 at the end of the playlist
+static int next_track(void)
+{
+    if (config.repeat == PLAYLIST_REPEAT_ONE) {
+        return order[position];
+    }
+    size_t last = order[position];
+    if (++position >= config.num_tracks) {
+        if (config.repeat != PLAYLIST_REPEAT_ALL) {
+            return -1;
+        }
+        position = 0;
+        if (config.order == PLAYLIST_SHUFFLE) {
+            shuffle_order(last);
+        }
+    }
+    return order[position];
+}
+
+static esp_err_t prepare_track(int index, melody_song_t *song)
+{
+    const playlist_track_t *track = &config.tracks[index];
+    int64_t start = esp_timer_get_time();
+
+    // Decode {frequency, divider} into absolute note durations
+    size_t notes_bytes = track->length * sizeof(melody_note_t);
+    melody_note_t *notes = malloc(notes_bytes);
+    if (notes == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    buffer_change(notes_bytes);
+    int whole_note = 60000 * 4 / track->tempo;
+    for (size_t i = 0; i < track->length; i++) {
+        int frequency = track->notes[i][0];
+        int divider = track->notes[i][1];
+        notes[i].frequency = config.map_frequency ? config.map_frequency(frequency) : frequency;
+        notes[i].duration = (divider > 0) ? whole_note / divider : whole_note * 3 / (-divider * 2);
+    }
+
+    esp_err_t ret = melody_rmt_compile(notes, track->length, song);
+    if (ret == ESP_OK && config.light_show) {
+        lightshow_info_t info;
+        melody_event_t *events = lightshow_build(notes, track->length, &info);
+        if (events != NULL) {
+            melody_rmt_set_events(song, events, info.num_events);
+        }
+    }
+    free(notes);
+    buffer_change(-(long)notes_bytes);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    buffer_change(song->bytes);
+
+    uint32_t prepare_us = (uint32_t)(esp_timer_get_time() - start);
+    portENTER_CRITICAL(&stats_lock);
+    stats.last_prepare_us = prepare_us;
+    if (prepare_us > stats.max_prepare_us) {
+        stats.max_prepare_us = prepare_us;
+    }
+    portEXIT_CRITICAL(&stats_lock);
+    return ESP_OK;
+}
+
+static void release_track(melody_song_t *song)
+{
+    buffer_change(-(long)song->bytes);
+    melody_rmt_free_song(song);
+}
+
+static void track_started(int index)
+{
+    portENTER_CRITICAL(&stats_lock);
+    stats.tracks_started++;
+    portEXIT_CRITICAL(&stats_lock);
+    ESP_LOGI(TAG, "Now playing: %s", config.tracks[index].name);
+}
+
+static void player_task(void *arg)
+{
+    melody_song_t songs[2];
+    int current = 0;
+    int track = order[position];
+
+    ESP_ERROR_CHECK(prepare_track(track, &songs[current]));
+    ESP_ERROR_CHECK(melody_rmt_play(&songs[current]));
+    track_started(track);
+
+    while (1) {
+        int next = next_track();
+        int spare = current ^ 1;
+
+        if (next >= 0 && config.prefetch) {
+            ESP_ERROR_CHECK(prepare_track(next, &songs[spare]));
+            ESP_ERROR_CHECK(melody_rmt_queue(&songs[spare]));
+        }
+
+        const melody_song_t *song = &songs[current];
+        ESP_ERROR_CHECK(melody_rmt_wait_song(song, song->duration_us / 1000 + 1000));
+        release_track(&songs[current]);
+        if (next < 0) {
+            break;
+        }
+
+        if (!config.prefetch) {
+            ESP_ERROR_CHECK(prepare_track(next, &songs[spare]));
+            ESP_ERROR_CHECK(melody_rmt_queue(&songs[spare]));
+        }
+        current = spare;
+        track_started(next);
+    }
+
+    ESP_LOGI(TAG, "Playlist finished");
+    running = false;
+    vTaskDelete(NULL);
+}
+
+esp_err_t playlist_start(const playlist_config_t *cfg)
+{
+    if (cfg == NULL || cfg->tracks == NULL || cfg->num_tracks == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (started) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    config = *cfg;
+
+    order = malloc(config.num_tracks * sizeof(size_t));
+    if (order == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    for (size_t i = 0; i < config.num_tracks; i++) {
+        order[i] = i;
+    }
+    if (config.order == PLAYLIST_SHUFFLE) {
+        shuffle_order(config.num_tracks);
+    }
+    position = 0;
+    memset(&stats, 0, sizeof(stats));
+
+    started = true;
+    running = true;
+    if (xTaskCreate(player_task, "playlist", PLAYER_STACK_SIZE, NULL, PLAYER_PRIORITY, NULL) != pdPASS) {
+        started = false;
+        running = false;
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "%d tracks, order %d, repeat %d, prefetch %s", (int)config.num_tracks,
+             config.order, config.repeat, config.prefetch ? "on" : "off");
+    return ESP_OK;
+}
+
+bool playlist_is_running(void)
+{
+    return running;
+}
+
+void playlist_get_stats(playlist_stats_t *out)
+{
+    melody_rmt_stats_t rmt_stats;
+    melody_rmt_get_stats(&rmt_stats);
+    portENTER_CRITICAL(&stats_lock);
+    *out = stats;
+    portEXIT_CRITICAL(&stats_lock);
+    out->last_switch_us = rmt_stats.last_switch_us;
+    out->max_switch_us = rmt_stats.max_switch_us;
+}
@@ -0,0 +1,53 @@
+/* Jukebox playlist
+ * Plays tracks back to back on the RMT melody backend. While one track
+ * plays, the player task decodes and compiles the next one and queues it
+ * behind the current RMT transaction, so track changes are gapless.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+typedef enum {
+    PLAYLIST_ORDERED,
+    PLAYLIST_SHUFFLE            // New order on every pass, no immediate repeats
+} playlist_order_t;
+
+typedef enum {
+    PLAYLIST_REPEAT_OFF,
+    PLAYLIST_REPEAT_ONE,
+    PLAYLIST_REPEAT_ALL
+} playlist_repeat_t;
+
+typedef struct {
+    const char *name;
+    const int (*notes)[2];      // {frequency Hz, duration divider}
+    size_t length;
+    int tempo;                  // BPM
+} playlist_track_t;
+
+typedef struct {
+    const playlist_track_t *tracks;
+    size_t num_tracks;
+    playlist_order_t order;
+    playlist_repeat_t repeat;
+    bool prefetch;              // false: prepare each track only after the previous ends
+    bool light_show;            // Replace note LEDs with a pre-rendered light show
+    uint16_t (*map_frequency)(int frequency);   // Optional tuning hook, NULL = as written
+} playlist_config_t;
+
+typedef struct {
+    uint32_t tracks_started;
+    uint32_t last_prepare_us;   // Decode + compile (+ light show) time of the latest track
+    uint32_t max_prepare_us;
+    uint32_t last_switch_us;    // End of one track -> first symbols of the next
+    uint32_t max_switch_us;
+    size_t buffer_bytes;        // Decoded/compiled song memory currently held
+    size_t peak_buffer_bytes;
+} playlist_stats_t;
+
+esp_err_t playlist_start(const playlist_config_t *config);
+bool playlist_is_running(void);
+void playlist_get_stats(playlist_stats_t *stats);
@@ -0,0 +1,33 @@
+/* Song library for the jukebox playlist
+ */
+#include "songs.h"
+
+// Ode to Joy - Beethoven, Symphony No. 9
+const int ode_to_joy[][2] = {
+    {NOTE_E4, 4}, {NOTE_E4, 4}, {NOTE_F4, 4}, {NOTE_G4, 4},
+    {NOTE_G4, 4}, {NOTE_F4, 4}, {NOTE_E4, 4}, {NOTE_D4, 4},
+    {NOTE_C4, 4}, {NOTE_C4, 4}, {NOTE_D4, 4}, {NOTE_E4, 4},
+    {NOTE_E4, -4}, {NOTE_D4, 8}, {NOTE_D4, 2},
+    {NOTE_E4, 4}, {NOTE_E4, 4}, {NOTE_F4, 4}, {NOTE_G4, 4},
+    {NOTE_G4, 4}, {NOTE_F4, 4}, {NOTE_E4, 4}, {NOTE_D4, 4},
+    {NOTE_C4, 4}, {NOTE_C4, 4}, {NOTE_D4, 4}, {NOTE_E4, 4},
+    {NOTE_D4, -4}, {NOTE_C4, 8}, {NOTE_C4, 2},
+};
+const size_t ode_to_joy_length = sizeof(ode_to_joy) / sizeof(ode_to_joy[0]);
+
+// Twinkle Twinkle Little Star
+const int twinkle_twinkle[][2] = {
+    {NOTE_C4, 4}, {NOTE_C4, 4}, {NOTE_G4, 4}, {NOTE_G4, 4},
+    {NOTE_A4, 4}, {NOTE_A4, 4}, {NOTE_G4, 2},
+    {NOTE_F4, 4}, {NOTE_F4, 4}, {NOTE_E4, 4}, {NOTE_E4, 4},
+    {NOTE_D4, 4}, {NOTE_D4, 4}, {NOTE_C4, 2},
+    {NOTE_G4, 4}, {NOTE_G4, 4}, {NOTE_F4, 4}, {NOTE_F4, 4},
+    {NOTE_E4, 4}, {NOTE_E4, 4}, {NOTE_D4, 2},
+    {NOTE_G4, 4}, {NOTE_G4, 4}, {NOTE_F4, 4}, {NOTE_F4, 4},
+    {NOTE_E4, 4}, {NOTE_E4, 4}, {NOTE_D4, 2},
+    {NOTE_C4, 4}, {NOTE_C4, 4}, {NOTE_G4, 4}, {NOTE_G4, 4},
+    {NOTE_A4, 4}, {NOTE_A4, 4}, {NOTE_G4, 2},
+    {NOTE_F4, 4}, {NOTE_F4, 4}, {NOTE_E4, 4}, {NOTE_E4, 4},
+    {NOTE_D4, 4}, {NOTE_D4, 4}, {NOTE_C4, 2},
+};
+const size_t twinkle_twinkle_length = sizeof(twinkle_twinkle) / sizeof(twinkle_twinkle[0]);
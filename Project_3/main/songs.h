@@ -0,0 +1,38 @@
+/* Song library for the jukebox playlist
+ * Same {frequency, duration divider} format as the Imperial March table:
+ * divider 4 = quarter note, negative = dotted.
+ */
+#pragma once
+
+#include <stddef.h>
+
+// Note frequency definitions (in Hz) [web:31][page:3]
+#define NOTE_B3  247
+#define NOTE_C4  262
+#define NOTE_CS4 277
+#define NOTE_D4  294
+#define NOTE_DS4 311
+#define NOTE_E4  330
+#define NOTE_F4  349
+#define NOTE_FS4 370
+#define NOTE_G4  392
+#define NOTE_GS4 415
+#define NOTE_A4  440
+#define NOTE_AS4 466
+#define NOTE_B4  494
+#define NOTE_C5  523
+#define NOTE_CS5 554
+#define NOTE_D5  587
+#define NOTE_DS5 622
+#define NOTE_E5  659
+#define NOTE_F5  698
+#define NOTE_FS5 740
+#define NOTE_G5  784
+#define NOTE_GS5 831
+#define NOTE_A5  880
+#define REST     0
+
+extern const int ode_to_joy[][2];
+extern const size_t ode_to_joy_length;
+extern const int twinkle_twinkle[][2];
+extern const size_t twinkle_twinkle_length;
@@ -0,0 +1,32 @@
+"""Project 3 under QEMU: Imperial March note timing on the LEDC backend
+
+Built with -DQEMU_TEST=1: QEMU has no RMT, so the song plays note by note
+through play_note() and its vTaskDelay()s. That loop prints with printf,
+without log timestamps, so the firmware reports the song time itself.
+"""
+import re
+
+import pytest
+
+from conftest import TICK_MS
+
+SONGS = 2
+SONG_OVERRUN_MS = 50            # Note-on/off work over a whole song
+
+
+@pytest.mark.esp32
+@pytest.mark.qemu
+def test_note_durations(dut, log):
+    log.check_boot()
+    length = dut.expect(re.compile(rb'Melody Length: (\d+) notes, (\d+) ms'))
+    notes, score_ms = int(length.group(1)), int(length.group(2))
+    for _ in range(SONGS):
+        dut.expect_exact('Playing: Star Wars Imperial March')
+        done = dut.expect(re.compile(rb'Melody complete in (\d+) ms'), timeout=score_ms / 1000 + 30)
+        played_ms = int(done.group(1))
+        # Each note is two tick-rounded delays (90% sound, 10% gap), each
+        # of which can come up to a tick short of its share of the score
+        assert score_ms - notes * 2 * TICK_MS <= played_ms, \
+            f'{played_ms} ms played, score is {score_ms} ms'
+        assert played_ms <= score_ms + log.budget(SONG_OVERRUN_MS), \
+            f'{played_ms} ms played, score is {score_ms} ms'
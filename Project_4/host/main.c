@@ -0,0 +1,300 @@
+/* Morse corpus renderer
+ *
+ * Validates a batch of beacon messages on the host before they go to a
+ * Project_4 unit. Each line of the corpus is one message; every message is
+ * encoded with the firmware's morse.c and timed like the beacon scheduler.
+ * Work is split across all cores in chunks of messages.
+ *
+ *     morse_render [options] corpus.txt
+ *       -w WPM      speed (default 20)
+ *       -f HZ       tone (default 1000, the buzzer's beep)
+ *       -r HZ       sample rate (default 8000)
+ *       -e MS       raised-cosine rise/fall, 0 = hard keying (default 5)
+ *       -j N        worker threads (default: all cores)
+ *       -o DIR      write <line>.wav per message
+ *       -t DIR      write <line>.csv key and envelope trace per message
+ *       -s          render samples even without -o (throughput check)
+ *       -q          no per-message report, summary only
+ *
+ * The report (stdout) is CSV: line, units, airtime_ms, cycle_ms, message.
+ * Airtime runs from the first key-down to the last key-up; the cycle adds
+ * the closing word gap and is the repeat period on a beacon. Lines with
+ * nothing sendable are reported with zero times and counted as errors.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "render.h"
+
+#define CHUNK_MESSAGES  64          // Messages claimed per worker grab
+
+typedef struct {
+    char *text;
+    size_t line;
+} message_t;
+
+typedef struct {
+    bool ok;
+    render_timing_t timing;
+} result_t;
+
+typedef struct {
+    const message_t *messages;
+    size_t num_messages;
+    result_t *results;
+    render_config_t config;
+    const char *wav_dir;
+    const char *trace_dir;
+    bool samples;
+    atomic_size_t next;
+    atomic_size_t write_errors;
+    atomic_ullong total_samples;
+} job_t;
+
+static void *worker(void *arg)
+{
+    job_t *job = arg;
+    render_buffer_t buf = { 0 };
+    char path[4096];
+    unsigned long long samples = 0;
+
+    for (;;) {
+        size_t first = atomic_fetch_add(&job->next, CHUNK_MESSAGES);
+        if (first >= job->num_messages) {
+            break;
+        }
+        size_t last = first + CHUNK_MESSAGES;
+        if (last > job->num_messages) {
+            last = job->num_messages;
+        }
+        for (size_t i = first; i < last; i++) {
+            const message_t *msg = &job->messages[i];
+            result_t *result = &job->results[i];
+            result->ok = render_message(msg->text, &job->config, job->trace_dir != NULL, job->samples,
+                                        &buf, &result->timing);
+            if (!result->ok) {
+                continue;
+            }
+            samples += buf.num_samples;
+            if (job->wav_dir) {
+                snprintf(path, sizeof(path), "%s/%06zu.wav", job->wav_dir, msg->line);
+                if (render_write_wav(path, &job->config, &buf) != 0) {
+                    atomic_fetch_add(&job->write_errors, 1);
+                }
+            }
+            if (job->trace_dir) {
+                snprintf(path, sizeof(path), "%s/%06zu.csv", job->trace_dir, msg->line);
+                if (render_write_trace(path, &result->timing, &buf) != 0) {
+                    atomic_fetch_add(&job->write_errors, 1);
+                }
+            }
+        }
+    }
+
+    atomic_fetch_add(&job->total_samples, samples);
+    render_buffer_free(&buf);
+    return NULL;
+}
+
+// Reads the whole corpus and splits it into lines in place
+static char *load_corpus(const char *path, message_t **messages, size_t *count)
+{
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        perror(path);
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *data = malloc((size_t)size + 1);
+    if (data == NULL || fread(data, 1, (size_t)size, f) != (size_t)size) {
+        fprintf(stderr, "%s: read failed\n", path);
+        fclose(f);
+        free(data);
+        return NULL;
+    }
+    fclose(f);
+    data[size] = '\0';
+
+    size_t lines = 1;
+    for (long i = 0; i < size; i++) {
+        lines += data[i] == '\n';
+    }
+    *messages = malloc(lines * sizeof(**messages));
+    if (*messages == NULL) {
+        free(data);
+        return NULL;
+    }
+
+    // Blank lines are skipped but still counted for line numbers
+    size_t n = 0, line = 0;
+    for (char *p = data; *p; ) {
+        char *end = strchr(p, '\n');
+        char *next = end ? end + 1 : p + strlen(p);
+        if (end) {
+            *end = '\0';
+        }
+        size_t len = strlen(p);
+        if (len && p[len - 1] == '\r') {
+            p[--len] = '\0';
+        }
+        line++;
+        if (len) {
+            (*messages)[n].text = p;
+            (*messages)[n].line = line;
+            n++;
+        }
+        p = next;
+    }
+    *count = n;
+    return data;
+}
+
+static void print_csv_text(const char *text)
+{
+    putchar('"');
+    for (const char *p = text; *p; p++) {
+        if (*p == '"') {
+            putchar('"');
+        }
+        putchar(*p);
+    }
+    putchar('"');
+}
+
+static double elapsed_s(const struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr, "usage: %s [-w wpm] [-f tone_hz] [-r sample_rate] [-e rise_ms] [-j threads]\n"
+                    "       [-o wav_dir] [-t trace_dir] [-s] [-q] corpus.txt\n", argv0);
+}
+
+int main(int argc, char **argv)
+{
+    job_t job = {
+        .config = {
+            .wpm = 20,
+            .tone_hz = 1000,
+            .sample_rate = 8000,
+            .rise_ms = 5,
+            .amplitude = 0.8f
+        }
+    };
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+    bool quiet = false;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "w:f:r:e:j:o:t:sq")) != -1) {
+        switch (opt) {
+            case 'w': job.config.wpm = (uint32_t)atoi(optarg); break;
+            case 'f': job.config.tone_hz = (uint32_t)atoi(optarg); break;
+            case 'r': job.config.sample_rate = (uint32_t)atoi(optarg); break;
+            case 'e': job.config.rise_ms = (uint32_t)atoi(optarg); break;
+            case 'j': threads = atol(optarg); break;
+            case 'o': job.wav_dir = optarg; job.samples = true; break;
+            case 't': job.trace_dir = optarg; break;
+            case 's': job.samples = true; break;
+            case 'q': quiet = true; break;
+            default: usage(argv[0]); return 2;
+        }
+    }
+    if (optind != argc - 1 || job.config.wpm == 0 || job.config.sample_rate == 0 ||
+        job.config.tone_hz == 0 || job.config.tone_hz >= job.config.sample_rate / 2) {
+        usage(argv[0]);
+        return 2;
+    }
+    if (threads < 1) {
+        threads = 1;
+    }
+
+    message_t *messages = NULL;
+    size_t num_messages = 0;
+    char *corpus = load_corpus(argv[optind], &messages, &num_messages);
+    if (corpus == NULL) {
+        return 1;
+    }
+    job.messages = messages;
+    job.num_messages = num_messages;
+    job.results = calloc(num_messages ? num_messages : 1, sizeof(result_t));
+    pthread_t *tids = malloc((size_t)threads * sizeof(pthread_t));
+    if (job.results == NULL || tids == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    render_init();
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    // Chunks are claimed dynamically, so a worker that fails to start just
+    // leaves its share to the others; the main thread picks up the rest
+    long started = 0;
+    for (long i = 0; i < threads; i++) {
+        int err = pthread_create(&tids[started], NULL, worker, &job);
+        if (err != 0) {
+            fprintf(stderr, "worker %ld: %s\n", i, strerror(err));
+            continue;
+        }
+        started++;
+    }
+    if (started < threads) {
+        worker(&job);
+    }
+    for (long i = 0; i < started; i++) {
+        pthread_join(tids[i], NULL);
+    }
+    double seconds = elapsed_s(&start);
+
+    // Report in corpus order
+    size_t errors = 0;
+    uint64_t total_airtime_us = 0, total_cycle_us = 0;
+    if (!quiet) {
+        printf("line,units,airtime_ms,cycle_ms,message\n");
+    }
+    for (size_t i = 0; i < num_messages; i++) {
+        const result_t *r = &job.results[i];
+        if (!r->ok) {
+            errors++;
+            fprintf(stderr, "line %zu: nothing sendable\n", messages[i].line);
+        }
+        total_airtime_us += r->timing.airtime_us;
+        total_cycle_us += r->timing.cycle_us;
+        if (!quiet) {
+            printf("%zu,%u,%.1f,%.1f,", messages[i].line, (unsigned)r->timing.units,
+                   r->timing.airtime_us / 1000.0, r->timing.cycle_us / 1000.0);
+            print_csv_text(messages[i].text);
+            putchar('\n');
+        }
+    }
+
+    unsigned long long samples = atomic_load(&job.total_samples);
+    fprintf(stderr, "%zu messages (%zu unsendable) at %u WPM on %ld thread(s) in %.3f s (%.0f msg/s)\n",
+            num_messages, errors, (unsigned)job.config.wpm, started < threads ? started + 1 : threads, seconds,
+            seconds > 0 ? num_messages / seconds : 0.0);
+    fprintf(stderr, "Total airtime %.1f s, total cycle %.1f s\n",
+            total_airtime_us / 1e6, total_cycle_us / 1e6);
+    if (samples) {
+        fprintf(stderr, "%llu samples at %u Hz (%.1f Msamples/s)\n", samples,
+                (unsigned)job.config.sample_rate, seconds > 0 ? samples / seconds / 1e6 : 0.0);
+    }
+    size_t write_errors = atomic_load(&job.write_errors);
+    if (write_errors) {
+        fprintf(stderr, "%zu file(s) could not be written\n", write_errors);
+    }
+
+    free(tids);
+    free(job.results);
+    free(messages);
+    free(corpus);
+    return (errors || write_errors) ? 1 : 0;
+}
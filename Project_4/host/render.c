@@ -0,0 +1,275 @@
+/* Offline Morse renderer
+ *
+ * The envelope is stepped first into spans of constant level (between two
+ * key edges or ramp steps); the trace writes those spans and samples are
+ * generated per span. The carrier runs continuously like the LEDC tone: a
+ * 32-bit phase accumulator gives the phase of any sample index, and the
+ * sine comes from a branch-free polynomial so the span loop has no calls
+ * and the compiler vectorises it.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "morse.h"
+#include "morse_envelope.h"
+#include "render.h"
+
+#define NEVER   UINT64_MAX
+
+static uint16_t envelope[MORSE_ENVELOPE_STEPS + 1];
+
+void render_init(void)
+{
+    morse_envelope_build(envelope);
+}
+
+static bool push_edge(render_buffer_t *buf, uint64_t at_us, bool on)
+{
+    if (buf->num_edges == buf->edge_capacity) {
+        size_t capacity = buf->edge_capacity ? buf->edge_capacity * 2 : 256;
+        render_edge_t *edges = realloc(buf->edges, capacity * sizeof(*edges));
+        if (edges == NULL) {
+            return false;
+        }
+        buf->edges = edges;
+        buf->edge_capacity = capacity;
+    }
+    buf->edges[buf->num_edges].at_us = at_us;
+    buf->edges[buf->num_edges].on = on;
+    buf->num_edges++;
+    return true;
+}
+
+static bool push_step(render_buffer_t *buf, uint64_t at_us, uint16_t envelope, bool key)
+{
+    if (buf->num_steps == buf->step_capacity) {
+        size_t capacity = buf->step_capacity ? buf->step_capacity * 2 : 1024;
+        render_step_t *steps = realloc(buf->steps, capacity * sizeof(*steps));
+        if (steps == NULL) {
+            return false;
+        }
+        buf->steps = steps;
+        buf->step_capacity = capacity;
+    }
+    buf->steps[buf->num_steps] = (render_step_t) { .at_us = at_us, .envelope = envelope, .key = key };
+    buf->num_steps++;
+    return true;
+}
+
+static bool reserve_samples(render_buffer_t *buf, size_t count)
+{
+    if (count > buf->sample_capacity) {
+        int16_t *samples = realloc(buf->samples, count * sizeof(*samples));
+        if (samples == NULL) {
+            return false;
+        }
+        buf->samples = samples;
+        buf->sample_capacity = count;
+    }
+    buf->num_samples = count;
+    return true;
+}
+
+// sin(2 pi x) for x in [-0.5, 0.5), max error ~0.001
+static inline float sine_turns(float x)
+{
+    float y = 8.0f * x - 16.0f * x * fabsf(x);
+    return 0.225f * (y * fabsf(y) - y) + y;
+}
+
+static void synth_span(int16_t *out, size_t first, size_t count, uint32_t phase_inc, float gain)
+{
+    if (gain == 0.0f) {
+        memset(out + first, 0, count * sizeof(*out));
+        return;
+    }
+    uint32_t phase = (uint32_t)first * phase_inc;
+    for (size_t i = 0; i < count; i++) {
+        // Signed phase maps one tone period onto [-0.5, 0.5)
+        float x = (float)(int32_t)phase * (1.0f / 4294967296.0f);
+        out[first + i] = (int16_t)(gain * sine_turns(x));
+        phase += phase_inc;
+    }
+}
+
+static size_t sample_at(uint64_t t_us, uint32_t sample_rate)
+{
+    return (size_t)(t_us * sample_rate / 1000000);
+}
+
+// Same stepping as the beacon ISR: every edge restarts the ramp towards
+// the new key level from wherever the envelope currently is, first step
+// one interval after the edge. Records one step per span of constant level.
+static bool step_envelope(const render_config_t *config, const render_timing_t *timing,
+                          render_buffer_t *buf)
+{
+    bool shaped = config->rise_ms > 0;
+    uint32_t rise_us = shaped ? morse_envelope_rise_us(config->rise_ms, timing->unit_us) : 0;
+
+    uint64_t t = 0;
+    uint64_t ramp_us = NEVER;
+    uint32_t ramp_frac = 0;
+    size_t next_edge = 0;
+    bool key_down = false;
+    int pos = 0;
+    buf->num_steps = 0;
+    while (t < timing->cycle_us) {
+        uint64_t edge_us = next_edge < buf->num_edges ? buf->edges[next_edge].at_us : timing->cycle_us;
+        if (edge_us == t && next_edge < buf->num_edges) {
+            key_down = buf->edges[next_edge++].on;
+            if (shaped) {
+                ramp_frac = 0;
+                ramp_us = morse_envelope_next_us(t, &ramp_frac, rise_us);
+            } else {
+                pos = key_down ? MORSE_ENVELOPE_STEPS : 0;
+            }
+            continue;
+        }
+        bool moved = true;
+        if (ramp_us == t) {
+            if (key_down && pos < MORSE_ENVELOPE_STEPS) {
+                pos++;
+            } else if (!key_down && pos > 0) {
+                pos--;
+            } else {
+                moved = false;
+            }
+            bool settled = key_down ? pos == MORSE_ENVELOPE_STEPS : pos == 0;
+            ramp_us = settled ? NEVER : morse_envelope_next_us(ramp_us, &ramp_frac, rise_us);
+        }
+
+        if (moved && !push_step(buf, t, envelope[pos], key_down)) {
+            return false;
+        }
+        uint64_t until = edge_us < ramp_us ? edge_us : ramp_us;
+        t = until < timing->cycle_us ? until : timing->cycle_us;
+    }
+    return true;
+}
+
+static void render_samples(const render_config_t *config, const render_timing_t *timing,
+                           render_buffer_t *buf)
+{
+    uint32_t phase_inc = (uint32_t)(((uint64_t)config->tone_hz << 32) / config->sample_rate);
+    float full_scale = config->amplitude * 32767.0f;
+
+    for (size_t i = 0; i < buf->num_steps; i++) {
+        uint64_t until = (i + 1 < buf->num_steps) ? buf->steps[i + 1].at_us : timing->cycle_us;
+        size_t first = sample_at(buf->steps[i].at_us, config->sample_rate);
+        size_t last = sample_at(until, config->sample_rate);
+        float gain = full_scale * buf->steps[i].envelope / 32768.0f;
+        synth_span(buf->samples, first, last - first, phase_inc, gain);
+    }
+}
+
+bool render_message(const char *text, const render_config_t *config, bool steps, bool samples,
+                    render_buffer_t *buf, render_timing_t *timing)
+{
+    morse_iter_t iter;
+    buf->num_edges = 0;
+    buf->num_steps = 0;
+    buf->num_samples = 0;
+    memset(timing, 0, sizeof(*timing));
+    if (config->wpm == 0 || !morse_iter_init(&iter, text)) {
+        return false;
+    }
+    timing->unit_us = 1200000 / config->wpm;
+
+    // One pass: the encoder repeats forever, stop at the closing word gap
+    morse_element_t element;
+    do {
+        morse_next(&iter, &element);
+        if (!push_edge(buf, (uint64_t)timing->units * timing->unit_us, element.on)) {
+            return false;
+        }
+        timing->units += element.units;
+        if (element.on) {
+            timing->key_units = timing->units;
+        }
+    } while (!morse_iter_pass_done(&iter));
+
+    timing->airtime_us = (uint64_t)timing->key_units * timing->unit_us;
+    timing->cycle_us = (uint64_t)timing->units * timing->unit_us;
+    if ((steps || samples) && !step_envelope(config, timing, buf)) {
+        return false;
+    }
+
+    if (samples) {
+        if (!reserve_samples(buf, sample_at(timing->cycle_us, config->sample_rate))) {
+            return false;
+        }
+        render_samples(config, timing, buf);
+    }
+    return true;
+}
+
+void render_buffer_free(render_buffer_t *buf)
+{
+    free(buf->edges);
+    free(buf->steps);
+    free(buf->samples);
+    memset(buf, 0, sizeof(*buf));
+}
+
+static void put_le(uint8_t *p, uint32_t value, int bytes)
+{
+    for (int i = 0; i < bytes; i++) {
+        p[i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+int render_write_wav(const char *path, const render_config_t *config, const render_buffer_t *buf)
+{
+    FILE *f = fopen(path, "wb");
+    if (f == NULL) {
+        return -1;
+    }
+    // 16-bit mono PCM
+    uint32_t data_bytes = (uint32_t)(buf->num_samples * sizeof(int16_t));
+    uint8_t header[44];
+    memcpy(header, "RIFF", 4);
+    put_le(header + 4, 36 + data_bytes, 4);
+    memcpy(header + 8, "WAVEfmt ", 8);
+    put_le(header + 16, 16, 4);
+    put_le(header + 20, 1, 2);
+    put_le(header + 22, 1, 2);
+    put_le(header + 24, config->sample_rate, 4);
+    put_le(header + 28, config->sample_rate * 2, 4);
+    put_le(header + 32, 2, 2);
+    put_le(header + 34, 16, 2);
+    memcpy(header + 36, "data", 4);
+    put_le(header + 40, data_bytes, 4);
+
+    // Samples are host-endian; WAV wants little-endian
+    int ok = fwrite(header, sizeof(header), 1, f) == 1;
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    ok = ok && fwrite(buf->samples, sizeof(int16_t), buf->num_samples, f) == buf->num_samples;
+#else
+    for (size_t i = 0; ok && i < buf->num_samples; i++) {
+        uint8_t le[2];
+        put_le(le, (uint16_t)buf->samples[i], 2);
+        ok = fwrite(le, sizeof(le), 1, f) == 1;
+    }
+#endif
+    return (fclose(f) == 0 && ok) ? 0 : -1;
+}
+
+int render_write_trace(const char *path, const render_timing_t *timing, const render_buffer_t *buf)
+{
+    FILE *f = fopen(path, "w");
+    if (f == NULL) {
+        return -1;
+    }
+    // Key and Q15 tone envelope from each time (us) until the next line:
+    // a row per key edge and per rise/fall step
+    fprintf(f, "# unit_us=%u units=%u cycle_us=%llu\n", (unsigned)timing->unit_us,
+            (unsigned)timing->units, (unsigned long long)timing->cycle_us);
+    fprintf(f, "t_us,key,envelope\n");
+    for (size_t i = 0; i < buf->num_steps; i++) {
+        fprintf(f, "%llu,%d,%u\n", (unsigned long long)buf->steps[i].at_us, buf->steps[i].key,
+                (unsigned)buf->steps[i].envelope);
+    }
+    fprintf(f, "%llu,0,0\n", (unsigned long long)timing->cycle_us);
+    return fclose(f) == 0 ? 0 : -1;
+}
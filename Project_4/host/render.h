@@ -0,0 +1,65 @@
+/* Offline Morse renderer
+ * Runs a message through the firmware encoder (morse.c) with the beacon's
+ * timing model: unit = 1200000 / wpm us, key edges at element boundaries,
+ * and the tone envelope stepped exactly like the scheduler ISR steps the
+ * LEDC duty (morse_envelope.c). Produces one pass of the message as key
+ * edges, the envelope steps between them and, optionally, 16-bit PCM
+ * samples.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef struct {
+    uint32_t wpm;
+    uint32_t tone_hz;
+    uint32_t sample_rate;
+    uint32_t rise_ms;           // Raised-cosine rise/fall, 0 = hard keying
+    float amplitude;            // Full-scale fraction at key-down
+} render_config_t;
+
+typedef struct {
+    uint64_t at_us;
+    bool on;
+} render_edge_t;
+
+// Tone level from at_us until the next step: one per key edge and ramp step
+typedef struct {
+    uint64_t at_us;
+    uint16_t envelope;          // Q15, 32768 = full amplitude
+    bool key;
+} render_step_t;
+
+// Scratch buffers, reused across messages by one worker
+typedef struct {
+    render_edge_t *edges;
+    size_t num_edges;
+    size_t edge_capacity;
+    render_step_t *steps;
+    size_t num_steps;
+    size_t step_capacity;
+    int16_t *samples;
+    size_t num_samples;
+    size_t sample_capacity;
+} render_buffer_t;
+
+typedef struct {
+    uint32_t unit_us;
+    uint32_t units;             // One pass, closing word gap included
+    uint32_t key_units;         // Up to the last key-up edge
+    uint64_t airtime_us;        // First key-down to last key-up
+    uint64_t cycle_us;          // Repeat period on a beacon
+} render_timing_t;
+
+// Builds the shared envelope table; call once before any render_message()
+void render_init(void);
+// Edges and timing always; envelope steps for a trace or samples, samples
+// on request. Returns false if the message has nothing sendable
+bool render_message(const char *text, const render_config_t *config, bool steps, bool samples,
+                    render_buffer_t *buf, render_timing_t *timing);
+void render_buffer_free(render_buffer_t *buf);
+
+int render_write_wav(const char *path, const render_config_t *config, const render_buffer_t *buf);
+int render_write_trace(const char *path, const render_timing_t *timing, const render_buffer_t *buf);
@@ -0,0 +1,209 @@
+/* Host test for the keying envelope in morse_render traces
+ *
+ * Runs morse_render (path given as the only argument) with -e 2, 5 and 10
+ * on a small corpus with -t, reads every trace back and checks each ramp:
+ *   - step k after a key-down edge is morse_envelope_build()'s entry k,
+ *     after a key-up edge entry 32 - k, one row per step
+ *   - step k lands floor(k * rise_us / 32) after the edge, the same for
+ *     rise and fall, so the ramp ends exactly rise_ms after the edge and
+ *     its 50% point is at rise_ms / 2
+ *   - rise and fall are mirror images: entry k + entry 32 - k = 32768
+ * Then times render_message() with and without envelope steps on the same
+ * corpus and reports the cost per step (host time, not checked).
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "render.h"
+#include "morse_envelope.h"
+
+#define WPM             20          // Unit 60 ms: every element outlasts a 10 ms ramp
+#define MAX_ROWS        4096
+#define TIMED_RUNS      2000
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do { \
+    if (!(cond)) { \
+        printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+        printf(__VA_ARGS__); \
+        printf("\n"); \
+        failures++; \
+    } \
+} while (0)
+
+static const char *const corpus[] = { "E", "SOS", "PARIS", "CQ CQ DE BEACON 73" };
+#define CORPUS_LINES    (sizeof(corpus) / sizeof(corpus[0]))
+
+typedef struct {
+    uint64_t t_us;
+    int key;
+    unsigned envelope;
+} row_t;
+
+static row_t rows[MAX_ROWS];
+static uint16_t table[MORSE_ENVELOPE_STEPS + 1];
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static size_t read_trace(const char *path)
+{
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        return 0;
+    }
+    char line[128];
+    size_t count = 0;
+    while (fgets(line, sizeof(line), f) && count < MAX_ROWS) {
+        unsigned long long t;
+        if (sscanf(line, "%llu,%d,%u", &t, &rows[count].key, &rows[count].envelope) == 3) {
+            rows[count++].t_us = t;
+        }
+    }
+    fclose(f);
+    return count;
+}
+
+// Checks the ramp after the edge at rows[edge]; returns the row after it
+static size_t check_ramp(const char *name, size_t edge, size_t count, uint32_t rise_us)
+{
+    int key = rows[edge].key;
+    uint64_t t0 = rows[edge].t_us;
+    for (int k = 1; k <= MORSE_ENVELOPE_STEPS; k++) {
+        size_t i = edge + k;
+        unsigned want = table[key ? k : MORSE_ENVELOPE_STEPS - k];
+        uint64_t at = t0 + (uint64_t)k * rise_us / MORSE_ENVELOPE_STEPS;
+        if (i >= count || rows[i].key != key || rows[i].envelope != want || rows[i].t_us != at) {
+            CHECK(0, "%s: %s step %d after the edge at %llu us is row %zu, expected %u at %llu us",
+                  name, key ? "rise" : "fall", k, (unsigned long long)t0, i, want,
+                  (unsigned long long)at);
+            return count;
+        }
+    }
+    CHECK(rows[edge + MORSE_ENVELOPE_STEPS].t_us - t0 == rise_us, "%s: ramp lasts %llu us, rise %u us",
+          name, (unsigned long long)(rows[edge + MORSE_ENVELOPE_STEPS].t_us - t0), (unsigned)rise_us);
+    return edge + MORSE_ENVELOPE_STEPS + 1;
+}
+
+static void check_trace(const char *name, size_t count, uint32_t rise_us)
+{
+    size_t rises = 0, falls = 0;
+    size_t i = 0;
+    while (i + 1 < count) {
+        // The last row closes the pass, it is not an edge
+        if (i > 0 && rows[i].key != rows[i - 1].key) {
+            rises += rows[i].key;
+            falls += !rows[i].key;
+            i = check_ramp(name, i, count - 1, rise_us);
+        } else if (i == 0 && rows[0].key) {
+            rises++;
+            i = check_ramp(name, 0, count - 1, rise_us);
+        } else {
+            i++;
+        }
+    }
+    CHECK(rises > 0 && rises == falls, "%s: %zu rises, %zu falls", name, rises, falls);
+}
+
+static void check_table(void)
+{
+    CHECK(table[0] == 0 && table[MORSE_ENVELOPE_STEPS] == 32768 &&
+          table[MORSE_ENVELOPE_STEPS / 2] == 16384, "table ends %u..%u, midpoint %u",
+          table[0], table[MORSE_ENVELOPE_STEPS], table[MORSE_ENVELOPE_STEPS / 2]);
+    for (int k = 0; k <= MORSE_ENVELOPE_STEPS; k++) {
+        int sum = table[k] + table[MORSE_ENVELOPE_STEPS - k];
+        CHECK(sum >= 32767 && sum <= 32769, "table[%d] + table[%d] = %d", k,
+              MORSE_ENVELOPE_STEPS - k, sum);
+        CHECK(k == 0 || table[k] > table[k - 1], "table[%d] = %u after %u", k, table[k],
+              k ? table[k - 1] : 0);
+    }
+}
+
+static void run_traces(const char *morse_render, const char *dir)
+{
+    char corpus_path[256], cmd[1024];
+    snprintf(corpus_path, sizeof(corpus_path), "%s/corpus.txt", dir);
+    FILE *f = fopen(corpus_path, "w");
+    CHECK(f != NULL, "cannot write %s", corpus_path);
+    if (f == NULL) {
+        return;
+    }
+    for (size_t i = 0; i < CORPUS_LINES; i++) {
+        fprintf(f, "%s\n", corpus[i]);
+    }
+    fclose(f);
+
+    const uint32_t rise_ms[] = { 2, 5, 10 };
+    for (size_t r = 0; r < sizeof(rise_ms) / sizeof(rise_ms[0]); r++) {
+        snprintf(cmd, sizeof(cmd), "\"%s\" -q -w %d -e %u -t \"%s\" \"%s\" > /dev/null 2>&1",
+                 morse_render, WPM, (unsigned)rise_ms[r], dir, corpus_path);
+        CHECK(system(cmd) == 0, "-e %u: morse_render failed", (unsigned)rise_ms[r]);
+        for (size_t line = 1; line <= CORPUS_LINES; line++) {
+            char path[512], name[64];
+            snprintf(path, sizeof(path), "%s/%06zu.csv", dir, line);
+            snprintf(name, sizeof(name), "-e %u \"%s\"", (unsigned)rise_ms[r], corpus[line - 1]);
+            size_t count = read_trace(path);
+            CHECK(count > 1 && count < MAX_ROWS, "%s: %zu trace rows", name, count);
+            if (count > 1 && count < MAX_ROWS) {
+                check_trace(name, count, rise_ms[r] * 1000);
+            }
+            remove(path);
+        }
+    }
+    remove(corpus_path);
+}
+
+static void report_step_cost(void)
+{
+    render_config_t config = { .wpm = WPM, .tone_hz = 1000, .sample_rate = 8000, .rise_ms = 5,
+                               .amplitude = 0.5f };
+    render_buffer_t buf = { 0 };
+    render_timing_t timing;
+    uint64_t ns[2] = { 0, 0 };
+    size_t steps = 0;
+    for (int with_steps = 0; with_steps < 2; with_steps++) {
+        for (int run = 0; run < TIMED_RUNS; run++) {
+            for (size_t i = 0; i < CORPUS_LINES; i++) {
+                uint64_t t0 = now_ns();
+                render_message(corpus[i], &config, with_steps, false, &buf, &timing);
+                ns[with_steps] += now_ns() - t0;
+                steps += (with_steps && run == 0) ? buf.num_steps : 0;
+            }
+        }
+    }
+    render_buffer_free(&buf);
+    double per_pass = (double)(ns[1] > ns[0] ? ns[1] - ns[0] : 0) / TIMED_RUNS;
+    printf("Envelope steps: %zu per corpus pass, %.1f ns per step (%.1f us edges only, %.1f us with steps)\n",
+           steps, steps ? per_pass / steps : 0.0, ns[0] / 1000.0 / TIMED_RUNS, ns[1] / 1000.0 / TIMED_RUNS);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s path/to/morse_render\n", argv[0]);
+        return 2;
+    }
+    render_init();
+    morse_envelope_build(table);
+    check_table();
+
+    char dir[] = "/tmp/test_trace_XXXXXX";
+    CHECK(mkdtemp(dir) != NULL, "no temp directory");
+    run_traces(argv[1], dir);
+    rmdir(dir);
+    report_step_cost();
+
+    if (failures) {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("All envelope trace checks passed\n");
+    return 0;
+}
@@ -10,6 +10,11 @@
 #include "driver/ledc.h"
 #include "esp_err.h"
 #include "esp_log.h"
+#include "esp_cpu.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
+#include "morse_beacon.h"
+#include "flash_stress.h"
 // Tag for logging [web:47][web:55]
 static const char *TAG = "SOS_BEACON";
 // Pin definitions
@@ -32,6 +37,23 @@ static const char *TAG = "SOS_BEACON";
 #define LETTER_SPACE    (TIME_UNIT * 3) // Space between letters = 3 units
 #define WORD_SPACE      (TIME_UNIT * 7) // Space between words = 7 units
 
+// Several beacons keyed concurrently by one timer instead of the blocking SOS loop
+#define MULTI_BEACON_ENABLE     1
+#define CALLSIGN_PIN            GPIO_NUM_4
+#define MAST_PIN                GPIO_NUM_16
+#define STATS_INTERVAL_MS       10000
+// Raised-cosine rise/fall on the SOS tone (2-10 ms), 0 = hard on/off keying
+#define KEY_RISE_MS             5
+// Scale virtual channels 1..16 and log timing error and CPU load
+#define MORSE_BENCH             0
+#define BENCH_WINDOW_MS         5000
+// Erase/write the NVS partition (unused here) without a break while the
+// beacons run. Every operation turns the flash cache off; the per-channel
+// edge error in the stats shows whether keying stalled.
+#define FLASH_STRESS            0
+#define FLASH_STRESS_SECTOR     4096
+#define FLASH_STRESS_PAGE       256
+
 // Morse code symbols
 typedef enum {
     DOT,
@@ -69,6 +91,9 @@ void signal_off(int duration_ms);
 void transmit_sos(void);
 void morse_buffer_add(const char* str);
 void morse_buffer_clear(void);
+void run_multi_beacon(void);
+void log_beacon_stats(int num_channels, uint32_t window_ms);
+void morse_bench(void);
 
 void app_main(void)
 {
@@ -80,6 +105,13 @@ void app_main(void)
     init_gpio();
     init_buzzer();
     
+#if MORSE_BENCH
+    morse_bench();
+#endif
+#if MULTI_BEACON_ENABLE
+    run_multi_beacon();
+#endif
+
     ESP_LOGI(TAG, "===========================================");
     ESP_LOGI(TAG, "SOS Morse Code Beacon - ESP32 ESP-IDF");
     ESP_LOGI(TAG, "===========================================");
@@ -206,3 +238,98 @@ void transmit_sos(void)
     ESP_LOGI(TAG, "Transmitted SOS: %s", morse_buffer);
     ESP_LOGD(TAG, "Transmission complete. Repeating...");
 }
+void log_beacon_stats(int num_channels, uint32_t window_ms)
+{
+    morse_beacon_stats_t stats;
+    morse_beacon_get_stats(&stats);
+    uint32_t runs = stats.isr_runs ? stats.isr_runs : 1;
+    uint32_t load_x100 = (uint32_t)(stats.total_cycles * 100 * 100 /
+                                    ((uint64_t)window_ms * CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ * 1000));
+    ESP_LOGI(TAG, "%d channel(s): %lu ISRs, %lu edges, %lu ramp steps, avg %lu cycles, max %lu cycles, load %lu.%02lu%%",
+             num_channels, (unsigned long)stats.isr_runs, (unsigned long)stats.edges,
+             (unsigned long)stats.ramp_steps,
+             (unsigned long)(stats.total_cycles / runs), (unsigned long)stats.max_cycles,
+             (unsigned long)(load_x100 / 100), (unsigned long)(load_x100 % 100));
+    for (int i = 0; i < num_channels; i++) {
+        morse_channel_stats_t cs;
+        if (morse_beacon_get_channel_stats(i, &cs) != ESP_OK) {
+            continue;
+        }
+        uint32_t edges = cs.edges ? cs.edges : 1;
+        ESP_LOGI(TAG, "  ch%d: %lu edges, error avg %lu us, max %lu us", i,
+                 (unsigned long)cs.edges, (unsigned long)(cs.total_error_us / edges),
+                 (unsigned long)cs.max_error_us);
+    }
+    morse_beacon_reset_stats();
+}
+void run_multi_beacon(void)
+{
+    // Channel 0 keeps the original SOS: LED plus the 1 kHz tone. With
+    // KEY_RISE_MS the tone duty is ramped by the scheduler; otherwise it is
+    // keyed by switching the buzzer pin's output enable while LEDC runs
+    static const morse_beacon_config_t beacons[] = {
+        {
+            .message = "SOS",
+            .wpm = 1200 / TIME_UNIT,
+            .key_pin = LED_PIN,
+            .tone_pin = BUZZER_PIN,
+            .rise_ms = KEY_RISE_MS,
+            .tone_mode = LEDC_MODE,
+            .tone_channel = LEDC_BUZZER_CHANNEL,
+            .tone_duty = LEDC_DUTY
+        },
+        { .message = "CQ DE ESP32", .wpm = 12, .key_pin = CALLSIGN_PIN, .tone_pin = GPIO_NUM_NC },
+        { .message = "VVV DE MAST1", .wpm = 20, .key_pin = MAST_PIN, .tone_pin = GPIO_NUM_NC },
+    };
+    const int num_beacons = sizeof(beacons) / sizeof(beacons[0]);
+
+    if (KEY_RISE_MS == 0) {
+        ESP_ERROR_CHECK(ledc_set_duty(LEDC_MODE, LEDC_BUZZER_CHANNEL, LEDC_DUTY));
+        ESP_ERROR_CHECK(ledc_update_duty(LEDC_MODE, LEDC_BUZZER_CHANNEL));
+    }
+    ESP_ERROR_CHECK(morse_beacon_start());
+    for (int i = 0; i < num_beacons; i++) {
+        ESP_ERROR_CHECK(morse_beacon_add(&beacons[i], NULL));
+    }
+
+#if FLASH_STRESS
+    ESP_ERROR_CHECK(flash_stress_start());
+#endif
+
+    // Keying runs from the timer ISR; this task only reports
+    while (1) {
+        vTaskDelay(pdMS_TO_TICKS(STATS_INTERVAL_MS));
+        log_beacon_stats(num_beacons, STATS_INTERVAL_MS);
+#if FLASH_STRESS
+        flash_stress_log();
+#endif
+    }
+}
+
+void morse_bench(void)
+{
+    // Virtual channels (no pins) at spread speeds so edges rarely coincide
+    static const int counts[] = { 1, 2, 4, 8, 16 };
+    int added = 0;
+
+    ESP_ERROR_CHECK(morse_beacon_start());
+    for (int c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+        while (added < counts[c]) {
+            morse_beacon_config_t cfg = {
+                .message = "PARIS PARIS",
+                .wpm = 10 + added * 3,
+                .key_pin = GPIO_NUM_NC,
+                .tone_pin = GPIO_NUM_NC
+            };
+            ESP_ERROR_CHECK(morse_beacon_add(&cfg, NULL));
+            added++;
+        }
+        morse_beacon_reset_stats();
+        vTaskDelay(pdMS_TO_TICKS(BENCH_WINDOW_MS));
+        log_beacon_stats(added, BENCH_WINDOW_MS);
+    }
+    ESP_LOGI(TAG, "Morse benchmark complete");
+    while (1) {
+        vTaskDelay(portMAX_DELAY);
+    }
+}
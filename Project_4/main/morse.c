@@ -0,0 +1,93 @@
+/* Morse encoder
+ */
+#include "morse.h"
+
+static const char *const letters[26] = {
+    ".-", "-...", "-.-.", "-..", ".", "..-.", "--.", "....", "..", ".---",
+    "-.-", ".-..", "--", "-.", "---", ".--.", "--.-", ".-.", "...", "-",
+    "..-", "...-", ".--", "-..-", "-.--", "--.."
+};
+
+static const char *const digits[10] = {
+    "-----", ".----", "..---", "...--", "....-",
+    ".....", "-....", "--...", "---..", "----."
+};
+
+const char *morse_code(char c)
+{
+    if (c >= 'a' && c <= 'z') {
+        return letters[c - 'a'];
+    }
+    if (c >= 'A' && c <= 'Z') {
+        return letters[c - 'A'];
+    }
+    if (c >= '0' && c <= '9') {
+        return digits[c - '0'];
+    }
+    switch (c) {
+        case '/': return "-..-.";
+        case '?': return "..--..";
+        case '.': return ".-.-.-";
+        case ',': return "--..--";
+        case '=': return "-...-";
+        default:  return NULL;
+    }
+}
+
+bool morse_iter_init(morse_iter_t *iter, const char *text)
+{
+    iter->text = text;
+    iter->pos = 0;
+    iter->symbol = 0;
+    iter->gap = 0;
+    // Needs at least one sendable character or morse_next() would spin
+    for (const char *p = text; *p; p++) {
+        if (morse_code(*p)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void morse_next(morse_iter_t *iter, morse_element_t *element)
+{
+    if (iter->gap) {
+        element->on = false;
+        element->units = iter->gap;
+        iter->gap = 0;
+        return;
+    }
+
+    // Skip spaces and unsendable characters, wrapping at the end
+    const char *code;
+    while ((code = morse_code(iter->text[iter->pos])) == NULL) {
+        iter->pos = iter->text[iter->pos] ? iter->pos + 1 : 0;
+    }
+
+    element->on = true;
+    element->units = (code[iter->symbol] == '-') ? 3 : 1;
+    if (code[++iter->symbol]) {
+        iter->gap = 1;
+        return;
+    }
+
+    // Character done: letter gap, or word gap before a space or the repeat
+    iter->symbol = 0;
+    iter->pos++;
+    char next = iter->text[iter->pos];
+    iter->gap = (next == '\0' || next == ' ') ? 7 : 3;
+}
+
+bool morse_iter_pass_done(const morse_iter_t *iter)
+{
+    if (iter->gap || iter->symbol) {
+        return false;
+    }
+    // Only spaces or unsendable characters left before the wrap
+    for (const char *p = iter->text + iter->pos; *p; p++) {
+        if (morse_code(*p)) {
+            return false;
+        }
+    }
+    return true;
+}
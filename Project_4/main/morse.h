@@ -0,0 +1,28 @@
+/* Morse encoder
+ * Turns a message into an endless stream of key-down/key-up elements in
+ * ITU units (dot 1, dash 3, element gap 1, letter gap 3, word gap 7). The
+ * message repeats after a word gap. Plain C with no ESP-IDF dependencies.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef struct {
+    bool on;                    // Key down
+    uint8_t units;
+} morse_element_t;
+
+typedef struct {
+    const char *text;
+    size_t pos;                 // Character being sent
+    uint8_t symbol;             // Dot/dash within the character
+    uint8_t gap;                // Key-up units owed before the next symbol
+} morse_iter_t;
+
+const char *morse_code(char c);
+bool morse_iter_init(morse_iter_t *iter, const char *text);
+void morse_next(morse_iter_t *iter, morse_element_t *element);
+// True once a full pass, closing word gap included, has been sent
+bool morse_iter_pass_done(const morse_iter_t *iter);
@@ -0,0 +1,359 @@
+/* Multi-channel Morse beacon scheduler
+ *
+ * The GPTimer free-runs at 1 MHz without auto-reload. Each channel holds
+ * the absolute count of its next key edge; a binary min-heap of channel
+ * indices orders them. The ISR pops every channel due within
+ * MORSE_BEACON_MERGE_US, folds their new levels into set/clear masks for
+ * GPIO_OUT (key pins) and GPIO_ENABLE (tone pins), writes each register
+ * once, advances the popped channels to their next element and re-arms
+ * the alarm for the new heap top. Cost per ISR is O(k log n) for k edges.
+ *
+ * Shaped channels add envelope steps to the same heap: from each element
+ * edge the tone duty walks the raised-cosine table one entry per step
+ * interval, written through the LEDC LL layer. A fall that starts before
+ * the rise finished walks back from the current level, so element edges
+ * are never moved by the shaping.
+ */
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "driver/gptimer.h"
+#include "hal/ledc_ll.h"
+#include "esp_cpu.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "soc/soc.h"
+#include "soc/gpio_reg.h"
+#include "morse.h"
+#include "morse_envelope.h"
+#include "morse_beacon.h"
+
+static const char *TAG = "MORSE_BEACON";
+
+#define START_DELAY_US  1000        // First edge of a newly added channel
+#define NEVER           UINT64_MAX
+
+typedef struct {
+    morse_iter_t iter;
+    uint32_t unit_us;
+    uint64_t next_us;               // Heap key: min(edge_us, ramp_us)
+    uint64_t edge_us;               // Absolute timer count of the next element edge
+    bool key_down;                  // Level of the element being keyed
+    uint32_t key_lo, key_hi;        // GPIO_OUT bits
+    uint32_t tone_lo, tone_hi;      // GPIO_ENABLE bits
+    // Shaped tone
+    bool shaped;
+    uint64_t ramp_us;               // Next envelope step, NEVER when settled
+    uint32_t ramp_frac;             // Sub-us remainder of ramp_us, morse_envelope.h
+    uint32_t rise_us;
+    uint8_t ramp_pos;               // Index into the envelope table
+    ledc_mode_t tone_mode;
+    ledc_channel_t tone_channel;
+    uint32_t tone_duty;
+    morse_channel_stats_t stats;
+} channel_t;
+
+typedef struct {
+    uint32_t out_set_lo, out_clr_lo, out_set_hi, out_clr_hi;
+    uint32_t en_set_lo, en_clr_lo, en_set_hi, en_clr_hi;
+} gpio_writes_t;
+
+static uint16_t envelope[MORSE_ENVELOPE_STEPS + 1];
+static channel_t channels[MORSE_BEACON_MAX_CHANNELS];
+static uint8_t heap[MORSE_BEACON_MAX_CHANNELS];
+static int num_channels = 0;
+static gptimer_handle_t beacon_timer = NULL;
+static morse_beacon_stats_t stats;
+static portMUX_TYPE beacon_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static IRAM_ATTR void heap_sift_down(int i)
+{
+    while (1) {
+        int smallest = i;
+        int left = 2 * i + 1, right = 2 * i + 2;
+        if (left < num_channels && channels[heap[left]].next_us < channels[heap[smallest]].next_us) {
+            smallest = left;
+        }
+        if (right < num_channels && channels[heap[right]].next_us < channels[heap[smallest]].next_us) {
+            smallest = right;
+        }
+        if (smallest == i) {
+            return;
+        }
+        uint8_t tmp = heap[i];
+        heap[i] = heap[smallest];
+        heap[smallest] = tmp;
+        i = smallest;
+    }
+}
+
+static void heap_sift_up(int i)
+{
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (channels[heap[parent]].next_us <= channels[heap[i]].next_us) {
+            return;
+        }
+        uint8_t tmp = heap[i];
+        heap[i] = heap[parent];
+        heap[parent] = tmp;
+        i = parent;
+    }
+}
+
+// Load the next element and schedule the edge that ends it
+static IRAM_ATTR void channel_advance(channel_t *ch)
+{
+    morse_element_t element;
+    morse_next(&ch->iter, &element);
+    ch->key_down = element.on;
+    ch->edge_us += (uint64_t)element.units * ch->unit_us;
+}
+
+static IRAM_ATTR void set_tone_duty(const channel_t *ch, uint32_t duty)
+{
+    ledc_dev_t *hw = LEDC_LL_GET_HW();
+    ledc_ll_set_duty_int_part(hw, ch->tone_mode, ch->tone_channel, duty);
+    ledc_ll_set_duty_direction(hw, ch->tone_mode, ch->tone_channel, LEDC_DUTY_DIR_INCREASE);
+    ledc_ll_set_duty_num(hw, ch->tone_mode, ch->tone_channel, 1);
+    ledc_ll_set_duty_cycle(hw, ch->tone_mode, ch->tone_channel, 1);
+    ledc_ll_set_duty_scale(hw, ch->tone_mode, ch->tone_channel, 0);
+    ledc_ll_set_duty_start(hw, ch->tone_mode, ch->tone_channel, true);
+    ledc_ll_ls_channel_update(hw, ch->tone_mode, ch->tone_channel);
+}
+
+// One envelope step towards the keyed level; returns false once settled
+static IRAM_ATTR bool ramp_step(channel_t *ch)
+{
+    if (ch->key_down && ch->ramp_pos < MORSE_ENVELOPE_STEPS) {
+        ch->ramp_pos++;
+    } else if (!ch->key_down && ch->ramp_pos > 0) {
+        ch->ramp_pos--;
+    } else {
+        return false;
+    }
+    set_tone_duty(ch, (ch->tone_duty * envelope[ch->ramp_pos]) >> 15);
+    bool settled = ch->key_down ? ch->ramp_pos == MORSE_ENVELOPE_STEPS : ch->ramp_pos == 0;
+    ch->ramp_us = settled ? NEVER : morse_envelope_next_us(ch->ramp_us, &ch->ramp_frac, ch->rise_us);
+    return true;
+}
+
+static IRAM_ATTR void collect_edge(const channel_t *ch, gpio_writes_t *w)
+{
+    if (ch->key_down) {
+        w->out_set_lo |= ch->key_lo;
+        w->out_set_hi |= ch->key_hi;
+        w->en_set_lo |= ch->tone_lo;
+        w->en_set_hi |= ch->tone_hi;
+    } else {
+        w->out_clr_lo |= ch->key_lo;
+        w->out_clr_hi |= ch->key_hi;
+        w->en_clr_lo |= ch->tone_lo;
+        w->en_clr_hi |= ch->tone_hi;
+    }
+}
+
+static IRAM_ATTR void apply_writes(const gpio_writes_t *w)
+{
+    if (w->out_set_lo) REG_WRITE(GPIO_OUT_W1TS_REG, w->out_set_lo);
+    if (w->out_clr_lo) REG_WRITE(GPIO_OUT_W1TC_REG, w->out_clr_lo);
+    if (w->out_set_hi) REG_WRITE(GPIO_OUT1_W1TS_REG, w->out_set_hi);
+    if (w->out_clr_hi) REG_WRITE(GPIO_OUT1_W1TC_REG, w->out_clr_hi);
+    if (w->en_set_lo) REG_WRITE(GPIO_ENABLE_W1TS_REG, w->en_set_lo);
+    if (w->en_clr_lo) REG_WRITE(GPIO_ENABLE_W1TC_REG, w->en_clr_lo);
+    if (w->en_set_hi) REG_WRITE(GPIO_ENABLE1_W1TS_REG, w->en_set_hi);
+    if (w->en_clr_hi) REG_WRITE(GPIO_ENABLE1_W1TC_REG, w->en_clr_hi);
+}
+
+static IRAM_ATTR bool beacon_isr(gptimer_handle_t timer, const gptimer_alarm_event_data_t *edata, void *user_ctx)
+{
+    uint32_t start = esp_cpu_get_cycle_count();
+    gpio_writes_t writes = { 0 };
+    uint8_t due[MORSE_BEACON_MAX_CHANNELS];
+    uint64_t scheduled[MORSE_BEACON_MAX_CHANNELS];
+    int num_due = 0;
+
+    portENTER_CRITICAL_ISR(&beacon_lock);
+    uint64_t now = edata->count_value;
+    // Pop everything due now or within the merge window
+    uint32_t ramp_steps = 0;
+    while (num_channels > 0 && channels[heap[0]].next_us <= now + MORSE_BEACON_MERGE_US) {
+        channel_t *ch = &channels[heap[0]];
+        if (ch->edge_us <= now + MORSE_BEACON_MERGE_US) {
+            // Each edge starts the channel's next element
+            due[num_due] = heap[0];
+            scheduled[num_due] = ch->edge_us;
+            num_due++;
+            channel_advance(ch);
+            collect_edge(ch, &writes);
+            if (ch->shaped) {
+                ch->ramp_frac = 0;
+                ch->ramp_us = morse_envelope_next_us(scheduled[num_due - 1], &ch->ramp_frac, ch->rise_us);
+            }
+        }
+        if (ch->ramp_us <= now + MORSE_BEACON_MERGE_US) {
+            if (ramp_step(ch)) {
+                ramp_steps++;
+            } else {
+                ch->ramp_us = NEVER;
+            }
+        }
+        ch->next_us = ch->edge_us < ch->ramp_us ? ch->edge_us : ch->ramp_us;
+        heap_sift_down(0);
+    }
+
+    apply_writes(&writes);
+    uint64_t applied = now;
+    gptimer_get_raw_count(timer, &applied);
+
+    for (int i = 0; i < num_due; i++) {
+        morse_channel_stats_t *cs = &channels[due[i]].stats;
+        uint32_t error = (uint32_t)(applied > scheduled[i] ? applied - scheduled[i] : scheduled[i] - applied);
+        cs->edges++;
+        cs->total_error_us += error;
+        if (error > cs->max_error_us) {
+            cs->max_error_us = error;
+        }
+    }
+
+    if (num_channels > 0) {
+        gptimer_alarm_config_t alarm = {
+            .alarm_count = channels[heap[0]].next_us
+        };
+        gptimer_set_alarm_action(timer, &alarm);
+    }
+
+    uint32_t cycles = esp_cpu_get_cycle_count() - start;
+    stats.isr_runs++;
+    stats.edges += num_due;
+    stats.ramp_steps += ramp_steps;
+    stats.total_cycles += cycles;
+    if (cycles > stats.max_cycles) {
+        stats.max_cycles = cycles;
+    }
+    portEXIT_CRITICAL_ISR(&beacon_lock);
+    return false;
+}
+
+esp_err_t morse_beacon_start(void)
+{
+    if (beacon_timer != NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    gptimer_config_t timer_config = {
+        .clk_src = GPTIMER_CLK_SRC_DEFAULT,
+        .direction = GPTIMER_COUNT_UP,
+        .resolution_hz = MORSE_BEACON_TIMER_HZ
+    };
+    morse_envelope_build(envelope);
+    ESP_ERROR_CHECK(gptimer_new_timer(&timer_config, &beacon_timer));
+    gptimer_event_callbacks_t callbacks = {
+        .on_alarm = beacon_isr
+    };
+    ESP_ERROR_CHECK(gptimer_register_event_callbacks(beacon_timer, &callbacks, NULL));
+    ESP_ERROR_CHECK(gptimer_enable(beacon_timer));
+    ESP_LOGI(TAG, "Scheduler started, up to %d channels", MORSE_BEACON_MAX_CHANNELS);
+    return gptimer_start(beacon_timer);
+}
+
+esp_err_t morse_beacon_add(const morse_beacon_config_t *config, int *channel_id)
+{
+    if (config == NULL || config->message == NULL || config->wpm == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (beacon_timer == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (num_channels >= MORSE_BEACON_MAX_CHANNELS) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    channel_t ch = { 0 };
+    if (!morse_iter_init(&ch.iter, config->message)) {
+        ESP_LOGE(TAG, "Nothing to send in \"%s\"", config->message);
+        return ESP_ERR_INVALID_ARG;
+    }
+    ch.unit_us = 1200000 / config->wpm;
+
+    if (config->key_pin != GPIO_NUM_NC) {
+        gpio_reset_pin(config->key_pin);
+        gpio_set_direction(config->key_pin, GPIO_MODE_OUTPUT);
+        gpio_set_level(config->key_pin, 0);
+        ch.key_lo = (config->key_pin < 32) ? (1u << config->key_pin) : 0;
+        ch.key_hi = (config->key_pin >= 32) ? (1u << (config->key_pin - 32)) : 0;
+    }
+    if (config->rise_ms > 0) {
+        ch.shaped = true;
+        ch.rise_us = morse_envelope_rise_us(config->rise_ms, ch.unit_us);
+        ch.tone_mode = config->tone_mode;
+        ch.tone_channel = config->tone_channel;
+        ch.tone_duty = config->tone_duty;
+        set_tone_duty(&ch, 0);
+    } else if (config->tone_pin != GPIO_NUM_NC) {
+        ch.tone_lo = (config->tone_pin < 32) ? (1u << config->tone_pin) : 0;
+        ch.tone_hi = (config->tone_pin >= 32) ? (1u << (config->tone_pin - 32)) : 0;
+        // Tone silent until the first key-down
+        REG_WRITE(GPIO_ENABLE_W1TC_REG, ch.tone_lo);
+        REG_WRITE(GPIO_ENABLE1_W1TC_REG, ch.tone_hi);
+    }
+
+    // First edge starts the first element
+    uint64_t now = 0;
+    ESP_ERROR_CHECK(gptimer_get_raw_count(beacon_timer, &now));
+    ch.edge_us = now + START_DELAY_US;
+    ch.ramp_us = NEVER;
+    ch.next_us = ch.edge_us;
+
+    portENTER_CRITICAL(&beacon_lock);
+    int id = num_channels;
+    channels[id] = ch;
+    heap[num_channels++] = id;
+    heap_sift_up(num_channels - 1);
+    if (heap[0] == id) {
+        gptimer_alarm_config_t alarm = {
+            .alarm_count = ch.next_us
+        };
+        gptimer_set_alarm_action(beacon_timer, &alarm);
+    }
+    portEXIT_CRITICAL(&beacon_lock);
+
+    if (ch.shaped) {
+        ESP_LOGI(TAG, "Channel %d: \"%s\" at %lu WPM on GPIO%d (tone LEDC ch %d, rise %lu us)", id,
+                 config->message, (unsigned long)config->wpm, config->key_pin, config->tone_channel,
+                 (unsigned long)ch.rise_us);
+    } else {
+        ESP_LOGI(TAG, "Channel %d: \"%s\" at %lu WPM on GPIO%d (tone GPIO%d)", id, config->message,
+                 (unsigned long)config->wpm, config->key_pin, config->tone_pin);
+    }
+    if (channel_id) {
+        *channel_id = id;
+    }
+    return ESP_OK;
+}
+
+esp_err_t morse_beacon_get_channel_stats(int channel_id, morse_channel_stats_t *out)
+{
+    if (channel_id < 0 || channel_id >= num_channels) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    portENTER_CRITICAL(&beacon_lock);
+    *out = channels[channel_id].stats;
+    portEXIT_CRITICAL(&beacon_lock);
+    return ESP_OK;
+}
+
+void morse_beacon_get_stats(morse_beacon_stats_t *out)
+{
+    portENTER_CRITICAL(&beacon_lock);
+    *out = stats;
+    portEXIT_CRITICAL(&beacon_lock);
+}
+
+void morse_beacon_reset_stats(void)
+{
+    portENTER_CRITICAL(&beacon_lock);
+    memset(&stats, 0, sizeof(stats));
+    for (int i = 0; i < num_channels; i++) {
+        memset(&channels[i].stats, 0, sizeof(channels[i].stats));
+    }
+    portEXIT_CRITICAL(&beacon_lock);
+}
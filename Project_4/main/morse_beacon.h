@@ -0,0 +1,51 @@
+/* Multi-channel Morse beacon scheduler
+ * Keys up to MORSE_BEACON_MAX_CHANNELS independent messages, each on its
+ * own pin and at its own speed, from one GPTimer. Channel edge times are
+ * kept in a min-heap; the timer alarm is always set to the earliest edge
+ * and edges falling together are applied with one GPIO register write.
+ * A channel's tone can instead be shaped: its LEDC duty follows a
+ * raised-cosine rise/fall stepped from the same scheduler.
+ */
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "driver/gpio.h"
+#include "driver/ledc.h"
+
+#define MORSE_BEACON_MAX_CHANNELS   16
+#define MORSE_BEACON_TIMER_HZ       1000000     // 1 us timer resolution
+#define MORSE_BEACON_MERGE_US       20          // Edges this close share one write
+
+typedef struct {
+    const char *message;        // Must stay valid while the channel runs
+    uint32_t wpm;               // PARIS words per minute (unit = 1200 / wpm ms)
+    gpio_num_t key_pin;         // Keyed output level (LED), GPIO_NUM_NC for none
+    gpio_num_t tone_pin;        // Keyed output enable (pin already driven by a
+                                // running LEDC tone), GPIO_NUM_NC for none
+    // Shaped tone instead of tone_pin: rise/fall time 2-10 ms, 0 = off
+    uint32_t rise_ms;
+    ledc_mode_t tone_mode;      // LEDC channel already configured on the buzzer
+    ledc_channel_t tone_channel;
+    uint32_t tone_duty;         // Duty at full level
+} morse_beacon_config_t;
+
+typedef struct {
+    uint32_t edges;
+    uint64_t total_error_us;    // Sum of |applied - scheduled|
+    uint32_t max_error_us;
+} morse_channel_stats_t;
+
+typedef struct {
+    uint32_t isr_runs;
+    uint32_t edges;             // Channel edges applied (>= isr_runs when merged)
+    uint32_t ramp_steps;        // Envelope duty writes
+    uint64_t total_cycles;      // Cycles spent in the scheduler ISR
+    uint32_t max_cycles;
+} morse_beacon_stats_t;
+
+esp_err_t morse_beacon_start(void);
+esp_err_t morse_beacon_add(const morse_beacon_config_t *config, int *channel_id);
+esp_err_t morse_beacon_get_channel_stats(int channel_id, morse_channel_stats_t *stats);
+void morse_beacon_get_stats(morse_beacon_stats_t *stats);
+void morse_beacon_reset_stats(void);
@@ -0,0 +1,45 @@
+/* Raised-cosine keying envelope
+ *
+ *     level(i) = (1 - cos(pi * i / steps)) / 2
+ *
+ * Rise and fall both start at the element edge, so the 50% points of an
+ * element stay exactly one element length apart. Step k of a ramp lands
+ * at floor(k * rise_us / steps) after the edge, so the ramp ends exactly
+ * rise_us after it and its midpoint at rise_us / 2.
+ *
+ * morse_envelope_next_us runs in the beacon ISR; linker.lf keeps it out
+ * of flash.
+ */
+#include <math.h>
+#include "morse_envelope.h"
+
+void morse_envelope_build(uint16_t table[MORSE_ENVELOPE_STEPS + 1])
+{
+    for (int i = 0; i <= MORSE_ENVELOPE_STEPS; i++) {
+        double level = (1.0 - cos(M_PI * i / MORSE_ENVELOPE_STEPS)) / 2.0;
+        table[i] = (uint16_t)(level * 32768.0 + 0.5);
+    }
+}
+
+uint32_t morse_envelope_rise_us(uint32_t rise_ms, uint32_t unit_us)
+{
+    if (rise_ms < MORSE_ENVELOPE_MIN_MS) {
+        rise_ms = MORSE_ENVELOPE_MIN_MS;
+    }
+    if (rise_ms > MORSE_ENVELOPE_MAX_MS) {
+        rise_ms = MORSE_ENVELOPE_MAX_MS;
+    }
+    uint32_t rise_us = rise_ms * 1000;
+    if (rise_us > unit_us) {
+        rise_us = unit_us;
+    }
+    return rise_us > MORSE_ENVELOPE_STEPS ? rise_us : MORSE_ENVELOPE_STEPS;
+}
+
+uint64_t morse_envelope_next_us(uint64_t at_us, uint32_t *frac, uint32_t rise_us)
+{
+    *frac += rise_us % MORSE_ENVELOPE_STEPS;
+    at_us += rise_us / MORSE_ENVELOPE_STEPS + *frac / MORSE_ENVELOPE_STEPS;
+    *frac %= MORSE_ENVELOPE_STEPS;
+    return at_us;
+}
@@ -0,0 +1,20 @@
+/* Raised-cosine keying envelope
+ * Rise/fall curve for click-free Morse keying, as a Q15 table stepped
+ * one entry per step interval. Plain C with no ESP-IDF dependencies.
+ */
+#pragma once
+
+#include <stdint.h>
+
+#define MORSE_ENVELOPE_STEPS    32          // Table steps per rise or fall
+#define MORSE_ENVELOPE_MIN_MS   2
+#define MORSE_ENVELOPE_MAX_MS   10
+
+// table[0] = 0 ... table[MORSE_ENVELOPE_STEPS] = 32768
+void morse_envelope_build(uint16_t table[MORSE_ENVELOPE_STEPS + 1]);
+// Rise time in us, clipped to 2-10 ms and so a rise fits inside one unit
+uint32_t morse_envelope_rise_us(uint32_t rise_ms, uint32_t unit_us);
+// Time of the step after at_us. Steps are rise_us / STEPS apart with the
+// remainder carried in *frac (1/STEPS us, 0 at the start of a ramp), so a
+// full rise or fall takes exactly rise_us.
+uint64_t morse_envelope_next_us(uint64_t at_us, uint32_t *frac, uint32_t rise_us);
@@ -0,0 +1,75 @@
+"""Project 4 under QEMU: Morse element timing on the multi-beacon scheduler
+
+The firmware reports edges per channel and each edge's error against its
+scheduled time every STATS_INTERVAL_MS. The edge count over a few windows
+checks the element lengths (unit = 1200 / wpm ms); the error checks that
+every edge landed on time.
+"""
+import pytest
+
+TAG = 'SOS_BEACON'
+STATS_INTERVAL_MS = 10000       # main.c
+WINDOWS = 3
+MAX_EDGE_ERROR_US = 100         # Regression budget, worst edge of a window
+MAX_ISR_CYCLES = 6000           # Regression budget for the scheduler ISR
+
+# run_multi_beacon(): (message, wpm); channel 0 is SOS at TIME_UNIT 200 ms
+BEACONS = [('SOS', 6), ('CQ DE ESP32', 12), ('VVV DE MAST1', 20)]
+
+MORSE = {
+    'A': '.-', 'B': '-...', 'C': '-.-.', 'D': '-..', 'E': '.', 'F': '..-.',
+    'G': '--.', 'H': '....', 'I': '..', 'J': '.---', 'K': '-.-', 'L': '.-..',
+    'M': '--', 'N': '-.', 'O': '---', 'P': '.--.', 'Q': '--.-', 'R': '.-.',
+    'S': '...', 'T': '-', 'U': '..-', 'V': '...-', 'W': '.--', 'X': '-..-',
+    'Y': '-.--', 'Z': '--..', '0': '-----', '1': '.----', '2': '..---',
+    '3': '...--', '4': '....-', '5': '.....', '6': '-....', '7': '--...',
+    '8': '---..', '9': '----.',
+}
+
+
+def message_cycle(message):
+    """(units, edges) of one pass of the message, with the word gap before the repeat.
+
+    Every element ends in an edge: each dot or dash, and the symbol, letter
+    or word gap that follows it.
+    """
+    units = edges = 0
+    for word in message.split():
+        for i, char in enumerate(word):
+            code = MORSE[char]
+            units += sum(3 if s == '-' else 1 for s in code) + len(code) - 1
+            units += 7 if i == len(word) - 1 else 3
+            edges += 2 * len(code)
+    return units, edges
+
+
+@pytest.mark.esp32
+@pytest.mark.qemu
+def test_element_timing(log):
+    log.check_boot()
+    timeout = STATS_INTERVAL_MS / 1000 + 5
+    channels = len(BEACONS)
+    # The first stats summary is only the baseline: its window began when the channels were
+    # added, so its per-channel lines are skipped and counting starts at the next summary
+    last_ms, _ = log.expect(TAG, r'\d+ channel\(s\):', timeout)
+    total_ms = 0
+    edges = [0] * channels
+    for _ in range(WINDOWS):
+        ms, summary = log.expect(TAG, rf'{channels} channel\(s\): \d+ ISRs, \d+ edges, '
+                                      r'\d+ ramp steps, avg \d+ cycles, max (\d+) cycles', timeout)
+        assert int(summary.group(2)) <= log.budget(MAX_ISR_CYCLES)
+        for ch in range(channels):
+            _, stats = log.expect(TAG, rf'  ch{ch}: (\d+) edges, error avg (\d+) us, max (\d+) us')
+            edges[ch] += int(stats.group(2))
+            assert int(stats.group(4)) <= log.budget(MAX_EDGE_ERROR_US), \
+                f'ch{ch} edge {stats.group(4).decode()} us off schedule'
+        total_ms += ms - last_ms
+        last_ms = ms
+
+    for ch, (message, wpm) in enumerate(BEACONS):
+        units, cycle_edges = message_cycle(message)
+        cycle_ms = units * 1200 / wpm
+        expected = total_ms * cycle_edges / cycle_ms
+        # The windows cut the message anywhere: up to one pass of edges either way
+        assert abs(edges[ch] - expected) <= cycle_edges, \
+            f'ch{ch} "{message}": {edges[ch]} edges in {total_ms} ms, expected {expected:.0f}'
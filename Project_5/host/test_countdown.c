@@ -0,0 +1,206 @@
+/* Countdown timeline host test
+ *
+ * Runs the firmware timeline (countdown.c) through a simulated GPTimer ISR
+ * that arms every event at start + event time with the firmware's own
+ * catch-up step (countdown_advance), with interrupt latency and occasional
+ * multi-millisecond stalls, and checks that a 10-minute countdown still
+ * explodes within 1 ms of its target.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include "countdown.h"
+
+#define MAX_END_ERROR_US 1000
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do { \
+    if (!(cond)) { \
+        printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+        printf(__VA_ARGS__); \
+        printf("\n"); \
+        failures++; \
+    } \
+} while (0)
+
+// Deterministic interrupt latency: 2-60 us, and a 3 ms stall every 97th alarm
+static uint32_t latency_us(uint32_t alarm)
+{
+    static uint32_t seed = 12345;
+    seed = seed * 1103515245 + 12345;
+    uint32_t latency = 2 + (seed >> 16) % 59;
+    return (alarm % 97 == 96) ? latency + 3000 : latency;
+}
+
+static const countdown_config_t ten_minutes = {
+    .total_ms = 10 * 60 * 1000,
+    .tick_interval_ms = 1000,
+    .urgent_ms = 10000,
+    .urgent_interval_ms = 200,
+    .tick_sound_ms = 100,
+    .explosion_ms = 2000,
+    .flash_interval_ms = 100,
+    .num_leds = 5
+};
+
+static void test_timeline_shape(void)
+{
+    countdown_iter_t iter;
+    countdown_event_t event;
+    CHECK(countdown_init(&iter, &ten_minutes), "init");
+
+    uint64_t last_us = 0;
+    uint32_t ticks = 0, urgent_ticks = 0, offs = 0;
+    uint64_t urgent_at = 0, explode_at = 0, end_at = 0;
+    uint8_t last_leds = ten_minutes.num_leds;
+    while (countdown_next(&iter, &event)) {
+        CHECK(event.at_us >= last_us, "event at %llu before %llu",
+              (unsigned long long)event.at_us, (unsigned long long)last_us);
+        last_us = event.at_us;
+        switch (event.action) {
+            case COUNTDOWN_TICK_ON:
+                ticks++;
+                if (event.urgent) {
+                    urgent_at = event.at_us;
+                }
+                if (urgent_at) {
+                    urgent_ticks++;
+                }
+                CHECK(event.leds <= last_leds && event.leds > 0, "LEDs %u after %u", event.leds, last_leds);
+                last_leds = event.leds;
+                break;
+            case COUNTDOWN_TICK_OFF:
+                offs++;
+                break;
+            case COUNTDOWN_EXPLODE:
+                explode_at = event.at_us;
+                break;
+            case COUNTDOWN_END:
+                end_at = event.at_us;
+                break;
+            default:
+                break;
+        }
+    }
+    CHECK(ticks == 590 + 50, "%u ticks", ticks);
+    CHECK(urgent_ticks == 50, "%u urgent ticks", urgent_ticks);
+    CHECK(offs == ticks, "%u beeps ended for %u ticks", offs, ticks);
+    CHECK(urgent_at == 590000000ULL, "urgent at %llu us", (unsigned long long)urgent_at);
+    CHECK(explode_at == 600000000ULL, "explosion at %llu us", (unsigned long long)explode_at);
+    CHECK(end_at == 602000000ULL, "end at %llu us", (unsigned long long)end_at);
+}
+
+typedef struct {
+    uint64_t explode_at;            // Simulated timer count when the explosion was applied
+    uint64_t max_late;
+    uint32_t alarms;
+    uint32_t events;
+} sim_result_t;
+
+// Simulated ISR: applies events against a fake timer count and lets
+// countdown_advance() decide catch-up and re-arming, as countdown_isr() does.
+// A pause at pause_at (timer count) for pause_us is resumed the way
+// countdown_timer_resume_from_isr() does it: start moves forward.
+static sim_result_t simulate(uint64_t start, uint64_t pause_at, uint64_t pause_us)
+{
+    countdown_iter_t iter;
+    countdown_event_t event;
+    sim_result_t result = { 0 };
+    CHECK(countdown_init(&iter, &ten_minutes), "init");
+    CHECK(countdown_next(&iter, &event), "first event");
+
+    uint64_t alarm_at = start + event.at_us;
+    bool paused = false;
+    bool more = true;
+    while (more) {
+        if (!paused && pause_us && alarm_at > pause_at) {
+            start += pause_us;
+            alarm_at = start + event.at_us;
+            paused = true;
+        }
+        uint64_t now = alarm_at + latency_us(result.alarms++);
+        for (;;) {
+            uint64_t deadline = start + event.at_us;
+            now += 2;                               // Applying the event
+            if (now - deadline > result.max_late) {
+                result.max_late = now - deadline;
+            }
+            if (event.action == COUNTDOWN_EXPLODE) {
+                result.explode_at = now;
+            }
+            result.events++;
+            countdown_step_t step = countdown_advance(&iter, &event, start, now, &alarm_at);
+            if (step == COUNTDOWN_STEP_DONE) {
+                more = false;
+                break;
+            }
+            if (step == COUNTDOWN_STEP_ARM) {
+                break;
+            }
+        }
+    }
+    return result;
+}
+
+static void test_ten_minute_accuracy(void)
+{
+    const uint64_t start = 1000;
+    const uint64_t target = start + ten_minutes.total_ms * 1000ULL;
+    sim_result_t r = simulate(start, 0, 0);
+    uint64_t explode_error = r.explode_at - target;
+    printf("10 min countdown: %u events in %u alarms, explosion %llu us late, worst event %llu us late\n",
+           r.events, r.alarms, (unsigned long long)explode_error, (unsigned long long)r.max_late);
+    CHECK(r.explode_at >= target && explode_error < MAX_END_ERROR_US,
+          "explosion %llu us late", (unsigned long long)explode_error);
+
+    // Paused for 5 s at the halfway mark: explosion moves by exactly the pause
+    const uint64_t pause_us = 5000000;
+    r = simulate(start, start + 300000000ULL + 123, pause_us);
+    explode_error = r.explode_at - (target + pause_us);
+    printf("With a 5 s pause: explosion %llu us after the shifted target\n", (unsigned long long)explode_error);
+    CHECK(r.explode_at >= target + pause_us && explode_error < MAX_END_ERROR_US,
+          "paused explosion %llu us late", (unsigned long long)explode_error);
+
+    // The blocking loop this replaces: each tick took interval + beep + overhead
+    uint64_t relative = 0;
+    for (uint32_t i = 0; i < 590; i++) {
+        relative += (ten_minutes.tick_interval_ms + ten_minutes.tick_sound_ms) * 1000ULL + 30;
+    }
+    for (uint32_t i = 0; i < 50; i++) {
+        relative += (ten_minutes.urgent_interval_ms + ten_minutes.tick_sound_ms) * 1000ULL + 30;
+    }
+    printf("Blocking delays would have exploded %.1f s late\n",
+           (relative - ten_minutes.total_ms * 1000ULL) / 1e6);
+}
+
+static void test_invalid_config(void)
+{
+    countdown_iter_t iter;
+    countdown_config_t config = ten_minutes;
+    config.urgent_ms = config.total_ms + 1;
+    CHECK(!countdown_init(&iter, &config), "urgent stretch longer than countdown");
+    config = ten_minutes;
+    config.tick_interval_ms = 0;
+    CHECK(!countdown_init(&iter, &config), "zero tick interval");
+    config = ten_minutes;
+    config.tick_sound_ms = config.tick_interval_ms;
+    CHECK(!countdown_init(&iter, &config), "beep as long as the tick interval");
+    config = ten_minutes;
+    config.tick_sound_ms = config.urgent_interval_ms;
+    CHECK(!countdown_init(&iter, &config), "beep as long as the urgent interval");
+    config.urgent_ms = 0;
+    CHECK(countdown_init(&iter, &config), "urgent interval unused without an urgent stretch");
+}
+
+int main(void)
+{
+    test_timeline_shape();
+    test_ten_minute_accuracy();
+    test_invalid_config();
+    if (failures) {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("All countdown checks passed\n");
+    return 0;
+}
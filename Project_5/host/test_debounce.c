@@ -0,0 +1,109 @@
+/* Input debounce host test
+ *
+ * Feeds recorded-style bounce bursts through the firmware debounce
+ * (debounce.c) and checks one activation per press, none from release
+ * bounce, and that the activation lands on the first edge of the burst.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "debounce.h"
+
+#define QUIET_US    20000
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do { \
+    if (!(cond)) { \
+        printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+        printf(__VA_ARGS__); \
+        printf("\n"); \
+        failures++; \
+    } \
+} while (0)
+
+typedef struct {
+    uint64_t at_us;
+    bool level;
+} edge_t;
+
+// Active-low button: press bounces for ~3 ms, release for ~5 ms
+static const edge_t press_release[] = {
+    { 100000, 0 }, { 100040, 1 }, { 100090, 0 }, { 100400, 1 }, { 100410, 0 }, { 103000, 0 },
+    { 250000, 1 }, { 250030, 0 }, { 250300, 1 }, { 251000, 0 }, { 251020, 1 }, { 255000, 1 },
+};
+
+static int feed(debounce_t *d, const edge_t *edges, int count, uint64_t offset_us, uint64_t *first_accept)
+{
+    int activations = 0;
+    for (int i = 0; i < count; i++) {
+        if (debounce_edge(d, edges[i].at_us + offset_us, edges[i].level)) {
+            if (activations == 0 && first_accept) {
+                *first_accept = edges[i].at_us + offset_us;
+            }
+            activations++;
+        }
+    }
+    return activations;
+}
+
+static void test_button(void)
+{
+    debounce_t d;
+    debounce_init(&d, QUIET_US, false);
+    int count = sizeof(press_release) / sizeof(press_release[0]);
+    uint64_t accepted = 0;
+    CHECK(feed(&d, press_release, count, 0, &accepted) == 1, "one activation per press");
+    CHECK(accepted == press_release[0].at_us, "accepted at %llu, first edge %llu",
+          (unsigned long long)accepted, (unsigned long long)press_release[0].at_us);
+
+    // 100 presses in a row, 400 ms apart
+    int total = 0;
+    for (int p = 1; p <= 100; p++) {
+        total += feed(&d, press_release, count, p * 400000ULL, NULL);
+    }
+    CHECK(total == 100, "%d activations for 100 presses", total);
+
+    // Conventional wait-for-stable debounce would act QUIET_US after the last bounce
+    uint64_t stable_at = press_release[4].at_us + QUIET_US;
+    printf("Debounce delay: 0 us at the first edge (wait-for-stable: %llu us)\n",
+           (unsigned long long)(stable_at - press_release[0].at_us));
+}
+
+static void test_wire_cut(void)
+{
+    // Wire holds the pin low; cutting it lets the pull-up take it high
+    static const edge_t cut[] = {
+        { 500000, 1 }, { 500015, 0 }, { 500030, 1 }, { 500200, 1 },
+    };
+    debounce_t d;
+    debounce_init(&d, QUIET_US, true);
+    uint64_t accepted = 0;
+    CHECK(feed(&d, cut, 4, 0, &accepted) == 1, "one activation per cut");
+    CHECK(accepted == cut[0].at_us, "cut accepted at %llu", (unsigned long long)accepted);
+}
+
+static void test_glitch_burst(void)
+{
+    // Continuous chatter never leaves a quiet gap: only its first edge counts
+    debounce_t d;
+    debounce_init(&d, QUIET_US, false);
+    int activations = 0;
+    for (int i = 0; i < 1000; i++) {
+        activations += debounce_edge(&d, 1000000 + i * 1000ULL, i % 2 == 0 ? false : true);
+    }
+    CHECK(activations == 1, "%d activations from chatter", activations);
+}
+
+int main(void)
+{
+    test_button();
+    test_wire_cut();
+    test_glitch_burst();
+    if (failures) {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("All debounce checks passed\n");
+    return 0;
+}
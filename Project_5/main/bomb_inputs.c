@@ -0,0 +1,101 @@
+/* Arm / pause / defuse inputs
+ *
+ * Pins interrupt on both edges so the debounce sees every bounce; the
+ * level is read back from GPIO_IN right after the edge. Timestamps come
+ * from esp_timer, which is safe to read from an IRAM ISR.
+ */
+#include <string.h>
+#include "esp_timer.h"
+#include "esp_cpu.h"
+#include "esp_attr.h"
+#include "esp_intr_alloc.h"
+#include "esp_log.h"
+#include "soc/soc.h"
+#include "soc/gpio_reg.h"
+#include "debounce.h"
+#include "bomb_inputs.h"
+
+static const char *TAG = "INPUTS";
+
+static bomb_inputs_config_t inputs;
+static debounce_t debounce[BOMB_INPUT_COUNT];
+static bomb_inputs_stats_t stats;
+static portMUX_TYPE inputs_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static IRAM_ATTR void input_isr(void *arg)
+{
+    uint32_t start = esp_cpu_get_cycle_count();
+    bomb_input_t input = (bomb_input_t)(intptr_t)arg;
+    uint64_t now = esp_timer_get_time();
+    gpio_num_t pin = inputs.pins[input];
+    bool level = (pin < 32) ? (REG_READ(GPIO_IN_REG) >> pin) & 1 : (REG_READ(GPIO_IN1_REG) >> (pin - 32)) & 1;
+
+    portENTER_CRITICAL_ISR(&inputs_lock);
+    stats.edges[input]++;
+    bool activated = debounce_edge(&debounce[input], now, level);
+    if (activated) {
+        stats.activations[input]++;
+    }
+    portEXIT_CRITICAL_ISR(&inputs_lock);
+
+    bool woken = false;
+    if (activated && inputs.callback) {
+        woken = inputs.callback(input, start, inputs.ctx);
+    }
+
+    uint32_t cycles = esp_cpu_get_cycle_count() - start;
+    portENTER_CRITICAL_ISR(&inputs_lock);
+    if (cycles > stats.max_isr_cycles) {
+        stats.max_isr_cycles = cycles;
+    }
+    portEXIT_CRITICAL_ISR(&inputs_lock);
+    if (woken) {
+        portYIELD_FROM_ISR();
+    }
+}
+
+esp_err_t bomb_inputs_init(const bomb_inputs_config_t *config)
+{
+    if (config == NULL || config->callback == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    inputs = *config;
+    memset(&stats, 0, sizeof(stats));
+
+    uint64_t pin_mask = 0;
+    for (int i = 0; i < BOMB_INPUT_COUNT; i++) {
+        if (!GPIO_IS_VALID_GPIO(config->pins[i])) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        pin_mask |= 1ULL << config->pins[i];
+        debounce_init(&debounce[i], config->quiet_us, config->active_level[i]);
+    }
+    gpio_config_t io_conf = {
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = config->pull_up ? GPIO_PULLUP_ENABLE : GPIO_PULLUP_DISABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_ANYEDGE,
+        .pin_bit_mask = pin_mask
+    };
+    ESP_ERROR_CHECK(gpio_config(&io_conf));
+
+    // The service may already be installed by another driver
+    esp_err_t ret = gpio_install_isr_service(ESP_INTR_FLAG_IRAM);
+    if (ret != ESP_OK && ret != ESP_ERR_INVALID_STATE) {
+        return ret;
+    }
+    for (int i = 0; i < BOMB_INPUT_COUNT; i++) {
+        ESP_ERROR_CHECK(gpio_isr_handler_add(config->pins[i], input_isr, (void *)(intptr_t)i));
+    }
+    ESP_LOGI(TAG, "Arm GPIO%d, pause GPIO%d, defuse GPIO%d, debounce %lu us",
+             config->pins[BOMB_INPUT_ARM], config->pins[BOMB_INPUT_PAUSE],
+             config->pins[BOMB_INPUT_DEFUSE], (unsigned long)config->quiet_us);
+    return ESP_OK;
+}
+
+void bomb_inputs_get_stats(bomb_inputs_stats_t *out)
+{
+    portENTER_CRITICAL(&inputs_lock);
+    *out = stats;
+    portEXIT_CRITICAL(&inputs_lock);
+}
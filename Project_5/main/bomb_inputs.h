@@ -0,0 +1,42 @@
+/* Arm / pause / defuse inputs
+ * Each input has its own GPIO ISR: the edge is timestamped, filtered by
+ * the timestamp debounce (debounce.h) and, if it is an activation, handed
+ * to the callback while still in the ISR so the countdown can react
+ * without waiting for a task switch.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "driver/gpio.h"
+
+typedef enum {
+    BOMB_INPUT_ARM,
+    BOMB_INPUT_PAUSE,           // Toggles pause / resume
+    BOMB_INPUT_DEFUSE,          // Wire cut
+    BOMB_INPUT_COUNT
+} bomb_input_t;
+
+// Runs in the GPIO ISR; edge_cycles is the CPU cycle count at ISR entry.
+// Return true if a higher-priority task was woken.
+typedef bool (*bomb_input_cb_t)(bomb_input_t input, uint32_t edge_cycles, void *ctx);
+
+typedef struct {
+    gpio_num_t pins[BOMB_INPUT_COUNT];
+    bool active_level[BOMB_INPUT_COUNT];    // Level once pressed / cut
+    bool pull_up;               // Internal pull-ups (not on GPIO34-39)
+    uint32_t quiet_us;          // Debounce: line quiet time before an edge counts
+    bomb_input_cb_t callback;
+    void *ctx;
+} bomb_inputs_config_t;
+
+typedef struct {
+    uint32_t edges[BOMB_INPUT_COUNT];
+    uint32_t activations[BOMB_INPUT_COUNT];
+    uint32_t max_isr_cycles;
+} bomb_inputs_stats_t;
+
+esp_err_t bomb_inputs_init(const bomb_inputs_config_t *config);
+void bomb_inputs_get_stats(bomb_inputs_stats_t *stats);
@@ -0,0 +1,116 @@
+/* Countdown timeline
+ */
+#include <string.h>
+#include "countdown.h"
+
+#define NONE    UINT64_MAX
+
+bool countdown_init(countdown_iter_t *iter, const countdown_config_t *config)
+{
+    if (config->total_ms == 0 || config->tick_interval_ms == 0 || config->num_leds == 0 ||
+        config->urgent_ms > config->total_ms ||
+        (config->urgent_ms > 0 && config->urgent_interval_ms == 0) ||
+        (config->explosion_ms > 0 && config->flash_interval_ms == 0)) {
+        return false;
+    }
+    // A beep must end before the next tick starts
+    if (config->tick_sound_ms >= config->tick_interval_ms ||
+        (config->urgent_ms > 0 && config->tick_sound_ms >= config->urgent_interval_ms)) {
+        return false;
+    }
+    memset(iter, 0, sizeof(*iter));
+    iter->config = *config;
+    iter->tick_off_us = NONE;
+    iter->leds = config->num_leds;
+    return true;
+}
+
+// LEDs still lit with t_us elapsed: remaining share of the countdown, rounded up
+static uint8_t leds_at(const countdown_config_t *config, uint64_t t_us)
+{
+    uint64_t total_us = (uint64_t)config->total_ms * 1000;
+    uint64_t remaining = total_us - t_us;
+    return (uint8_t)((remaining * config->num_leds + total_us - 1) / total_us);
+}
+
+static void emit(countdown_event_t *event, uint64_t at_us, countdown_action_t action, uint8_t leds)
+{
+    event->at_us = at_us;
+    event->action = action;
+    event->leds = leds;
+    event->urgent = false;
+}
+
+bool countdown_next(countdown_iter_t *iter, countdown_event_t *event)
+{
+    const countdown_config_t *config = &iter->config;
+    uint64_t total_us = (uint64_t)config->total_ms * 1000;
+    uint64_t urgent_start_us = total_us - (uint64_t)config->urgent_ms * 1000;
+
+    if (iter->done) {
+        return false;
+    }
+
+    if (!iter->exploding) {
+        // Beep ending before the next tick or the explosion
+        if (iter->tick_off_us <= iter->next_tick_us && iter->tick_off_us < total_us) {
+            emit(event, iter->tick_off_us, COUNTDOWN_TICK_OFF, iter->leds);
+            iter->tick_off_us = NONE;
+            return true;
+        }
+        if (iter->next_tick_us < total_us) {
+            uint64_t t = iter->next_tick_us;
+            iter->leds = leds_at(config, t);
+            emit(event, t, COUNTDOWN_TICK_ON, iter->leds);
+            if (!iter->urgent && t >= urgent_start_us) {
+                iter->urgent = true;
+                event->urgent = true;
+            }
+            iter->tick_off_us = t + (uint64_t)config->tick_sound_ms * 1000;
+            // Normal ticks stop at the start of the urgent stretch
+            if (iter->urgent) {
+                iter->next_tick_us = t + (uint64_t)config->urgent_interval_ms * 1000;
+            } else {
+                uint64_t next = t + (uint64_t)config->tick_interval_ms * 1000;
+                iter->next_tick_us = next < urgent_start_us ? next : urgent_start_us;
+            }
+            return true;
+        }
+        // The explosion takes over the buzzer from any beep still sounding
+        iter->exploding = true;
+        iter->tick_off_us = NONE;
+        iter->flash_on = true;
+        iter->leds = config->num_leds;
+        iter->next_flash_us = total_us + (uint64_t)config->flash_interval_ms * 1000;
+        emit(event, total_us, COUNTDOWN_EXPLODE, iter->leds);
+        return true;
+    }
+
+    uint64_t end_us = total_us + (uint64_t)config->explosion_ms * 1000;
+    if (iter->next_flash_us < end_us) {
+        iter->flash_on = !iter->flash_on;
+        iter->leds = iter->flash_on ? config->num_leds : 0;
+        emit(event, iter->next_flash_us, iter->flash_on ? COUNTDOWN_FLASH_ON : COUNTDOWN_FLASH_OFF, iter->leds);
+        iter->next_flash_us += (uint64_t)config->flash_interval_ms * 1000;
+        return true;
+    }
+    iter->done = true;
+    iter->leds = 0;
+    emit(event, end_us, COUNTDOWN_END, 0);
+    return true;
+}
+
+countdown_step_t countdown_advance(countdown_iter_t *iter, countdown_event_t *event,
+                                   uint64_t start, uint64_t now, uint64_t *alarm_at)
+{
+    if (!countdown_next(iter, event)) {
+        return COUNTDOWN_STEP_DONE;
+    }
+    // Re-arm on the absolute timeline unless the next event is already due
+    uint64_t deadline = start + event->at_us;
+    if (deadline > now + COUNTDOWN_MIN_LEAD_US) {
+        *alarm_at = deadline;
+        return COUNTDOWN_STEP_ARM;
+    }
+    return COUNTDOWN_STEP_DUE;
+}
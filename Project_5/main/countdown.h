@@ -0,0 +1,70 @@
+/* Countdown timeline
+ * The whole countdown as a stream of events at absolute times (us from
+ * arming): tick beeps on/off with the LED count, the switch to urgent
+ * ticks, the explosion with its LED flashes, and the end. Times come from
+ * the configuration alone, never from when earlier events actually ran,
+ * so lateness of one event cannot shift the next. Plain C with no ESP-IDF
+ * dependencies.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef enum {
+    COUNTDOWN_TICK_ON,          // Beep on, show `leds`
+    COUNTDOWN_TICK_OFF,
+    COUNTDOWN_EXPLODE,          // Explosion tone on, all LEDs on
+    COUNTDOWN_FLASH_ON,
+    COUNTDOWN_FLASH_OFF,
+    COUNTDOWN_END               // Tone and LEDs off; no further events
+} countdown_action_t;
+
+typedef struct {
+    uint64_t at_us;
+    countdown_action_t action;
+    uint8_t leds;               // LEDs lit from this event on
+    bool urgent;                // First tick of the accelerated stretch
+} countdown_event_t;
+
+typedef struct {
+    uint32_t total_ms;          // Arming to explosion
+    uint32_t tick_interval_ms;
+    uint32_t urgent_ms;         // Final stretch with accelerated ticks
+    uint32_t urgent_interval_ms;
+    uint32_t tick_sound_ms;     // Shorter than both intervals
+    uint32_t explosion_ms;
+    uint32_t flash_interval_ms;
+    uint8_t num_leds;
+} countdown_config_t;
+
+typedef struct {
+    countdown_config_t config;
+    uint64_t next_tick_us;
+    uint64_t tick_off_us;       // UINT64_MAX when no beep is sounding
+    uint64_t next_flash_us;
+    uint8_t leds;
+    bool urgent;
+    bool exploding;
+    bool flash_on;
+    bool done;
+} countdown_iter_t;
+
+#define COUNTDOWN_MIN_LEAD_US   5       // Closer deadlines are applied right away
+
+// What the timer ISR does after countdown_advance()
+typedef enum {
+    COUNTDOWN_STEP_DUE,         // Next event already due: apply it in this run
+    COUNTDOWN_STEP_ARM,         // Arm the alarm at *alarm_at
+    COUNTDOWN_STEP_DONE         // COUNTDOWN_END was applied; nothing follows
+} countdown_step_t;
+
+// Rejects tick_sound_ms not shorter than the tick (and urgent) interval
+bool countdown_init(countdown_iter_t *iter, const countdown_config_t *config);
+// Next event in time order; returns false after COUNTDOWN_END
+bool countdown_next(countdown_iter_t *iter, countdown_event_t *event);
+// Catch-up step of a timeline armed at timer count `start`, once *event
+// has been applied at count `now`: loads the next event into *event and
+// says whether to apply it straight away or arm for start + its time
+countdown_step_t countdown_advance(countdown_iter_t *iter, countdown_event_t *event,
+                                   uint64_t start, uint64_t now, uint64_t *alarm_at);
@@ -0,0 +1,344 @@
+/* Hardware-timed countdown
+ *
+ * The GPTimer free-runs at 1 MHz from init. Arming records a start count;
+ * each alarm applies the due event, pulls the next one from the timeline
+ * and arms the alarm at start + event time. An event that is already due
+ * (the ISR ran late) is applied in the same ISR run instead of being
+ * re-armed, so lateness never accumulates along the timeline. That
+ * decision is countdown_advance() in countdown.c, which the host test
+ * runs too.
+ *
+ * Pausing disarms the alarm and remembers the count; resuming moves the
+ * start count forward by the pause length, which shifts every remaining
+ * deadline at once.
+ */
+#include <string.h>
+#include "driver/gptimer.h"
+#include "hal/ledc_ll.h"
+#include "esp_cpu.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "soc/soc.h"
+#include "soc/gpio_reg.h"
+#include "countdown_timer.h"
+
+static const char *TAG = "COUNTDOWN";
+
+#define START_DELAY_US  1000        // Arming to the first event
+
+static gptimer_handle_t countdown_timer = NULL;
+static countdown_outputs_t outputs;
+static uint32_t led_masks[33];      // GPIO_OUT bits with the first n LEDs lit
+static uint32_t tick_divider, explosion_divider;
+
+static countdown_iter_t iter;
+static countdown_event_t next_event;
+static uint64_t start_count;
+static TaskHandle_t notify_task;
+static volatile bool running = false;
+static volatile bool paused = false;
+static volatile bool defused = false;
+static uint64_t pause_count;        // Frozen timeline position while paused or defused
+static uint32_t tone_divider;       // Pitch of the sounding tone, 0 = silent
+
+static countdown_timer_stats_t stats;
+static portMUX_TYPE countdown_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static IRAM_ATTR void set_tone(uint32_t divider, uint32_t duty)
+{
+    ledc_dev_t *hw = LEDC_LL_GET_HW();
+    if (divider) {
+        ledc_ll_set_clock_divider(hw, outputs.speed_mode, outputs.timer_num, divider);
+        ledc_ll_ls_timer_update(hw, outputs.speed_mode, outputs.timer_num);
+    }
+    ledc_ll_set_duty_int_part(hw, outputs.speed_mode, outputs.channel, duty);
+    ledc_ll_set_duty_direction(hw, outputs.speed_mode, outputs.channel, LEDC_DUTY_DIR_INCREASE);
+    ledc_ll_set_duty_num(hw, outputs.speed_mode, outputs.channel, 1);
+    ledc_ll_set_duty_cycle(hw, outputs.speed_mode, outputs.channel, 1);
+    ledc_ll_set_duty_scale(hw, outputs.speed_mode, outputs.channel, 0);
+    ledc_ll_set_duty_start(hw, outputs.speed_mode, outputs.channel, true);
+    ledc_ll_ls_channel_update(hw, outputs.speed_mode, outputs.channel);
+}
+
+static IRAM_ATTR void apply_event(const countdown_event_t *event)
+{
+    uint32_t lit = led_masks[event->leds];
+    uint32_t dark = led_masks[outputs.num_leds] & ~lit;
+    if (lit) {
+        REG_WRITE(GPIO_OUT_W1TS_REG, lit);
+    }
+    if (dark) {
+        REG_WRITE(GPIO_OUT_W1TC_REG, dark);
+    }
+
+    switch (event->action) {
+        case COUNTDOWN_TICK_ON:
+            tone_divider = tick_divider;
+            set_tone(tone_divider, outputs.duty);
+            break;
+        case COUNTDOWN_EXPLODE:
+            tone_divider = explosion_divider;
+            set_tone(tone_divider, outputs.duty);
+            break;
+        case COUNTDOWN_TICK_OFF:
+        case COUNTDOWN_END:
+            tone_divider = 0;
+            set_tone(0, 0);
+            break;
+        default:
+            break;
+    }
+}
+
+static IRAM_ATTR bool countdown_isr(gptimer_handle_t timer, const gptimer_alarm_event_data_t *edata, void *user_ctx)
+{
+    uint32_t start = esp_cpu_get_cycle_count();
+    uint32_t notify = 0;
+
+    portENTER_CRITICAL_ISR(&countdown_lock);
+    // A pause from another ISR may land while this alarm is pending
+    while (running && !paused) {
+        uint64_t deadline = start_count + next_event.at_us;
+        apply_event(&next_event);
+        uint64_t now = deadline;
+        gptimer_get_raw_count(timer, &now);
+
+        uint32_t late = (uint32_t)(now > deadline ? now - deadline : 0);
+        stats.events++;
+        stats.total_late_us += late;
+        if (late > stats.max_late_us) {
+            stats.max_late_us = late;
+        }
+        if (next_event.urgent) {
+            notify |= COUNTDOWN_NOTIFY_URGENT;
+        }
+        if (next_event.action == COUNTDOWN_EXPLODE) {
+            stats.explode_late_us = late;
+            notify |= COUNTDOWN_NOTIFY_EXPLODE;
+        }
+
+        uint64_t alarm_at = 0;
+        countdown_step_t step = countdown_advance(&iter, &next_event, start_count, now, &alarm_at);
+        if (step == COUNTDOWN_STEP_DONE) {
+            running = false;
+            notify |= COUNTDOWN_NOTIFY_END;
+            break;
+        }
+        if (step == COUNTDOWN_STEP_ARM) {
+            gptimer_alarm_config_t alarm = {
+                .alarm_count = alarm_at
+            };
+            gptimer_set_alarm_action(timer, &alarm);
+            break;
+        }
+    }
+
+    uint32_t cycles = esp_cpu_get_cycle_count() - start;
+    stats.isr_runs++;
+    if (cycles > stats.max_cycles) {
+        stats.max_cycles = cycles;
+    }
+    portEXIT_CRITICAL_ISR(&countdown_lock);
+
+    BaseType_t woken = pdFALSE;
+    if (notify && notify_task) {
+        xTaskNotifyFromISR(notify_task, notify, eSetBits, &woken);
+    }
+    return woken == pdTRUE;
+}
+
+static uint32_t divider_q8(uint32_t hz)
+{
+    // ESP32 LEDC divider: Q10.8 of clk / (freq << duty bits)
+    return (uint32_t)(((uint64_t)COUNTDOWN_LEDC_CLK_HZ << 8) / ((uint64_t)hz << outputs.duty_resolution));
+}
+
+static bool divider_ok(uint32_t divider)
+{
+    // Register holds 1.0 .. 1023.996 (18 bits, Q10.8)
+    return divider >= (1u << 8) && divider < (1u << 18);
+}
+
+esp_err_t countdown_timer_init(const countdown_outputs_t *config)
+{
+    if (config == NULL || config->num_leds == 0 || config->num_leds >= 33 ||
+        config->tick_hz == 0 || config->explosion_hz == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (countdown_timer != NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    outputs = *config;
+
+    led_masks[0] = 0;
+    for (int i = 0; i < config->num_leds; i++) {
+        if (config->led_pins[i] >= 32) {
+            ESP_LOGE(TAG, "LED pin GPIO%d must be below GPIO32", config->led_pins[i]);
+            return ESP_ERR_INVALID_ARG;
+        }
+        led_masks[i + 1] = led_masks[i] | (1u << config->led_pins[i]);
+    }
+    tick_divider = divider_q8(config->tick_hz);
+    explosion_divider = divider_q8(config->explosion_hz);
+    if (!divider_ok(tick_divider) || !divider_ok(explosion_divider)) {
+        ESP_LOGE(TAG, "Tone out of divider range at %lu-bit duty (tick %lu Hz, explosion %lu Hz)",
+                 (unsigned long)config->duty_resolution, (unsigned long)config->tick_hz,
+                 (unsigned long)config->explosion_hz);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    gptimer_config_t timer_config = {
+        .clk_src = GPTIMER_CLK_SRC_DEFAULT,
+        .direction = GPTIMER_COUNT_UP,
+        .resolution_hz = COUNTDOWN_TIMER_HZ
+    };
+    ESP_ERROR_CHECK(gptimer_new_timer(&timer_config, &countdown_timer));
+    gptimer_event_callbacks_t callbacks = {
+        .on_alarm = countdown_isr
+    };
+    ESP_ERROR_CHECK(gptimer_register_event_callbacks(countdown_timer, &callbacks, NULL));
+    ESP_ERROR_CHECK(gptimer_enable(countdown_timer));
+    ESP_LOGI(TAG, "Timeline timer ready, tick %lu Hz, explosion %lu Hz",
+             (unsigned long)config->tick_hz, (unsigned long)config->explosion_hz);
+    return gptimer_start(countdown_timer);
+}
+
+esp_err_t countdown_timer_start(const countdown_config_t *config, TaskHandle_t task)
+{
+    if (countdown_timer == NULL || running) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (config->num_leds > outputs.num_leds) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    countdown_iter_t timeline;
+    countdown_event_t first;
+    if (!countdown_init(&timeline, config) || !countdown_next(&timeline, &first)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint64_t now = 0;
+    ESP_ERROR_CHECK(gptimer_get_raw_count(countdown_timer, &now));
+
+    portENTER_CRITICAL(&countdown_lock);
+    iter = timeline;
+    next_event = first;
+    paused = false;
+    defused = false;
+    tone_divider = 0;
+    notify_task = task;
+    start_count = now + START_DELAY_US;
+    memset(&stats, 0, sizeof(stats));
+    running = true;
+    gptimer_alarm_config_t alarm = {
+        .alarm_count = start_count + first.at_us
+    };
+    gptimer_set_alarm_action(countdown_timer, &alarm);
+    portEXIT_CRITICAL(&countdown_lock);
+
+    ESP_LOGI(TAG, "Armed: %lu ms to explosion", (unsigned long)config->total_ms);
+    return ESP_OK;
+}
+
+int64_t countdown_timer_elapsed_us(void)
+{
+    uint64_t now = 0;
+    if (countdown_timer == NULL || gptimer_get_raw_count(countdown_timer, &now) != ESP_OK) {
+        return 0;
+    }
+    portENTER_CRITICAL(&countdown_lock);
+    if (paused || defused) {
+        now = pause_count;
+    }
+    int64_t elapsed = (int64_t)(now - start_count);
+    portEXIT_CRITICAL(&countdown_lock);
+    return elapsed;
+}
+
+IRAM_ATTR bool countdown_timer_is_paused(void)
+{
+    return paused;
+}
+
+IRAM_ATTR bool countdown_timer_pause_from_isr(uint32_t *effect_cycles, BaseType_t *woken)
+{
+    portENTER_CRITICAL_SAFE(&countdown_lock);
+    if (!running || paused) {
+        portEXIT_CRITICAL_SAFE(&countdown_lock);
+        return false;
+    }
+    set_tone(0, 0);
+    *effect_cycles = esp_cpu_get_cycle_count();
+    gptimer_get_raw_count(countdown_timer, &pause_count);
+    gptimer_set_alarm_action(countdown_timer, NULL);
+    paused = true;
+    stats.pauses++;
+    portEXIT_CRITICAL_SAFE(&countdown_lock);
+
+    if (notify_task) {
+        xTaskNotifyFromISR(notify_task, COUNTDOWN_NOTIFY_PAUSED, eSetBits, woken);
+    }
+    return true;
+}
+
+IRAM_ATTR bool countdown_timer_resume_from_isr(uint32_t *effect_cycles, BaseType_t *woken)
+{
+    portENTER_CRITICAL_SAFE(&countdown_lock);
+    if (!running || !paused) {
+        portEXIT_CRITICAL_SAFE(&countdown_lock);
+        return false;
+    }
+    uint64_t now = pause_count;
+    gptimer_get_raw_count(countdown_timer, &now);
+    start_count += now - pause_count;
+    stats.paused_us += now - pause_count;
+    paused = false;
+    if (tone_divider) {
+        set_tone(tone_divider, outputs.duty);
+    }
+    *effect_cycles = esp_cpu_get_cycle_count();
+    uint64_t deadline = start_count + next_event.at_us;
+    gptimer_alarm_config_t alarm = {
+        .alarm_count = deadline > now + COUNTDOWN_MIN_LEAD_US ? deadline : now + COUNTDOWN_MIN_LEAD_US
+    };
+    gptimer_set_alarm_action(countdown_timer, &alarm);
+    portEXIT_CRITICAL_SAFE(&countdown_lock);
+
+    if (notify_task) {
+        xTaskNotifyFromISR(notify_task, COUNTDOWN_NOTIFY_RESUMED, eSetBits, woken);
+    }
+    return true;
+}
+
+IRAM_ATTR bool countdown_timer_defuse_from_isr(uint32_t *effect_cycles, BaseType_t *woken)
+{
+    portENTER_CRITICAL_SAFE(&countdown_lock);
+    if (!running) {
+        portEXIT_CRITICAL_SAFE(&countdown_lock);
+        return false;
+    }
+    tone_divider = 0;
+    set_tone(0, 0);
+    REG_WRITE(GPIO_OUT_W1TC_REG, led_masks[outputs.num_leds]);
+    *effect_cycles = esp_cpu_get_cycle_count();
+    gptimer_set_alarm_action(countdown_timer, NULL);
+    if (!paused) {
+        gptimer_get_raw_count(countdown_timer, &pause_count);
+    }
+    running = false;
+    paused = false;
+    defused = true;
+    portEXIT_CRITICAL_SAFE(&countdown_lock);
+
+    if (notify_task) {
+        xTaskNotifyFromISR(notify_task, COUNTDOWN_NOTIFY_DEFUSED, eSetBits, woken);
+    }
+    return true;
+}
+
+void countdown_timer_get_stats(countdown_timer_stats_t *out)
+{
+    portENTER_CRITICAL(&countdown_lock);
+    *out = stats;
+    portEXIT_CRITICAL(&countdown_lock);
+}
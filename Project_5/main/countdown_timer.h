@@ -0,0 +1,69 @@
+/* Hardware-timed countdown
+ * Plays a countdown timeline (countdown.h) from a GPTimer ISR. Every event
+ * is armed at an absolute timer count (start + event time), so beeps, LED
+ * updates and phase changes stay on the planned timeline however long the
+ * previous event took to run. LEDs are switched with one W1TS and one W1TC
+ * write; the buzzer tone and pitch are written through the LEDC LL layer.
+ * Pause, resume and defuse are callable from other ISRs and take effect
+ * before they return.
+ */
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "driver/gpio.h"
+#include "driver/ledc.h"
+#include "countdown.h"
+
+#define COUNTDOWN_TIMER_HZ      1000000
+#define COUNTDOWN_LEDC_CLK_HZ   80000000    // LEDC timer must use the APB clock
+
+// Task notification bits sent to the task passed to countdown_timer_start()
+#define COUNTDOWN_NOTIFY_URGENT     (1 << 0)
+#define COUNTDOWN_NOTIFY_EXPLODE    (1 << 1)
+#define COUNTDOWN_NOTIFY_END        (1 << 2)
+#define COUNTDOWN_NOTIFY_PAUSED     (1 << 3)
+#define COUNTDOWN_NOTIFY_RESUMED    (1 << 4)
+#define COUNTDOWN_NOTIFY_DEFUSED    (1 << 5)
+
+typedef struct {
+    const gpio_num_t *led_pins;     // Below GPIO32, first LED lit longest
+    uint8_t num_leds;
+    ledc_mode_t speed_mode;
+    ledc_timer_t timer_num;
+    ledc_channel_t channel;
+    uint32_t duty_resolution;       // Bits, as configured on the LEDC timer
+    uint32_t duty;
+    uint32_t tick_hz;
+    uint32_t explosion_hz;
+} countdown_outputs_t;
+
+typedef struct {
+    uint32_t events;
+    uint32_t isr_runs;              // Less than events when late events were caught up
+    uint64_t total_late_us;         // Applied minus deadline
+    uint32_t max_late_us;
+    uint32_t explode_late_us;       // Lateness of the explosion itself
+    uint32_t max_cycles;
+    uint32_t pauses;
+    uint64_t paused_us;             // Total time the timeline stood still
+} countdown_timer_stats_t;
+
+esp_err_t countdown_timer_init(const countdown_outputs_t *outputs);
+// Arms the countdown; returns ESP_ERR_INVALID_STATE while one is running
+esp_err_t countdown_timer_start(const countdown_config_t *config, TaskHandle_t notify_task);
+// Timeline time since arming; stands still while paused
+int64_t countdown_timer_elapsed_us(void);
+bool countdown_timer_is_paused(void);
+
+// ISR-safe. Each returns false if it had nothing to act on; otherwise
+// effect_cycles gets the CPU cycle count once the outputs were changed.
+// Pause silences the buzzer and freezes the LEDs and the timeline.
+bool countdown_timer_pause_from_isr(uint32_t *effect_cycles, BaseType_t *woken);
+// Shifts every remaining deadline by the time spent paused
+bool countdown_timer_resume_from_isr(uint32_t *effect_cycles, BaseType_t *woken);
+// Stops the countdown for good: buzzer and LEDs off
+bool countdown_timer_defuse_from_isr(uint32_t *effect_cycles, BaseType_t *woken);
+void countdown_timer_get_stats(countdown_timer_stats_t *stats);
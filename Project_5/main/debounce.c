@@ -0,0 +1,19 @@
+/* Timestamp debounce
+ */
+#include "debounce.h"
+
+void debounce_init(debounce_t *debounce, uint32_t quiet_us, bool active_level)
+{
+    debounce->quiet_us = quiet_us;
+    debounce->active_level = active_level;
+    debounce->seen = false;
+    debounce->last_edge_us = 0;
+}
+
+bool debounce_edge(debounce_t *debounce, uint64_t now_us, bool level)
+{
+    bool quiet = !debounce->seen || now_us - debounce->last_edge_us >= debounce->quiet_us;
+    debounce->seen = true;
+    debounce->last_edge_us = now_us;
+    return quiet && level == debounce->active_level;
+}
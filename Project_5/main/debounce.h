@@ -0,0 +1,22 @@
+/* Timestamp debounce
+ * An edge counts only if the line had been quiet (no edges at all) for
+ * quiet_us before it and it lands on the active level. The first edge of a
+ * press is accepted the moment it happens; the rest of its bounce burst,
+ * and any glitch inside the release bounce, follows too closely to count.
+ * Plain C with no ESP-IDF dependencies.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct {
+    uint32_t quiet_us;
+    bool active_level;
+    bool seen;                  // Any edge yet
+    uint64_t last_edge_us;
+} debounce_t;
+
+void debounce_init(debounce_t *debounce, uint32_t quiet_us, bool active_level);
+// Feed every edge with its timestamp and the level read after it; true = activation
+bool debounce_edge(debounce_t *debounce, uint64_t now_us, bool level);
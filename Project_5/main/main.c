@@ -10,9 +10,21 @@
 #include "esp_timer.h"
 #include "esp_err.h"
 #include "esp_log.h"
+#include "esp_cpu.h"
+#include "esp_attr.h"
+#include "seven_seg.h"
+#include "countdown_timer.h"
+#include "bomb_inputs.h"
+#include "flash_stress.h"
 
 static const char *TAG = "TIME_BOMB";
 
+// Set by idf.py -DQEMU_TEST=1 for the QEMU tests: no buttons there, so the
+// countdown starts without waiting for ARM
+#ifndef QEMU_TEST
+#define QEMU_TEST 0
+#endif
+
 // Pin definitions - Array of 5 LEDs [web:44][page:6]
 #define NUM_LEDS 5
 static const gpio_num_t led_pins[NUM_LEDS] = {
@@ -39,6 +51,69 @@ static const gpio_num_t led_pins[NUM_LEDS] = {
 #define EXPLOSION_FREQUENCY     100     // Low rumbling explosion sound (Hz)
 #define EXPLOSION_DURATION      2000    // Explosion effect duration (ms)
 #define FLASH_INTERVAL          100     // LED flash interval during explosion (ms)
+#define TICK_SOUND_MS           100     // Tick beep length (ms)
+
+// Countdown on a fixed GPTimer timeline instead of blocking beeps and delays
+#define HW_TIMER_COUNTDOWN      1
+#define COUNTDOWN_MS            5000    // Arming to explosion
+#define URGENT_MS               1200    // Accelerated ticks before the explosion
+
+#if HW_TIMER_COUNTDOWN
+#define COUNTDOWN_TOTAL_MS      COUNTDOWN_MS
+#else
+// Planned length of both countdown phases (ticks plus waits)
+#define COUNTDOWN_TOTAL_MS      ((NUM_LEDS - 1) * TICK_SOUND_MS + (NUM_LEDS - 2) * INITIAL_TICK_INTERVAL + \
+                                 TICK_SOUND_MS + 5 * (ACCELERATED_TICK_INTERVAL + TICK_SOUND_MS))
+#endif
+
+// Arm, pause/resume and defuse inputs, handled in their GPIO ISRs (needs HW_TIMER_COUNTDOWN).
+// GPIO34-39 have no internal pull-ups: fit 10k pull-ups. Buttons pull low,
+// the defuse wire holds its pin low until cut.
+#define INPUTS_ENABLE           (!QEMU_TEST)
+#define ARM_PIN                 GPIO_NUM_34
+#define PAUSE_PIN               GPIO_NUM_35
+#define DEFUSE_PIN              GPIO_NUM_39
+#define DEBOUNCE_QUIET_US       20000
+#define INPUT_NOTIFY_ARM        (1 << 8)    // Next to the COUNTDOWN_NOTIFY_* bits
+// Drive the pause input from a loopback pin and log input-to-effect latency.
+// Every free output pin left is a strapping pin, so the bench borrows the
+// display's fourth digit (GPIO33) and runs without the display
+#define INPUT_BENCH             0
+#define BENCH_LOOPBACK_PIN      GPIO_NUM_33
+#define BENCH_PRESSES           20
+
+// 4-digit multiplexed 7-segment display showing the remaining time
+#define DISPLAY_ENABLE          (!INPUT_BENCH)
+#define DISPLAY_UPDATE_MS       10
+static const seven_seg_config_t display_pins = {
+    .segment_pins = { GPIO_NUM_13, GPIO_NUM_14, GPIO_NUM_16, GPIO_NUM_17,   // a b c d
+                      GPIO_NUM_21, GPIO_NUM_22, GPIO_NUM_23, GPIO_NUM_25 }, // e f g dp
+    .digit_pins = { GPIO_NUM_26, GPIO_NUM_27, GPIO_NUM_32, GPIO_NUM_33 }
+};
+
+// Erase/write the NVS partition (unused here) without a break while the
+// countdown runs. Every operation turns the flash cache off; the timeline
+// lateness and display ISR period in the stats show whether outputs stalled.
+#define FLASH_STRESS            0
+#define FLASH_STRESS_SECTOR     4096
+#define FLASH_STRESS_PAGE       256
+
+typedef enum {
+    DISPLAY_ARMED,
+    DISPLAY_COUNTDOWN,
+    DISPLAY_EXPLOSION,
+    DISPLAY_DEFUSED,
+    DISPLAY_OFF
+} DisplayMode;
+
+static volatile DisplayMode display_mode = DISPLAY_OFF;
+static volatile int64_t countdown_end_us;
+
+// Input edge (ISR entry, or loopback write in the bench) to outputs changed
+static TaskHandle_t main_task;
+static volatile uint32_t bench_write_cycles;
+static volatile uint32_t latency_count, latency_max_cycles;
+static volatile uint64_t latency_total_cycles;
 
 // Countdown phases
 typedef enum {
@@ -61,6 +136,12 @@ void flash_all_leds(int times, int interval_ms);
 void beep(int frequency, int duration_ms);
 void tick_sound(void);
 void explosion_sound(void);
+bool run_timed_countdown(void);
+bool on_bomb_input(bomb_input_t input, uint32_t edge_cycles, void *ctx);
+void log_input_latency(void);
+void input_bench(void);
+void display_task(void *arg);
+void log_display_stats(int64_t window_us);
 
 void app_main(void)
 {
@@ -73,14 +154,70 @@ void app_main(void)
     // Initialize hardware
     init_leds();
     init_buzzer();
+#if HW_TIMER_COUNTDOWN
+    countdown_outputs_t outputs = {
+        .led_pins = led_pins,
+        .num_leds = NUM_LEDS,
+        .speed_mode = LEDC_MODE,
+        .timer_num = LEDC_TIMER,
+        .channel = LEDC_BUZZER_CHANNEL,
+        .duty_resolution = LEDC_DUTY_RES,
+        .duty = LEDC_DUTY,
+        .tick_hz = TICK_FREQUENCY,
+        .explosion_hz = EXPLOSION_FREQUENCY
+    };
+    ESP_ERROR_CHECK(countdown_timer_init(&outputs));
+#endif
+#if HW_TIMER_COUNTDOWN && INPUTS_ENABLE
+    main_task = xTaskGetCurrentTaskHandle();
+    bomb_inputs_config_t inputs = {
+        .pins = { ARM_PIN, INPUT_BENCH ? BENCH_LOOPBACK_PIN : PAUSE_PIN, DEFUSE_PIN },
+        .active_level = { 0, 0, 1 },
+        .pull_up = false,
+        .quiet_us = DEBOUNCE_QUIET_US,
+        .callback = on_bomb_input
+    };
+    ESP_ERROR_CHECK(bomb_inputs_init(&inputs));
+#endif
+#if DISPLAY_ENABLE
+    ESP_ERROR_CHECK(seven_seg_init(&display_pins));
+    xTaskCreate(display_task, "display", 2048, NULL, 5, NULL);
+    int64_t stats_start = esp_timer_get_time();
+#endif
+#if HW_TIMER_COUNTDOWN && INPUTS_ENABLE && INPUT_BENCH
+    input_bench();
+#endif
+#if FLASH_STRESS
+    ESP_ERROR_CHECK(flash_stress_start());
+#endif
     
     while(1) {
         // Phase 1: Setup - All LEDs ON
         ESP_LOGI(TAG, "PHASE: Setup");
         setup_phase();
         
+#if HW_TIMER_COUNTDOWN
+#if INPUTS_ENABLE
+        ESP_LOGI(TAG, "Waiting for ARM");
+        // Drop an ARM press that landed during the last countdown or setup,
+        // so only a press from here on arms the next one
+        xTaskNotifyStateClear(NULL);
+        ulTaskNotifyValueClear(NULL, UINT32_MAX);
+        uint32_t bits = 0;
+        while (!(bits & INPUT_NOTIFY_ARM)) {
+            xTaskNotifyWait(0, UINT32_MAX, &bits, portMAX_DELAY);
+        }
+#endif
+        // Phases 2-4 on one timeline
+        bool defused = !run_timed_countdown();
+#if INPUTS_ENABLE
+        log_input_latency();
+#endif
+#else
         // Phase 2: Normal countdown (5 LEDs → 2 LEDs)
         ESP_LOGI(TAG, "PHASE: Normal Countdown");
+        countdown_end_us = esp_timer_get_time() + COUNTDOWN_TOTAL_MS * 1000LL;
+        display_mode = DISPLAY_COUNTDOWN;
         countdown_phase(NUM_LEDS - 1, 1, INITIAL_TICK_INTERVAL);
         
         // Phase 3: Accelerated countdown (Last LED)
@@ -89,11 +226,30 @@ void app_main(void)
         
         // Phase 4: Explosion
         ESP_LOGI(TAG, "PHASE: EXPLOSION!");
+        display_mode = DISPLAY_EXPLOSION;
         explosion_phase();
+#endif
+#if HW_TIMER_COUNTDOWN
+        // A defused countdown stays frozen on the display until the reset
+        if (!defused) {
+            display_mode = DISPLAY_OFF;
+        }
+#else
+        display_mode = DISPLAY_OFF;
+#endif
+#if DISPLAY_ENABLE
+        log_display_stats(esp_timer_get_time() - stats_start);
+        seven_seg_reset_stats();
+        stats_start = esp_timer_get_time();
+#endif
+#if FLASH_STRESS
+        flash_stress_log();
+#endif
         
         // Wait before restarting
         ESP_LOGI(TAG, "Resetting in 3 seconds...\n");
         vTaskDelay(pdMS_TO_TICKS(3000));
+        display_mode = DISPLAY_OFF;
     }
 }
 
@@ -127,7 +283,7 @@ void init_buzzer(void)
         .timer_num        = LEDC_TIMER,
         .duty_resolution  = LEDC_DUTY_RES,
         .freq_hz          = TICK_FREQUENCY,
-        .clk_cfg          = LEDC_AUTO_CLK
+        .clk_cfg          = LEDC_USE_APB_CLK    // Fixed source for the timeline's pitch dividers
     };
     ESP_ERROR_CHECK(ledc_timer_config(&ledc_timer));
     
@@ -197,7 +353,7 @@ void beep(int frequency, int duration_ms)
 void tick_sound(void)
 {
     // Short tick beep (100ms) [web:39]
-    beep(TICK_FREQUENCY, 100);
+    beep(TICK_FREQUENCY, TICK_SOUND_MS);
 }
 
 void explosion_sound(void)
@@ -210,6 +366,7 @@ void setup_phase(void)
 {
     // Turn on all LEDs to show full countdown [web:44]
     turn_on_leds(NUM_LEDS);
+    display_mode = DISPLAY_ARMED;
     ESP_LOGI(TAG, "All %d LEDs ON - Timer Armed", NUM_LEDS);
     vTaskDelay(pdMS_TO_TICKS(2000));  // Display for 2 seconds
 }
@@ -268,3 +425,213 @@ void explosion_phase(void)
     
     ESP_LOGI(TAG, "Explosion complete");
 }
+
+// Returns false if the countdown was defused
+bool run_timed_countdown(void)
+{
+    static const countdown_config_t plan = {
+        .total_ms = COUNTDOWN_MS,
+        .tick_interval_ms = INITIAL_TICK_INTERVAL,
+        .urgent_ms = URGENT_MS,
+        .urgent_interval_ms = ACCELERATED_TICK_INTERVAL,
+        .tick_sound_ms = TICK_SOUND_MS,
+        .explosion_ms = EXPLOSION_DURATION,
+        .flash_interval_ms = FLASH_INTERVAL,
+        .num_leds = NUM_LEDS
+    };
+
+    ESP_LOGI(TAG, "PHASE: Normal Countdown");
+    ESP_ERROR_CHECK(countdown_timer_start(&plan, xTaskGetCurrentTaskHandle()));
+    display_mode = DISPLAY_COUNTDOWN;
+
+    // The ISRs drive every output; this task only follows the phases
+    uint32_t bits = 0;
+    while (!(bits & (COUNTDOWN_NOTIFY_END | COUNTDOWN_NOTIFY_DEFUSED))) {
+        xTaskNotifyWait(0, UINT32_MAX, &bits, portMAX_DELAY);
+        if (bits & COUNTDOWN_NOTIFY_PAUSED) {
+            ESP_LOGI(TAG, "Paused at %lld ms", (long long)(countdown_timer_elapsed_us() / 1000));
+        }
+        if (bits & COUNTDOWN_NOTIFY_RESUMED) {
+            ESP_LOGI(TAG, "Resumed");
+        }
+        if (bits & COUNTDOWN_NOTIFY_DEFUSED) {
+            ESP_LOGI(TAG, "*** DEFUSED with %lld ms left ***",
+                     (long long)(COUNTDOWN_MS - countdown_timer_elapsed_us() / 1000));
+            display_mode = DISPLAY_DEFUSED;
+        }
+        if (bits & COUNTDOWN_NOTIFY_URGENT) {
+            ESP_LOGI(TAG, "PHASE: CRITICAL - Accelerated Ticking!");
+        }
+        if (bits & COUNTDOWN_NOTIFY_EXPLODE) {
+            ESP_LOGI(TAG, "PHASE: EXPLOSION!");
+            ESP_LOGI(TAG, "*** BOOM! ***");
+            display_mode = DISPLAY_EXPLOSION;
+        }
+    }
+
+    countdown_timer_stats_t stats;
+    countdown_timer_get_stats(&stats);
+    uint32_t events = stats.events ? stats.events : 1;
+    ESP_LOGI(TAG, "Timeline: %lu events in %lu ISRs, late avg %lu us, max %lu us, max %lu cycles",
+             (unsigned long)stats.events, (unsigned long)stats.isr_runs,
+             (unsigned long)(stats.total_late_us / events), (unsigned long)stats.max_late_us,
+             (unsigned long)stats.max_cycles);
+    if (bits & COUNTDOWN_NOTIFY_DEFUSED) {
+        return false;
+    }
+    ESP_LOGI(TAG, "Explosion %lu us after the %d ms target (+%llu ms paused)",
+             (unsigned long)stats.explode_late_us, COUNTDOWN_MS,
+             (unsigned long long)(stats.paused_us / 1000));
+    return true;
+}
+
+IRAM_ATTR bool on_bomb_input(bomb_input_t input, uint32_t edge_cycles, void *ctx)
+{
+    BaseType_t woken = pdFALSE;
+    uint32_t effect_cycles = 0;
+    bool acted = false;
+
+    switch (input) {
+        case BOMB_INPUT_ARM:
+            xTaskNotifyFromISR(main_task, INPUT_NOTIFY_ARM, eSetBits, &woken);
+            break;
+        case BOMB_INPUT_PAUSE:
+            if (countdown_timer_is_paused()) {
+                acted = countdown_timer_resume_from_isr(&effect_cycles, &woken);
+            } else {
+                acted = countdown_timer_pause_from_isr(&effect_cycles, &woken);
+            }
+            break;
+        case BOMB_INPUT_DEFUSE:
+            acted = countdown_timer_defuse_from_isr(&effect_cycles, &woken);
+            break;
+        default:
+            break;
+    }
+
+    if (acted) {
+        uint32_t latency = effect_cycles - (INPUT_BENCH ? bench_write_cycles : edge_cycles);
+        latency_count++;
+        latency_total_cycles += latency;
+        if (latency > latency_max_cycles) {
+            latency_max_cycles = latency;
+        }
+    }
+    return woken == pdTRUE;
+}
+
+void log_input_latency(void)
+{
+    if (latency_count == 0) {
+        return;
+    }
+    bomb_inputs_stats_t stats;
+    bomb_inputs_get_stats(&stats);
+    ESP_LOGI(TAG, "Inputs: %lu effects, latency avg %lu us, max %lu us (%s)",
+             (unsigned long)latency_count,
+             (unsigned long)(latency_total_cycles / latency_count / CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ),
+             (unsigned long)(latency_max_cycles / CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ),
+             INPUT_BENCH ? "from pin write" : "from ISR entry");
+    ESP_LOGI(TAG, "Inputs: pause %lu/%lu edges accepted, defuse %lu/%lu, max ISR %lu cycles",
+             (unsigned long)stats.activations[BOMB_INPUT_PAUSE], (unsigned long)stats.edges[BOMB_INPUT_PAUSE],
+             (unsigned long)stats.activations[BOMB_INPUT_DEFUSE], (unsigned long)stats.edges[BOMB_INPUT_DEFUSE],
+             (unsigned long)stats.max_isr_cycles);
+    latency_count = 0;
+    latency_total_cycles = 0;
+    latency_max_cycles = 0;
+}
+
+void input_bench(void)
+{
+    // Loopback pin drives its own input path; every press toggles pause
+    static const countdown_config_t plan = {
+        .total_ms = 10000,
+        .tick_interval_ms = INITIAL_TICK_INTERVAL,
+        .tick_sound_ms = TICK_SOUND_MS,
+        .num_leds = NUM_LEDS
+    };
+    ESP_ERROR_CHECK(gpio_set_direction(BENCH_LOOPBACK_PIN, GPIO_MODE_INPUT_OUTPUT));
+    ESP_ERROR_CHECK(gpio_set_level(BENCH_LOOPBACK_PIN, 1));
+    vTaskDelay(pdMS_TO_TICKS(100));
+    ESP_ERROR_CHECK(countdown_timer_start(&plan, xTaskGetCurrentTaskHandle()));
+
+    for (int i = 0; i < BENCH_PRESSES; i++) {
+        vTaskDelay(pdMS_TO_TICKS(DEBOUNCE_QUIET_US / 1000 + 30));
+        bench_write_cycles = esp_cpu_get_cycle_count();
+        gpio_set_level(BENCH_LOOPBACK_PIN, 0);
+        vTaskDelay(pdMS_TO_TICKS(DEBOUNCE_QUIET_US / 1000 + 30));
+        gpio_set_level(BENCH_LOOPBACK_PIN, 1);
+    }
+
+    uint32_t bits = 0;
+    while (!(bits & COUNTDOWN_NOTIFY_END)) {
+        xTaskNotifyWait(0, UINT32_MAX, &bits, portMAX_DELAY);
+    }
+    ESP_LOGI(TAG, "Input benchmark: %d loopback presses", BENCH_PRESSES);
+    log_input_latency();
+}
+
+void display_task(void *arg)
+{
+    // Frames are cheap to build; the ISR keeps refreshing whatever was last shown
+    while (1) {
+        int64_t now = esp_timer_get_time();
+        switch (display_mode) {
+            case DISPLAY_ARMED:
+                seven_seg_show_time(COUNTDOWN_TOTAL_MS / 60000, (COUNTDOWN_TOTAL_MS / 1000) % 60, true);
+                break;
+            case DISPLAY_COUNTDOWN:
+            case DISPLAY_DEFUSED: {
+#if HW_TIMER_COUNTDOWN
+                // Timer-based, so it freezes with a pause or defuse
+                int64_t remaining_ms = COUNTDOWN_MS - countdown_timer_elapsed_us() / 1000;
+#else
+                int64_t remaining_ms = (countdown_end_us - now) / 1000;
+#endif
+                if (remaining_ms < 0) {
+                    remaining_ms = 0;
+                }
+                if (display_mode == DISPLAY_DEFUSED && (now / 250000) % 2) {
+                    seven_seg_blank();
+                } else if (remaining_ms >= 60000) {
+                    // MM.SS, colon blinking at 1 Hz
+                    seven_seg_show_time(remaining_ms / 60000, (remaining_ms / 1000) % 60,
+                                        remaining_ms % 1000 >= 500);
+                } else {
+                    // Last minute: SS.hh
+                    seven_seg_show_time(remaining_ms / 1000, (remaining_ms / 10) % 100, true);
+                }
+                break;
+            }
+            case DISPLAY_EXPLOSION:
+                if ((now / 1000 / FLASH_INTERVAL) % 2 == 0) {
+                    seven_seg_show_text("----");
+                } else {
+                    seven_seg_blank();
+                }
+                break;
+            default:
+                seven_seg_blank();
+                break;
+        }
+        vTaskDelay(pdMS_TO_TICKS(DISPLAY_UPDATE_MS));
+    }
+}
+
+void log_display_stats(int64_t window_us)
+{
+    seven_seg_stats_t stats;
+    seven_seg_get_stats(&stats);
+    uint32_t runs = stats.isr_runs ? stats.isr_runs : 1;
+    uint32_t digit_hz = (uint32_t)((uint64_t)stats.isr_runs * 1000000 / SEVEN_SEG_DIGITS / window_us);
+    uint32_t load_x100 = (uint32_t)(stats.total_cycles * 100 * 100 /
+                                    ((uint64_t)window_us * CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ));
+    ESP_LOGI(TAG, "Display: %lu ISRs, %lu Hz per digit, avg %lu cycles, max %lu cycles, load %lu.%02lu%%",
+             (unsigned long)stats.isr_runs, (unsigned long)digit_hz,
+             (unsigned long)(stats.total_cycles / runs), (unsigned long)stats.max_cycles,
+             (unsigned long)(load_x100 / 100), (unsigned long)(load_x100 % 100));
+    ESP_LOGI(TAG, "Display: ISR period %lu-%lu us, %lu frames",
+             (unsigned long)(stats.min_period_cycles / CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ),
+             (unsigned long)(stats.max_period_cycles / CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ),
+             (unsigned long)stats.frame_swaps);
+}
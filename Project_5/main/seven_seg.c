@@ -0,0 +1,257 @@
+/* Multiplexed 4-digit 7-segment display
+ *
+ * Each alarm blanks the previous digit and lights the next one:
+ *
+ *     W1TC  all segment bits | digit bits (low bank)
+ *     W1TC  digit bits (high bank, only if a digit pin is >= 32)
+ *     W1TS  segments of this digit | its digit bit
+ *     W1TS  its digit bit (high bank)
+ *
+ * The set masks of all digits form a frame. show() calls build the next
+ * frame and hand it over under the display lock; the ISR adopts it at the
+ * start of a scan so a frame is never mixed with the previous one.
+ */
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "driver/gptimer.h"
+#include "esp_cpu.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "soc/soc.h"
+#include "soc/gpio_reg.h"
+#include "seven_seg.h"
+
+static const char *TAG = "SEVEN_SEG";
+
+typedef struct {
+    uint32_t set_lo;
+    uint32_t set_hi;
+} digit_bits_t;
+
+typedef struct {
+    digit_bits_t digit[SEVEN_SEG_DIGITS];
+} frame_t;
+
+static uint32_t segment_bits[8];
+static uint32_t digit_lo[SEVEN_SEG_DIGITS], digit_hi[SEVEN_SEG_DIGITS];
+static uint32_t clear_lo, clear_hi;
+
+static frame_t current;             // Owned by the ISR
+static frame_t pending;
+static bool frame_pending = false;
+static int scan_digit = 0;
+static uint32_t last_start;
+
+static gptimer_handle_t refresh_timer = NULL;
+static seven_seg_stats_t stats;
+static portMUX_TYPE display_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static IRAM_ATTR bool refresh_isr(gptimer_handle_t timer, const gptimer_alarm_event_data_t *edata, void *user_ctx)
+{
+    uint32_t start = esp_cpu_get_cycle_count();
+
+    portENTER_CRITICAL_ISR(&display_lock);
+    if (scan_digit == 0 && frame_pending) {
+        current = pending;
+        frame_pending = false;
+        stats.frame_swaps++;
+    }
+    const digit_bits_t *bits = &current.digit[scan_digit];
+    REG_WRITE(GPIO_OUT_W1TC_REG, clear_lo);
+    if (clear_hi) {
+        REG_WRITE(GPIO_OUT1_W1TC_REG, clear_hi);
+    }
+    REG_WRITE(GPIO_OUT_W1TS_REG, bits->set_lo);
+    if (bits->set_hi) {
+        REG_WRITE(GPIO_OUT1_W1TS_REG, bits->set_hi);
+    }
+    scan_digit = (scan_digit + 1) % SEVEN_SEG_DIGITS;
+
+    if (stats.isr_runs > 0) {
+        uint32_t period = start - last_start;
+        if (period < stats.min_period_cycles) {
+            stats.min_period_cycles = period;
+        }
+        if (period > stats.max_period_cycles) {
+            stats.max_period_cycles = period;
+        }
+    }
+    last_start = start;
+    uint32_t cycles = esp_cpu_get_cycle_count() - start;
+    stats.isr_runs++;
+    stats.total_cycles += cycles;
+    if (cycles > stats.max_cycles) {
+        stats.max_cycles = cycles;
+    }
+    portEXIT_CRITICAL_ISR(&display_lock);
+    return false;
+}
+
+esp_err_t seven_seg_init(const seven_seg_config_t *config)
+{
+    if (config == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (refresh_timer != NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    uint64_t pin_mask = 0;
+    clear_lo = 0;
+    clear_hi = 0;
+    for (int i = 0; i < 8; i++) {
+        gpio_num_t pin = config->segment_pins[i];
+        // Segments share one W1TS/W1TC write with the low digit bits
+        if (pin < 0 || pin >= 32) {
+            ESP_LOGE(TAG, "Segment pin GPIO%d must be below GPIO32", pin);
+            return ESP_ERR_INVALID_ARG;
+        }
+        segment_bits[i] = 1u << pin;
+        clear_lo |= segment_bits[i];
+        pin_mask |= 1ULL << pin;
+    }
+    for (int i = 0; i < SEVEN_SEG_DIGITS; i++) {
+        gpio_num_t pin = config->digit_pins[i];
+        if (!GPIO_IS_VALID_OUTPUT_GPIO(pin)) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        digit_lo[i] = (pin < 32) ? (1u << pin) : 0;
+        digit_hi[i] = (pin >= 32) ? (1u << (pin - 32)) : 0;
+        clear_lo |= digit_lo[i];
+        clear_hi |= digit_hi[i];
+        pin_mask |= 1ULL << pin;
+    }
+
+    gpio_config_t io_conf = {
+        .mode = GPIO_MODE_OUTPUT,
+        .pull_up_en = GPIO_PULLUP_DISABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_DISABLE,
+        .pin_bit_mask = pin_mask
+    };
+    ESP_ERROR_CHECK(gpio_config(&io_conf));
+    REG_WRITE(GPIO_OUT_W1TC_REG, clear_lo);
+    REG_WRITE(GPIO_OUT1_W1TC_REG, clear_hi);
+    seven_seg_reset_stats();
+
+    gptimer_config_t timer_config = {
+        .clk_src = GPTIMER_CLK_SRC_DEFAULT,
+        .direction = GPTIMER_COUNT_UP,
+        .resolution_hz = SEVEN_SEG_TIMER_HZ
+    };
+    ESP_ERROR_CHECK(gptimer_new_timer(&timer_config, &refresh_timer));
+    gptimer_event_callbacks_t callbacks = {
+        .on_alarm = refresh_isr
+    };
+    ESP_ERROR_CHECK(gptimer_register_event_callbacks(refresh_timer, &callbacks, NULL));
+    gptimer_alarm_config_t alarm = {
+        .alarm_count = SEVEN_SEG_TIMER_HZ / (SEVEN_SEG_DIGIT_HZ * SEVEN_SEG_DIGITS),
+        .reload_count = 0,
+        .flags.auto_reload_on_alarm = true
+    };
+    ESP_ERROR_CHECK(gptimer_set_alarm_action(refresh_timer, &alarm));
+    ESP_ERROR_CHECK(gptimer_enable(refresh_timer));
+    ESP_LOGI(TAG, "%d digits at %d Hz each (ISR every %lu us)", SEVEN_SEG_DIGITS, SEVEN_SEG_DIGIT_HZ,
+             (unsigned long)alarm.alarm_count);
+    return gptimer_start(refresh_timer);
+}
+
+uint8_t seven_seg_glyph(char c)
+{
+    static const uint8_t digits[10] = {
+        0x3F, 0x06, 0x5B, 0x4F, 0x66, 0x6D, 0x7D, 0x07, 0x7F, 0x6F
+    };
+    if (c >= '0' && c <= '9') {
+        return digits[c - '0'];
+    }
+    switch (c) {
+        case '-':           return SEG_G;
+        case '_':           return SEG_D;
+        case 'A': case 'a': return 0x77;
+        case 'B': case 'b': return 0x7C;
+        case 'C': case 'c': return 0x39;
+        case 'D': case 'd': return 0x5E;
+        case 'E': case 'e': return 0x79;
+        case 'F': case 'f': return 0x71;
+        case 'H': case 'h': return 0x76;
+        case 'L': case 'l': return 0x38;
+        case 'N': case 'n': return 0x54;
+        case 'O': case 'o': return 0x5C;
+        case 'P': case 'p': return 0x73;
+        case 'R': case 'r': return 0x50;
+        case 'T': case 't': return 0x78;
+        case 'U': case 'u': return 0x1C;
+        default:            return 0;
+    }
+}
+
+void seven_seg_show(const uint8_t patterns[SEVEN_SEG_DIGITS])
+{
+    frame_t frame;
+    for (int d = 0; d < SEVEN_SEG_DIGITS; d++) {
+        uint32_t segments = 0;
+        for (int s = 0; s < 8; s++) {
+            if (patterns[d] & (1 << s)) {
+                segments |= segment_bits[s];
+            }
+        }
+        // A blank digit leaves its driver off as well
+        frame.digit[d].set_lo = segments ? (segments | digit_lo[d]) : 0;
+        frame.digit[d].set_hi = segments ? digit_hi[d] : 0;
+    }
+
+    portENTER_CRITICAL(&display_lock);
+    pending = frame;
+    frame_pending = true;
+    portEXIT_CRITICAL(&display_lock);
+}
+
+void seven_seg_show_text(const char *text)
+{
+    uint8_t patterns[SEVEN_SEG_DIGITS] = { 0 };
+    int count = 0;
+    for (const char *p = text; *p; p++) {
+        if (*p == '.' && count > 0) {
+            patterns[count - 1] |= SEG_DP;
+        } else if (count < SEVEN_SEG_DIGITS) {
+            patterns[count++] = seven_seg_glyph(*p);
+        }
+    }
+    seven_seg_show(patterns);
+}
+
+void seven_seg_show_time(uint32_t minutes, uint32_t seconds, bool colon)
+{
+    if (minutes > 99) {
+        minutes = 99;
+        seconds = 59;
+    }
+    uint8_t patterns[SEVEN_SEG_DIGITS] = {
+        seven_seg_glyph('0' + minutes / 10),
+        seven_seg_glyph('0' + minutes % 10) | (colon ? SEG_DP : 0),
+        seven_seg_glyph('0' + seconds / 10),
+        seven_seg_glyph('0' + seconds % 10)
+    };
+    seven_seg_show(patterns);
+}
+
+void seven_seg_blank(void)
+{
+    static const uint8_t blank[SEVEN_SEG_DIGITS] = { 0 };
+    seven_seg_show(blank);
+}
+
+void seven_seg_get_stats(seven_seg_stats_t *out)
+{
+    portENTER_CRITICAL(&display_lock);
+    *out = stats;
+    portEXIT_CRITICAL(&display_lock);
+}
+
+void seven_seg_reset_stats(void)
+{
+    portENTER_CRITICAL(&display_lock);
+    memset(&stats, 0, sizeof(stats));
+    stats.min_period_cycles = UINT32_MAX;
+    portEXIT_CRITICAL(&display_lock);
+}
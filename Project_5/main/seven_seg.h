@@ -0,0 +1,58 @@
+/* Multiplexed 4-digit 7-segment display
+ * A GPTimer ISR lights one digit per alarm. Frames (the GPIO bits of every
+ * digit) are computed in task context and double-buffered, so the ISR only
+ * does one clear and one set write per register bank.
+ *
+ * Wiring: common-cathode digits switched by active-high drivers, segments
+ * active high. Segment pins must be below GPIO32; digit pins may be any
+ * output-capable GPIO.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "driver/gpio.h"
+
+#define SEVEN_SEG_DIGITS        4
+#define SEVEN_SEG_DIGIT_HZ      1250        // Refresh rate of each digit
+#define SEVEN_SEG_TIMER_HZ      1000000
+
+// Segment bits of a pattern: a..g = bit 0..6, decimal point = bit 7
+#define SEG_A   (1 << 0)
+#define SEG_B   (1 << 1)
+#define SEG_C   (1 << 2)
+#define SEG_D   (1 << 3)
+#define SEG_E   (1 << 4)
+#define SEG_F   (1 << 5)
+#define SEG_G   (1 << 6)
+#define SEG_DP  (1 << 7)
+
+typedef struct {
+    gpio_num_t segment_pins[8];     // a, b, c, d, e, f, g, dp
+    gpio_num_t digit_pins[SEVEN_SEG_DIGITS];    // Leftmost first
+} seven_seg_config_t;
+
+// Refresh timing
+typedef struct {
+    uint32_t isr_runs;
+    uint64_t total_cycles;          // Cycles spent in the ISR
+    uint32_t max_cycles;
+    uint32_t min_period_cycles;     // Between consecutive ISR entries
+    uint32_t max_period_cycles;
+    uint32_t frame_swaps;           // New frames picked up by the ISR
+} seven_seg_stats_t;
+
+esp_err_t seven_seg_init(const seven_seg_config_t *config);
+// Segment pattern for '0'-'9', '-', ' ' and a few letters; blank if unknown
+uint8_t seven_seg_glyph(char c);
+// Show raw patterns, leftmost first; takes effect at the next full scan
+void seven_seg_show(const uint8_t patterns[SEVEN_SEG_DIGITS]);
+// Text of up to four glyphs; '.' adds the decimal point to the previous glyph
+void seven_seg_show_text(const char *text);
+// "MM.SS" with the point as the colon
+void seven_seg_show_time(uint32_t minutes, uint32_t seconds, bool colon);
+void seven_seg_blank(void);
+
+void seven_seg_get_stats(seven_seg_stats_t *stats);
+void seven_seg_reset_stats(void);
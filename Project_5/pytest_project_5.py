@@ -0,0 +1,41 @@
+"""Project 5 under QEMU: countdown timeline and display refresh
+
+Built with -DQEMU_TEST=1: with no ARM button the GPTimer countdown starts
+as soon as the setup phase is shown.
+"""
+import pytest
+
+from conftest import TICK_MS
+
+TAG = 'TIME_BOMB'
+COUNTDOWN_MS = 5000             # main.c
+URGENT_MS = 1200                # main.c
+DISPLAY_PERIOD_US = 200         # seven_seg.h: 4 digits at 1250 Hz each
+ROUNDS = 2
+MAX_EVENT_LATE_US = 100         # Regression budget, latest timeline event
+MAX_EXPLODE_LATE_US = 100
+MAX_PERIOD_JITTER_US = 20       # Display ISR period either side of nominal
+
+
+@pytest.mark.esp32
+@pytest.mark.qemu
+def test_countdown_phases(log):
+    log.check_boot()
+    for _ in range(ROUNDS):
+        log.expect(TAG, 'PHASE: Setup', timeout=15)
+        start_ms, _ = log.expect(TAG, 'PHASE: Normal Countdown')
+        urgent_ms, _ = log.expect(TAG, 'PHASE: CRITICAL')
+        boom_ms, _ = log.expect(TAG, 'PHASE: EXPLOSION!')
+        # Phase logs follow the ISR's task notification by at most a tick
+        assert abs(urgent_ms - start_ms - (COUNTDOWN_MS - URGENT_MS)) <= log.budget(TICK_MS)
+        assert abs(boom_ms - start_ms - COUNTDOWN_MS) <= log.budget(TICK_MS)
+
+        _, timeline = log.expect(TAG, r'Timeline: \d+ events in \d+ ISRs, late avg (\d+) us, max (\d+) us')
+        assert int(timeline.group(3)) <= log.budget(MAX_EVENT_LATE_US)
+        _, explosion = log.expect(TAG, r'Explosion (\d+) us after')
+        assert int(explosion.group(2)) <= log.budget(MAX_EXPLODE_LATE_US)
+
+        _, period = log.expect(TAG, r'Display: ISR period (\d+)-(\d+) us')
+        jitter = log.budget(MAX_PERIOD_JITTER_US)
+        assert int(period.group(2)) >= DISPLAY_PERIOD_US - jitter
+        assert int(period.group(3)) <= DISPLAY_PERIOD_US + jitter
@@ -0,0 +1,236 @@
+/* Junction delay model
+ *
+ * The state machine is stepped deadline to deadline exactly as the alarm
+ * ISR steps it, with no latency. Each step closes one state; a closed
+ * GREEN or RED is a service window for its queue. Nothing is allocated
+ * per evaluation, so any number of workers can share one arrivals_t.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "delay_sim.h"
+
+#define MS_TO_US(ms)    ((uint64_t)(ms) * 1000)
+
+typedef struct {
+    const uint64_t *at_us;
+    size_t count;
+    size_t next;                // First vehicle not yet served
+    double total_delay_us;
+    uint64_t max_delay_us;
+} queue_t;
+
+// Discharges the queue through [open_us, close_us)
+static void serve(queue_t *q, uint64_t open_us, uint64_t close_us, uint64_t headway_us)
+{
+    uint64_t t = open_us;
+    while (q->next < q->count && t < close_us) {
+        uint64_t arrival = q->at_us[q->next];
+        uint64_t depart = arrival > t ? arrival : t;
+        if (depart >= close_us) {
+            break;
+        }
+        uint64_t delay = depart - arrival;
+        q->total_delay_us += (double)delay;
+        if (delay > q->max_delay_us) {
+            q->max_delay_us = delay;
+        }
+        q->next++;
+        t = depart + headway_us;
+    }
+}
+
+bool sim_evaluate(const traffic_fsm_config_t *config, const arrivals_t *arrivals,
+                  const sim_model_t *model, sim_result_t *result)
+{
+    traffic_fsm_t fsm;
+    if (config->plan.flash || !traffic_fsm_init(&fsm, config, TRAFFIC_RED, 0)) {
+        return false;
+    }
+    queue_t queues[APPROACH_COUNT];
+    for (int i = 0; i < APPROACH_COUNT; i++) {
+        queues[i] = (queue_t){ .at_us = arrivals->at_us[i], .count = arrivals->count[i] };
+    }
+    uint64_t headway = MS_TO_US(model->headway_ms);
+    uint64_t lost = MS_TO_US(model->lost_ms);
+    uint64_t end = arrivals->span_us + model->drain_us;
+    uint64_t entered = 0;
+    uint32_t cycles = 0;
+    traffic_fsm_step_t step;
+
+    for (;;) {
+        uint64_t deadline = traffic_fsm_deadline(&fsm);
+        traffic_fsm_advance(&fsm, deadline, &step);
+        if (step.from == TRAFFIC_GREEN) {
+            serve(&queues[APPROACH_MAIN], entered + lost, step.at_us, headway);
+        } else if (step.from == TRAFFIC_RED) {
+            uint64_t open = entered + MS_TO_US(config->all_red_ms) + lost;
+            uint64_t close = step.at_us - MS_TO_US(config->min_yellow_ms);
+            if (close > open) {
+                serve(&queues[APPROACH_CROSS], open, close, headway);
+            }
+        } else if (step.to == TRAFFIC_RED) {
+            cycles++;
+            // Stop at a cycle end once the recording is over and drained
+            bool empty = queues[APPROACH_MAIN].next == queues[APPROACH_MAIN].count &&
+                         queues[APPROACH_CROSS].next == queues[APPROACH_CROSS].count;
+            if (step.at_us >= end || (step.at_us >= arrivals->span_us && empty)) {
+                entered = step.at_us;
+                break;
+            }
+        }
+        entered = step.at_us;
+    }
+
+    double total = 0;
+    uint64_t max_delay = 0;
+    size_t served = 0, unserved = 0;
+    for (int i = 0; i < APPROACH_COUNT; i++) {
+        queue_t *q = &queues[i];
+        total += q->total_delay_us;
+        served += q->next;
+        if (q->max_delay_us > max_delay) {
+            max_delay = q->max_delay_us;
+        }
+        // Still waiting when the run stopped: counted up to then
+        for (size_t v = q->next; v < q->count; v++) {
+            uint64_t wait = entered - q->at_us[v];
+            total += (double)wait;
+            if (wait > max_delay) {
+                max_delay = wait;
+            }
+        }
+        unserved += q->count - q->next;
+    }
+    size_t vehicles = served + unserved;
+    result->mean_delay_s = vehicles ? total / vehicles / 1e6 : 0;
+    result->max_delay_s = max_delay / 1e6;
+    result->served = served;
+    result->unserved = unserved;
+    result->cycles = cycles;
+    return true;
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static int push_arrival(arrivals_t *arrivals, size_t *capacity, int approach, uint64_t at_us)
+{
+    if (arrivals->count[approach] == capacity[approach]) {
+        size_t grown = capacity[approach] ? capacity[approach] * 2 : 1024;
+        uint64_t *at = realloc(arrivals->at_us[approach], grown * sizeof(*at));
+        if (at == NULL) {
+            return -1;
+        }
+        arrivals->at_us[approach] = at;
+        capacity[approach] = grown;
+    }
+    arrivals->at_us[approach][arrivals->count[approach]++] = at_us;
+    if (at_us > arrivals->span_us) {
+        arrivals->span_us = at_us;
+    }
+    return 0;
+}
+
+int sim_load_arrivals(const char *path, arrivals_t *arrivals)
+{
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        perror(path);
+        return -1;
+    }
+    memset(arrivals, 0, sizeof(*arrivals));
+    size_t capacity[APPROACH_COUNT] = {0};
+    char line[256];
+    size_t line_no = 0;
+    int ret = 0;
+
+    while (fgets(line, sizeof(line), f)) {
+        line_no++;
+        double seconds;
+        char approach[32];
+        if (line[0] == '#' || line[0] == '\n' || line[0] == '\r') {
+            continue;
+        }
+        if (sscanf(line, "%lf,%31[^,\r\n]", &seconds, approach) != 2 || seconds < 0) {
+            // A header line is fine, anything else later is not
+            if (line_no == 1) {
+                continue;
+            }
+            fprintf(stderr, "%s:%zu: expected seconds,approach\n", path, line_no);
+            ret = -1;
+            break;
+        }
+        int a;
+        if (strcmp(approach, "main") == 0 || strcmp(approach, "0") == 0) {
+            a = APPROACH_MAIN;
+        } else if (strcmp(approach, "cross") == 0 || strcmp(approach, "1") == 0) {
+            a = APPROACH_CROSS;
+        } else {
+            fprintf(stderr, "%s:%zu: unknown approach '%s'\n", path, line_no, approach);
+            ret = -1;
+            break;
+        }
+        if (push_arrival(arrivals, capacity, a, (uint64_t)llround(seconds * 1e6)) != 0) {
+            ret = -1;
+            break;
+        }
+    }
+    fclose(f);
+    if (ret != 0) {
+        sim_free_arrivals(arrivals);
+        return ret;
+    }
+    for (int i = 0; i < APPROACH_COUNT; i++) {
+        qsort(arrivals->at_us[i], arrivals->count[i], sizeof(uint64_t), compare_u64);
+    }
+    return 0;
+}
+
+int sim_synthetic_arrivals(double main_vph, double cross_vph, double hours, uint32_t seed,
+                           arrivals_t *arrivals)
+{
+    memset(arrivals, 0, sizeof(*arrivals));
+    size_t capacity[APPROACH_COUNT] = {0};
+    const double rates[APPROACH_COUNT] = { main_vph, cross_vph };
+    uint64_t span = (uint64_t)(hours * 3600e6);
+    uint32_t state = seed ? seed : 1;
+
+    for (int a = 0; a < APPROACH_COUNT; a++) {
+        if (rates[a] <= 0) {
+            continue;
+        }
+        double mean_gap_us = 3600e6 / rates[a];
+        double t = 0;
+        for (;;) {
+            // xorshift32, exponential gaps
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            double u = (state + 1.0) / 4294967297.0;
+            t += -log(u) * mean_gap_us;
+            if (t >= span) {
+                break;
+            }
+            if (push_arrival(arrivals, capacity, a, (uint64_t)t) != 0) {
+                sim_free_arrivals(arrivals);
+                return -1;
+            }
+        }
+    }
+    arrivals->span_us = span;
+    return 0;
+}
+
+void sim_free_arrivals(arrivals_t *arrivals)
+{
+    for (int i = 0; i < APPROACH_COUNT; i++) {
+        free(arrivals->at_us[i]);
+        arrivals->at_us[i] = NULL;
+        arrivals->count[i] = 0;
+    }
+}
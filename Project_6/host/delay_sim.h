@@ -0,0 +1,49 @@
+/* Junction delay model
+ * Runs the firmware state machine (traffic_fsm.c) on a candidate plan and
+ * serves recorded arrivals from the states' timing. The signal head
+ * controls the main street: it discharges during GREEN. The cross street
+ * is the implicit other phase: it discharges during RED, after the
+ * all-red clearance and before its own yellow (min_yellow_ms) at the end.
+ * Each queue is FIFO. Service starts a start-up lost time into the window
+ * and leaves one vehicle per saturation headway. A vehicle that meets a
+ * green with an empty queue passes without delay.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "traffic_fsm.h"
+
+enum { APPROACH_MAIN, APPROACH_CROSS, APPROACH_COUNT };
+
+typedef struct {
+    uint64_t *at_us[APPROACH_COUNT];    // Sorted arrival times
+    size_t count[APPROACH_COUNT];
+    uint64_t span_us;                   // Length of the recording
+} arrivals_t;
+
+typedef struct {
+    uint32_t headway_ms;        // Saturation headway, per vehicle
+    uint32_t lost_ms;           // Start-up lost time at the start of each green
+    uint64_t drain_us;          // Run on this long past the recording to empty queues
+} sim_model_t;
+
+typedef struct {
+    double mean_delay_s;        // Per vehicle, unserved ones up to the end of the run
+    double max_delay_s;
+    size_t served;
+    size_t unserved;
+    uint32_t cycles;
+} sim_result_t;
+
+// False if the state machine rejects the plan
+bool sim_evaluate(const traffic_fsm_config_t *config, const arrivals_t *arrivals,
+                  const sim_model_t *model, sim_result_t *result);
+
+// Loads "seconds,approach" lines (approach main/cross or 0/1); 0 on success
+int sim_load_arrivals(const char *path, arrivals_t *arrivals);
+// Poisson arrivals at the given hourly rates
+int sim_synthetic_arrivals(double main_vph, double cross_vph, double hours, uint32_t seed,
+                           arrivals_t *arrivals);
+void sim_free_arrivals(arrivals_t *arrivals);
@@ -0,0 +1,938 @@
+/* Exhaustive state-space explorer for the traffic state machine
+ *
+ * Runs the firmware state machine (traffic_fsm.c) through every
+ * interleaving of timer expiry, preemption requests, day-plan changes,
+ * pedestrian beep requests and warm or cold resets on a time grid of one
+ * tick, and checks the junction's safety invariants on every move:
+ *   - steps follow the cycle; RED, RED_TO_YELLOW and the caution yellow
+ *     last at least their safety minimums, the caution yellow its full
+ *     plan duration
+ *   - GREEN is never left during a request, nor within min_green of one
+ *     clearing; a request reaches GREEN within the preemption bound
+ *   - the cross street (the implicit other phase, as in delay_sim.h: green
+ *     during RED after the all-red clearance, yellow for the last
+ *     min_yellow of RED) is never green or yellow unless the main street
+ *     is at RED, and always gets a full yellow
+ *   - the pedestrian beeps sound only in GREEN with no request active
+ *   - a warm resume moves the lights on by at most one legal step
+ * A warm reset leaves the lights dark for up to -g ms, which counts as
+ * time in whatever yellow was showing; the preemption input may have
+ * changed meanwhile. A cold start is power-up, so it only has to start
+ * in RED or FLASH.
+ *
+ * A state is the machine's state plus how long ago it was entered, the
+ * request arrived and the last request cleared, in ticks, each capped
+ * where a larger value no longer moves any deadline; with the plan in
+ * force, the queued plan, the buzzer and the cross street lamp it packs
+ * into 64 bits. The search is a level-by-level BFS: a pool of worker
+ * threads claims the current level's states in chunks from a shared
+ * counter and inserts successors into a lock-free open-addressing set,
+ * or into a bitstate set (two bits per state, may miss states, no
+ * counterexample traces) for models too big for exact storage.
+ *
+ *     fsm_explore [options]
+ *       -t MS      tick: time grid of the model (default 500); every
+ *                  duration and minimum must be a multiple of it
+ *       -g MS      longest dark gap on a warm reset (default 1000)
+ *       -R         no resets
+ *       -D         no plan changes: the off-peak plan only
+ *       -j N       worker threads (default: all cores)
+ *       -m BITS    exact visited set of 2^BITS entries, 16 bytes each (default 22)
+ *       -b BITS    bitstate visited set of 2^BITS bits instead
+ *
+ * Exits 1 with a shortest counterexample per broken invariant.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "traffic_fsm.h"
+
+#define NOW_US          1000000000000ULL    // Model time; every state is seen from here
+#define CHUNK_STATES    256                 // States claimed per worker grab
+#define AGE_MAX         255
+#define NONE            0xff                // No release age
+#define NO_PLAN         0x7                 // No queued plan
+#define ROOT            0xffULL             // Action of an initial state
+#define MAX_LOAD        0.9
+
+// Project_6/main/main.c safety settings and plans
+static const traffic_fsm_config_t base_config = {
+    .all_red_ms = 1000,
+    .min_ready_ms = 1000,
+    .min_yellow_ms = 2000,
+    .min_green_ms = 3000
+};
+
+static const traffic_plan_t plans[] = {
+    { .durations_ms = { 5000, 2000, 5000, 2000 } },
+    { .durations_ms = { 4000, 2000, 9000, 3000 } },
+    { .durations_ms = { 6000, 2000, 6000, 2000 } },
+    { .durations_ms = { 5000, 2000, 5000, 2000 }, .flash = true }
+};
+static const char *const plan_names[] = { "off-peak", "peak", "weekend", "night flash" };
+#define NUM_PLANS   (sizeof(plans) / sizeof(plans[0]))
+
+static const char *const state_names[TRAFFIC_STATE_COUNT] = {
+    "RED", "RED_TO_YELLOW", "GREEN", "GREEN_TO_YELLOW", "FLASH"
+};
+
+typedef enum { LAMP_RED, LAMP_GREEN, LAMP_YELLOW } lamp_t;
+static const char *const lamp_names[] = { "red", "green", "yellow" };
+
+typedef enum {
+    V_STEP,
+    V_MAIN_YELLOW,
+    V_YELLOW_CUT,
+    V_ALL_RED,
+    V_READY,
+    V_HELD,
+    V_MIN_GREEN,
+    V_BOUND,
+    V_CONFLICT,
+    V_CROSS_YELLOW,
+    V_BUZZER,
+    V_RESET,
+    V_COUNT,
+    V_NONE = V_COUNT
+} violation_t;
+
+static const char *const violation_names[V_COUNT] = {
+    [V_STEP] = "step out of the cycle",
+    [V_MAIN_YELLOW] = "caution yellow shorter than min_yellow",
+    [V_YELLOW_CUT] = "caution yellow cut short of its plan",
+    [V_ALL_RED] = "RED shorter than the all-red clearance",
+    [V_READY] = "RED_TO_YELLOW shorter than min_ready",
+    [V_HELD] = "GREEN left during a request",
+    [V_MIN_GREEN] = "GREEN left within min_green of a release",
+    [V_BOUND] = "request waited past the preemption bound",
+    [V_CONFLICT] = "cross street green or yellow off main RED",
+    [V_CROSS_YELLOW] = "cross street yellow missing or short",
+    [V_BUZZER] = "beeps outside an undisturbed GREEN",
+    [V_RESET] = "warm resume skipped a state",
+};
+
+// Actions: tick, request toggle, beep toggle, one per plan, then warm
+// resets by gap and input, then cold starts by input
+enum { A_TICK, A_PREEMPT, A_BEEP, A_PLAN };
+
+// Decoded state; ages are whole ticks before NOW_US
+typedef struct {
+    traffic_state_t state;
+    uint32_t age;               // In the state
+    bool preempt;
+    uint32_t preempt_age;       // Since the active request arrived
+    uint32_t release_age;       // Since a request cleared in this GREEN, NONE if none
+    uint32_t cut;               // Latched RED end, ticks after its start; 0 if none
+    uint8_t plan;               // Durations in force
+    bool flash;                 // Flash flag in force (a warm resume keeps only the durations)
+    uint8_t pending;            // Queued plan, NO_PLAN if none
+    bool buzzer;
+    lamp_t cross;
+    uint32_t cross_age;         // In cross yellow
+} model_t;
+
+// Model settings, fixed before the search
+static struct {
+    uint64_t tick_us;
+    uint32_t max_gap;           // Ticks
+    uint32_t age_cap;           // No deadline depends on larger ages
+    uint32_t preempt_cap;
+    uint32_t all_red, min_ready, min_yellow, min_green;
+    uint8_t num_plans;
+    bool resets;
+    int num_actions;
+    int warm_action;            // First warm reset action
+    int cold_action;
+} cfg;
+
+static uint64_t encode(const model_t *m)
+{
+    return (uint64_t)m->state |
+           (uint64_t)m->age << 3 |
+           (uint64_t)m->preempt << 11 |
+           (uint64_t)m->preempt_age << 12 |
+           (uint64_t)m->release_age << 20 |
+           (uint64_t)m->cut << 28 |
+           (uint64_t)m->plan << 36 |
+           (uint64_t)m->flash << 39 |
+           (uint64_t)m->pending << 40 |
+           (uint64_t)m->buzzer << 43 |
+           (uint64_t)m->cross << 44 |
+           (uint64_t)m->cross_age << 46;
+}
+
+static void decode(uint64_t key, model_t *m)
+{
+    m->state = (traffic_state_t)(key & 0x7);
+    m->age = (key >> 3) & 0xff;
+    m->preempt = (key >> 11) & 1;
+    m->preempt_age = (key >> 12) & 0xff;
+    m->release_age = (key >> 20) & 0xff;
+    m->cut = (key >> 28) & 0xff;
+    m->plan = (key >> 36) & 0x7;
+    m->flash = (key >> 39) & 1;
+    m->pending = (key >> 40) & 0x7;
+    m->buzzer = (key >> 43) & 1;
+    m->cross = (lamp_t)((key >> 44) & 0x3);
+    m->cross_age = (key >> 46) & 0xff;
+}
+
+static uint32_t ticks(uint64_t us)
+{
+    return (uint32_t)(us / cfg.tick_us);
+}
+
+static uint32_t cap(uint32_t value, uint32_t limit)
+{
+    return value < limit ? value : limit;
+}
+
+// One move being played out from a state
+typedef struct {
+    traffic_fsm_t fsm;
+    model_t m;                  // Bookkeeping the machine does not hold
+    uint64_t now;
+    violation_t violation;      // First one seen
+} move_t;
+
+static void check(move_t *mv, bool ok, violation_t kind)
+{
+    if (!ok && mv->violation == V_NONE) {
+        mv->violation = kind;
+    }
+}
+
+static void load(move_t *mv, const model_t *m)
+{
+    traffic_fsm_config_t config = base_config;
+    config.plan = plans[m->plan];
+    config.plan.flash = m->flash;
+    traffic_fsm_t *fsm = &mv->fsm;
+    traffic_fsm_init(fsm, &config, m->state, NOW_US - m->age * cfg.tick_us);
+    fsm->preempt = m->preempt;
+    fsm->preempt_us = NOW_US - m->preempt_age * cfg.tick_us;
+    fsm->release_us = m->release_age == NONE ? 0 : NOW_US - m->release_age * cfg.tick_us;
+    fsm->red_cut_us = m->cut ? fsm->state_start_us + m->cut * cfg.tick_us : 0;
+    if (m->pending != NO_PLAN) {
+        fsm->next = plans[m->pending];
+        fsm->plan_pending = true;
+    }
+    mv->m = *m;
+    mv->now = NOW_US;
+    mv->violation = V_NONE;
+}
+
+// Canonical form: ages capped, fields that no longer matter cleared
+static uint64_t store(const move_t *mv)
+{
+    const traffic_fsm_t *fsm = &mv->fsm;
+    model_t m = mv->m;
+    uint64_t now = mv->now;
+    m.state = fsm->state;
+    m.age = fsm->state == TRAFFIC_FLASH ? 0 : cap(ticks(now - fsm->state_start_us), cfg.age_cap);
+    m.preempt = fsm->preempt;
+    m.preempt_age = (fsm->preempt && fsm->state != TRAFFIC_GREEN) ?
+                    cap(ticks(now - fsm->preempt_us), cfg.preempt_cap) : 0;
+    m.release_age = NONE;
+    if (fsm->state == TRAFFIC_GREEN && fsm->release_us > fsm->state_start_us &&
+        ticks(now - fsm->release_us) < cfg.min_green) {
+        m.release_age = ticks(now - fsm->release_us);
+    }
+    m.cut = (fsm->state == TRAFFIC_RED && fsm->red_cut_us) ? ticks(fsm->red_cut_us - fsm->state_start_us) : 0;
+    m.buzzer = m.buzzer && fsm->state == TRAFFIC_GREEN;
+    m.cross_age = m.cross == LAMP_YELLOW ? cap(m.cross_age, cfg.min_yellow) : 0;
+    return encode(&m);
+}
+
+// A queued plan the machine has taken over
+static void sync_plan(move_t *mv)
+{
+    if (mv->m.pending != NO_PLAN && !mv->fsm.plan_pending) {
+        mv->m.plan = mv->m.pending;
+        mv->m.flash = plans[mv->m.pending].flash;
+        mv->m.pending = NO_PLAN;
+    }
+}
+
+static void check_step(move_t *mv, const traffic_fsm_step_t *step, uint64_t entered_us,
+                       uint64_t release_us, const traffic_plan_t *plan)
+{
+    uint32_t length = ticks(step->at_us - entered_us);
+    traffic_state_t expected = step->from == TRAFFIC_FLASH ? TRAFFIC_RED :
+                               (traffic_state_t)((step->from + 1) % TRAFFIC_CYCLE_STATES);
+    bool to_flash = step->from == TRAFFIC_GREEN_TO_YELLOW && step->to == TRAFFIC_FLASH;
+    check(mv, step->to == expected || to_flash, V_STEP);
+    switch (step->from) {
+        case TRAFFIC_RED:
+            check(mv, length >= cfg.all_red, V_ALL_RED);
+            break;
+        case TRAFFIC_RED_TO_YELLOW:
+            check(mv, length >= cfg.min_ready, V_READY);
+            break;
+        case TRAFFIC_GREEN:
+            check(mv, !step->preempt, V_HELD);
+            check(mv, release_us <= entered_us ||
+                      ticks(step->at_us - release_us) >= cfg.min_green, V_MIN_GREEN);
+            break;
+        case TRAFFIC_GREEN_TO_YELLOW:
+            check(mv, length >= cfg.min_yellow, V_MAIN_YELLOW);
+            check(mv, length >= ticks(plan->durations_ms[TRAFFIC_GREEN_TO_YELLOW] * 1000ULL), V_YELLOW_CUT);
+            break;
+        default:
+            break;
+    }
+}
+
+// Steps the machine as far as it goes at this instant, as the ISRs do
+static void run_machine(move_t *mv)
+{
+    traffic_fsm_step_t step;
+    for (;;) {
+        uint64_t entered = mv->fsm.state_start_us;
+        uint64_t release = mv->fsm.release_us;
+        traffic_plan_t plan = mv->fsm.config.plan;
+        if (!traffic_fsm_advance(&mv->fsm, mv->now, &step)) {
+            break;
+        }
+        check_step(mv, &step, entered, release, &plan);
+        if (step.to == TRAFFIC_GREEN && step.preempt) {
+            check(mv, ticks(step.at_us - mv->fsm.preempt_us) <= cfg.preempt_cap - 1, V_BOUND);
+        }
+        // Every light change silences the beeps
+        mv->m.buzzer = false;
+        sync_plan(mv);
+    }
+}
+
+// Cross street lamp now, given what it showed before
+static lamp_t cross_lamp(const traffic_fsm_t *fsm, uint64_t now, lamp_t before)
+{
+    if (fsm->state != TRAFFIC_RED || ticks(now - fsm->state_start_us) < cfg.all_red) {
+        return LAMP_RED;
+    }
+    if (now + base_config.min_yellow_ms * 1000ULL < traffic_fsm_deadline(fsm)) {
+        return LAMP_GREEN;
+    }
+    return before == LAMP_RED ? LAMP_RED : LAMP_YELLOW;
+}
+
+// Checks what the lamps and buzzer show once the move has settled
+static void settle(move_t *mv)
+{
+    lamp_t before = mv->m.cross;
+    lamp_t after = cross_lamp(&mv->fsm, mv->now, before);
+    if (before == LAMP_YELLOW) {
+        check(mv, after != LAMP_GREEN, V_CROSS_YELLOW);
+        check(mv, after != LAMP_RED || mv->m.cross_age >= cfg.min_yellow, V_CROSS_YELLOW);
+    } else if (before == LAMP_GREEN) {
+        check(mv, after != LAMP_RED, V_CROSS_YELLOW);
+    }
+    if (after != before) {
+        mv->m.cross_age = 0;
+    }
+    mv->m.cross = after;
+    check(mv, after == LAMP_RED || mv->fsm.state == TRAFFIC_RED, V_CONFLICT);
+    check(mv, !mv->m.buzzer || traffic_fsm_beep_allowed(&mv->fsm), V_BUZZER);
+    if (mv->fsm.preempt && mv->fsm.state != TRAFFIC_GREEN) {
+        check(mv, ticks(mv->now - mv->fsm.preempt_us) < cfg.preempt_cap, V_BOUND);
+    }
+}
+
+static void pass_time(move_t *mv, uint32_t n)
+{
+    mv->now += n * cfg.tick_us;
+    if (mv->m.cross == LAMP_YELLOW) {
+        mv->m.cross_age = cap(mv->m.cross_age + n, cfg.min_yellow);
+    }
+}
+
+static void warm_reset(move_t *mv, uint32_t gap, bool input)
+{
+    traffic_state_t saved = mv->fsm.state;
+    uint32_t shown = ticks(mv->now - mv->fsm.state_start_us);
+    traffic_plan_t plan = plans[mv->m.plan];
+    traffic_state_t state = saved;
+    uint64_t start = mv->fsm.state_start_us;
+    pass_time(mv, gap);
+    traffic_fsm_resume(&base_config, &plan, &state, &start, NULL, mv->now);
+
+    // The lights come back at most one step on, and only past a state
+    // that was shown (or dark) for its minimum
+    if (state != saved) {
+        traffic_state_t next = saved == TRAFFIC_FLASH ? TRAFFIC_RED :
+                               (traffic_state_t)((saved + 1) % TRAFFIC_CYCLE_STATES);
+        uint32_t minimum = saved == TRAFFIC_RED ? cfg.all_red :
+                           saved == TRAFFIC_RED_TO_YELLOW ? cfg.min_ready :
+                           saved == TRAFFIC_GREEN_TO_YELLOW ? cfg.min_yellow : 0;
+        check(mv, state == next && shown + gap >= minimum, V_RESET);
+    }
+    traffic_fsm_config_t config = base_config;
+    config.plan = plan;
+    config.plan.flash = (state == TRAFFIC_FLASH);
+    traffic_fsm_init(&mv->fsm, &config, state, start);
+    mv->m.flash = config.plan.flash;
+    mv->m.pending = NO_PLAN;
+    mv->m.buzzer = false;
+    if (input) {
+        traffic_fsm_set_preempt(&mv->fsm, true, mv->now);
+    }
+    run_machine(mv);
+    settle(mv);
+}
+
+static void cold_start(move_t *mv, bool input)
+{
+    traffic_fsm_config_t config = base_config;
+    config.plan = plans[mv->m.plan];
+    mv->m.flash = config.plan.flash;
+    traffic_fsm_init(&mv->fsm, &config, config.plan.flash ? TRAFFIC_FLASH : TRAFFIC_RED, mv->now);
+    mv->m.pending = NO_PLAN;
+    mv->m.buzzer = false;
+    mv->m.cross = LAMP_RED;
+    mv->m.cross_age = 0;
+    if (input) {
+        traffic_fsm_set_preempt(&mv->fsm, true, mv->now);
+    }
+    run_machine(mv);
+    settle(mv);
+}
+
+// Plays action `a` from `m`; false if it does not apply there
+static bool play(const model_t *m, int a, move_t *mv)
+{
+    load(mv, m);
+    if (a == A_TICK) {
+        pass_time(mv, 1);
+    } else if (a == A_PREEMPT) {
+        traffic_fsm_set_preempt(&mv->fsm, !m->preempt, mv->now);
+        if (mv->fsm.preempt) {
+            mv->m.buzzer = false;
+        }
+    } else if (a == A_BEEP) {
+        if (!m->buzzer && !traffic_fsm_beep_allowed(&mv->fsm)) {
+            return false;
+        }
+        mv->m.buzzer = !m->buzzer;
+    } else if (a < A_PLAN + cfg.num_plans) {
+        uint8_t plan = (uint8_t)(a - A_PLAN);
+        if (m->pending == plan || !traffic_fsm_set_plan(&mv->fsm, &plans[plan])) {
+            return false;
+        }
+        mv->m.pending = plan;
+        sync_plan(mv);
+    } else if (a < cfg.cold_action) {
+        int w = a - cfg.warm_action;
+        warm_reset(mv, (uint32_t)(w / 2), w % 2);
+        return true;
+    } else {
+        cold_start(mv, (a - cfg.cold_action) == 1);
+        return true;
+    }
+    run_machine(mv);
+    settle(mv);
+    return true;
+}
+
+// Visited set: exact open addressing, or bitstate
+typedef struct {
+    _Atomic uint64_t key;       // State + 1, 0 while free
+    uint64_t parent;            // Parent state, action in the top byte
+} slot_t;
+
+static struct {
+    slot_t *slots;              // Exact
+    _Atomic uint64_t *bits;     // Bitstate
+    uint64_t mask;
+    atomic_size_t used;
+    size_t capacity;
+    atomic_bool full;
+} seen;
+
+static uint64_t mix(uint64_t x)
+{
+    // splitmix64 finaliser
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+// True if the state was not there yet
+static bool seen_insert(uint64_t key, uint64_t parent)
+{
+    uint64_t h = mix(key);
+    if (seen.bits) {
+        // Two bits from the two halves of the hash
+        uint64_t b1 = h & seen.mask, b2 = (h >> 32 ^ h * 0x9e3779b97f4a7c15ULL) & seen.mask;
+        uint64_t old1 = atomic_fetch_or(&seen.bits[b1 >> 6], 1ULL << (b1 & 63));
+        uint64_t old2 = atomic_fetch_or(&seen.bits[b2 >> 6], 1ULL << (b2 & 63));
+        bool fresh = !(old1 & 1ULL << (b1 & 63)) || !(old2 & 1ULL << (b2 & 63));
+        if (fresh) {
+            atomic_fetch_add(&seen.used, 1);
+        }
+        return fresh;
+    }
+    for (uint64_t i = h & seen.mask; ; i = (i + 1) & seen.mask) {
+        uint64_t expected = 0;
+        if (atomic_compare_exchange_strong(&seen.slots[i].key, &expected, key + 1)) {
+            seen.slots[i].parent = parent;
+            if (atomic_fetch_add(&seen.used, 1) + 1 > seen.capacity) {
+                atomic_store(&seen.full, true);
+            }
+            return true;
+        }
+        if (expected == key + 1) {
+            return false;
+        }
+    }
+}
+
+static const slot_t *seen_find(uint64_t key)
+{
+    for (uint64_t i = mix(key) & seen.mask; ; i = (i + 1) & seen.mask) {
+        uint64_t k = atomic_load(&seen.slots[i].key);
+        if (k == key + 1) {
+            return &seen.slots[i];
+        }
+        if (k == 0) {
+            return NULL;
+        }
+    }
+}
+
+// First example of each broken invariant
+static struct {
+    atomic_size_t count;
+    atomic_bool taken;
+    uint64_t from;
+    int action;
+} examples[V_COUNT];
+
+typedef struct {
+    uint64_t *states;
+    size_t count;
+    size_t capacity;
+} level_t;
+
+static int level_push(level_t *level, uint64_t key)
+{
+    if (level->count == level->capacity) {
+        size_t grown = level->capacity ? level->capacity * 2 : 4096;
+        uint64_t *states = realloc(level->states, grown * sizeof(*states));
+        if (states == NULL) {
+            return -1;
+        }
+        level->states = states;
+        level->capacity = grown;
+    }
+    level->states[level->count++] = key;
+    return 0;
+}
+
+typedef struct {
+    pthread_t *threads;
+    long num_threads;
+    pthread_mutex_t lock;
+    pthread_cond_t start;
+    pthread_cond_t done;
+    uint64_t batch_id;
+    long finished;
+    bool quit;
+
+    // Current level
+    const uint64_t *states;
+    size_t count;
+    atomic_size_t next;
+    level_t *out;               // One next level per worker
+    atomic_size_t workers;      // Hands out the indexes into out
+    atomic_size_t transitions;
+    atomic_bool oom;
+} pool_t;
+
+static void expand(pool_t *pool, uint64_t key, level_t *out)
+{
+    model_t m;
+    move_t mv;
+    size_t transitions = 0;
+    decode(key, &m);
+    for (int a = 0; a < cfg.num_actions; a++) {
+        if (!play(&m, a, &mv)) {
+            continue;
+        }
+        transitions++;
+        if (mv.violation != V_NONE) {
+            atomic_fetch_add(&examples[mv.violation].count, 1);
+            if (!atomic_exchange(&examples[mv.violation].taken, true)) {
+                examples[mv.violation].from = key;
+                examples[mv.violation].action = a;
+            }
+        }
+        uint64_t child = store(&mv);
+        if (seen_insert(child, key | (uint64_t)a << 56) && level_push(out, child) != 0) {
+            atomic_store(&pool->oom, true);
+        }
+    }
+    atomic_fetch_add(&pool->transitions, transitions);
+}
+
+static void *worker(void *arg)
+{
+    pool_t *pool = arg;
+    uint64_t seen_batch = 0;
+    size_t self = atomic_fetch_add(&pool->workers, 1);
+
+    for (;;) {
+        pthread_mutex_lock(&pool->lock);
+        while (pool->batch_id == seen_batch && !pool->quit) {
+            pthread_cond_wait(&pool->start, &pool->lock);
+        }
+        if (pool->quit) {
+            pthread_mutex_unlock(&pool->lock);
+            return NULL;
+        }
+        seen_batch = pool->batch_id;
+        pthread_mutex_unlock(&pool->lock);
+
+        for (;;) {
+            size_t first = atomic_fetch_add(&pool->next, CHUNK_STATES);
+            if (first >= pool->count) {
+                break;
+            }
+            size_t last = first + CHUNK_STATES;
+            if (last > pool->count) {
+                last = pool->count;
+            }
+            for (size_t i = first; i < last; i++) {
+                expand(pool, pool->states[i], &pool->out[self]);
+            }
+        }
+
+        pthread_mutex_lock(&pool->lock);
+        if (++pool->finished == pool->num_threads) {
+            pthread_cond_signal(&pool->done);
+        }
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+static int pool_start(pool_t *pool, long threads)
+{
+    pool->threads = malloc((size_t)threads * sizeof(pthread_t));
+    pool->out = calloc((size_t)threads, sizeof(level_t));
+    if (pool->threads == NULL || pool->out == NULL) {
+        return -1;
+    }
+    pool->num_threads = threads;
+    pool->batch_id = 0;
+    pool->quit = false;
+    atomic_init(&pool->next, 0);
+    atomic_init(&pool->transitions, 0);
+    atomic_init(&pool->oom, false);
+    atomic_init(&pool->workers, 0);
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->start, NULL);
+    pthread_cond_init(&pool->done, NULL);
+    for (long i = 0; i < threads; i++) {
+        pthread_create(&pool->threads[i], NULL, worker, pool);
+    }
+    return 0;
+}
+
+// Expands one level; successors land in pool->out
+static void pool_run(pool_t *pool, const uint64_t *states, size_t count)
+{
+    pthread_mutex_lock(&pool->lock);
+    pool->states = states;
+    pool->count = count;
+    atomic_store(&pool->next, 0);
+    pool->finished = 0;
+    pool->batch_id++;
+    pthread_cond_broadcast(&pool->start);
+    while (pool->finished < pool->num_threads) {
+        pthread_cond_wait(&pool->done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+static void pool_stop(pool_t *pool)
+{
+    pthread_mutex_lock(&pool->lock);
+    pool->quit = true;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+    for (long i = 0; i < pool->num_threads; i++) {
+        pthread_join(pool->threads[i], NULL);
+        free(pool->out[i].states);
+    }
+    free(pool->threads);
+    free(pool->out);
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->start);
+    pthread_cond_destroy(&pool->done);
+}
+
+static void describe(uint64_t key, char *buf, size_t size)
+{
+    model_t m;
+    decode(key, &m);
+    int n = snprintf(buf, size, "%-15s %5.1f s | cross %-6s | plan %s%s", state_names[m.state],
+                     m.age * cfg.tick_us / 1e6, lamp_names[m.cross], plan_names[m.plan],
+                     m.flash == plans[m.plan].flash ? "" : (m.flash ? " +flash" : " -flash"));
+    if (m.preempt && n < (int)size) {
+        n += snprintf(buf + n, size - n, " | request %.1f s", m.preempt_age * cfg.tick_us / 1e6);
+    }
+    if (m.pending != NO_PLAN && n < (int)size) {
+        n += snprintf(buf + n, size - n, " | next %s", plan_names[m.pending]);
+    }
+    if (m.buzzer && n < (int)size) {
+        snprintf(buf + n, size - n, " | beeping");
+    }
+}
+
+static uint32_t describe_action(const model_t *m, int a, char *buf, size_t size)
+{
+    if (a == A_TICK) {
+        snprintf(buf, size, "tick");
+        return 1;
+    }
+    if (a == A_PREEMPT) {
+        snprintf(buf, size, "request %s", m->preempt ? "clears" : "arrives");
+    } else if (a == A_BEEP) {
+        snprintf(buf, size, "beep %s", m->buzzer ? "off" : "on");
+    } else if (a < A_PLAN + cfg.num_plans) {
+        snprintf(buf, size, "plan %s", plan_names[a - A_PLAN]);
+    } else if (a < cfg.cold_action) {
+        int w = a - cfg.warm_action;
+        snprintf(buf, size, "warm reset, %.1f s dark, input %s", (w / 2) * cfg.tick_us / 1e6,
+                 w % 2 ? "on" : "off");
+        return (uint32_t)(w / 2);
+    } else {
+        snprintf(buf, size, "cold start, input %s", a - cfg.cold_action ? "on" : "off");
+    }
+    return 0;
+}
+
+static void print_trace(violation_t kind)
+{
+    uint64_t path[1024];
+    int actions[1024];
+    int length = 0;
+    uint64_t key = examples[kind].from;
+    int action = examples[kind].action;
+    // Back to an initial state
+    while (length < 1024) {
+        path[length] = key;
+        actions[length] = action;
+        length++;
+        const slot_t *slot = seen_find(key);
+        if (slot == NULL || slot->parent >> 56 == ROOT) {
+            break;
+        }
+        action = (int)(slot->parent >> 56);
+        key = slot->parent & ((1ULL << 56) - 1);
+    }
+    char state[160], what[64];
+    uint32_t t = 0;
+    for (int i = length - 1; i >= 0; i--) {
+        model_t m;
+        decode(path[i], &m);
+        describe(path[i], state, sizeof(state));
+        printf("  %7.1f s  %s\n", t * cfg.tick_us / 1e6, state);
+        t += describe_action(&m, actions[i], what, sizeof(what));
+        printf("             -> %s\n", what);
+    }
+    move_t mv;
+    model_t m;
+    decode(examples[kind].from, &m);
+    play(&m, examples[kind].action, &mv);
+    describe(store(&mv), state, sizeof(state));
+    printf("  %7.1f s  %s\n", t * cfg.tick_us / 1e6, state);
+}
+
+static double elapsed_s(const struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr, "usage: %s [-t tick_ms] [-g gap_ms] [-R] [-D] [-j threads] [-m bits | -b bits]\n", argv0);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t tick_ms = 500, gap_ms = 1000;
+    int table_bits = 22, bitstate_bits = 0;
+    bool plan_changes = true;
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+    cfg.resets = true;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "t:g:RDj:m:b:")) != -1) {
+        switch (opt) {
+            case 't': tick_ms = (uint32_t)atoi(optarg); break;
+            case 'g': gap_ms = (uint32_t)atoi(optarg); break;
+            case 'R': cfg.resets = false; break;
+            case 'D': plan_changes = false; break;
+            case 'j': threads = atol(optarg); break;
+            case 'm': table_bits = atoi(optarg); break;
+            case 'b': bitstate_bits = atoi(optarg); break;
+            default: usage(argv[0]); return 2;
+        }
+    }
+    if (optind != argc || tick_ms == 0 || table_bits < 10 || table_bits > 34 ||
+        (bitstate_bits && (bitstate_bits < 16 || bitstate_bits > 40))) {
+        usage(argv[0]);
+        return 2;
+    }
+    if (threads < 1) {
+        threads = 1;
+    }
+
+    // Everything on the tick grid, every age in a byte
+    const uint32_t minimums[] = { base_config.all_red_ms, base_config.min_ready_ms,
+                                  base_config.min_yellow_ms, base_config.min_green_ms, gap_ms };
+    uint32_t longest = base_config.min_green_ms;
+    bool on_grid = true;
+    for (size_t i = 0; i < sizeof(minimums) / sizeof(minimums[0]); i++) {
+        on_grid &= minimums[i] % tick_ms == 0;
+    }
+    for (size_t p = 0; p < NUM_PLANS; p++) {
+        for (int s = 0; s < TRAFFIC_CYCLE_STATES; s++) {
+            on_grid &= plans[p].durations_ms[s] % tick_ms == 0;
+            if (plans[p].durations_ms[s] > longest) {
+                longest = plans[p].durations_ms[s];
+            }
+        }
+    }
+    cfg.tick_us = tick_ms * 1000ULL;
+    cfg.all_red = ticks(base_config.all_red_ms * 1000ULL);
+    cfg.min_ready = ticks(base_config.min_ready_ms * 1000ULL);
+    cfg.min_yellow = ticks(base_config.min_yellow_ms * 1000ULL);
+    cfg.min_green = ticks(base_config.min_green_ms * 1000ULL);
+    cfg.max_gap = cfg.resets ? ticks(gap_ms * 1000ULL) : 0;
+    cfg.age_cap = ticks(longest * 1000ULL) + 1;
+    // The worst plan's bound; a request still waiting one tick past it is a violation
+    uint64_t bound_us = 0;
+    for (size_t p = 0; p < NUM_PLANS; p++) {
+        traffic_fsm_config_t config = base_config;
+        config.plan = plans[p];
+        if (traffic_fsm_preempt_bound_us(&config) > bound_us) {
+            bound_us = traffic_fsm_preempt_bound_us(&config);
+        }
+    }
+    cfg.preempt_cap = ticks(bound_us) + 1;
+    if (cfg.preempt_cap < cfg.age_cap) {
+        cfg.preempt_cap = cfg.age_cap;
+    }
+    if (!on_grid || cfg.preempt_cap >= AGE_MAX || cfg.age_cap >= AGE_MAX) {
+        fprintf(stderr, "tick of %u ms: every duration must be a multiple, and under %u ticks\n",
+                tick_ms, AGE_MAX);
+        return 2;
+    }
+    cfg.num_plans = plan_changes ? NUM_PLANS : 0;
+    cfg.warm_action = A_PLAN + cfg.num_plans;
+    cfg.cold_action = cfg.warm_action + (cfg.resets ? 2 * (cfg.max_gap + 1) : 0);
+    cfg.num_actions = cfg.cold_action + (cfg.resets ? 2 : 0);
+
+    if (bitstate_bits) {
+        seen.mask = (1ULL << bitstate_bits) - 1;
+        seen.bits = calloc((size_t)1 << (bitstate_bits - 6), sizeof(uint64_t));
+        seen.capacity = SIZE_MAX;
+    } else {
+        seen.mask = (1ULL << table_bits) - 1;
+        seen.slots = calloc((size_t)1 << table_bits, sizeof(slot_t));
+        seen.capacity = (size_t)((seen.mask + 1) * MAX_LOAD);
+    }
+    if (seen.slots == NULL && seen.bits == NULL) {
+        fprintf(stderr, "out of memory for the visited set\n");
+        return 1;
+    }
+
+    // Cold starts under each plan, with and without a request
+    level_t level = {0};
+    for (uint8_t p = 0; p < (plan_changes ? NUM_PLANS : 1); p++) {
+        for (int input = 0; input < 2; input++) {
+            move_t mv;
+            model_t m = { .plan = p, .pending = NO_PLAN, .release_age = NONE };
+            load(&mv, &m);
+            cold_start(&mv, input);
+            uint64_t key = store(&mv);
+            if (seen_insert(key, key | ROOT << 56) && level_push(&level, key) != 0) {
+                fprintf(stderr, "out of memory\n");
+                return 1;
+            }
+        }
+    }
+
+    pool_t pool = {0};
+    if (pool_start(&pool, threads) != 0) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    size_t depth = 0, peak_level = 0;
+    while (level.count > 0 && !atomic_load(&seen.full) && !atomic_load(&pool.oom)) {
+        if (level.count > peak_level) {
+            peak_level = level.count;
+        }
+        pool_run(&pool, level.states, level.count);
+        depth++;
+        // Gather the workers' successors into the next level
+        level.count = 0;
+        for (long i = 0; i < threads; i++) {
+            level_t *out = &pool.out[i];
+            for (size_t j = 0; j < out->count; j++) {
+                if (level_push(&level, out->states[j]) != 0) {
+                    atomic_store(&pool.oom, true);
+                    break;
+                }
+            }
+            out->count = 0;
+        }
+    }
+    double seconds = elapsed_s(&start);
+    size_t states = atomic_load(&seen.used);
+    size_t transitions = atomic_load(&pool.transitions);
+    pool_stop(&pool);
+    free(level.states);
+
+    if (atomic_load(&seen.full) || atomic_load(&pool.oom)) {
+        fprintf(stderr, "visited set full after %zu states: raise -m or use -b\n", states);
+        return 1;
+    }
+    printf("Tick %u ms, %u plan(s), %s: %zu states, %zu transitions, depth %zu, widest level %zu\n",
+           tick_ms, plan_changes ? (unsigned)NUM_PLANS : 1u,
+           cfg.resets ? "warm and cold resets" : "no resets", states, transitions, depth, peak_level);
+    int broken = 0;
+    for (int v = 0; v < V_COUNT; v++) {
+        size_t count = atomic_load(&examples[v].count);
+        if (count == 0) {
+            continue;
+        }
+        broken++;
+        printf("VIOLATION: %s (%zu transitions)\n", violation_names[v], count);
+        if (seen.slots) {
+            print_trace((violation_t)v);
+        }
+    }
+    if (broken == 0) {
+        printf("All invariants hold in every reachable state\n");
+    }
+    fprintf(stderr, "%s search on %ld thread(s) in %.3f s (%.0f states/s, %.0f transitions/s), "
+            "visited set %.1f%% full\n", seen.bits ? "Bitstate" : "Exact", threads, seconds,
+            seconds > 0 ? states / seconds : 0.0, seconds > 0 ? transitions / seconds : 0.0,
+            100.0 * states / (double)(seen.bits ? (seen.mask + 1) / 2 : seen.mask + 1));
+    free(seen.slots);
+    free(seen.bits);
+    return broken ? 1 : 0;
+}
@@ -0,0 +1,522 @@
+/* Signal timing optimiser
+ *
+ * Picks RED/GREEN durations for a junction from recorded arrivals. Every
+ * candidate plan is run through the firmware state machine (traffic_fsm.c)
+ * by the delay model in delay_sim.c and scored by mean delay per vehicle.
+ * Candidates are evaluated in batches by a pool of worker threads, one per
+ * core by default, that claim candidates in chunks from a shared counter.
+ *
+ *     plan_optimiser [options] [arrivals.csv]
+ *       -S M,C,H        synthetic Poisson arrivals instead of a file: main and
+ *                       cross street veh/h over H hours (default 600,300,1)
+ *       -a grid|ga      exhaustive grid or genetic search (default grid)
+ *       -R MIN:MAX:STEP RED range in ms, the cross street's time (default 3000:60000:1000)
+ *       -G MIN:MAX:STEP GREEN range in ms (default 3000:60000:1000)
+ *       -y READY,CAUTION fixed yellow durations in ms (default 2000,2000)
+ *       -H MS           saturation headway (default 2000)
+ *       -l MS           start-up lost time (default 2000)
+ *       -p N            GA population (default 64)
+ *       -n N            GA generations (default 40)
+ *       -s SEED         GA and synthetic arrival seed (default 1)
+ *       -j N            worker threads (default: all cores)
+ *       -k N            best plans listed (default 10)
+ *       -B              scaling run: the grid on 1, 2, 4 ... -j threads
+ *
+ * The safety minimums are the firmware's; plans that break them are
+ * skipped. The GA works on the grid's cells and remembers every cell it
+ * has scored, so no plan is simulated twice.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "delay_sim.h"
+
+#define CHUNK_CANDIDATES    8       // Candidates claimed per worker grab
+#define TOURNAMENT          3
+#define ELITE               2
+
+// Project_6/main/main.c safety settings
+static const traffic_fsm_config_t base_config = {
+    .plan = { .durations_ms = { 5000, 2000, 5000, 2000 } },
+    .all_red_ms = 1000,
+    .min_ready_ms = 1000,
+    .min_yellow_ms = 2000,
+    .min_green_ms = 3000
+};
+
+typedef struct {
+    uint32_t min_ms;
+    uint32_t max_ms;
+    uint32_t step_ms;
+} range_t;
+
+typedef struct {
+    uint32_t red_ms;
+    uint32_t green_ms;
+    bool valid;
+    sim_result_t result;
+} candidate_t;
+
+typedef struct {
+    pthread_t *threads;
+    long num_threads;
+    pthread_mutex_t lock;
+    pthread_cond_t start;
+    pthread_cond_t done;
+    uint64_t batch_id;
+    long finished;
+    bool quit;
+
+    // Current batch
+    candidate_t *batch;
+    size_t count;
+    atomic_size_t next;
+
+    const arrivals_t *arrivals;
+    const sim_model_t *model;
+    traffic_fsm_config_t config;    // Yellow durations; RED and GREEN per candidate
+} pool_t;
+
+static void evaluate(pool_t *pool, candidate_t *c)
+{
+    traffic_fsm_config_t config = pool->config;
+    config.plan.durations_ms[TRAFFIC_RED] = c->red_ms;
+    config.plan.durations_ms[TRAFFIC_GREEN] = c->green_ms;
+    c->valid = sim_evaluate(&config, pool->arrivals, pool->model, &c->result);
+}
+
+static void *worker(void *arg)
+{
+    pool_t *pool = arg;
+    uint64_t seen = 0;
+
+    for (;;) {
+        pthread_mutex_lock(&pool->lock);
+        while (pool->batch_id == seen && !pool->quit) {
+            pthread_cond_wait(&pool->start, &pool->lock);
+        }
+        if (pool->quit) {
+            pthread_mutex_unlock(&pool->lock);
+            return NULL;
+        }
+        seen = pool->batch_id;
+        pthread_mutex_unlock(&pool->lock);
+
+        for (;;) {
+            size_t first = atomic_fetch_add(&pool->next, CHUNK_CANDIDATES);
+            if (first >= pool->count) {
+                break;
+            }
+            size_t last = first + CHUNK_CANDIDATES;
+            if (last > pool->count) {
+                last = pool->count;
+            }
+            for (size_t i = first; i < last; i++) {
+                evaluate(pool, &pool->batch[i]);
+            }
+        }
+
+        pthread_mutex_lock(&pool->lock);
+        if (++pool->finished == pool->num_threads) {
+            pthread_cond_signal(&pool->done);
+        }
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+static int pool_start(pool_t *pool, long threads)
+{
+    pool->threads = malloc((size_t)threads * sizeof(pthread_t));
+    if (pool->threads == NULL) {
+        return -1;
+    }
+    pool->num_threads = threads;
+    pool->batch_id = 0;
+    pool->quit = false;
+    atomic_init(&pool->next, 0);
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->start, NULL);
+    pthread_cond_init(&pool->done, NULL);
+    for (long i = 0; i < threads; i++) {
+        pthread_create(&pool->threads[i], NULL, worker, pool);
+    }
+    return 0;
+}
+
+// Evaluates every candidate of the batch and returns when all are done
+static void pool_run(pool_t *pool, candidate_t *batch, size_t count)
+{
+    pthread_mutex_lock(&pool->lock);
+    pool->batch = batch;
+    pool->count = count;
+    atomic_store(&pool->next, 0);
+    pool->finished = 0;
+    pool->batch_id++;
+    pthread_cond_broadcast(&pool->start);
+    while (pool->finished < pool->num_threads) {
+        pthread_cond_wait(&pool->done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+static void pool_stop(pool_t *pool)
+{
+    pthread_mutex_lock(&pool->lock);
+    pool->quit = true;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+    for (long i = 0; i < pool->num_threads; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+    free(pool->threads);
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->start);
+    pthread_cond_destroy(&pool->done);
+}
+
+static double score(const candidate_t *c)
+{
+    return c->valid ? c->result.mean_delay_s : INFINITY;
+}
+
+static int compare_candidates(const void *a, const void *b)
+{
+    double x = score(a), y = score(b);
+    return (x > y) - (x < y);
+}
+
+static uint32_t range_cells(const range_t *r)
+{
+    return (r->max_ms - r->min_ms) / r->step_ms + 1;
+}
+
+static size_t make_grid(const range_t *red, const range_t *green, candidate_t *out)
+{
+    size_t n = 0;
+    for (uint32_t i = 0; i < range_cells(red); i++) {
+        for (uint32_t j = 0; j < range_cells(green); j++) {
+            out[n++] = (candidate_t){
+                .red_ms = red->min_ms + i * red->step_ms,
+                .green_ms = green->min_ms + j * green->step_ms
+            };
+        }
+    }
+    return n;
+}
+
+static uint32_t rng_state;
+
+static uint32_t next_random(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+typedef struct {
+    uint32_t red;               // Cell indices
+    uint32_t green;
+} genome_t;
+
+static uint32_t mutate(uint32_t cell, uint32_t cells)
+{
+    // Mostly small moves, now and then a jump anywhere
+    if (next_random() % 8 == 0) {
+        return next_random() % cells;
+    }
+    int span = cells / 10 > 1 ? (int)(cells / 10) : 1;
+    int moved = (int)cell + (int)(next_random() % (2 * span + 1)) - span;
+    return moved < 0 ? 0 : moved >= (int)cells ? cells - 1 : (uint32_t)moved;
+}
+
+static const genome_t *tournament(const genome_t *population, const double *fitness, uint32_t size)
+{
+    uint32_t best = next_random() % size;
+    for (int i = 1; i < TOURNAMENT; i++) {
+        uint32_t other = next_random() % size;
+        if (fitness[other] < fitness[best]) {
+            best = other;
+        }
+    }
+    return &population[best];
+}
+
+// Genetic search over the grid cells; every scored cell lands in `memo`
+static size_t run_ga(pool_t *pool, const range_t *red, const range_t *green, uint32_t population_size,
+                     uint32_t generations, candidate_t *memo, bool *scored)
+{
+    uint32_t red_cells = range_cells(red), green_cells = range_cells(green);
+    genome_t *population = malloc(population_size * sizeof(genome_t));
+    genome_t *children = malloc(population_size * sizeof(genome_t));
+    double *fitness = malloc(population_size * sizeof(double));
+    candidate_t *batch = malloc(population_size * sizeof(candidate_t));
+    size_t *batch_cell = malloc(population_size * sizeof(size_t));
+    size_t scored_count = 0;
+    if (!population || !children || !fitness || !batch || !batch_cell) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+
+    for (uint32_t i = 0; i < population_size; i++) {
+        population[i] = (genome_t){ next_random() % red_cells, next_random() % green_cells };
+    }
+    for (uint32_t gen = 0; gen < generations; gen++) {
+        // Only cells never scored go to the pool
+        size_t n = 0;
+        for (uint32_t i = 0; i < population_size; i++) {
+            size_t cell = (size_t)population[i].red * green_cells + population[i].green;
+            bool queued = false;
+            for (size_t k = 0; k < n && !queued; k++) {
+                queued = batch_cell[k] == cell;
+            }
+            if (!scored[cell] && !queued) {
+                batch[n] = (candidate_t){
+                    .red_ms = red->min_ms + population[i].red * red->step_ms,
+                    .green_ms = green->min_ms + population[i].green * green->step_ms
+                };
+                batch_cell[n++] = cell;
+            }
+        }
+        pool_run(pool, batch, n);
+        for (size_t k = 0; k < n; k++) {
+            memo[batch_cell[k]] = batch[k];
+            scored[batch_cell[k]] = true;
+        }
+        scored_count += n;
+        for (uint32_t i = 0; i < population_size; i++) {
+            fitness[i] = score(&memo[(size_t)population[i].red * green_cells + population[i].green]);
+        }
+
+        // Elites carry over unchanged
+        for (uint32_t e = 0; e < ELITE && e < population_size; e++) {
+            uint32_t best = e;
+            for (uint32_t i = e + 1; i < population_size; i++) {
+                if (fitness[i] < fitness[best]) {
+                    best = i;
+                }
+            }
+            genome_t g = population[e];
+            population[e] = population[best];
+            population[best] = g;
+            double f = fitness[e];
+            fitness[e] = fitness[best];
+            fitness[best] = f;
+            children[e] = population[e];
+        }
+        for (uint32_t i = ELITE; i < population_size; i++) {
+            const genome_t *a = tournament(population, fitness, population_size);
+            const genome_t *b = tournament(population, fitness, population_size);
+            genome_t child = {
+                .red = (next_random() & 1) ? a->red : b->red,
+                .green = (next_random() & 1) ? a->green : b->green
+            };
+            if (next_random() % 3 == 0) {
+                child.red = mutate(child.red, red_cells);
+            }
+            if (next_random() % 3 == 0) {
+                child.green = mutate(child.green, green_cells);
+            }
+            children[i] = child;
+        }
+        genome_t *swap = population;
+        population = children;
+        children = swap;
+    }
+
+    free(population);
+    free(children);
+    free(fitness);
+    free(batch);
+    free(batch_cell);
+    return scored_count;
+}
+
+static double elapsed_s(const struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static bool parse_range(const char *text, range_t *r)
+{
+    unsigned min, max, step;
+    if (sscanf(text, "%u:%u:%u", &min, &max, &step) != 3 || step == 0 || max < min) {
+        return false;
+    }
+    *r = (range_t){ min, max, step };
+    return true;
+}
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr, "usage: %s [-S main,cross,hours] [-a grid|ga] [-R min:max:step] [-G min:max:step]\n"
+                    "       [-y ready,caution] [-H headway_ms] [-l lost_ms] [-p population]\n"
+                    "       [-n generations] [-s seed] [-j threads] [-k best] [-B] [arrivals.csv]\n", argv0);
+}
+
+int main(int argc, char **argv)
+{
+    range_t red = { 3000, 60000, 1000 };
+    range_t green = { 3000, 60000, 1000 };
+    sim_model_t model = { .headway_ms = 2000, .lost_ms = 2000, .drain_us = 3600000000ULL };
+    traffic_fsm_config_t config = base_config;
+    double main_vph = 600, cross_vph = 300, hours = 1;
+    bool ga = false, scaling = false;
+    uint32_t population = 64, generations = 40, seed = 1, best = 10;
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+
+    int opt;
+    while ((opt = getopt(argc, argv, "S:a:R:G:y:H:l:p:n:s:j:k:B")) != -1) {
+        switch (opt) {
+            case 'S':
+                if (sscanf(optarg, "%lf,%lf,%lf", &main_vph, &cross_vph, &hours) != 3 || hours <= 0) {
+                    usage(argv[0]);
+                    return 2;
+                }
+                break;
+            case 'a':
+                if (strcmp(optarg, "ga") != 0 && strcmp(optarg, "grid") != 0) {
+                    usage(argv[0]);
+                    return 2;
+                }
+                ga = strcmp(optarg, "ga") == 0;
+                break;
+            case 'R':
+            case 'G':
+                if (!parse_range(optarg, opt == 'R' ? &red : &green)) {
+                    usage(argv[0]);
+                    return 2;
+                }
+                break;
+            case 'y': {
+                unsigned ready, caution;
+                if (sscanf(optarg, "%u,%u", &ready, &caution) != 2) {
+                    usage(argv[0]);
+                    return 2;
+                }
+                config.plan.durations_ms[TRAFFIC_RED_TO_YELLOW] = ready;
+                config.plan.durations_ms[TRAFFIC_GREEN_TO_YELLOW] = caution;
+                break;
+            }
+            case 'H': model.headway_ms = (uint32_t)atoi(optarg); break;
+            case 'l': model.lost_ms = (uint32_t)atoi(optarg); break;
+            case 'p': population = (uint32_t)atoi(optarg); break;
+            case 'n': generations = (uint32_t)atoi(optarg); break;
+            case 's': seed = (uint32_t)atoi(optarg); break;
+            case 'j': threads = atol(optarg); break;
+            case 'k': best = (uint32_t)atoi(optarg); break;
+            case 'B': scaling = true; break;
+            default: usage(argv[0]); return 2;
+        }
+    }
+    if (optind < argc - 1 || model.headway_ms == 0 || population < ELITE + 1) {
+        usage(argv[0]);
+        return 2;
+    }
+    if (!traffic_fsm_plan_ok(&config, &config.plan)) {
+        fprintf(stderr, "yellow durations break the firmware's safety minimums\n");
+        return 2;
+    }
+    if (threads < 1) {
+        threads = 1;
+    }
+
+    arrivals_t arrivals;
+    int ret = optind < argc ? sim_load_arrivals(argv[optind], &arrivals)
+                            : sim_synthetic_arrivals(main_vph, cross_vph, hours, seed, &arrivals);
+    if (ret != 0) {
+        return 1;
+    }
+    size_t vehicles = arrivals.count[APPROACH_MAIN] + arrivals.count[APPROACH_CROSS];
+    fprintf(stderr, "%zu main and %zu cross arrivals over %.2f h\n", arrivals.count[APPROACH_MAIN],
+            arrivals.count[APPROACH_CROSS], arrivals.span_us / 3.6e9);
+
+    size_t cells = (size_t)range_cells(&red) * range_cells(&green);
+    candidate_t *all = calloc(cells, sizeof(candidate_t));
+    bool *scored = calloc(cells, sizeof(bool));
+    if (all == NULL || scored == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    pool_t pool = { .arrivals = &arrivals, .model = &model, .config = config };
+
+    if (scaling) {
+        // Same grid, growing thread counts
+        double base_rate = 0;
+        printf("threads,seconds,evals_per_s,speedup,efficiency\n");
+        for (long t = 1; ; t = t * 2 < threads ? t * 2 : threads) {
+            size_t n = make_grid(&red, &green, all);
+            pool_start(&pool, t);
+            struct timespec start;
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            pool_run(&pool, all, n);
+            double seconds = elapsed_s(&start);
+            pool_stop(&pool);
+            double rate = n / seconds;
+            if (t == 1) {
+                base_rate = rate;
+            }
+            printf("%ld,%.3f,%.0f,%.2f,%.2f\n", t, seconds, rate, rate / base_rate, rate / base_rate / t);
+            if (t == threads) {
+                break;
+            }
+        }
+        free(all);
+        free(scored);
+        sim_free_arrivals(&arrivals);
+        return 0;
+    }
+
+    pool_start(&pool, threads);
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    size_t evaluated;
+    if (ga) {
+        rng_state = seed ? seed : 1;
+        evaluated = run_ga(&pool, &red, &green, population, generations, all, scored);
+        // Keep only scored cells for the ranking
+        size_t n = 0;
+        for (size_t i = 0; i < cells; i++) {
+            if (scored[i]) {
+                all[n++] = all[i];
+            }
+        }
+        cells = n;
+    } else {
+        evaluated = make_grid(&red, &green, all);
+        pool_run(&pool, all, evaluated);
+    }
+    double seconds = elapsed_s(&start);
+    pool_stop(&pool);
+
+    qsort(all, cells, sizeof(candidate_t), compare_candidates);
+    printf("rank,red_ms,ready_ms,green_ms,caution_ms,cycle_ms,mean_delay_s,max_delay_s,unserved\n");
+    for (uint32_t i = 0; i < best && i < cells && all[i].valid; i++) {
+        const candidate_t *c = &all[i];
+        uint32_t cycle = c->red_ms + config.plan.durations_ms[TRAFFIC_RED_TO_YELLOW] + c->green_ms +
+                         config.plan.durations_ms[TRAFFIC_GREEN_TO_YELLOW];
+        printf("%u,%u,%u,%u,%u,%u,%.2f,%.1f,%zu\n", i + 1, c->red_ms,
+               config.plan.durations_ms[TRAFFIC_RED_TO_YELLOW], c->green_ms,
+               config.plan.durations_ms[TRAFFIC_GREEN_TO_YELLOW], cycle,
+               c->result.mean_delay_s, c->result.max_delay_s, c->result.unserved);
+    }
+    fprintf(stderr, "%s: %zu evaluations on %ld thread(s) in %.3f s (%.0f evals/s, %.1f M vehicles/s)\n",
+            ga ? "GA" : "Grid", evaluated, threads, seconds, seconds > 0 ? evaluated / seconds : 0.0,
+            seconds > 0 ? evaluated * (double)vehicles / seconds / 1e6 : 0.0);
+
+    bool found = cells > 0 && all[0].valid;
+    if (!found) {
+        fprintf(stderr, "no plan in range meets the safety minimums\n");
+    }
+    free(all);
+    free(scored);
+    sim_free_arrivals(&arrivals);
+    return found ? 0 : 1;
+}
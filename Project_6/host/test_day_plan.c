@@ -0,0 +1,373 @@
+/* Day plan host test
+ *
+ * Checks the binary-search lookup against a linear scan for every minute
+ * of the week, then runs the firmware state machine (traffic_fsm.c) under
+ * the firmware's weekly schedule for a simulated year, handing it a plan
+ * at every cycle start as main.c does. Every step must follow the cycle,
+ * every phase must last exactly what its plan says, plans may change only
+ * where a cycle ends, transition cycles must move each phase in even
+ * steps, and each scheduled change must be in force within a few cycles.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <time.h>
+#include "day_plan.h"
+
+#define YEAR_START      1735689600ULL   // 2025-01-01 00:00 UTC, a Wednesday
+#define YEAR_DAYS       365
+#define POLL_US         1000000         // Plan check while flashing, as FLASH_PLAN_CHECK_MS
+#define TRANSITION      2
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do { \
+    if (!(cond)) { \
+        printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+        printf(__VA_ARGS__); \
+        printf("\n"); \
+        failures++; \
+    } \
+} while (0)
+
+// Same plans and schedule as Project_6/main/main.c
+enum { OFF_PEAK, PEAK, WEEKEND, NIGHT_FLASH, PLAN_COUNT };
+
+static const traffic_plan_t plans[PLAN_COUNT] = {
+    [OFF_PEAK] = { .durations_ms = { 5000, 2000, 5000, 2000 } },
+    [PEAK] = { .durations_ms = { 4000, 2000, 9000, 3000 } },
+    [WEEKEND] = { .durations_ms = { 6000, 2000, 6000, 2000 } },
+    [NIGHT_FLASH] = { .durations_ms = { 5000, 2000, 5000, 2000 }, .flash = true }
+};
+
+#define WEEKDAY_PLANS(day) \
+    { DAY_PLAN_AT(day, 6, 0), OFF_PEAK }, \
+    { DAY_PLAN_AT(day, 7, 0), PEAK }, \
+    { DAY_PLAN_AT(day, 9, 30), OFF_PEAK }, \
+    { DAY_PLAN_AT(day, 16, 30), PEAK }, \
+    { DAY_PLAN_AT(day, 19, 0), OFF_PEAK }, \
+    { DAY_PLAN_AT(day, 23, 0), NIGHT_FLASH }
+#define WEEKEND_PLANS(day) \
+    { DAY_PLAN_AT(day, 8, 0), WEEKEND }, \
+    { DAY_PLAN_AT(day, 23, 30), NIGHT_FLASH }
+
+static const day_plan_switch_t switches[] = {
+    WEEKDAY_PLANS(0), WEEKDAY_PLANS(1), WEEKDAY_PLANS(2), WEEKDAY_PLANS(3), WEEKDAY_PLANS(4),
+    WEEKEND_PLANS(5), WEEKEND_PLANS(6)
+};
+
+static const day_plan_table_t table = {
+    .plans = plans,
+    .num_plans = PLAN_COUNT,
+    .switches = switches,
+    .num_switches = sizeof(switches) / sizeof(switches[0]),
+    .transition_cycles = TRANSITION
+};
+
+static const traffic_fsm_config_t fsm_config = {
+    .plan = { .durations_ms = { 5000, 2000, 5000, 2000 } },
+    .all_red_ms = 1000,
+    .min_ready_ms = 1000,
+    .min_yellow_ms = 2000,
+    .min_green_ms = 3000
+};
+
+static bool plan_equal(const traffic_plan_t *a, const traffic_plan_t *b)
+{
+    for (int i = 0; i < TRAFFIC_CYCLE_STATES; i++) {
+        if (a->durations_ms[i] != b->durations_ms[i]) {
+            return false;
+        }
+    }
+    return a->flash == b->flash;
+}
+
+static uint32_t week_minute_at(uint64_t sim_us)
+{
+    uint64_t secs = YEAR_START + sim_us / 1000000;
+    uint64_t days = secs / 86400;
+    // 1970-01-01 was a Thursday: day 3 counting from Monday
+    return (uint32_t)(((days + 3) % 7) * 24 * 60 + (secs % 86400) / 60);
+}
+
+static void test_lookup(void)
+{
+    CHECK(day_plan_check(&table), "firmware table valid");
+    for (uint32_t minute = 0; minute < DAY_PLAN_WEEK_MINUTES; minute++) {
+        // Linear reference: last switch point at or before, else last week's final one
+        uint16_t expect = table.num_switches - 1;
+        for (uint16_t i = 0; i < table.num_switches; i++) {
+            if (switches[i].minute <= minute) {
+                expect = i;
+            }
+        }
+        uint16_t got = day_plan_lookup(&table, minute);
+        CHECK(got == expect, "minute %u: switch %u, expected %u", minute, got, expect);
+    }
+    CHECK(day_plan_in_force(&table, DAY_PLAN_AT(0, 3, 0)) == NIGHT_FLASH, "Monday 03:00 flashes");
+    CHECK(day_plan_in_force(&table, DAY_PLAN_AT(2, 8, 0)) == PEAK, "Wednesday 08:00 is peak");
+    CHECK(day_plan_in_force(&table, DAY_PLAN_AT(6, 12, 0)) == WEEKEND, "Sunday noon is weekend");
+    CHECK(day_plan_week_minute(1, 0, 0) == 0, "Monday 00:00 is minute 0");
+    CHECK(day_plan_week_minute(0, 23, 59) == DAY_PLAN_WEEK_MINUTES - 1, "Sunday 23:59 is the last minute");
+
+    day_plan_switch_t bad[] = { { 100, OFF_PEAK }, { 100, PEAK } };
+    day_plan_table_t t = table;
+    t.switches = bad;
+    t.num_switches = 2;
+    CHECK(!day_plan_check(&t), "duplicate minute rejected");
+    bad[1].minute = DAY_PLAN_WEEK_MINUTES;
+    CHECK(!day_plan_check(&t), "minute past the week rejected");
+    bad[1].minute = 200;
+    bad[1].plan = PLAN_COUNT;
+    CHECK(!day_plan_check(&t), "missing plan rejected");
+
+    // Cost: the lookup runs once per cycle in the firmware
+    volatile uint32_t sink = 0;
+    const uint32_t runs = 10000000;
+    clock_t start = clock();
+    for (uint32_t i = 0; i < runs; i++) {
+        sink += day_plan_lookup(&table, (i * 7919) % DAY_PLAN_WEEK_MINUTES);
+    }
+    double ns = (double)(clock() - start) / CLOCKS_PER_SEC * 1e9 / runs;
+    printf("Lookup over %u switch points: %.1f ns\n", table.num_switches, ns);
+}
+
+static void test_transition(void)
+{
+    // Switch points ten minutes apart, then a change half way through
+    static const day_plan_switch_t sw[] = { { 0, OFF_PEAK }, { 10, PEAK }, { 20, WEEKEND } };
+    day_plan_table_t t = table;
+    t.switches = sw;
+    t.num_switches = 3;
+    day_plan_sched_t sched;
+    traffic_plan_t plan;
+    day_plan_start(&sched, &t, OFF_PEAK);
+
+    CHECK(!day_plan_next_cycle(&sched, 5, &plan), "no change while settled");
+    CHECK(day_plan_next_cycle(&sched, 10, &plan) && plan.durations_ms[TRAFFIC_GREEN] == 6333,
+          "first transition cycle, green %u", plan.durations_ms[TRAFFIC_GREEN]);
+    CHECK(day_plan_in_transition(&sched), "easing");
+    CHECK(day_plan_next_cycle(&sched, 10, &plan) && plan.durations_ms[TRAFFIC_GREEN] == 7666,
+          "second transition cycle, green %u", plan.durations_ms[TRAFFIC_GREEN]);
+    CHECK(day_plan_next_cycle(&sched, 10, &plan) && plan_equal(&plan, &plans[PEAK]), "peak reached");
+    CHECK(!day_plan_in_transition(&sched), "settled");
+
+    day_plan_start(&sched, &t, OFF_PEAK);
+    day_plan_next_cycle(&sched, 10, &plan);
+    uint32_t green = plan.durations_ms[TRAFFIC_GREEN];
+    day_plan_next_cycle(&sched, 20, &plan);
+    // From 6333 towards 6000, a third of the way
+    CHECK(plan.durations_ms[TRAFFIC_GREEN] == green - (green - 6000) / 3,
+          "change mid-transition eases from the running timing, green %u", plan.durations_ms[TRAFFIC_GREEN]);
+}
+
+static void test_flash_preempt(void)
+{
+    // A preemption during the night flash: straight to RED, then the
+    // safety minimums, then back to flashing after one cycle
+    traffic_fsm_config_t config = fsm_config;
+    config.plan = plans[NIGHT_FLASH];
+    traffic_fsm_t fsm;
+    traffic_fsm_step_t step;
+    CHECK(traffic_fsm_init(&fsm, &config, TRAFFIC_FLASH, 0), "flash start");
+    CHECK(traffic_fsm_deadline(&fsm) == TRAFFIC_FSM_HELD, "flash held");
+    traffic_fsm_set_preempt(&fsm, true, 5000000);
+    CHECK(traffic_fsm_advance(&fsm, 5000000, &step) && step.to == TRAFFIC_RED, "flash left at once");
+    CHECK(traffic_fsm_deadline(&fsm) == 6000000, "all-red only");
+    traffic_fsm_advance(&fsm, 6000000, &step);
+    CHECK(traffic_fsm_deadline(&fsm) == 7000000, "ready minimum");
+    traffic_fsm_advance(&fsm, 7000000, &step);
+    CHECK(fsm.state == TRAFFIC_GREEN && traffic_fsm_deadline(&fsm) == TRAFFIC_FSM_HELD, "green held");
+    traffic_fsm_set_preempt(&fsm, false, 20000000);
+    traffic_fsm_advance(&fsm, traffic_fsm_deadline(&fsm), &step);
+    traffic_fsm_advance(&fsm, traffic_fsm_deadline(&fsm), &step);
+    CHECK(step.from == TRAFFIC_GREEN_TO_YELLOW && step.to == TRAFFIC_FLASH, "back to flashing");
+
+    // A request already active at the end of the cycle skips the flash
+    traffic_fsm_init(&fsm, &config, TRAFFIC_GREEN_TO_YELLOW, 0);
+    traffic_fsm_set_preempt(&fsm, true, 1000000);
+    traffic_fsm_advance(&fsm, traffic_fsm_deadline(&fsm), &step);
+    CHECK(step.to == TRAFFIC_RED, "preempted cycle end goes to RED");
+}
+
+static bool legal_step(traffic_state_t from, traffic_state_t to)
+{
+    switch (from) {
+        case TRAFFIC_GREEN_TO_YELLOW:
+            return to == TRAFFIC_RED || to == TRAFFIC_FLASH;
+        case TRAFFIC_FLASH:
+            return to == TRAFFIC_RED;
+        default:
+            return to == from + 1;
+    }
+}
+
+// The firmware's update_day_plan(): hand the signal the next cycle's plan
+static void update_plan(day_plan_sched_t *sched, traffic_fsm_t *fsm, uint64_t now, uint32_t *changes)
+{
+    traffic_plan_t plan;
+    if (day_plan_next_cycle(sched, week_minute_at(now), &plan)) {
+        CHECK(traffic_fsm_set_plan(fsm, &plan), "scheduled plan rejected");
+        (*changes)++;
+    }
+}
+
+static void test_year(void)
+{
+    uint64_t end = YEAR_DAYS * 86400ULL * 1000000;
+    day_plan_sched_t sched;
+    traffic_fsm_t fsm;
+    traffic_fsm_step_t step;
+
+    // Cold start on the plan in force, flashing at night
+    uint8_t first = day_plan_in_force(&table, week_minute_at(0));
+    day_plan_start(&sched, &table, first);
+    traffic_fsm_config_t config = fsm_config;
+    config.plan = plans[first];
+    CHECK(traffic_fsm_init(&fsm, &config, plans[first].flash ? TRAFFIC_FLASH : TRAFFIC_RED, 0), "start");
+
+    // Largest per-cycle step of each phase a transition may take
+    uint32_t max_step[TRAFFIC_CYCLE_STATES] = {0};
+    uint32_t longest_cycle = 0;
+    for (int a = 0; a < PLAN_COUNT; a++) {
+        uint32_t cycle = 0;
+        for (int i = 0; i < TRAFFIC_CYCLE_STATES; i++) {
+            cycle += plans[a].durations_ms[i];
+            for (int b = 0; b < PLAN_COUNT; b++) {
+                if (plans[a].flash || plans[b].flash) {
+                    continue;
+                }
+                uint32_t diff = abs((int)plans[a].durations_ms[i] - (int)plans[b].durations_ms[i]);
+                uint32_t per_cycle = (diff + TRANSITION) / (TRANSITION + 1);
+                if (per_cycle > max_step[i]) {
+                    max_step[i] = per_cycle;
+                }
+            }
+        }
+        if (cycle > longest_cycle) {
+            longest_cycle = cycle;
+        }
+    }
+    uint64_t settle_bound = (uint64_t)(TRANSITION + 2) * longest_cycle * 1000;
+
+    uint64_t now = 0, entered = 0;
+    traffic_plan_t state_plan = fsm.config.plan;    // Plan the current state began under
+    traffic_plan_t cycle_plan = fsm.config.plan;    // Plan of the current cycle
+    traffic_plan_t prev_cycle = fsm.config.plan;
+    bool have_prev = false;
+    uint32_t cycles = 0, changes = 0, switches_seen = 0, flashes = 0;
+    uint64_t flash_us = 0, scheduled_flash_us = 0, max_settle = 0;
+
+    // Scheduled target and when it last changed, minute by minute
+    uint8_t scheduled = first;
+    uint64_t scheduled_at = 0;
+    bool settled = true;
+    uint64_t next_minute = 60000000;
+
+    while (now < end) {
+        uint64_t deadline = traffic_fsm_deadline(&fsm);
+        uint64_t next = deadline == TRAFFIC_FSM_HELD ? now + POLL_US : deadline;
+
+        // Follow the schedule a minute at a time, to score settling
+        while (next_minute <= next) {
+            if (scheduled == NIGHT_FLASH) {
+                scheduled_flash_us += 60000000;
+            }
+            uint8_t target = day_plan_in_force(&table, week_minute_at(next_minute));
+            if (target != scheduled) {
+                CHECK(settled, "schedule moved on before plan %u was in force", scheduled);
+                scheduled = target;
+                scheduled_at = next_minute;
+                settled = false;
+                switches_seen++;
+            }
+            next_minute += 60000000;
+        }
+
+        now = next;
+        bool stepped;
+        if (deadline == TRAFFIC_FSM_HELD) {
+            update_plan(&sched, &fsm, now, &changes);
+            stepped = traffic_fsm_advance(&fsm, now, &step);
+        } else {
+            stepped = traffic_fsm_advance(&fsm, now, &step);
+            CHECK(stepped, "due deadline did not step");
+        }
+        if (!stepped) {
+            continue;
+        }
+
+        uint64_t length = step.at_us - entered;
+        CHECK(legal_step(step.from, step.to), "illegal step %d -> %d", step.from, step.to);
+        if (step.from == TRAFFIC_FLASH) {
+            flash_us += length;
+        } else {
+            CHECK(length == state_plan.durations_ms[step.from] * 1000ULL,
+                  "state %d lasted %llu us, plan says %u ms", step.from,
+                  (unsigned long long)length, state_plan.durations_ms[step.from]);
+        }
+        entered = step.at_us;
+
+        if (step.to == TRAFFIC_RED) {
+            cycle_plan = fsm.config.plan;
+            if (have_prev && !prev_cycle.flash && !cycle_plan.flash) {
+                for (int i = 0; i < TRAFFIC_CYCLE_STATES; i++) {
+                    uint32_t diff = abs((int)cycle_plan.durations_ms[i] - (int)prev_cycle.durations_ms[i]);
+                    CHECK(diff <= max_step[i], "phase %d jumped %u ms between cycles", i, diff);
+                }
+            }
+            prev_cycle = cycle_plan;
+            have_prev = true;
+            cycles++;
+            update_plan(&sched, &fsm, now, &changes);
+        } else if (step.to == TRAFFIC_FLASH) {
+            // Nothing to ease across a night flash
+            have_prev = false;
+            flashes++;
+        } else {
+            CHECK(plan_equal(&fsm.config.plan, &cycle_plan), "plan changed inside a cycle");
+        }
+        state_plan = fsm.config.plan;
+
+        // In force: cycling on exactly the scheduled plan, or flashing for it
+        bool in_force = plans[scheduled].flash ? step.to == TRAFFIC_FLASH
+                                               : step.to == TRAFFIC_RED && plan_equal(&cycle_plan, &plans[scheduled]);
+        if (!settled && in_force) {
+            settled = true;
+            uint64_t delay = now - scheduled_at;
+            CHECK(delay <= settle_bound, "plan %u took %llu ms to take over", scheduled,
+                  (unsigned long long)(delay / 1000));
+            if (delay > max_settle) {
+                max_settle = delay;
+            }
+        }
+    }
+
+    printf("%d days: %u cycles, %u schedule changes, %u plans handed to the signal\n",
+           YEAR_DAYS, cycles, switches_seen, changes);
+    printf("Night flash %.1f h, scheduled %.1f h; slowest takeover %.1f s (bound %.1f s)\n",
+           flash_us / 3.6e9, scheduled_flash_us / 3.6e9, max_settle / 1e6, settle_bound / 1e6);
+    // 52 weeks of 30 weekday and 4 weekend switch points, plus a day
+    CHECK(switches_seen > 52 * 34, "only %u schedule changes", switches_seen);
+    // Each flash starts up to two cycles late (seen at a cycle start, taken
+    // at its end) and ends within a poll of its scheduled minute
+    int64_t flash_error = (int64_t)flash_us - (int64_t)scheduled_flash_us;
+    int64_t flash_slack = (int64_t)flashes * (2LL * longest_cycle * 1000 + POLL_US);
+    CHECK(flash_error <= flash_slack && -flash_error <= flash_slack, "flash time off by %.2f h over %u nights",
+          flash_error / 3.6e9, flashes);
+}
+
+int main(void)
+{
+    test_lookup();
+    test_transition();
+    test_flash_preempt();
+    test_year();
+    if (failures) {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("All day plan checks passed\n");
+    return 0;
+}
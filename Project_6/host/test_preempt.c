@@ -0,0 +1,308 @@
+/* Emergency preemption host test
+ *
+ * Drives the firmware state machine (traffic_fsm.c) the way the signal
+ * ISRs do: alarms at each deadline and preemption requests at random
+ * edges, every one of them entering its ISR 2-60 us late. Checks that
+ * every step follows the cycle and respects the safety minimums, that
+ * GREEN is never left while a request is active, and that every request
+ * reaches GREEN within the configured bound. Prints the latency
+ * distribution from request edge to first light change and to GREEN.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "traffic_fsm.h"
+
+#define SIM_HOURS       24
+#define MAX_LATENCY_US  60
+#define MAX_SAMPLES     200000
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do { \
+    if (!(cond)) { \
+        printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+        printf(__VA_ARGS__); \
+        printf("\n"); \
+        failures++; \
+    } \
+} while (0)
+
+// Same timing as Project_6/main/main.c
+static const traffic_fsm_config_t config = {
+    .plan = { .durations_ms = { 5000, 2000, 5000, 2000 } },
+    .all_red_ms = 1000,
+    .min_ready_ms = 1000,
+    .min_yellow_ms = 2000,
+    .min_green_ms = 3000
+};
+
+static uint32_t seed = 2024;
+
+static uint32_t next_random(void)
+{
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+}
+
+static uint64_t random_between(uint64_t lo, uint64_t hi)
+{
+    return lo + next_random() % (hi - lo + 1);
+}
+
+static uint64_t isr_latency_us(void)
+{
+    return random_between(2, MAX_LATENCY_US);
+}
+
+// Shortest a state may last, whatever the requests did
+static uint64_t min_length_us(traffic_state_t state)
+{
+    switch (state) {
+        case TRAFFIC_RED:
+            return config.all_red_ms * 1000ULL;
+        case TRAFFIC_RED_TO_YELLOW:
+            return config.min_ready_ms * 1000ULL;
+        default:
+            // GREEN is only ever extended, GREEN_TO_YELLOW never shortened
+            return config.plan.durations_ms[state] * 1000ULL;
+    }
+}
+
+typedef struct {
+    traffic_fsm_t fsm;
+    uint64_t entered_us;
+    bool requested_in_state;    // A request was active at some point in this state
+    uint32_t steps;
+} sim_t;
+
+static void sim_init(sim_t *sim)
+{
+    CHECK(traffic_fsm_init(&sim->fsm, &config, TRAFFIC_RED, 0), "config accepted");
+    sim->entered_us = 0;
+    sim->requested_in_state = false;
+    sim->steps = 0;
+}
+
+static void check_step(sim_t *sim, const traffic_fsm_step_t *step, uint64_t latency_slack_us)
+{
+    uint64_t length = step->at_us - sim->entered_us;
+    CHECK(step->to == (step->from + 1) % TRAFFIC_CYCLE_STATES, "step %d -> %d skips a state",
+          step->from, step->to);
+    CHECK(length >= min_length_us(step->from), "state %d lasted %llu us, minimum %llu",
+          step->from, (unsigned long long)length, (unsigned long long)min_length_us(step->from));
+    CHECK(!(step->from == TRAFFIC_GREEN && step->preempt), "GREEN left while preempted");
+    if (!sim->requested_in_state) {
+        uint64_t full = config.plan.durations_ms[step->from] * 1000ULL;
+        CHECK(length >= full && length <= full + latency_slack_us,
+              "undisturbed state %d lasted %llu us", step->from, (unsigned long long)length);
+    }
+    sim->entered_us = step->at_us;
+    sim->requested_in_state = sim->fsm.preempt;
+    sim->steps++;
+}
+
+// Runs alarms up to `until_us`, with no latency
+static void run_until(sim_t *sim, uint64_t until_us)
+{
+    traffic_fsm_step_t step;
+    for (;;) {
+        uint64_t deadline = traffic_fsm_deadline(&sim->fsm);
+        if (deadline > until_us) {
+            break;
+        }
+        CHECK(traffic_fsm_advance(&sim->fsm, deadline, &step), "due deadline steps");
+        check_step(sim, &step, 0);
+    }
+}
+
+static void set_request(sim_t *sim, bool active, uint64_t at_us)
+{
+    traffic_fsm_set_preempt(&sim->fsm, active, at_us);
+    sim->requested_in_state |= active;
+    traffic_fsm_step_t step;
+    if (traffic_fsm_advance(&sim->fsm, at_us, &step)) {
+        check_step(sim, &step, 0);
+    }
+}
+
+static void test_plain_cycle(void)
+{
+    sim_t sim;
+    sim_init(&sim);
+    run_until(&sim, 100 * 14000000ULL);
+    CHECK(sim.steps == 400, "%u steps in 100 cycles", sim.steps);
+}
+
+static void test_worst_case(void)
+{
+    // Request as the caution YELLOW begins: full yellow, all-red, ready
+    sim_t sim;
+    sim_init(&sim);
+    uint64_t yellow_start = 12000000;
+    run_until(&sim, yellow_start);
+    CHECK(sim.fsm.state == TRAFFIC_GREEN_TO_YELLOW, "in caution yellow");
+    set_request(&sim, true, yellow_start);
+    uint64_t bound = traffic_fsm_preempt_bound_us(&config);
+    run_until(&sim, yellow_start + bound - 1);
+    CHECK(sim.fsm.state == TRAFFIC_RED_TO_YELLOW, "still clearing 1 us before the bound");
+    run_until(&sim, yellow_start + bound);
+    CHECK(sim.fsm.state == TRAFFIC_GREEN, "green at the bound");
+
+    // Held for a minute, then min_green after release
+    run_until(&sim, yellow_start + bound + 60000000);
+    CHECK(sim.fsm.state == TRAFFIC_GREEN, "green held");
+    uint64_t release = yellow_start + bound + 60000000;
+    set_request(&sim, false, release);
+    run_until(&sim, release + config.min_green_ms * 1000ULL - 1);
+    CHECK(sim.fsm.state == TRAFFIC_GREEN, "green kept after release");
+    run_until(&sim, release + config.min_green_ms * 1000ULL);
+    CHECK(sim.fsm.state == TRAFFIC_GREEN_TO_YELLOW, "cycle resumes");
+}
+
+static void test_red(void)
+{
+    // In the all-red the cross street has had no green: RED ends with it
+    sim_t sim;
+    sim_init(&sim);
+    run_until(&sim, 500000);
+    set_request(&sim, true, 500000);
+    run_until(&sim, 999999);
+    CHECK(sim.fsm.state == TRAFFIC_RED, "all-red kept");
+    run_until(&sim, 1000000);
+    CHECK(sim.fsm.state == TRAFFIC_RED_TO_YELLOW, "switched after the all-red");
+
+    // Later the cross street gets its yellow first, even if the request
+    // clears meanwhile
+    sim_init(&sim);
+    run_until(&sim, 1500000);
+    set_request(&sim, true, 1500000);
+    set_request(&sim, false, 2000000);
+    uint64_t yellow_end = 1500000 + config.min_yellow_ms * 1000ULL;
+    run_until(&sim, yellow_end - 1);
+    CHECK(sim.fsm.state == TRAFFIC_RED, "cross street yellow kept");
+    run_until(&sim, yellow_end);
+    CHECK(sim.fsm.state == TRAFFIC_RED_TO_YELLOW && sim.entered_us == yellow_end,
+          "switched after the cross street yellow");
+}
+
+static void test_immediate(void)
+{
+    // Past min_ready in RED_TO_YELLOW the request switches at once
+    sim_t sim;
+    sim_init(&sim);
+    uint64_t ready_start = config.plan.durations_ms[TRAFFIC_RED] * 1000ULL;
+    run_until(&sim, ready_start + 1500000);
+    set_request(&sim, true, ready_start + 1500000);
+    CHECK(sim.fsm.state == TRAFFIC_GREEN && sim.entered_us == ready_start + 1500000, "switched on the edge");
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void print_distribution(const char *name, uint64_t *samples, uint32_t count)
+{
+    if (count == 0) {
+        return;
+    }
+    qsort(samples, count, sizeof(samples[0]), compare_u64);
+    printf("%-22s n=%-6u min %9.3f  p50 %9.3f  p90 %9.3f  p99 %9.3f  max %9.3f ms\n", name, count,
+           samples[0] / 1000.0, samples[count / 2] / 1000.0, samples[count * 9 / 10] / 1000.0,
+           samples[count * 99 / 100] / 1000.0, samples[count - 1] / 1000.0);
+}
+
+static uint64_t first_change[MAX_SAMPLES];
+static uint64_t to_green[MAX_SAMPLES];
+
+static void test_random_preempts(void)
+{
+    sim_t sim;
+    sim_init(&sim);
+    uint64_t end = SIM_HOURS * 3600000000ULL;
+    uint64_t bound = traffic_fsm_preempt_bound_us(&config);
+    uint64_t next_edge = random_between(1000000, 60000000);
+    bool active = false;
+    uint64_t edge_at = 0;
+    bool awaiting_change = false, awaiting_green = false;
+    uint32_t requests = 0, already_green = 0, changes = 0, greens = 0, immediate = 0;
+
+    while (next_edge < end) {
+        uint64_t deadline = traffic_fsm_deadline(&sim.fsm);
+        traffic_fsm_step_t step;
+        bool stepped;
+        uint64_t now;
+
+        if (deadline <= next_edge) {
+            now = deadline + isr_latency_us();
+            stepped = traffic_fsm_advance(&sim.fsm, now, &step);
+            CHECK(stepped, "alarm without a step");
+        } else {
+            // Input ISR: the request changes, then the machine runs at once
+            active = !active;
+            now = next_edge + isr_latency_us();
+            traffic_fsm_set_preempt(&sim.fsm, active, now);
+            sim.requested_in_state |= active;
+            if (active) {
+                requests++;
+                edge_at = next_edge;
+                awaiting_change = sim.fsm.state != TRAFFIC_GREEN;
+                awaiting_green = awaiting_change;
+                already_green += !awaiting_change;
+            } else {
+                awaiting_change = awaiting_green = false;
+            }
+            stepped = traffic_fsm_advance(&sim.fsm, now, &step);
+            if (stepped && active) {
+                immediate++;
+            }
+            // Mostly vehicles 5-60 s apart, some detector chatter
+            bool chatter = next_random() % 10 < 3;
+            next_edge += chatter ? random_between(1000, 500000)
+                                 : (active ? random_between(1000000, 20000000)
+                                           : random_between(5000000, 60000000));
+        }
+        if (!stepped) {
+            continue;
+        }
+        check_step(&sim, &step, MAX_LATENCY_US);
+        if (awaiting_change && changes < MAX_SAMPLES) {
+            first_change[changes++] = step.at_us - edge_at;
+            awaiting_change = false;
+        }
+        if (awaiting_green && step.to == TRAFFIC_GREEN && greens < MAX_SAMPLES) {
+            uint64_t wait = step.at_us - edge_at;
+            CHECK(wait <= bound + MAX_LATENCY_US, "request waited %llu us for green, bound %llu",
+                  (unsigned long long)wait, (unsigned long long)bound);
+            to_green[greens++] = wait;
+            awaiting_green = false;
+        }
+    }
+
+    printf("%d h simulated: %u steps, %u requests (%u already green, %u switched in the input ISR)\n",
+           SIM_HOURS, sim.steps, requests, already_green, immediate);
+    print_distribution("Edge to first change", first_change, changes);
+    print_distribution("Edge to green", to_green, greens);
+    printf("Bound: %.3f ms + ISR latency\n", bound / 1000.0);
+    CHECK(requests > 1000, "only %u requests simulated", requests);
+}
+
+int main(void)
+{
+    test_plain_cycle();
+    test_worst_case();
+    test_red();
+    test_immediate();
+    test_random_preempts();
+    if (failures) {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("All preemption checks passed\n");
+    return 0;
+}
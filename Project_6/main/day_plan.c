@@ -0,0 +1,105 @@
+/* Time-of-day signal plans
+ *
+ * Transition cycle k of n runs every phase at from + (to - from) * k / (n + 1),
+ * so neither end is repeated and each phase moves by the same amount per
+ * cycle. A phase between two safe plans is itself safe: it lies between
+ * two values that both meet its minimum. A change of plan in the middle
+ * of a transition starts the next one from the timing last handed out.
+ */
+#include "day_plan.h"
+
+static bool plan_equal(const traffic_plan_t *a, const traffic_plan_t *b)
+{
+    for (int i = 0; i < TRAFFIC_CYCLE_STATES; i++) {
+        if (a->durations_ms[i] != b->durations_ms[i]) {
+            return false;
+        }
+    }
+    return a->flash == b->flash;
+}
+
+bool day_plan_check(const day_plan_table_t *table)
+{
+    if (table->num_plans == 0 || table->num_switches == 0) {
+        return false;
+    }
+    for (uint16_t i = 0; i < table->num_switches; i++) {
+        if (table->switches[i].minute >= DAY_PLAN_WEEK_MINUTES ||
+            table->switches[i].plan >= table->num_plans ||
+            (i > 0 && table->switches[i].minute <= table->switches[i - 1].minute)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+uint16_t day_plan_lookup(const day_plan_table_t *table, uint32_t week_minute)
+{
+    // Last switch point at or before week_minute
+    uint16_t lo = 0;
+    uint16_t hi = table->num_switches;
+    while (lo < hi) {
+        uint16_t mid = (lo + hi) / 2;
+        if (table->switches[mid].minute <= week_minute) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    // None yet this week: last week's final switch point still holds
+    return lo > 0 ? lo - 1 : table->num_switches - 1;
+}
+
+uint8_t day_plan_in_force(const day_plan_table_t *table, uint32_t week_minute)
+{
+    return table->switches[day_plan_lookup(table, week_minute)].plan;
+}
+
+uint32_t day_plan_week_minute(int wday, int hour, int minute)
+{
+    return DAY_PLAN_AT((wday + 6) % 7, hour, minute);
+}
+
+void day_plan_start(day_plan_sched_t *sched, const day_plan_table_t *table, uint8_t plan)
+{
+    sched->table = table;
+    sched->target = plan;
+    sched->step = table->transition_cycles;
+    sched->current = table->plans[sched->target];
+    sched->from = sched->current;
+}
+
+bool day_plan_next_cycle(day_plan_sched_t *sched, uint32_t week_minute, traffic_plan_t *out)
+{
+    const day_plan_table_t *table = sched->table;
+    uint8_t target = day_plan_in_force(table, week_minute);
+    const traffic_plan_t *to = &table->plans[target];
+
+    if (target != sched->target) {
+        sched->target = target;
+        sched->from = sched->current;
+        // Nothing to ease into or out of when flashing
+        sched->step = (to->flash || sched->current.flash) ? table->transition_cycles : 0;
+    }
+
+    traffic_plan_t next = *to;
+    if (sched->step < table->transition_cycles) {
+        sched->step++;
+        uint32_t parts = table->transition_cycles + 1;
+        for (int i = 0; i < TRAFFIC_CYCLE_STATES; i++) {
+            int64_t from_ms = sched->from.durations_ms[i];
+            int64_t delta = (int64_t)to->durations_ms[i] - from_ms;
+            next.durations_ms[i] = (uint32_t)(from_ms + delta * sched->step / (int64_t)parts);
+        }
+    }
+
+    bool changed = !plan_equal(&next, &sched->current);
+    sched->current = next;
+    *out = next;
+    return changed;
+}
+
+bool day_plan_in_transition(const day_plan_sched_t *sched)
+{
+    return sched->step < sched->table->transition_cycles;
+}
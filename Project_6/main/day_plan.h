@@ -0,0 +1,59 @@
+/* Time-of-day signal plans
+ * A weekly table of switch points, sorted by minute of the week (Monday
+ * 00:00 is minute 0), each naming the timing plan that runs from then on;
+ * before the first switch point the last one of the previous week still
+ * holds. The lookup is a binary search, so asking once per cycle costs a
+ * handful of comparisons.
+ *
+ * The scheduler hands out one plan per cycle. When the scheduled plan
+ * changes between two cycling plans it eases over `transition_cycles`
+ * cycles, each phase stepping evenly from the old duration to the new;
+ * changes to or from a night flash plan take effect at once. Plain C, so
+ * the host tests run it over a simulated year.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "traffic_fsm.h"
+
+#define DAY_PLAN_WEEK_MINUTES   (7 * 24 * 60)
+
+// Minute of the week; day 0 is Monday
+#define DAY_PLAN_AT(day, hour, minute)  ((day) * 24 * 60 + (hour) * 60 + (minute))
+
+typedef struct {
+    uint16_t minute;            // Minute of the week the plan starts
+    uint8_t plan;               // Index into the plan table
+} day_plan_switch_t;
+
+typedef struct {
+    const traffic_plan_t *plans;
+    uint8_t num_plans;
+    const day_plan_switch_t *switches;
+    uint16_t num_switches;
+    uint8_t transition_cycles;
+} day_plan_table_t;
+
+typedef struct {
+    const day_plan_table_t *table;
+    uint8_t target;             // Plan the schedule asks for
+    uint8_t step;               // Transition cycles handed out so far
+    traffic_plan_t from;        // Timing the transition started from
+    traffic_plan_t current;     // Timing of the last cycle handed out
+} day_plan_sched_t;
+
+// False if the switch points are unsorted or name a missing plan
+bool day_plan_check(const day_plan_table_t *table);
+// Switch point in force at `week_minute`
+uint16_t day_plan_lookup(const day_plan_table_t *table, uint32_t week_minute);
+// Plan in force at `week_minute`
+uint8_t day_plan_in_force(const day_plan_table_t *table, uint32_t week_minute);
+// Monday-based minute of the week; wday as in struct tm (0 is Sunday)
+uint32_t day_plan_week_minute(int wday, int hour, int minute);
+// Settles on `plan`, with no transition
+void day_plan_start(day_plan_sched_t *sched, const day_plan_table_t *table, uint8_t plan);
+// Timing for the next cycle; true if it differs from the previous one
+bool day_plan_next_cycle(day_plan_sched_t *sched, uint32_t week_minute, traffic_plan_t *out);
+// True while easing from one plan to another
+bool day_plan_in_transition(const day_plan_sched_t *sched);
@@ -4,6 +4,10 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/time.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "driver/gpio.h"
@@ -11,14 +15,34 @@
 #include "esp_timer.h"
 #include "esp_err.h"
 #include "esp_log.h"
+#include "esp_random.h"
+#include "esp_attr.h"
+#include "esp_cpu.h"
+#include "esp_rom_gpio.h"
+#include "soc/soc.h"
+#include "soc/gpio_reg.h"
+#include "soc/gpio_sig_map.h"
+#include "warm_state.h"
+#include "trans_log.h"
+#include "traffic_fsm.h"
+#include "traffic_signal.h"
+#include "day_plan.h"
+#include "flash_stress.h"
 
 static const char *TAG = "TRAFFIC_LIGHT";
 
+// Set by idf.py -DQEMU_TEST=1 for the QEMU tests: no detector on the
+// preemption pin, and stats often enough for a short run
+#ifndef QEMU_TEST
+#define QEMU_TEST 0
+#endif
+
 // Pin definitions
 #define RED_LED_PIN     GPIO_NUM_2
 #define YELLOW_LED_PIN  GPIO_NUM_4
 #define GREEN_LED_PIN   GPIO_NUM_15
 #define BUZZER_PIN      GPIO_NUM_5
+#define PREEMPT_PIN     GPIO_NUM_18     // Optical detector output, active low
 
 // LEDC configuration for buzzer
 #define LEDC_TIMER              LEDC_TIMER_0
@@ -28,7 +52,8 @@ static const char *TAG = "TRAFFIC_LIGHT";
 #define LEDC_DUTY               (4096)  // 50% duty cycle
 #define BEEP_FREQUENCY          800     // Hz - pedestrian crossing beep
 
-// Traffic light timing configuration (in milliseconds)
+// Traffic light timing configuration (in milliseconds); the off-peak plan
+// and the one used while the clock is unset
 #define RED_DURATION            5000    // 5 seconds
 #define RED_TO_YELLOW_DURATION  2000    // 2 seconds (prepare to go)
 #define GREEN_DURATION          5000    // 5 seconds
@@ -36,64 +61,222 @@ static const char *TAG = "TRAFFIC_LIGHT";
 #define BEEP_INTERVAL           1000    // Beep every 1 second during green
 #define BEEP_DURATION           200     // 200ms beep
 
-// Traffic light states using enum [web:67][web:69]
-typedef enum {
-    STATE_RED,                  // Stop - No buzzer
-    STATE_RED_TO_YELLOW,        // Prepare to go
-    STATE_GREEN,                // Go - Beeping for blind-friendly
-    STATE_GREEN_TO_YELLOW,      // Prepare to stop
-    STATE_MAX                   // Total number of states
-} TrafficLightState;
+// Time-of-day plans: the weekly schedule below picks the timing plan,
+// looked up once per cycle and applied where the next cycle begins
+#define DAY_PLAN_ENABLE         1
+#define DAY_PLAN_TZ             "UTC0"  // POSIX TZ string for local time
+#define DAY_PLAN_START_TIME     0       // Epoch seconds to set an unset clock to; 0 leaves it
+#define DAY_PLAN_TRANSITION_CYCLES 2    // Cycles spent easing from one plan to the next
+#define FLASH_PLAN_CHECK_MS     1000    // Night flash has no cycles; check this often
+
+// Emergency-vehicle preemption: RED and the ready YELLOW are cut to their
+// minimums, the caution YELLOW always runs in full, then GREEN is held for
+// the approaching vehicle with the pedestrian beeps silenced
+#define PREEMPT_ENABLE          (!QEMU_TEST)
+#define PREEMPT_SIMULATE        0       // Random requests from a task instead of the detector
+#define ALL_RED_MS              1000    // Shortest RED: cross traffic clears the junction
+#define MIN_READY_MS            1000
+#define MIN_YELLOW_MS           2000
+#define MIN_GREEN_AFTER_PREEMPT_MS 3000
+
+// Warm restart: after a watchdog, panic, brownout or software reset the
+// controller picks up the cycle where the RTC timer says it should be,
+// restoring the lights before logging or driver init
+#define WARM_RESTART_ENABLE     1
+#define WARM_RESTART_MAX_GAP_MS 30000   // Dark longer than this: start cold from RED
+// Benchmark: alternately warm and cold software resets, reset-to-lights timing
+#define WARM_RESTART_BENCH      0
+#define BENCH_RUNS              10      // Of each kind
+#define BENCH_RESET_DELAY_MS    1500
+
+// Transition log in the "translog" flash partition. Pages are flushed only
+// when the next transition or beep edge is further off than the flash
+// operation's guard time; TRANS_LOG_GUARD 0 flushes as soon as a page is
+// sealed, to measure what an unguarded flush does to transition timing.
+#define TRANS_LOG_ENABLE        1
+#define TRANS_LOG_GUARD         1
+#define TRANS_LOG_STATS_CYCLES  (QEMU_TEST ? 2 : 10)   // Log flush cost and lateness every N cycles
+
+// Erase/write the NVS partition (unused here) without a break, on top of
+// the transition log. Every operation turns the flash cache off; the
+// signal's step lateness in the stats shows whether the lights stalled.
+#define FLASH_STRESS            0
+#define FLASH_STRESS_SECTOR     4096
+#define FLASH_STRESS_PAGE       256
+
+#if WARM_RESTART_BENCH && !WARM_RESTART_ENABLE
+#error "WARM_RESTART_BENCH needs WARM_RESTART_ENABLE"
+#endif
+
+// Traffic light states come from the state machine module (traffic_fsm.h);
+// the ISRs in traffic_signal.c step it, this file logs and persists the steps
 
 // State names for logging [web:67]
 static const char* state_names[] = {
     "RED (STOP)",
     "YELLOW (READY)",
     "GREEN (GO - Safe to Cross)",
-    "YELLOW (CAUTION)"
+    "YELLOW (CAUTION)",
+    "YELLOW (FLASHING)"
+};
+
+enum {
+    PLAN_OFF_PEAK,
+    PLAN_PEAK,
+    PLAN_WEEKEND,
+    PLAN_NIGHT_FLASH,
+    PLAN_COUNT
+};
+
+// Phase timing per plan: RED, YELLOW (ready), GREEN, YELLOW (caution)
+static const traffic_plan_t signal_plans[PLAN_COUNT] = {
+    [PLAN_OFF_PEAK] = { .durations_ms = { RED_DURATION, RED_TO_YELLOW_DURATION,
+                                          GREEN_DURATION, GREEN_TO_YELLOW_DURATION } },
+    [PLAN_PEAK] = { .durations_ms = { 4000, 2000, 9000, 3000 } },
+    [PLAN_WEEKEND] = { .durations_ms = { 6000, 2000, 6000, 2000 } },
+    // Cycle timing used only after a preemption out of the flash
+    [PLAN_NIGHT_FLASH] = { .durations_ms = { RED_DURATION, RED_TO_YELLOW_DURATION,
+                                             GREEN_DURATION, GREEN_TO_YELLOW_DURATION },
+                           .flash = true }
+};
+
+static const char *const plan_names[PLAN_COUNT] = {
+    [PLAN_OFF_PEAK] = "off-peak",
+    [PLAN_PEAK] = "peak",
+    [PLAN_WEEKEND] = "weekend",
+    [PLAN_NIGHT_FLASH] = "night flash"
+};
+
+// Weekly switch points, sorted; day 0 is Monday. Const, so it stays in flash.
+#define WEEKDAY_PLANS(day) \
+    { DAY_PLAN_AT(day, 6, 0), PLAN_OFF_PEAK }, \
+    { DAY_PLAN_AT(day, 7, 0), PLAN_PEAK }, \
+    { DAY_PLAN_AT(day, 9, 30), PLAN_OFF_PEAK }, \
+    { DAY_PLAN_AT(day, 16, 30), PLAN_PEAK }, \
+    { DAY_PLAN_AT(day, 19, 0), PLAN_OFF_PEAK }, \
+    { DAY_PLAN_AT(day, 23, 0), PLAN_NIGHT_FLASH }
+#define WEEKEND_PLANS(day) \
+    { DAY_PLAN_AT(day, 8, 0), PLAN_WEEKEND }, \
+    { DAY_PLAN_AT(day, 23, 30), PLAN_NIGHT_FLASH }
+
+static const day_plan_switch_t plan_switches[] = {
+    WEEKDAY_PLANS(0), WEEKDAY_PLANS(1), WEEKDAY_PLANS(2), WEEKDAY_PLANS(3), WEEKDAY_PLANS(4),
+    WEEKEND_PLANS(5), WEEKEND_PLANS(6)
 };
 
-// State duration mapping [web:67]
-static const uint32_t state_durations[] = {
-    RED_DURATION,
-    RED_TO_YELLOW_DURATION,
-    GREEN_DURATION,
-    GREEN_TO_YELLOW_DURATION
+static const day_plan_table_t day_plans = {
+    .plans = signal_plans,
+    .num_plans = PLAN_COUNT,
+    .switches = plan_switches,
+    .num_switches = sizeof(plan_switches) / sizeof(plan_switches[0]),
+    .transition_cycles = DAY_PLAN_TRANSITION_CYCLES
 };
 
 // Traffic light context structure [web:69][web:71]
 typedef struct {
-    TrafficLightState current_state;
+    traffic_state_t current_state;
     uint32_t state_start_time;
     uint32_t last_beep_time;
     bool beep_active;
+    uint32_t cycles;            // Completed cycles, carried across warm restarts
+    uint64_t state_start_rtc_us;
+    uint64_t cycle_start_rtc_us;
+    traffic_plan_t plan;        // Plan the signal is running
 } TrafficLightContext;
 
 // Global context
 static TrafficLightContext traffic_context = {
-    .current_state = STATE_RED,
+    .current_state = TRAFFIC_RED,
     .state_start_time = 0,
     .last_beep_time = 0,
-    .beep_active = false
+    .beep_active = false,
+    .plan = { .durations_ms = { RED_DURATION, RED_TO_YELLOW_DURATION,
+                                GREEN_DURATION, GREEN_TO_YELLOW_DURATION } }
 };
 
 // Function prototypes
 void init_traffic_leds(void);
 void init_buzzer(void);
-void set_traffic_light(TrafficLightState state);
-void turn_off_all_lights(void);
+void init_signal(void);
 void beep_on(void);
 void beep_off(void);
-void handle_state_red(void);
-void handle_state_red_to_yellow(void);
 void handle_state_green(void);
-void handle_state_green_to_yellow(void);
 void state_machine_run(void);
-void transition_to_state(TrafficLightState new_state);
+void transition_to_state(const traffic_fsm_step_t *step);
 uint32_t millis(void);
+static uint32_t light_mask(traffic_state_t state);
+static bool warm_resume(void);
+static void cold_start(void);
+static void start_signal(void);
+static void log_signal_stats(void);
+
+#if DAY_PLAN_ENABLE
+static void init_day_plan(void);
+static void update_day_plan(void);
+static day_plan_sched_t plan_sched;
+static bool clock_valid;
+static uint32_t last_plan_check;
+static uint32_t max_plan_cycles;        // CPU cycles of the slowest plan evaluation
+#endif
+
+#if PREEMPT_SIMULATE
+static void preempt_sim_task(void *pvParameters);
+#endif
+
+#if TRANS_LOG_ENABLE
+static void service_trans_log(void);
+static void log_trans_log_stats(void);
+static bool flushed_last_poll;
+
+// Timed steps picked up right after a flash operation, and how late the
+// ISR took them
+static struct {
+    uint32_t after_flush;
+    uint32_t max_late_after_flush_us;
+} timing;
+
+static void count_record(uint16_t boot, const trans_log_record_t *record, void *ctx)
+{
+    uint32_t *count = ctx;
+    count[0]++;
+    if (count[1] != boot) {
+        count[1] = boot;
+        count[2]++;
+    }
+}
+#endif
+
+#if WARM_RESTART_ENABLE
+// Filled in by warm_resume() before logging is up
+static struct {
+    esp_reset_reason_t reason;
+    uint32_t remaining_ms;
+    int64_t outputs_at_us;      // esp_timer time once the lights were right
+    bool reset_age_valid;
+    uint64_t reset_age_us;      // Benchmark only: deliberate reset to lights
+} resume_info;
+#endif
+
+#if WARM_RESTART_BENCH
+#define BENCH_MAGIC             0x42454e43  // "BENC"
+
+static RTC_NOINIT_ATTR struct {
+    uint32_t magic;
+    uint32_t run;
+    uint32_t count[2];          // [0] cold, [1] warm
+    uint64_t total_us[2];
+    uint64_t min_us[2];
+    uint64_t max_us[2];
+} bench;
+
+static void bench_step(bool warm, bool age_valid, uint64_t age_us);
+#endif
 
 void app_main(void)
 {
+    // First thing after boot: nothing slow may run before the lights are back
+    bool warm = warm_resume();
+
     esp_log_level_set(TAG, ESP_LOG_INFO);
     
     ESP_LOGI(TAG, "================================================");
@@ -104,10 +287,49 @@ void app_main(void)
     // Initialize hardware
     init_traffic_leds();
     init_buzzer();
+    init_signal();
+#if TRANS_LOG_ENABLE
+    // The controller runs without the log rather than not at all
+    if (trans_log_init() == ESP_OK) {
+        uint32_t count[3] = {0, UINT32_MAX, 0};     // records, last boot, boots
+        ESP_ERROR_CHECK(trans_log_for_each(count_record, count));
+        ESP_LOGI(TAG, "Transition log holds %lu records from %lu boots",
+                 (unsigned long)count[0], (unsigned long)count[2]);
+    } else {
+        ESP_LOGW(TAG, "Transition log unavailable");
+    }
+#endif
+#if DAY_PLAN_ENABLE
+    init_day_plan();
+#endif
     
     // Initialize state machine [web:67]
-    traffic_context.current_state = STATE_RED;
-    traffic_context.state_start_time = millis();
+    if (warm) {
+#if WARM_RESTART_ENABLE
+        ESP_LOGW(TAG, "Warm restart (reset reason %d): resumed %s, %lu ms left, cycle %lu",
+                 resume_info.reason, state_names[traffic_context.current_state],
+                 (unsigned long)resume_info.remaining_ms, (unsigned long)traffic_context.cycles);
+        ESP_LOGI(TAG, "Lights restored %lld us after app start",
+                 (long long)resume_info.outputs_at_us);
+#endif
+#if DAY_PLAN_ENABLE
+        // The resumed cycle keeps its saved timing; the next cycle start
+        // brings it back onto the schedule
+        plan_sched.current = traffic_context.plan;
+#endif
+        start_signal();
+    } else {
+        cold_start();
+    }
+#if PREEMPT_SIMULATE
+    xTaskCreate(preempt_sim_task, "preempt_sim", 2048, NULL, 5, NULL);
+#endif
+#if FLASH_STRESS
+    ESP_ERROR_CHECK(flash_stress_start());
+#endif
+#if WARM_RESTART_BENCH
+    bench_step(warm, resume_info.reset_age_valid, resume_info.reset_age_us);
+#endif
     
     ESP_LOGI(TAG, "Traffic light system started");
     ESP_LOGI(TAG, "Audio cues enabled during GREEN phase");
@@ -116,6 +338,9 @@ void app_main(void)
     // Main loop - run state machine continuously [web:67]
     while(1) {
         state_machine_run();
+#if TRANS_LOG_ENABLE
+        service_trans_log();
+#endif
         vTaskDelay(pdMS_TO_TICKS(10));  // Small delay to prevent CPU hogging
     }
 }
@@ -138,9 +363,10 @@ void init_traffic_leds(void)
         .pull_down_en = GPIO_PULLDOWN_DISABLE,
         .intr_type = GPIO_INTR_DISABLE
     };
+    // Leaves the output levels alone, so lights restored by a warm
+    // restart stay lit; a cold start sets them afterwards
     ESP_ERROR_CHECK(gpio_config(&io_conf));
     
-    turn_off_all_lights();
     ESP_LOGI(TAG, "Traffic LEDs initialized (R:%d, Y:%d, G:%d)", 
              RED_LED_PIN, YELLOW_LED_PIN, GREEN_LED_PIN);
 }
@@ -172,89 +398,442 @@ void init_buzzer(void)
     ESP_LOGI(TAG, "Buzzer initialized on GPIO%d at %d Hz", BUZZER_PIN, BEEP_FREQUENCY);
 }
 
-void turn_off_all_lights(void)
+void init_signal(void)
 {
-    gpio_set_level(RED_LED_PIN, 0);
-    gpio_set_level(YELLOW_LED_PIN, 0);
-    gpio_set_level(GREEN_LED_PIN, 0);
+    traffic_signal_config_t config = {
+        .light_pins = {
+            [TRAFFIC_RED] = RED_LED_PIN,
+            [TRAFFIC_RED_TO_YELLOW] = YELLOW_LED_PIN,
+            [TRAFFIC_GREEN] = GREEN_LED_PIN,
+            [TRAFFIC_GREEN_TO_YELLOW] = YELLOW_LED_PIN
+        },
+        .speed_mode = LEDC_MODE,
+        .buzzer_channel = LEDC_BUZZER_CHANNEL,
+        .beep_duty = LEDC_DUTY,
+#if PREEMPT_ENABLE && !PREEMPT_SIMULATE
+        .preempt_pin = PREEMPT_PIN,
+#else
+        .preempt_pin = GPIO_NUM_NC,
+#endif
+        .preempt_active_level = false,
+        .preempt_pull_up = true
+    };
+    ESP_ERROR_CHECK(traffic_signal_init(&config));
 }
 
-void set_traffic_light(TrafficLightState state)
+// Hands the state machine to the signal ISRs, picking up where
+// traffic_context says the current state began
+static void start_signal(void)
+{
+    traffic_fsm_config_t config = {
+        .plan = traffic_context.plan,
+        .all_red_ms = ALL_RED_MS,
+        .min_ready_ms = MIN_READY_MS,
+        .min_yellow_ms = MIN_YELLOW_MS,
+        .min_green_ms = MIN_GREEN_AFTER_PREEMPT_MS
+    };
+    ESP_ERROR_CHECK(traffic_signal_start(&config, traffic_context.current_state,
+                                         millis() - traffic_context.state_start_time));
+    ESP_LOGI(TAG, "Preemption: all-red %d ms, ready %d ms, yellow %lu ms, worst case %llu ms to green",
+             ALL_RED_MS, MIN_READY_MS, (unsigned long)traffic_context.plan.durations_ms[TRAFFIC_GREEN_TO_YELLOW],
+             (unsigned long long)(traffic_fsm_preempt_bound_us(&config) / 1000));
+}
+
+static uint32_t light_mask(traffic_state_t state)
 {
-    // Turn off all lights first [web:44]
-    turn_off_all_lights();
-    
-    // Turn on appropriate light based on state [web:67]
     switch(state) {
-        case STATE_RED:
-            gpio_set_level(RED_LED_PIN, 1);
-            break;
-            
-        case STATE_RED_TO_YELLOW:
-        case STATE_GREEN_TO_YELLOW:
-            gpio_set_level(YELLOW_LED_PIN, 1);
-            break;
-            
-        case STATE_GREEN:
-            gpio_set_level(GREEN_LED_PIN, 1);
-            break;
-            
+        case TRAFFIC_RED:
+            return 1UL << RED_LED_PIN;
+        case TRAFFIC_RED_TO_YELLOW:
+        case TRAFFIC_GREEN_TO_YELLOW:
+        case TRAFFIC_FLASH:
+            return 1UL << YELLOW_LED_PIN;
+        case TRAFFIC_GREEN:
+            return 1UL << GREEN_LED_PIN;
         default:
-            break;
+            return 0;
+    }
+}
+
+static void cold_start(void)
+{
+    traffic_state_t state = TRAFFIC_RED;
+#if DAY_PLAN_ENABLE
+    // Straight into the plan in force; a night start flashes from the outset
+    if (clock_valid) {
+        traffic_context.plan = plan_sched.current;
+        if (traffic_context.plan.flash) {
+            state = TRAFFIC_FLASH;
+        }
+    }
+#endif
+    traffic_context.current_state = state;
+    traffic_context.state_start_time = millis();
+    traffic_context.cycles = 0;
+    start_signal();
+#if TRANS_LOG_ENABLE
+    trans_log_append(traffic_context.state_start_time, TRAFFIC_STATE_COUNT, state, TRANS_CAUSE_COLD_START);
+#endif
+#if WARM_RESTART_ENABLE
+    resume_info.reset_age_valid = warm_state_reset_age_us(&resume_info.reset_age_us);
+    uint64_t now = warm_state_now_us();
+    traffic_context.state_start_rtc_us = now;
+    traffic_context.cycle_start_rtc_us = now;
+    warm_state_save(state, 0, now, now, traffic_context.plan.durations_ms);
+#endif
+}
+
+static bool warm_resume(void)
+{
+#if WARM_RESTART_ENABLE
+    warm_state_t saved;
+    if (!warm_state_load(&saved, &resume_info.reason) || saved.state >= TRAFFIC_STATE_COUNT) {
+        return false;
+    }
+    uint64_t now = warm_state_now_us();
+    uint64_t in_state_ms = (now - saved.state_start_us) / 1000;
+    const uint32_t *durations = saved.durations_ms;
+    // FLASH has no end of its own; the day plan takes it from here
+    if (saved.state != TRAFFIC_FLASH && in_state_ms > durations[saved.state] + WARM_RESTART_MAX_GAP_MS) {
+        return false;
+    }
+
+    // Where the cycle would be had there been no reset, walking on from
+    // the saved state with the plan it ran; the RTC timer kept running,
+    // so time spent in reset is skipped rather than replayed, except that
+    // a green that ran out in the dark still gets its full yellow. The
+    // blink phase of a flash does not matter; it may have run for hours
+    const traffic_fsm_config_t limits = {
+        .all_red_ms = ALL_RED_MS,
+        .min_ready_ms = MIN_READY_MS,
+        .min_yellow_ms = MIN_YELLOW_MS
+    };
+    traffic_plan_t plan = { .flash = (saved.state == TRAFFIC_FLASH) };
+    memcpy(plan.durations_ms, durations, sizeof(plan.durations_ms));
+    traffic_state_t state = saved.state;
+    uint64_t state_start_us = saved.state_start_us;
+    uint32_t cycles = saved.cycles;
+    uint64_t cycle_start_us = saved.cycle_start_us;
+    cycles += traffic_fsm_resume(&limits, &plan, &state, &state_start_us, &cycle_start_us, now);
+    uint32_t offset_ms = (now - state_start_us) / 1000;
+
+    // Pad mux, output matrix and levels by register: gpio_config() and its
+    // per-pin log lines come later
+    const gpio_num_t pins[] = {RED_LED_PIN, YELLOW_LED_PIN, GREEN_LED_PIN};
+    uint32_t pin_mask = 0;
+    for (int i = 0; i < 3; i++) {
+        esp_rom_gpio_pad_select_gpio(pins[i]);
+        REG_WRITE(GPIO_FUNC0_OUT_SEL_CFG_REG + pins[i] * 4, SIG_GPIO_OUT_IDX);
+        pin_mask |= 1UL << pins[i];
+    }
+    uint32_t on = light_mask(state);
+    REG_WRITE(GPIO_OUT_W1TC_REG, pin_mask & ~on);
+    REG_WRITE(GPIO_OUT_W1TS_REG, on);
+    REG_WRITE(GPIO_ENABLE_W1TS_REG, pin_mask);
+    resume_info.outputs_at_us = esp_timer_get_time();
+    resume_info.reset_age_valid = warm_state_reset_age_us(&resume_info.reset_age_us);
+
+    uint32_t now_ms = millis();
+    traffic_context.current_state = state;
+    traffic_context.state_start_time = now_ms - offset_ms;
+    // Keep the green beeps on their one-second grid
+    traffic_context.last_beep_time = (state == TRAFFIC_GREEN) ? now_ms - offset_ms % BEEP_INTERVAL : 0;
+    traffic_context.cycles = cycles;
+    traffic_context.state_start_rtc_us = state_start_us;
+    traffic_context.cycle_start_rtc_us = cycle_start_us;
+    traffic_context.plan = plan;
+    resume_info.remaining_ms = (state == TRAFFIC_FLASH) ? 0 : durations[state] - offset_ms;
+    warm_state_save(state, cycles, state_start_us, cycle_start_us, durations);
+#if TRANS_LOG_ENABLE
+    trans_log_append(now_ms, saved.state, state, TRANS_CAUSE_WARM_RESUME);
+#endif
+    return true;
+#else
+    return false;
+#endif
+}
+
+#if WARM_RESTART_BENCH
+static void bench_step(bool warm, bool age_valid, uint64_t age_us)
+{
+    if (bench.magic != BENCH_MAGIC) {
+        memset(&bench, 0, sizeof(bench));
+        bench.magic = BENCH_MAGIC;
+        bench.min_us[0] = bench.min_us[1] = UINT64_MAX;
+    }
+    if (age_valid) {
+        bench.count[warm]++;
+        bench.total_us[warm] += age_us;
+        if (age_us < bench.min_us[warm]) {
+            bench.min_us[warm] = age_us;
+        }
+        if (age_us > bench.max_us[warm]) {
+            bench.max_us[warm] = age_us;
+        }
+        ESP_LOGI(TAG, "Bench: %s start, reset to correct lights %llu us",
+                 warm ? "warm" : "cold", (unsigned long long)age_us);
+    }
+    if (bench.run >= 2 * BENCH_RUNS) {
+        for (int i = 1; i >= 0; i--) {
+            if (bench.count[i] > 0) {
+                ESP_LOGI(TAG, "Bench %s: %lu runs, reset to lights avg %llu us, min %llu, max %llu",
+                         i ? "warm" : "cold", (unsigned long)bench.count[i],
+                         (unsigned long long)(bench.total_us[i] / bench.count[i]),
+                         (unsigned long long)bench.min_us[i], (unsigned long long)bench.max_us[i]);
+            }
+        }
+        bench.magic = 0;
+        return;
+    }
+
+    // Land mid-phase, then reset; every other run drops the record so the
+    // next boot takes the cold path through the same kind of reset
+    vTaskDelay(pdMS_TO_TICKS(BENCH_RESET_DELAY_MS));
+    if (bench.run++ % 2) {
+        warm_state_clear();
+    }
+    warm_state_mark_reset();
+    esp_restart();
+}
+#endif
+
+#if DAY_PLAN_ENABLE
+static bool local_time(struct tm *tm)
+{
+    time_t now = time(NULL);
+    localtime_r(&now, tm);
+    // Unset clocks start in 1970
+    return tm->tm_year + 1900 >= 2024;
+}
+
+static void init_day_plan(void)
+{
+    if (!day_plan_check(&day_plans)) {
+        ESP_LOGE(TAG, "Day plan switch points unsorted or out of range");
+        ESP_ERROR_CHECK(ESP_ERR_INVALID_ARG);
+    }
+    traffic_fsm_config_t check = {
+        .all_red_ms = ALL_RED_MS,
+        .min_ready_ms = MIN_READY_MS,
+        .min_yellow_ms = MIN_YELLOW_MS
+    };
+    for (int i = 0; i < PLAN_COUNT; i++) {
+        if (!traffic_fsm_plan_ok(&check, &signal_plans[i])) {
+            ESP_LOGE(TAG, "Plan '%s' breaks a safety minimum", plan_names[i]);
+            ESP_ERROR_CHECK(ESP_ERR_INVALID_ARG);
+        }
     }
+
+    setenv("TZ", DAY_PLAN_TZ, 1);
+    tzset();
+    struct tm tm;
+    clock_valid = local_time(&tm);
+#if DAY_PLAN_START_TIME
+    if (!clock_valid) {
+        struct timeval tv = { .tv_sec = DAY_PLAN_START_TIME };
+        settimeofday(&tv, NULL);
+        clock_valid = local_time(&tm);
+    }
+#endif
+    if (!clock_valid) {
+        ESP_LOGW(TAG, "Clock not set: running the %s plan until it is", plan_names[PLAN_OFF_PEAK]);
+        day_plan_start(&plan_sched, &day_plans, PLAN_OFF_PEAK);
+        return;
+    }
+    uint32_t minute = day_plan_week_minute(tm.tm_wday, tm.tm_hour, tm.tm_min);
+    day_plan_start(&plan_sched, &day_plans, day_plan_in_force(&day_plans, minute));
+    ESP_LOGI(TAG, "Day plan: %u switch points, %s in force (%04d-%02d-%02d %02d:%02d)",
+             day_plans.num_switches, plan_names[plan_sched.target],
+             tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min);
 }
 
+// Runs at each cycle start, and every FLASH_PLAN_CHECK_MS while flashing;
+// the plan handed to the signal starts with the next cycle
+static void update_day_plan(void)
+{
+    last_plan_check = millis();
+    struct tm tm;
+    if (!local_time(&tm)) {
+        return;
+    }
+    if (!clock_valid) {
+        clock_valid = true;
+        ESP_LOGI(TAG, "Clock set: following the day plan");
+    }
+
+    uint32_t start = esp_cpu_get_cycle_count();
+    traffic_plan_t plan;
+    bool changed = day_plan_next_cycle(&plan_sched,
+                                       day_plan_week_minute(tm.tm_wday, tm.tm_hour, tm.tm_min), &plan);
+    uint32_t cycles = esp_cpu_get_cycle_count() - start;
+    if (cycles > max_plan_cycles) {
+        max_plan_cycles = cycles;
+    }
+    if (!changed) {
+        return;
+    }
+    esp_err_t ret = traffic_signal_set_plan(&plan);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Plan rejected: %s", esp_err_to_name(ret));
+        return;
+    }
+    if (traffic_context.current_state == TRAFFIC_FLASH) {
+        ESP_LOGI(TAG, "Plan: %s, leaving the night flash", plan_names[plan_sched.target]);
+    } else if (day_plan_in_transition(&plan_sched)) {
+        ESP_LOGI(TAG, "Plan: easing to %s, next cycle %lu/%lu/%lu/%lu ms", plan_names[plan_sched.target],
+                 (unsigned long)plan.durations_ms[0], (unsigned long)plan.durations_ms[1],
+                 (unsigned long)plan.durations_ms[2], (unsigned long)plan.durations_ms[3]);
+    } else {
+        ESP_LOGI(TAG, "Plan: %s from the next cycle", plan_names[plan_sched.target]);
+    }
+}
+#endif
+
 void beep_on(void)
 {
-    ESP_ERROR_CHECK(ledc_set_duty(LEDC_MODE, LEDC_BUZZER_CHANNEL, LEDC_DUTY));
-    ESP_ERROR_CHECK(ledc_update_duty(LEDC_MODE, LEDC_BUZZER_CHANNEL));
-    traffic_context.beep_active = true;
+    // Refused while preempted or once the ISR has already left GREEN
+    traffic_context.beep_active = traffic_signal_beep(true);
 }
 
 void beep_off(void)
 {
-    ESP_ERROR_CHECK(ledc_set_duty(LEDC_MODE, LEDC_BUZZER_CHANNEL, 0));
-    ESP_ERROR_CHECK(ledc_update_duty(LEDC_MODE, LEDC_BUZZER_CHANNEL));
+    traffic_signal_beep(false);
     traffic_context.beep_active = false;
 }
 
-void transition_to_state(TrafficLightState new_state)
+#if TRANS_LOG_ENABLE
+// Time until the main loop next has to act: phase end, or in GREEN the
+// next beep edge
+static uint32_t quiet_time_ms(void)
 {
-    // Log state transition [web:67]
-    ESP_LOGI(TAG, "State Transition: %s -> %s", 
-             state_names[traffic_context.current_state],
-             state_names[new_state]);
-    
-    // Update state [web:67]
-    traffic_context.current_state = new_state;
-    traffic_context.state_start_time = millis();
-    traffic_context.last_beep_time = 0;
-    
-    // Turn off buzzer during state transition
-    beep_off();
-    
-    // Set appropriate traffic light
-    set_traffic_light(new_state);
+    uint32_t now = millis();
+    uint32_t quiet = traffic_signal_remaining_ms();
+
+    if (traffic_context.current_state == TRAFFIC_GREEN) {
+        uint32_t since_beep = now - traffic_context.last_beep_time;
+        uint32_t edge = traffic_context.beep_active ? BEEP_DURATION : BEEP_INTERVAL;
+        uint32_t to_edge = (traffic_context.last_beep_time == 0 || since_beep >= edge) ? 0 : edge - since_beep;
+        if (to_edge < quiet) {
+            quiet = to_edge;
+        }
+    }
+    return quiet;
 }
 
-void handle_state_red(void)
+static void service_trans_log(void)
 {
-    // RED state: STOP - No buzzer [web:67]
-    // Simply wait for duration to expire
-    uint32_t elapsed = millis() - traffic_context.state_start_time;
-    
-    if (elapsed >= state_durations[STATE_RED]) {
-        transition_to_state(STATE_RED_TO_YELLOW);
+#if TRANS_LOG_GUARD
+    uint32_t quiet = quiet_time_ms();
+#else
+    uint32_t quiet = UINT32_MAX;
+#endif
+    bool did_work;
+    esp_err_t ret = trans_log_flush(quiet, &did_work);
+    if (ret != ESP_OK && ret != ESP_ERR_INVALID_STATE) {
+        ESP_LOGE(TAG, "Transition log flush failed: %s", esp_err_to_name(ret));
+    }
+    flushed_last_poll = did_work;
+}
+
+static void log_trans_log_stats(void)
+{
+    trans_log_stats_t stats;
+    trans_log_get_stats(&stats);
+    ESP_LOGI(TAG, "Log: %lu records, %lu dropped, %lu pages, %lu erases, %lu deferred",
+             (unsigned long)stats.appended, (unsigned long)stats.dropped,
+             (unsigned long)stats.pages_written, (unsigned long)stats.sectors_erased,
+             (unsigned long)stats.deferred);
+    ESP_LOGI(TAG, "Flash cost: page write max %lu us, sector erase max %lu us, total %llu us",
+             (unsigned long)stats.max_write_us, (unsigned long)stats.max_erase_us,
+             (unsigned long long)stats.total_flash_us);
+    ESP_LOGI(TAG, "Transitions right after a flush: %lu, max late %lu us",
+             (unsigned long)timing.after_flush, (unsigned long)timing.max_late_after_flush_us);
+}
+#endif
+
+static void log_signal_stats(void)
+{
+    traffic_signal_stats_t stats;
+    traffic_signal_get_stats(&stats);
+    ESP_LOGI(TAG, "Signal: %lu steps, timed steps max late %lu us, ISR max %lu cycles",
+             (unsigned long)stats.steps, (unsigned long)stats.max_late_us,
+             (unsigned long)stats.max_isr_cycles);
+#if DAY_PLAN_ENABLE
+    ESP_LOGI(TAG, "Day plan: %s, evaluation max %lu CPU cycles",
+             plan_names[plan_sched.target], (unsigned long)max_plan_cycles);
+#endif
+    if (stats.preempts > 0) {
+        ESP_LOGI(TAG, "Preemption: %lu requests, %lu switched lights in the input ISR "
+                 "(avg %llu, max %lu cycles), max %lu ms to green",
+                 (unsigned long)stats.preempts, (unsigned long)stats.immediate,
+                 (unsigned long long)(stats.immediate ? stats.total_effect_cycles / stats.immediate : 0),
+                 (unsigned long)stats.max_effect_cycles, (unsigned long)(stats.max_to_green_us / 1000));
+    }
+    if (stats.queue_full > 0) {
+        ESP_LOGW(TAG, "%lu steps lost from a full queue", (unsigned long)stats.queue_full);
     }
 }
 
-void handle_state_red_to_yellow(void)
+void transition_to_state(const traffic_fsm_step_t *step)
 {
-    // YELLOW (after RED): READY - Prepare to go [web:67]
-    uint32_t elapsed = millis() - traffic_context.state_start_time;
+    // The signal ISR has already switched the lights and silenced the
+    // buzzer; this is the bookkeeping that may take its time
+    traffic_state_t new_state = step->to;
+    uint32_t now_ms = millis();
+#if TRANS_LOG_ENABLE
+    if (!step->preempt && flushed_last_poll) {
+        uint32_t late = (uint32_t)(step->at_us - step->deadline_us);
+        timing.after_flush++;
+        if (late > timing.max_late_after_flush_us) {
+            timing.max_late_after_flush_us = late;
+        }
+    }
+    trans_log_append(now_ms, step->from, new_state,
+                     step->preempt ? TRANS_CAUSE_PREEMPT :
+                     step->from == TRAFFIC_FLASH ? TRANS_CAUSE_PLAN : TRANS_CAUSE_TIMER);
+#endif
+
+    // Log state transition [web:67]
+    ESP_LOGI(TAG, "State Transition: %s -> %s%s", 
+             state_names[step->from],
+             state_names[new_state],
+             step->preempt ? " (preempted)" : "");
     
-    if (elapsed >= state_durations[STATE_RED_TO_YELLOW]) {
-        transition_to_state(STATE_GREEN);
+    // Update state [web:67]
+    traffic_context.current_state = new_state;
+    traffic_context.state_start_time = now_ms;
+    traffic_context.last_beep_time = 0;
+    traffic_context.beep_active = false;
+    // A queued plan takes over as the cycle or the flash ends
+    if (step->from == TRAFFIC_GREEN_TO_YELLOW || step->from == TRAFFIC_FLASH) {
+        traffic_signal_get_plan(&traffic_context.plan);
+    }
+#if WARM_RESTART_ENABLE
+    uint64_t now = warm_state_now_us();
+    traffic_context.state_start_rtc_us = now;
+    if (new_state == TRAFFIC_RED) {
+        traffic_context.cycles++;
+        traffic_context.cycle_start_rtc_us = now;
+    }
+    warm_state_save(new_state, traffic_context.cycles, traffic_context.state_start_rtc_us,
+                    traffic_context.cycle_start_rtc_us, traffic_context.plan.durations_ms);
+#endif
+#if DAY_PLAN_ENABLE
+    // Each cycle picks the plan for the one after it
+    if (new_state == TRAFFIC_RED) {
+        update_day_plan();
+    }
+#endif
+
+    static uint32_t red_entries;
+    if (new_state == TRAFFIC_RED && ++red_entries % TRANS_LOG_STATS_CYCLES == 0) {
+        log_signal_stats();
+#if TRANS_LOG_ENABLE
+        log_trans_log_stats();
+#endif
+#if FLASH_STRESS
+        flash_stress_log();
+#endif
     }
 }
 
@@ -262,7 +841,6 @@ void handle_state_green(void)
 {
     // GREEN state: GO - Safe to cross with periodic beeps [web:67]
     uint32_t current_time = millis();
-    uint32_t elapsed = current_time - traffic_context.state_start_time;
     
     // Handle periodic beeping for blind-friendly assistance
     if (traffic_context.last_beep_time == 0 || 
@@ -279,47 +857,43 @@ void handle_state_green(void)
         (current_time - traffic_context.last_beep_time >= BEEP_DURATION)) {
         beep_off();
     }
-    
-    // Check if state duration expired
-    if (elapsed >= state_durations[STATE_GREEN]) {
-        beep_off();  // Ensure buzzer is off before transition
-        transition_to_state(STATE_GREEN_TO_YELLOW);
-    }
 }
 
-void handle_state_green_to_yellow(void)
+void state_machine_run(void)
 {
-    // YELLOW (after GREEN): CAUTION - Prepare to stop [web:67]
-    uint32_t elapsed = millis() - traffic_context.state_start_time;
-    
-    if (elapsed >= state_durations[STATE_GREEN_TO_YELLOW]) {
-        transition_to_state(STATE_RED);
+    // Steps are taken in the signal ISRs at their deadlines [web:67]
+    traffic_fsm_step_t step;
+    while (traffic_signal_get_step(&step, 0)) {
+        transition_to_state(&step);
     }
+
+    static bool preempted;
+    if (traffic_signal_preempted() != preempted) {
+        preempted = !preempted;
+        ESP_LOGW(TAG, "Emergency preemption %s", preempted ? "requested" : "cleared");
+    }
+
+    if (traffic_context.current_state == TRAFFIC_GREEN) {
+        handle_state_green();
+    }
+#if DAY_PLAN_ENABLE
+    if (traffic_context.current_state == TRAFFIC_FLASH &&
+        millis() - last_plan_check >= FLASH_PLAN_CHECK_MS) {
+        update_day_plan();
+    }
+#endif
 }
 
-void state_machine_run(void)
+#if PREEMPT_SIMULATE
+// Stands in for the optical detector: a vehicle every 20-40 s, each
+// holding the request for 3-8 s
+static void preempt_sim_task(void *pvParameters)
 {
-    // Main state machine dispatcher using switch-case [web:67][web:69][page:7]
-    switch(traffic_context.current_state) {
-        case STATE_RED:
-            handle_state_red();
-            break;
-            
-        case STATE_RED_TO_YELLOW:
-            handle_state_red_to_yellow();
-            break;
-            
-        case STATE_GREEN:
-            handle_state_green();
-            break;
-            
-        case STATE_GREEN_TO_YELLOW:
-            handle_state_green_to_yellow();
-            break;
-            
-        default:
-            ESP_LOGE(TAG, "Unknown state: %d", traffic_context.current_state);
-            transition_to_state(STATE_RED);
-            break;
+    while (1) {
+        vTaskDelay(pdMS_TO_TICKS(20000 + esp_random() % 20000));
+        traffic_signal_set_preempt(true);
+        vTaskDelay(pdMS_TO_TICKS(3000 + esp_random() % 5000));
+        traffic_signal_set_preempt(false);
     }
 }
+#endif
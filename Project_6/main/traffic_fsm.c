@@ -0,0 +1,212 @@
+/* Traffic signal state machine
+ *
+ * Every deadline is derived from the state start and the current
+ * preemption request, so a request arriving or clearing simply moves the
+ * deadline; nothing is queued, except that a cross street yellow a
+ * request started in RED is kept if it clears. A deadline that has
+ * already passed when a request arrives (RED_TO_YELLOW longer than
+ * min_ready_ms, say) makes the next advance() step at once.
+ */
+#include "traffic_fsm.h"
+
+#define MS_TO_US(ms)    ((uint64_t)(ms) * 1000)
+
+bool traffic_fsm_plan_ok(const traffic_fsm_config_t *config, const traffic_plan_t *plan)
+{
+    // Flash plans too: a preemption out of FLASH runs one cycle on them
+    return plan->durations_ms[TRAFFIC_GREEN_TO_YELLOW] >= config->min_yellow_ms &&
+           plan->durations_ms[TRAFFIC_RED] >= config->all_red_ms &&
+           plan->durations_ms[TRAFFIC_RED_TO_YELLOW] >= config->min_ready_ms &&
+           plan->durations_ms[TRAFFIC_GREEN] > 0;
+}
+
+bool traffic_fsm_init(traffic_fsm_t *fsm, const traffic_fsm_config_t *config,
+                      traffic_state_t state, uint64_t state_start_us)
+{
+    if (state >= TRAFFIC_STATE_COUNT || !traffic_fsm_plan_ok(config, &config->plan) ||
+        config->min_yellow_ms == 0 || config->all_red_ms == 0 || config->min_ready_ms == 0) {
+        return false;
+    }
+    fsm->config = *config;
+    fsm->state = state;
+    fsm->state_start_us = state_start_us;
+    fsm->preempt = false;
+    fsm->preempt_us = 0;
+    fsm->release_us = 0;
+    fsm->red_cut_us = 0;
+    fsm->plan_pending = false;
+    return true;
+}
+
+// End of a RED cut short by a request at request_us. Before the all-red
+// clearance the cross street has had no green, so RED may end with it;
+// later the cross street first gets its yellow, as at the end of a full RED
+static uint64_t red_end_for(const traffic_fsm_t *fsm, uint64_t request_us)
+{
+    const traffic_fsm_config_t *c = &fsm->config;
+    uint64_t clear = fsm->state_start_us + MS_TO_US(c->all_red_ms);
+    return request_us < clear ? clear : request_us + MS_TO_US(c->min_yellow_ms);
+}
+
+uint64_t traffic_fsm_deadline(const traffic_fsm_t *fsm)
+{
+    const traffic_fsm_config_t *c = &fsm->config;
+    const uint32_t *durations = c->plan.durations_ms;
+    uint64_t start = fsm->state_start_us;
+
+    switch (fsm->state) {
+        case TRAFFIC_RED: {
+            uint64_t end = start + MS_TO_US(durations[TRAFFIC_RED]);
+            if (fsm->preempt && red_end_for(fsm, fsm->preempt_us) < end) {
+                end = red_end_for(fsm, fsm->preempt_us);
+            }
+            if (fsm->red_cut_us && fsm->red_cut_us < end) {
+                end = fsm->red_cut_us;
+            }
+            return end;
+        }
+        case TRAFFIC_RED_TO_YELLOW:
+            return start + MS_TO_US(fsm->preempt ? c->min_ready_ms : durations[TRAFFIC_RED_TO_YELLOW]);
+        case TRAFFIC_GREEN: {
+            if (fsm->preempt) {
+                return TRAFFIC_FSM_HELD;
+            }
+            uint64_t end = start + MS_TO_US(durations[TRAFFIC_GREEN]);
+            // A request that cleared during this GREEN still leaves min_green_ms
+            if (fsm->release_us > start && fsm->release_us + MS_TO_US(c->min_green_ms) > end) {
+                end = fsm->release_us + MS_TO_US(c->min_green_ms);
+            }
+            return end;
+        }
+        case TRAFFIC_GREEN_TO_YELLOW:
+            return start + MS_TO_US(durations[TRAFFIC_GREEN_TO_YELLOW]);
+        case TRAFFIC_FLASH:
+        default:
+            // Left for RED as soon as the night plan ends or a request comes
+            return (fsm->preempt || !c->plan.flash) ? start : TRAFFIC_FSM_HELD;
+    }
+}
+
+bool traffic_fsm_advance(traffic_fsm_t *fsm, uint64_t now_us, traffic_fsm_step_t *step)
+{
+    uint64_t deadline = traffic_fsm_deadline(fsm);
+    if (now_us < deadline) {
+        return false;
+    }
+    step->at_us = now_us;
+    step->deadline_us = deadline;
+    step->from = fsm->state;
+    if (fsm->state == TRAFFIC_GREEN_TO_YELLOW) {
+        // End of the cycle: the queued plan takes over here
+        if (fsm->plan_pending) {
+            fsm->config.plan = fsm->next;
+            fsm->plan_pending = false;
+        }
+        step->to = (fsm->config.plan.flash && !fsm->preempt) ? TRAFFIC_FLASH : TRAFFIC_RED;
+    } else if (fsm->state == TRAFFIC_FLASH) {
+        step->to = TRAFFIC_RED;
+    } else {
+        step->to = (traffic_state_t)(fsm->state + 1);
+    }
+    step->preempt = fsm->preempt;
+    fsm->red_cut_us = 0;
+    fsm->state = step->to;
+    fsm->state_start_us = now_us;
+    return true;
+}
+
+bool traffic_fsm_set_plan(traffic_fsm_t *fsm, const traffic_plan_t *plan)
+{
+    if (!traffic_fsm_plan_ok(&fsm->config, plan)) {
+        return false;
+    }
+    if (fsm->state == TRAFFIC_FLASH) {
+        fsm->config.plan = *plan;
+        fsm->plan_pending = false;
+    } else {
+        fsm->next = *plan;
+        fsm->plan_pending = true;
+    }
+    return true;
+}
+
+bool traffic_fsm_set_preempt(traffic_fsm_t *fsm, bool active, uint64_t now_us)
+{
+    if (fsm->preempt == active) {
+        return false;
+    }
+    fsm->preempt = active;
+    if (active) {
+        fsm->preempt_us = now_us;
+    } else {
+        fsm->release_us = now_us;
+        // A cross street yellow already showing runs to its end
+        if (fsm->state == TRAFFIC_RED &&
+            fsm->preempt_us >= fsm->state_start_us + MS_TO_US(fsm->config.all_red_ms)) {
+            uint64_t end = red_end_for(fsm, fsm->preempt_us);
+            if (fsm->red_cut_us == 0 || end < fsm->red_cut_us) {
+                fsm->red_cut_us = end;
+            }
+        }
+    }
+    return true;
+}
+
+bool traffic_fsm_beep_allowed(const traffic_fsm_t *fsm)
+{
+    return fsm->state == TRAFFIC_GREEN && !fsm->preempt;
+}
+
+uint32_t traffic_fsm_resume(const traffic_fsm_config_t *config, const traffic_plan_t *plan,
+                            traffic_state_t *state, uint64_t *state_start_us,
+                            uint64_t *cycle_start_us, uint64_t now_us)
+{
+    const uint32_t *durations = plan->durations_ms;
+    uint64_t all_red = MS_TO_US(config->all_red_ms);
+    uint64_t red = MS_TO_US(durations[TRAFFIC_RED]);
+    // Where the cross street's yellow begins, if it gets a green at all
+    uint64_t cross_yellow = red - MS_TO_US(config->min_yellow_ms);
+    bool cross_green = red >= all_red + MS_TO_US(config->min_yellow_ms);
+    uint32_t cycles = 0;
+
+    if (*state == TRAFFIC_FLASH) {
+        *state_start_us = now_us;
+        return 0;
+    }
+    // The lights were dark meanwhile, which only counts as time in a
+    // yellow that was already showing: a green that ran out in the dark,
+    // main or cross street, still gets its full yellow
+    while (now_us - *state_start_us >= MS_TO_US(durations[*state])) {
+        if (*state == TRAFFIC_GREEN) {
+            *state = TRAFFIC_GREEN_TO_YELLOW;
+            *state_start_us = now_us;
+            break;
+        }
+        if (*state == TRAFFIC_RED && cross_green) {
+            break;
+        }
+        *state_start_us += MS_TO_US(durations[*state]);
+        *state = (traffic_state_t)((*state + 1) % TRAFFIC_CYCLE_STATES);
+        if (*state == TRAFFIC_RED) {
+            cycles++;
+            if (cycle_start_us) {
+                *cycle_start_us = *state_start_us;
+            }
+        }
+    }
+    // Past the all-red the cross street was green or yellow, perhaps a
+    // yellow a request started early, which nothing records: it gets a
+    // full yellow from now
+    if (*state == TRAFFIC_RED && cross_green && now_us - *state_start_us >= all_red) {
+        *state_start_us = now_us - cross_yellow;
+    }
+    return cycles;
+}
+
+uint64_t traffic_fsm_preempt_bound_us(const traffic_fsm_config_t *config)
+{
+    // Worst case: the request lands as GREEN_TO_YELLOW begins; from FLASH
+    // it is only all-red and ready
+    return MS_TO_US(config->plan.durations_ms[TRAFFIC_GREEN_TO_YELLOW] + config->all_red_ms +
+                    config->min_ready_ms);
+}
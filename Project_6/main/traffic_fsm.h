@@ -0,0 +1,92 @@
+/* Traffic signal state machine
+ * The RED -> RED_TO_YELLOW -> GREEN -> GREEN_TO_YELLOW cycle as pure
+ * timing logic: given the time, it says when the current state ends and
+ * steps to the next one. The head is the main street's; the cross street
+ * is the implicit other phase, green during RED after the all-red
+ * clearance and yellow for the last min_yellow_ms of RED. Emergency-vehicle
+ * preemption shortens RED, after giving a cross street green its yellow,
+ * and RED_TO_YELLOW down to their safety minimums and holds GREEN while
+ * the request lasts; GREEN_TO_YELLOW is never cut short and no state is
+ * ever skipped. Timing plans change only where a cycle ends: after
+ * GREEN_TO_YELLOW the machine goes on to RED, or to FLASH under a night
+ * plan, and leaves FLASH only for RED. Plain C with no ESP-IDF
+ * dependencies, so it runs in ISRs and in the host tests alike.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef enum {
+    TRAFFIC_RED,                // Stop
+    TRAFFIC_RED_TO_YELLOW,      // Prepare to go
+    TRAFFIC_GREEN,              // Go, pedestrian beeps
+    TRAFFIC_GREEN_TO_YELLOW,    // Prepare to stop
+    TRAFFIC_FLASH,              // Night flash, outside the cycle
+    TRAFFIC_STATE_COUNT
+} traffic_state_t;
+
+#define TRAFFIC_CYCLE_STATES    4               // RED through GREEN_TO_YELLOW
+#define TRAFFIC_FSM_HELD        UINT64_MAX      // Deadline while GREEN or FLASH is held
+
+// Timing plan; a new one takes over at the end of a cycle
+typedef struct {
+    uint32_t durations_ms[TRAFFIC_CYCLE_STATES];
+    bool flash;                 // Flash yellow instead of cycling
+} traffic_plan_t;
+
+typedef struct {
+    traffic_plan_t plan;        // Plan in force
+    uint32_t all_red_ms;        // Shortest RED on preemption (cross traffic clears)
+    uint32_t min_ready_ms;      // Shortest RED_TO_YELLOW on preemption
+    uint32_t min_yellow_ms;     // GREEN_TO_YELLOW may not be configured shorter
+    uint32_t min_green_ms;      // GREEN kept at least this long after a preempt clears
+} traffic_fsm_config_t;
+
+typedef struct {
+    traffic_fsm_config_t config;
+    traffic_state_t state;
+    uint64_t state_start_us;    // When the outputs last changed
+    bool preempt;               // Preemption request active
+    uint64_t preempt_us;        // When the active request arrived
+    uint64_t release_us;        // When the last request cleared
+    uint64_t red_cut_us;        // RED ends here, once a request gave the cross street its yellow; 0 if not
+    traffic_plan_t next;        // Takes over when the current cycle ends
+    bool plan_pending;
+} traffic_fsm_t;
+
+typedef struct {
+    uint64_t at_us;             // When the step was taken
+    uint64_t deadline_us;       // When the state was due to end
+    traffic_state_t from;
+    traffic_state_t to;
+    bool preempt;               // Taken while preemption was active
+} traffic_fsm_step_t;
+
+// False if the configuration breaks a safety minimum
+bool traffic_fsm_init(traffic_fsm_t *fsm, const traffic_fsm_config_t *config,
+                      traffic_state_t state, uint64_t state_start_us);
+// False if the plan breaks a safety minimum of the configuration
+bool traffic_fsm_plan_ok(const traffic_fsm_config_t *config, const traffic_plan_t *plan);
+// End of the current state, TRAFFIC_FSM_HELD while GREEN or FLASH is held
+uint64_t traffic_fsm_deadline(const traffic_fsm_t *fsm);
+// Takes at most one step if the current state has ended by now_us; the
+// new state starts at now_us, so a late step never shortens the next one
+bool traffic_fsm_advance(traffic_fsm_t *fsm, uint64_t now_us, traffic_fsm_step_t *step);
+// Queues a plan for the end of the cycle, or in FLASH applies it at once;
+// false if the plan is unsafe
+bool traffic_fsm_set_plan(traffic_fsm_t *fsm, const traffic_plan_t *plan);
+// Returns false if the request did not change
+bool traffic_fsm_set_preempt(traffic_fsm_t *fsm, bool active, uint64_t now_us);
+// True if the pedestrian beeps may sound: GREEN with no request active
+bool traffic_fsm_beep_allowed(const traffic_fsm_t *fsm);
+// Where a cycle saved at (*state, *state_start_us) stands at now_us had it
+// run on under `plan` with the lights dark; a green that ran out in the
+// dark, main or cross street, gets its full yellow from now_us and FLASH
+// restarts at now_us. Returns the cycles begun; cycle_start_us (NULL if
+// not wanted) gets the start of the last one
+uint32_t traffic_fsm_resume(const traffic_fsm_config_t *config, const traffic_plan_t *plan,
+                            traffic_state_t *state, uint64_t *state_start_us,
+                            uint64_t *cycle_start_us, uint64_t now_us);
+// Longest wait from a preemption request to GREEN
+uint64_t traffic_fsm_preempt_bound_us(const traffic_fsm_config_t *config);
@@ -0,0 +1,382 @@
+/* Hardware-timed traffic signal
+ *
+ * The GPTimer free-runs at 1 MHz and is the state machine's clock. It
+ * starts an hour in, so a state resumed after a warm restart can have
+ * begun before the timer did. Both ISRs run the machine under one lock:
+ * the alarm ISR steps at a deadline, the input ISR changes the preemption
+ * request and steps at once if that made the deadline due. Either way the
+ * alarm is re-armed at the machine's new deadline, or disarmed while
+ * GREEN is held. With the GPTimer and GPIO ISRs in IRAM, flash writes in
+ * the main task cannot delay either path.
+ */
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "driver/gptimer.h"
+#include "hal/ledc_ll.h"
+#include "esp_cpu.h"
+#include "esp_attr.h"
+#include "esp_intr_alloc.h"
+#include "esp_log.h"
+#include "soc/soc.h"
+#include "soc/gpio_reg.h"
+#include "traffic_signal.h"
+
+static const char *TAG = "SIGNAL";
+
+#define START_COUNT_US  3600000000ULL   // Timer count at init
+#define MIN_LEAD_US     5               // Closer deadlines are applied right away
+#define STEP_QUEUE_LEN  8
+#define FLASH_HALF_US   500000          // Night flash: 1 s period, half on
+
+static gptimer_handle_t signal_timer = NULL;
+static traffic_signal_config_t hw;
+static uint32_t light_masks[TRAFFIC_STATE_COUNT];
+static uint32_t all_lights;
+static QueueHandle_t step_queue;
+
+static traffic_fsm_t fsm;
+static volatile bool running = false;
+static bool beeping = false;
+
+static traffic_signal_stats_t stats;
+static portMUX_TYPE signal_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static IRAM_ATTR void set_buzzer(uint32_t duty)
+{
+    ledc_dev_t *dev = LEDC_LL_GET_HW();
+    ledc_ll_set_duty_int_part(dev, hw.speed_mode, hw.buzzer_channel, duty);
+    ledc_ll_set_duty_direction(dev, hw.speed_mode, hw.buzzer_channel, LEDC_DUTY_DIR_INCREASE);
+    ledc_ll_set_duty_num(dev, hw.speed_mode, hw.buzzer_channel, 1);
+    ledc_ll_set_duty_cycle(dev, hw.speed_mode, hw.buzzer_channel, 1);
+    ledc_ll_set_duty_scale(dev, hw.speed_mode, hw.buzzer_channel, 0);
+    ledc_ll_set_duty_start(dev, hw.speed_mode, hw.buzzer_channel, true);
+    ledc_ll_ls_channel_update(dev, hw.speed_mode, hw.buzzer_channel);
+}
+
+static IRAM_ATTR void show_mask(uint32_t lit)
+{
+    REG_WRITE(GPIO_OUT_W1TC_REG, all_lights & ~lit);
+    REG_WRITE(GPIO_OUT_W1TS_REG, lit);
+}
+
+static IRAM_ATTR void show(traffic_state_t state)
+{
+    show_mask(light_masks[state]);
+}
+
+// Lock held. Steps if due, then arms the alarm for whatever comes next.
+static IRAM_ATTR bool run_machine(uint64_t now, traffic_fsm_step_t *step)
+{
+    bool stepped = traffic_fsm_advance(&fsm, now, step);
+    if (stepped) {
+        show(step->to);
+        // Beeps belong to one GREEN; any change ends the current one
+        if (beeping) {
+            set_buzzer(0);
+            beeping = false;
+        }
+        stats.steps++;
+        if (step->to == TRAFFIC_GREEN && fsm.preempt) {
+            uint32_t to_green = (uint32_t)(now - fsm.preempt_us);
+            if (to_green > stats.max_to_green_us) {
+                stats.max_to_green_us = to_green;
+            }
+        }
+    }
+    uint64_t deadline = traffic_fsm_deadline(&fsm);
+    if (fsm.state == TRAFFIC_FLASH && deadline > now) {
+        // Blink edges on whole half-periods from the start of the flash
+        uint64_t half = (now - fsm.state_start_us) / FLASH_HALF_US;
+        show_mask((half % 2 == 0) ? light_masks[TRAFFIC_FLASH] : 0);
+        uint64_t edge = fsm.state_start_us + (half + 1) * FLASH_HALF_US;
+        if (edge < deadline) {
+            deadline = edge;
+        }
+    }
+    if (deadline == TRAFFIC_FSM_HELD) {
+        gptimer_set_alarm_action(signal_timer, NULL);
+    } else {
+        gptimer_alarm_config_t alarm = {
+            .alarm_count = deadline > now + MIN_LEAD_US ? deadline : now + MIN_LEAD_US
+        };
+        gptimer_set_alarm_action(signal_timer, &alarm);
+    }
+    return stepped;
+}
+
+static IRAM_ATTR void queue_step(const traffic_fsm_step_t *step, BaseType_t *woken)
+{
+    BaseType_t ok = xPortInIsrContext() ? xQueueSendFromISR(step_queue, step, woken)
+                                        : xQueueSend(step_queue, step, 0);
+    if (ok != pdTRUE) {
+        portENTER_CRITICAL_SAFE(&signal_lock);
+        stats.queue_full++;
+        portEXIT_CRITICAL_SAFE(&signal_lock);
+    }
+}
+
+static IRAM_ATTR bool signal_isr(gptimer_handle_t timer, const gptimer_alarm_event_data_t *edata, void *user_ctx)
+{
+    uint32_t start = esp_cpu_get_cycle_count();
+    traffic_fsm_step_t step;
+    bool stepped = false;
+
+    portENTER_CRITICAL_ISR(&signal_lock);
+    if (running) {
+        uint64_t now = edata->count_value;
+        gptimer_get_raw_count(timer, &now);
+        stepped = run_machine(now, &step);
+        if (stepped) {
+            uint32_t late = (uint32_t)(now - step.deadline_us);
+            if (late > stats.max_late_us) {
+                stats.max_late_us = late;
+            }
+        }
+    }
+    uint32_t cycles = esp_cpu_get_cycle_count() - start;
+    if (cycles > stats.max_isr_cycles) {
+        stats.max_isr_cycles = cycles;
+    }
+    portEXIT_CRITICAL_ISR(&signal_lock);
+
+    BaseType_t woken = pdFALSE;
+    if (stepped) {
+        queue_step(&step, &woken);
+    }
+    return woken == pdTRUE;
+}
+
+// Shared by the input ISR and software requests
+static IRAM_ATTR void request_preempt(bool active, uint32_t entry_cycles, BaseType_t *woken)
+{
+    traffic_fsm_step_t step;
+    bool stepped = false;
+
+    portENTER_CRITICAL_SAFE(&signal_lock);
+    uint64_t now = 0;
+    gptimer_get_raw_count(signal_timer, &now);
+    if (running && traffic_fsm_set_preempt(&fsm, active, now)) {
+        if (active) {
+            stats.preempts++;
+            if (beeping) {
+                set_buzzer(0);
+                beeping = false;
+            }
+        }
+        // Steps now if the new deadline has passed, else re-arms earlier
+        stepped = run_machine(now, &step);
+        if (stepped) {
+            uint32_t cycles = esp_cpu_get_cycle_count() - entry_cycles;
+            stats.immediate++;
+            stats.total_effect_cycles += cycles;
+            if (cycles > stats.max_effect_cycles) {
+                stats.max_effect_cycles = cycles;
+            }
+        }
+    }
+    portEXIT_CRITICAL_SAFE(&signal_lock);
+
+    if (stepped) {
+        queue_step(&step, woken);
+    }
+}
+
+static IRAM_ATTR void preempt_isr(void *arg)
+{
+    uint32_t start = esp_cpu_get_cycle_count();
+    gpio_num_t pin = hw.preempt_pin;
+    bool level = (pin < 32) ? (REG_READ(GPIO_IN_REG) >> pin) & 1 : (REG_READ(GPIO_IN1_REG) >> (pin - 32)) & 1;
+
+    portENTER_CRITICAL_ISR(&signal_lock);
+    stats.preempt_edges++;
+    portEXIT_CRITICAL_ISR(&signal_lock);
+
+    BaseType_t woken = pdFALSE;
+    request_preempt(level == hw.preempt_active_level, start, &woken);
+
+    uint32_t cycles = esp_cpu_get_cycle_count() - start;
+    portENTER_CRITICAL_ISR(&signal_lock);
+    if (cycles > stats.max_isr_cycles) {
+        stats.max_isr_cycles = cycles;
+    }
+    portEXIT_CRITICAL_ISR(&signal_lock);
+    if (woken == pdTRUE) {
+        portYIELD_FROM_ISR();
+    }
+}
+
+esp_err_t traffic_signal_init(const traffic_signal_config_t *config)
+{
+    if (config == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (signal_timer != NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    hw = *config;
+    all_lights = 0;
+    for (int i = 0; i < TRAFFIC_STATE_COUNT; i++) {
+        if (config->light_pins[i] >= 32) {
+            ESP_LOGE(TAG, "Light pin GPIO%d must be below GPIO32", config->light_pins[i]);
+            return ESP_ERR_INVALID_ARG;
+        }
+        light_masks[i] = 1u << config->light_pins[i];
+        all_lights |= light_masks[i];
+    }
+
+    step_queue = xQueueCreate(STEP_QUEUE_LEN, sizeof(traffic_fsm_step_t));
+    if (step_queue == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    gptimer_config_t timer_config = {
+        .clk_src = GPTIMER_CLK_SRC_DEFAULT,
+        .direction = GPTIMER_COUNT_UP,
+        .resolution_hz = TRAFFIC_SIGNAL_TIMER_HZ
+    };
+    ESP_ERROR_CHECK(gptimer_new_timer(&timer_config, &signal_timer));
+    gptimer_event_callbacks_t callbacks = {
+        .on_alarm = signal_isr
+    };
+    ESP_ERROR_CHECK(gptimer_register_event_callbacks(signal_timer, &callbacks, NULL));
+    ESP_ERROR_CHECK(gptimer_set_raw_count(signal_timer, START_COUNT_US));
+    ESP_ERROR_CHECK(gptimer_enable(signal_timer));
+    ESP_ERROR_CHECK(gptimer_start(signal_timer));
+
+    if (config->preempt_pin != GPIO_NUM_NC) {
+        if (!GPIO_IS_VALID_GPIO(config->preempt_pin)) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        gpio_config_t io_conf = {
+            .mode = GPIO_MODE_INPUT,
+            .pull_up_en = config->preempt_pull_up ? GPIO_PULLUP_ENABLE : GPIO_PULLUP_DISABLE,
+            .pull_down_en = GPIO_PULLDOWN_DISABLE,
+            .intr_type = GPIO_INTR_ANYEDGE,
+            .pin_bit_mask = 1ULL << config->preempt_pin
+        };
+        ESP_ERROR_CHECK(gpio_config(&io_conf));
+        // The service may already be installed by another driver
+        esp_err_t ret = gpio_install_isr_service(ESP_INTR_FLAG_IRAM);
+        if (ret != ESP_OK && ret != ESP_ERR_INVALID_STATE) {
+            return ret;
+        }
+        ESP_ERROR_CHECK(gpio_isr_handler_add(config->preempt_pin, preempt_isr, NULL));
+        ESP_LOGI(TAG, "Preemption input on GPIO%d, active %s", config->preempt_pin,
+                 config->preempt_active_level ? "high" : "low");
+    }
+    return ESP_OK;
+}
+
+esp_err_t traffic_signal_start(const traffic_fsm_config_t *fsm_config, traffic_state_t state,
+                               uint32_t elapsed_ms)
+{
+    if (signal_timer == NULL || running) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    uint64_t now = 0;
+    ESP_ERROR_CHECK(gptimer_get_raw_count(signal_timer, &now));
+    traffic_fsm_t machine;
+    if (!traffic_fsm_init(&machine, fsm_config, state, now - (uint64_t)elapsed_ms * 1000)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    portENTER_CRITICAL(&signal_lock);
+    fsm = machine;
+    memset(&stats, 0, sizeof(stats));
+    running = true;
+    show(state);
+    traffic_fsm_step_t step;
+    bool stepped = run_machine(now, &step);
+    portEXIT_CRITICAL(&signal_lock);
+
+    if (stepped) {
+        queue_step(&step, NULL);
+    }
+    // Preemption requests that arrived before the machine ran
+    if (hw.preempt_pin != GPIO_NUM_NC && gpio_get_level(hw.preempt_pin) == hw.preempt_active_level) {
+        traffic_signal_set_preempt(true);
+    }
+    return ESP_OK;
+}
+
+bool traffic_signal_get_step(traffic_fsm_step_t *step, TickType_t wait)
+{
+    return xQueueReceive(step_queue, step, wait) == pdTRUE;
+}
+
+void traffic_signal_set_preempt(bool active)
+{
+    request_preempt(active, esp_cpu_get_cycle_count(), NULL);
+}
+
+esp_err_t traffic_signal_set_plan(const traffic_plan_t *plan)
+{
+    traffic_fsm_step_t step;
+    bool stepped = false;
+    esp_err_t ret = ESP_ERR_INVALID_STATE;
+
+    portENTER_CRITICAL(&signal_lock);
+    if (running) {
+        ret = ESP_ERR_INVALID_ARG;
+        if (traffic_fsm_set_plan(&fsm, plan)) {
+            ret = ESP_OK;
+            // Leaving FLASH happens right here
+            uint64_t now = 0;
+            gptimer_get_raw_count(signal_timer, &now);
+            stepped = run_machine(now, &step);
+        }
+    }
+    portEXIT_CRITICAL(&signal_lock);
+
+    if (stepped) {
+        queue_step(&step, NULL);
+    }
+    return ret;
+}
+
+void traffic_signal_get_plan(traffic_plan_t *plan)
+{
+    portENTER_CRITICAL(&signal_lock);
+    *plan = fsm.config.plan;
+    portEXIT_CRITICAL(&signal_lock);
+}
+
+bool traffic_signal_preempted(void)
+{
+    return fsm.preempt;
+}
+
+uint32_t traffic_signal_remaining_ms(void)
+{
+    uint64_t now = 0;
+    if (signal_timer == NULL || gptimer_get_raw_count(signal_timer, &now) != ESP_OK) {
+        return 0;
+    }
+    portENTER_CRITICAL(&signal_lock);
+    uint64_t deadline = traffic_fsm_deadline(&fsm);
+    portEXIT_CRITICAL(&signal_lock);
+    if (deadline == TRAFFIC_FSM_HELD) {
+        return UINT32_MAX;
+    }
+    return deadline > now ? (uint32_t)((deadline - now) / 1000) : 0;
+}
+
+bool traffic_signal_beep(bool on)
+{
+    portENTER_CRITICAL(&signal_lock);
+    bool allowed = !on || (running && traffic_fsm_beep_allowed(&fsm));
+    if (allowed) {
+        set_buzzer(on ? hw.beep_duty : 0);
+        beeping = on;
+    }
+    portEXIT_CRITICAL(&signal_lock);
+    return allowed;
+}
+
+void traffic_signal_get_stats(traffic_signal_stats_t *out)
+{
+    portENTER_CRITICAL(&signal_lock);
+    *out = stats;
+    portEXIT_CRITICAL(&signal_lock);
+}
@@ -0,0 +1,66 @@
+/* Hardware-timed traffic signal
+ * Runs the state machine (traffic_fsm.h) from a GPTimer ISR: each state
+ * change is armed at its absolute deadline and the lights are switched
+ * with one W1TC and one W1TS write inside the ISR. The emergency-vehicle
+ * preemption input has its own GPIO ISR that updates the request and, if
+ * the outputs can change right away, changes them before it returns;
+ * otherwise the alarm is re-armed at the new, earlier deadline. Steps are
+ * queued for the main task, which logs and persists them. In the night
+ * FLASH state the alarm ISR also blinks the FLASH light.
+ *
+ * The pedestrian buzzer is written through the LEDC LL layer under the
+ * same lock, so a preemption silences it and no beep can restart it.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "driver/gpio.h"
+#include "driver/ledc.h"
+#include "traffic_fsm.h"
+
+#define TRAFFIC_SIGNAL_TIMER_HZ     1000000
+
+typedef struct {
+    gpio_num_t light_pins[TRAFFIC_STATE_COUNT];     // Lit in each state, below GPIO32
+    ledc_mode_t speed_mode;
+    ledc_channel_t buzzer_channel;  // Channel already configured by the caller
+    uint32_t beep_duty;
+    gpio_num_t preempt_pin;         // GPIO_NUM_NC: software requests only
+    bool preempt_active_level;
+    bool preempt_pull_up;
+} traffic_signal_config_t;
+
+typedef struct {
+    uint32_t steps;
+    uint32_t max_late_us;           // Timed steps: applied minus deadline
+    uint32_t preempt_edges;
+    uint32_t preempts;              // Requests that became active
+    uint32_t immediate;             // Requests that changed the lights inside the input ISR
+    uint32_t max_effect_cycles;     // Input ISR entry to light change, for those
+    uint64_t total_effect_cycles;
+    uint32_t max_to_green_us;       // Request to GREEN shown, the clearance included
+    uint32_t max_isr_cycles;
+    uint32_t queue_full;
+} traffic_signal_stats_t;
+
+esp_err_t traffic_signal_init(const traffic_signal_config_t *config);
+// Starts the machine in `state`, elapsed_ms into it, and shows its lights
+esp_err_t traffic_signal_start(const traffic_fsm_config_t *fsm_config, traffic_state_t state,
+                               uint32_t elapsed_ms);
+// Next step taken by the ISRs; false on timeout
+bool traffic_signal_get_step(traffic_fsm_step_t *step, TickType_t wait);
+// Queues a timing plan for the end of the cycle (applied at once in FLASH)
+esp_err_t traffic_signal_set_plan(const traffic_plan_t *plan);
+// Plan the running cycle uses
+void traffic_signal_get_plan(traffic_plan_t *plan);
+// Software request (simulated detector), same path as the input ISR
+void traffic_signal_set_preempt(bool active);
+bool traffic_signal_preempted(void);
+// Time left in the current state, UINT32_MAX while GREEN or FLASH is held
+uint32_t traffic_signal_remaining_ms(void);
+// Turning on is refused (false) outside GREEN and while preemption is active
+bool traffic_signal_beep(bool on);
+void traffic_signal_get_stats(traffic_signal_stats_t *stats);
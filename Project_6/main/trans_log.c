@@ -0,0 +1,261 @@
+/* Transition log
+ *
+ * Flash layout: the partition is an array of 256-byte pages, each
+ * { magic, seq, boot, count, crc, records[30] }. seq grows by one per page
+ * written, so the newest page is the valid one with the highest seq and
+ * the write position follows it. A page torn by a reset fails its CRC and
+ * is skipped together with the rest of its sector.
+ *
+ * erased_pages counts the erased pages from the write position on. The
+ * erased stretch always ends on a sector boundary, so it is refilled a
+ * whole sector at a time, one sector ahead of the writes.
+ */
+#include <string.h>
+#include <stddef.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "trans_log.h"
+
+static const char *TAG = "TRANS_LOG";
+
+#define PAGE_MAGIC          0x4c475254      // "TRGL"
+#define SECTOR_SIZE         4096
+#define PAGES_PER_SECTOR    (SECTOR_SIZE / TRANS_LOG_PAGE_SIZE)
+#define HEADER_SIZE         16
+#define RECORDS_PER_PAGE    ((TRANS_LOG_PAGE_SIZE - HEADER_SIZE) / sizeof(trans_log_record_t))
+
+typedef struct {
+    uint32_t magic;
+    uint32_t seq;
+    uint16_t boot;
+    uint16_t count;
+    uint32_t crc;               // Header before it plus the used records
+    trans_log_record_t records[RECORDS_PER_PAGE];
+} log_page_t;
+
+_Static_assert(sizeof(log_page_t) == TRANS_LOG_PAGE_SIZE, "log page must fill one flash page");
+
+static const esp_partition_t *partition;
+static uint32_t num_pages;
+static uint32_t head;               // Next page to write
+static uint32_t erased_pages;
+static uint32_t next_seq;
+static uint16_t boot;
+
+// RAM side: the page being filled and the sealed pages behind it
+static log_page_t fill;
+static log_page_t queue[TRANS_LOG_RAM_PAGES];
+static uint32_t queue_head;
+static uint32_t queue_count;
+static log_page_t io_page;          // Flash-side copy, never touched by append
+static trans_log_stats_t stats;
+static portMUX_TYPE log_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static uint32_t page_crc(const log_page_t *page)
+{
+    uint32_t crc = esp_rom_crc32_le(0, (const uint8_t *)page, offsetof(log_page_t, crc));
+    return esp_rom_crc32_le(crc, (const uint8_t *)page->records, page->count * sizeof(trans_log_record_t));
+}
+
+static bool page_valid(const log_page_t *page)
+{
+    return page->magic == PAGE_MAGIC && page->count > 0 && page->count <= RECORDS_PER_PAGE &&
+           page->crc == page_crc(page);
+}
+
+static bool page_blank(const log_page_t *page)
+{
+    const uint32_t *word = (const uint32_t *)page;
+    for (size_t i = 0; i < sizeof(*page) / sizeof(uint32_t); i++) {
+        if (word[i] != 0xFFFFFFFF) {
+            return false;
+        }
+    }
+    return true;
+}
+
+esp_err_t trans_log_init(void)
+{
+    const esp_partition_t *part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                                           TRANS_LOG_SUBTYPE, TRANS_LOG_PARTITION);
+    if (part == NULL) {
+        ESP_LOGE(TAG, "No '%s' partition", TRANS_LOG_PARTITION);
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (part->size % SECTOR_SIZE != 0 || part->size < 2 * SECTOR_SIZE) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    num_pages = part->size / TRANS_LOG_PAGE_SIZE;
+
+    // Newest valid page decides where writing resumes
+    bool found = false;
+    uint32_t newest = 0;
+    uint32_t newest_seq = 0;
+    for (uint32_t i = 0; i < num_pages; i++) {
+        ESP_ERROR_CHECK(esp_partition_read(part, i * TRANS_LOG_PAGE_SIZE, &io_page, sizeof(io_page)));
+        if (page_valid(&io_page) && (!found || io_page.seq > newest_seq)) {
+            found = true;
+            newest = i;
+            newest_seq = io_page.seq;
+            boot = io_page.boot + 1;
+        }
+    }
+    head = found ? (newest + 1) % num_pages : 0;
+    next_seq = found ? newest_seq + 1 : 0;
+
+    // Trust the rest of the current sector only if every page of it is
+    // blank; a torn page moves writing on to the next sector
+    erased_pages = 0;
+    if (head % PAGES_PER_SECTOR != 0) {
+        uint32_t sector_end = (head / PAGES_PER_SECTOR + 1) * PAGES_PER_SECTOR;
+        bool blank = true;
+        for (uint32_t i = head; i < sector_end && blank; i++) {
+            ESP_ERROR_CHECK(esp_partition_read(part, i * TRANS_LOG_PAGE_SIZE, &io_page, sizeof(io_page)));
+            blank = page_blank(&io_page);
+        }
+        if (blank) {
+            erased_pages = sector_end - head;
+        } else {
+            head = sector_end % num_pages;
+        }
+    }
+    partition = part;
+    ESP_LOGI(TAG, "%lu KB at 0x%lx, boot %u, next page %lu (seq %lu)",
+             (unsigned long)(part->size / 1024), (unsigned long)part->address, boot,
+             (unsigned long)head, (unsigned long)next_seq);
+    return ESP_OK;
+}
+
+void trans_log_append(uint32_t time_ms, uint8_t from, uint8_t to, trans_log_cause_t cause)
+{
+    portENTER_CRITICAL_SAFE(&log_lock);
+    fill.records[fill.count++] = (trans_log_record_t){
+        .time_ms = time_ms,
+        .from = from,
+        .to = to,
+        .cause = cause
+    };
+    stats.appended++;
+    if (fill.count == RECORDS_PER_PAGE) {
+        if (queue_count < TRANS_LOG_RAM_PAGES) {
+            queue[(queue_head + queue_count) % TRANS_LOG_RAM_PAGES] = fill;
+            queue_count++;
+        } else {
+            stats.dropped += fill.count;
+        }
+        fill.count = 0;
+    }
+    portEXIT_CRITICAL_SAFE(&log_lock);
+}
+
+bool trans_log_pending(void)
+{
+    portENTER_CRITICAL(&log_lock);
+    bool pending = queue_count > 0;
+    portEXIT_CRITICAL(&log_lock);
+    return pending;
+}
+
+esp_err_t trans_log_flush(uint32_t quiet_ms, bool *did_work)
+{
+    *did_work = false;
+    if (partition == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    bool pending = trans_log_pending();
+    int64_t start;
+    esp_err_t ret;
+
+    if (pending && erased_pages > 0) {
+        if (quiet_ms < TRANS_LOG_WRITE_GUARD_MS) {
+            stats.deferred++;
+            return ESP_OK;
+        }
+        portENTER_CRITICAL(&log_lock);
+        io_page = queue[queue_head];
+        portEXIT_CRITICAL(&log_lock);
+        io_page.magic = PAGE_MAGIC;
+        io_page.seq = next_seq;
+        io_page.boot = boot;
+        io_page.crc = page_crc(&io_page);
+
+        start = esp_timer_get_time();
+        ret = esp_partition_write(partition, head * TRANS_LOG_PAGE_SIZE, &io_page, sizeof(io_page));
+        uint32_t us = esp_timer_get_time() - start;
+        *did_work = true;
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        portENTER_CRITICAL(&log_lock);
+        queue_head = (queue_head + 1) % TRANS_LOG_RAM_PAGES;
+        queue_count--;
+        portEXIT_CRITICAL(&log_lock);
+        next_seq++;
+        head = (head + 1) % num_pages;
+        erased_pages--;
+        stats.pages_written++;
+        stats.total_flash_us += us;
+        if (us > stats.max_write_us) {
+            stats.max_write_us = us;
+        }
+        return ESP_OK;
+    }
+
+    // Keep one erased sector ahead of the write position; this erases the
+    // oldest sector of the ring
+    if (erased_pages <= PAGES_PER_SECTOR) {
+        if (quiet_ms < TRANS_LOG_ERASE_GUARD_MS) {
+            if (pending) {
+                stats.deferred++;
+            }
+            return ESP_OK;
+        }
+        uint32_t sector_page = (head + erased_pages) % num_pages;
+        start = esp_timer_get_time();
+        ret = esp_partition_erase_range(partition, sector_page * TRANS_LOG_PAGE_SIZE, SECTOR_SIZE);
+        uint32_t us = esp_timer_get_time() - start;
+        *did_work = true;
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        erased_pages += PAGES_PER_SECTOR;
+        stats.sectors_erased++;
+        stats.total_flash_us += us;
+        if (us > stats.max_erase_us) {
+            stats.max_erase_us = us;
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t trans_log_for_each(trans_log_visit_t visit, void *ctx)
+{
+    if (partition == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    // From the write position on the pages are the oldest lap
+    for (uint32_t n = 0; n < num_pages; n++) {
+        uint32_t i = (head + n) % num_pages;
+        esp_err_t ret = esp_partition_read(partition, i * TRANS_LOG_PAGE_SIZE, &io_page, sizeof(io_page));
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        if (!page_valid(&io_page)) {
+            continue;
+        }
+        for (uint32_t r = 0; r < io_page.count; r++) {
+            visit(io_page.boot, &io_page.records[r], ctx);
+        }
+    }
+    return ESP_OK;
+}
+
+void trans_log_get_stats(trans_log_stats_t *out)
+{
+    portENTER_CRITICAL(&log_lock);
+    *out = stats;
+    portEXIT_CRITICAL(&log_lock);
+}
@@ -0,0 +1,69 @@
+/* Transition log
+ * Append-only binary log of signal transitions (boot, time, from, to,
+ * cause) in its own flash partition. Records collect in RAM pages of one
+ * flash program page (256 bytes) each; only whole pages are written. The
+ * partition is used as a ring: sectors are erased one ahead of the write
+ * position and each is erased once per lap, which spreads wear evenly.
+ *
+ * Flash operations disable the cache and stall both cores, so nothing
+ * here touches flash on its own. The owner calls trans_log_flush() with
+ * the time it can spare before its next deadline and at most one write
+ * or erase runs, only if it fits.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#define TRANS_LOG_PARTITION     "translog"
+#define TRANS_LOG_SUBTYPE       0x40
+#define TRANS_LOG_PAGE_SIZE     256
+#define TRANS_LOG_RAM_PAGES     4       // Sealed pages waiting for a quiet window
+
+// Worst-case cost assumed before starting each operation
+#define TRANS_LOG_WRITE_GUARD_MS    20
+#define TRANS_LOG_ERASE_GUARD_MS    500
+
+typedef enum {
+    TRANS_CAUSE_TIMER,          // Phase time ran out
+    TRANS_CAUSE_COLD_START,
+    TRANS_CAUSE_WARM_RESUME,
+    TRANS_CAUSE_FAULT,          // Unknown state, forced back to RED
+    TRANS_CAUSE_PREEMPT,        // Taken while emergency preemption was active
+    TRANS_CAUSE_PLAN            // Night flash ended by the day plan
+} trans_log_cause_t;
+
+typedef struct {
+    uint32_t time_ms;           // Since boot
+    uint8_t from;
+    uint8_t to;
+    uint8_t cause;
+    uint8_t reserved;
+} trans_log_record_t;
+
+typedef struct {
+    uint32_t appended;
+    uint32_t dropped;           // RAM pages full, flash starved
+    uint32_t pages_written;
+    uint32_t sectors_erased;
+    uint32_t deferred;          // Flush calls with work but too little time
+    uint32_t max_write_us;
+    uint32_t max_erase_us;
+    uint64_t total_flash_us;
+} trans_log_stats_t;
+
+// Finds the partition and the write position; records appended before
+// this are kept
+esp_err_t trans_log_init(void);
+// RAM only, safe to call at any time from any task
+void trans_log_append(uint32_t time_ms, uint8_t from, uint8_t to, trans_log_cause_t cause);
+// Runs at most one flash operation, and only if it fits in quiet_ms.
+// Sets *did_work when it touched flash.
+esp_err_t trans_log_flush(uint32_t quiet_ms, bool *did_work);
+bool trans_log_pending(void);
+// Oldest to newest over everything in flash; boot counts up once per boot.
+// Reads flash, so call it only where a stall is harmless.
+typedef void (*trans_log_visit_t)(uint16_t boot, const trans_log_record_t *record, void *ctx);
+esp_err_t trans_log_for_each(trans_log_visit_t visit, void *ctx);
+void trans_log_get_stats(trans_log_stats_t *stats);
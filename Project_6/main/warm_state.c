@@ -0,0 +1,100 @@
+/* Warm-restart state
+ *
+ * RTC_NOINIT_ATTR places the record in RTC slow memory and keeps the
+ * startup code from zeroing it, so it holds garbage after power-on; the
+ * magic and CRC tell the two apart. The RTC timer runs from the slow
+ * clock (150 kHz RC by default, a few percent off), which is plenty for
+ * phases measured in seconds.
+ */
+#include <stddef.h>
+#include <string.h>
+#include "esp_attr.h"
+#include "esp_rom_crc.h"
+#include "esp_rtc_time.h"
+#include "warm_state.h"
+
+#define WARM_STATE_MAGIC    0x54524632      // "TRF2"
+#define RESET_MARK_MAGIC    0x52535431      // "RST1"
+
+static RTC_NOINIT_ATTR warm_state_t record;
+static RTC_NOINIT_ATTR uint32_t reset_mark_magic;
+static RTC_NOINIT_ATTR uint64_t reset_mark_us;
+
+static uint32_t record_crc(const warm_state_t *r)
+{
+    return esp_rom_crc32_le(0, (const uint8_t *)r, offsetof(warm_state_t, crc));
+}
+
+uint64_t warm_state_now_us(void)
+{
+    return esp_rtc_get_time_us();
+}
+
+void warm_state_save(uint8_t state, uint32_t cycles, uint64_t state_start_us, uint64_t cycle_start_us,
+                     const uint32_t durations_ms[4])
+{
+    warm_state_t r = {
+        .magic = WARM_STATE_MAGIC,
+        .state = state,
+        .cycles = cycles,
+        .state_start_us = state_start_us,
+        .cycle_start_us = cycle_start_us
+    };
+    memcpy(r.durations_ms, durations_ms, sizeof(r.durations_ms));
+    r.crc = record_crc(&r);
+    record = r;
+}
+
+bool warm_state_load(warm_state_t *out, esp_reset_reason_t *reason)
+{
+    *reason = esp_reset_reason();
+    switch (*reason) {
+        case ESP_RST_SW:
+        case ESP_RST_PANIC:
+        case ESP_RST_INT_WDT:
+        case ESP_RST_TASK_WDT:
+        case ESP_RST_WDT:
+        case ESP_RST_BROWNOUT:
+            break;
+        default:
+            // Power-on and reset-pin boots restart the RTC timer too
+            return false;
+    }
+    warm_state_t r = record;
+    if (r.magic != WARM_STATE_MAGIC || r.crc != record_crc(&r)) {
+        return false;
+    }
+    uint64_t now = warm_state_now_us();
+    if (r.state_start_us > now || r.cycle_start_us > r.state_start_us) {
+        return false;
+    }
+    // The resume walks phases forward by these
+    for (int i = 0; i < 4; i++) {
+        if (r.durations_ms[i] == 0) {
+            return false;
+        }
+    }
+    *out = r;
+    return true;
+}
+
+void warm_state_clear(void)
+{
+    record.magic = 0;
+}
+
+void warm_state_mark_reset(void)
+{
+    reset_mark_us = warm_state_now_us();
+    reset_mark_magic = RESET_MARK_MAGIC;
+}
+
+bool warm_state_reset_age_us(uint64_t *age_us)
+{
+    if (reset_mark_magic != RESET_MARK_MAGIC) {
+        return false;
+    }
+    reset_mark_magic = 0;
+    *age_us = warm_state_now_us() - reset_mark_us;
+    return true;
+}
@@ -0,0 +1,40 @@
+/* Warm-restart state
+ * One record in RTC slow memory (RTC_NOINIT_ATTR) holding where the
+ * signal cycle stands: current state, when it was entered and when the
+ * current cycle began, all on the RTC timer, which keeps counting through
+ * software, panic, watchdog and brownout resets. After such a reset the
+ * record tells the controller which lights to show and how much of the
+ * phase is left without waiting for a fresh cycle. Power-on and reset-pin
+ * boots always start cold.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_system.h"
+
+typedef struct {
+    uint32_t magic;
+    uint8_t state;
+    uint8_t reserved[3];
+    uint32_t cycles;            // Completed signal cycles since the cold start
+    uint64_t state_start_us;    // RTC time the state was entered
+    uint64_t cycle_start_us;    // RTC time the current cycle (RED) began
+    uint32_t durations_ms[4];   // Phase timing of the plan in force
+    uint32_t crc;
+} warm_state_t;
+
+// RTC timer time; the clock every record field refers to
+uint64_t warm_state_now_us(void);
+// Cheap enough to call on every transition: one RTC memory copy and a CRC
+void warm_state_save(uint8_t state, uint32_t cycles, uint64_t state_start_us, uint64_t cycle_start_us,
+                     const uint32_t durations_ms[4]);
+// True if the reset kept RTC memory and the record is intact; reason is
+// filled either way
+bool warm_state_load(warm_state_t *out, esp_reset_reason_t *reason);
+void warm_state_clear(void);
+
+// Benchmark support: stamp the RTC time just before a deliberate reset,
+// then read back (once) how long ago that was
+void warm_state_mark_reset(void);
+bool warm_state_reset_age_us(uint64_t *age_us);
@@ -0,0 +1,48 @@
+"""Project 6 under QEMU: signal dwell times and step lateness
+
+Built with -DQEMU_TEST=1: preemption is off (no detector) and the signal
+stats come every 2 cycles. QEMU boots with the clock unset, so the
+off-peak plan runs.
+"""
+import pytest
+
+from conftest import TICK_MS
+
+TAG = 'TRAFFIC_LIGHT'
+# Off-peak plan, main.c: RED, YELLOW (ready), GREEN, YELLOW (caution)
+DWELL_MS = {
+    b'RED (STOP)': 5000,
+    b'YELLOW (READY)': 2000,
+    b'GREEN (GO - Safe to Cross)': 5000,
+    b'YELLOW (CAUTION)': 2000,
+}
+CYCLE = [b'RED (STOP)', b'YELLOW (READY)', b'GREEN (GO - Safe to Cross)', b'YELLOW (CAUTION)']
+STATS_CYCLES = 2                # TRANS_LOG_STATS_CYCLES under QEMU_TEST
+MAX_STEP_LATE_US = 100          # Regression budget, latest timed step
+MAX_ISR_CYCLES = 5000           # Regression budget for the signal ISRs
+
+STATE = r'([A-Z]+ \([^)]*\))'
+
+
+@pytest.mark.esp32
+@pytest.mark.qemu
+def test_dwell_times(log):
+    log.check_boot()
+    log.expect(TAG, 'Traffic light system started')
+    steps = log.expect_all(TAG, rf'State Transition: {STATE} -> {STATE}',
+                           STATS_CYCLES * len(CYCLE), timeout=10)
+    for (ms, step), (next_ms, _) in zip(steps, steps[1:]):
+        state = step.group(3)
+        assert CYCLE.index(state) == (CYCLE.index(step.group(2)) + 1) % len(CYCLE), \
+            f'{step.group(2)} -> {state} out of order'
+        # Both ends are the ISR's step as logged by the task, each within a tick
+        assert abs(next_ms - ms - DWELL_MS[state]) <= log.budget(2 * TICK_MS), \
+            f'{state.decode()} held {next_ms - ms} ms'
+
+    # Stats follow the RED entry that ends the STATS_CYCLES-th cycle
+    _, signal = log.expect(TAG, r'Signal: \d+ steps, timed steps max late (\d+) us, ISR max (\d+) cycles')
+    assert int(signal.group(2)) <= log.budget(MAX_STEP_LATE_US)
+    assert int(signal.group(3)) <= log.budget(MAX_ISR_CYCLES)
+    # Flash page writes must not delay the steps that follow them
+    _, flush = log.expect(TAG, r'Transitions right after a flush: \d+, max late (\d+) us')
+    assert int(flush.group(2)) <= log.budget(MAX_STEP_LATE_US)
@@ -0,0 +1,64 @@
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "flash_stress.h"
+
+static const char *TAG = "FLASH_STRESS";
+
+static uint32_t stress_erases, stress_writes, stress_max_op_us;
+
+static void stress_op_done(int64_t start)
+{
+    uint32_t us = (uint32_t)(esp_timer_get_time() - start);
+    if (us > stress_max_op_us) {
+        stress_max_op_us = us;
+    }
+}
+
+static void flash_stress_task(void *arg)
+{
+    const esp_partition_t *part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                                           ESP_PARTITION_SUBTYPE_DATA_NVS, NULL);
+    if (part == NULL) {
+        ESP_LOGE(TAG, "Flash stress: no NVS partition");
+        vTaskDelete(NULL);
+    }
+    static uint8_t page[FLASH_STRESS_PAGE];
+    memset(page, 0xA5, sizeof(page));
+    uint32_t offset = 0;
+    while (1) {
+        int64_t start = esp_timer_get_time();
+        ESP_ERROR_CHECK(esp_partition_erase_range(part, offset, FLASH_STRESS_SECTOR));
+        stress_op_done(start);
+        stress_erases++;
+        for (uint32_t at = 0; at < FLASH_STRESS_SECTOR; at += FLASH_STRESS_PAGE) {
+            start = esp_timer_get_time();
+            ESP_ERROR_CHECK(esp_partition_write(part, offset + at, page, FLASH_STRESS_PAGE));
+            stress_op_done(start);
+            stress_writes++;
+        }
+        offset = (offset + FLASH_STRESS_SECTOR) % part->size;
+        vTaskDelay(1);      // Lets the idle task run
+    }
+}
+
+esp_err_t flash_stress_start(void)
+{
+    if (xTaskCreate(flash_stress_task, "flash_stress", 2048, NULL, 1, NULL) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+void flash_stress_log(void)
+{
+    ESP_LOGI(TAG, "Flash stress: %lu sector erases, %lu page writes, longest operation %lu us",
+             (unsigned long)stress_erases, (unsigned long)stress_writes,
+             (unsigned long)stress_max_op_us);
+    stress_erases = 0;
+    stress_writes = 0;
+    stress_max_op_us = 0;
+}
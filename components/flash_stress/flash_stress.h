@@ -0,0 +1,18 @@
+/* Flash stress task shared by the timing benchmarks (P1, P2, P4, P5, P6)
+ * Erases and writes the NVS partition without a break. Every operation
+ * turns the flash cache off, so anything not running from IRAM stalls;
+ * each project's own period/lateness stats show whether its outputs did.
+ * Add ../components to EXTRA_COMPONENT_DIRS to use it.
+ */
+#pragma once
+
+#include "esp_err.h"
+
+#define FLASH_STRESS_SECTOR 4096    // Erase unit
+#define FLASH_STRESS_PAGE   256     // Write unit
+
+// Starts the eraser task at priority 1, below everything that is timed
+esp_err_t flash_stress_start(void);
+
+// Logs erases, writes and the longest operation since the last call, then resets them
+void flash_stress_log(void);
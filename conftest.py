@@ -0,0 +1,61 @@
+"""Shared fixtures for the QEMU end-to-end tests (Project_N/pytest_project_N.py)
+
+Each project's firmware is built with -DQEMU_TEST=1 and booted under
+Espressif's QEMU by pytest-embedded. QEMU has no pins or LEDC to probe, so
+the tests follow the firmware's own log: ESP_LOGx lines carry a millisecond
+timestamp, and the on-device stats lines report what the ISRs measured.
+"""
+import re
+
+import pytest
+
+# Budgets below are for QEMU on an idle host. Scale them with
+# --timing-slack on a loaded CI runner rather than editing the tests.
+BOOT_BUDGET_MS = 1000           # Reset to app_main()
+TICK_MS = 10                    # CONFIG_FREERTOS_HZ 100: log timestamps step in ticks
+
+# "I (1234) TAG: message", after any colour escape
+LOG_PREFIX = rb'[IWE] \((\d+)\) '
+
+
+def pytest_addoption(parser):
+    parser.addoption('--timing-slack', type=float, default=1.0,
+                     help='Multiply every timing budget by this factor')
+
+
+class LogClock:
+    """Waits for firmware log lines and returns their timestamps."""
+
+    def __init__(self, dut, slack):
+        self.dut = dut
+        self.slack = slack
+
+    def expect(self, tag, message, timeout=30):
+        """Next "tag: message" line (message is a regex); returns (ms, match)."""
+        pattern = LOG_PREFIX + re.escape(tag).encode() + rb': ' + message.encode()
+        match = self.dut.expect(re.compile(pattern), timeout=timeout)
+        return int(match.group(1)), match
+
+    def expect_all(self, tag, message, count, timeout=30):
+        """The next count matching lines, as (ms, match) pairs."""
+        return [self.expect(tag, message, timeout) for _ in range(count)]
+
+    def budget(self, value):
+        return value * self.slack
+
+    def check_boot(self):
+        """Boot-time regression check: reset to app_main()."""
+        ms, _ = self.expect('main_task', r'Calling app_main\(\)')
+        assert ms <= self.budget(BOOT_BUDGET_MS), f'app_main() reached at {ms} ms'
+        return ms
+
+    def check_period(self, times, period_ms, tolerance_ms=TICK_MS):
+        """Every interval between timestamps is period_ms within the tolerance."""
+        for a, b in zip(times, times[1:]):
+            assert abs((b - a) - period_ms) <= self.budget(tolerance_ms), \
+                f'interval {b - a} ms at {b} ms, expected {period_ms} ms'
+
+
+@pytest.fixture
+def log(dut, request):
+    return LogClock(dut, request.config.getoption('--timing-slack'))